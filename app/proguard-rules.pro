@@ -18,3 +18,12 @@
 
 # Suppress warnings for other classes referenced in the error logs
 -dontwarn org.tritonus.share.sampled.**
+
+# Classes constructed or called by name from native code (native-lib.cpp)
+-keep class com.waltermelon.vibedict.data.FullTextHit { <init>(...); }
+-keep class com.waltermelon.vibedict.data.Deinflection { <init>(...); }
+-keep class com.waltermelon.vibedict.data.TextSegment { <init>(...); }
+-keep class com.waltermelon.vibedict.data.EntryMeta { <init>(...); }
+-keep class com.waltermelon.vibedict.data.DamagedBlock { <init>(...); }
+-keep class com.waltermelon.vibedict.data.ScrubReport { <init>(...); }
+-keep interface com.waltermelon.vibedict.data.MdictEngine$ProgressListener { *; }
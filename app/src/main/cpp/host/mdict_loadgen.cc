@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+/**
+ * mdict-loadgen: drives an mdictd with concurrent pipelined requests and
+ * reports the throughput and latency distribution
+ *
+ *   mdict-loadgen [-s socket] [-c connections] [-p pipeline] [-d seconds]
+ *                 [-o lookup|suggest|fulltext] [-D dict] [-w words.txt]
+ *
+ *#| every connection keeps `pipeline` requests outstanding for the whole
+ *   run, so the daemon sees connections x pipeline concurrent requests
+ *#| words are picked at random from the word file, or from keys sampled
+ *   with SUGGEST requests over two-letter prefixes when there is none
+ *#| latency is measured per request, from writing it to reading its
+ *   response
+ */
+
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "mdictd_protocol.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string socket_path = "/tmp/mdictd.sock";
+  unsigned connections = 8;
+  unsigned pipeline = 4;
+  double seconds = 10;
+  uint8_t op = mdictd::OP_LOOKUP;
+  uint16_t dict = 0;
+  std::string word_file;
+};
+
+struct Stats {
+  // microseconds per completed request
+  std::vector<uint32_t> latencies;
+  uint64_t not_found = 0;
+  uint64_t errors = 0;
+  bool failed = false;
+};
+
+int connect_to(const std::string &path) {
+  sockaddr_un addr{};
+  if (path.size() >= sizeof(addr.sun_path)) return -1;
+  addr.sun_family = AF_UNIX;
+  std::strcpy(addr.sun_path, path.c_str());
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+  if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// one request, waiting for its response
+bool call(int fd, uint8_t op, uint16_t dict, const std::string &payload,
+          mdictd::response &resp) {
+  std::string frame = mdictd::encode_request(0, op, dict, payload);
+  std::string body;
+  return mdictd::write_full(fd, frame.data(), frame.size()) &&
+         mdictd::read_frame(fd, body) && mdictd::decode_response(body, resp);
+}
+
+std::vector<std::string> sample_words(int fd, uint16_t dict) {
+  std::vector<std::string> words;
+  mdictd::response resp;
+  for (char a = 'a'; a <= 'z'; ++a) {
+    for (char b = 'a'; b <= 'z'; ++b) {
+      if (!call(fd, mdictd::OP_SUGGEST, dict, std::string{a, b}, resp)) return words;
+      for (std::string &w : resp.items) words.push_back(std::move(w));
+    }
+  }
+  std::sort(words.begin(), words.end());
+  words.erase(std::unique(words.begin(), words.end()), words.end());
+  return words;
+}
+
+void drive(const Options &opts, const std::vector<std::string> &words,
+           Clock::time_point deadline, unsigned seed, Stats &stats) {
+  int fd = connect_to(opts.socket_path);
+  if (fd < 0) {
+    stats.failed = true;
+    return;
+  }
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<size_t> pick(0, words.size() - 1);
+  std::unordered_map<uint32_t, Clock::time_point> sent;
+  uint32_t next_id = 0;
+
+  auto send_one = [&]() {
+    uint32_t id = next_id++;
+    std::string frame = mdictd::encode_request(id, opts.op, opts.dict, words[pick(rng)]);
+    sent[id] = Clock::now();
+    return mdictd::write_full(fd, frame.data(), frame.size());
+  };
+
+  bool ok = true;
+  for (unsigned i = 0; i < opts.pipeline && ok; ++i) ok = send_one();
+  std::string body;
+  mdictd::response resp;
+  while (ok && !sent.empty()) {
+    if (!mdictd::read_frame(fd, body) || !mdictd::decode_response(body, resp)) {
+      ok = false;
+      break;
+    }
+    Clock::time_point now = Clock::now();
+    auto it = sent.find(resp.id);
+    if (it == sent.end()) {
+      ok = false;
+      break;
+    }
+    stats.latencies.push_back((uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                                  now - it->second).count());
+    sent.erase(it);
+    if (resp.status == mdictd::STATUS_NOT_FOUND) {
+      ++stats.not_found;
+    } else if (resp.status != mdictd::STATUS_OK) {
+      ++stats.errors;
+    }
+    if (now < deadline) ok = send_one();
+  }
+  if (!ok) stats.failed = true;
+  close(fd);
+}
+
+uint32_t percentile(const std::vector<uint32_t> &sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(i, sorted.size() - 1)];
+}
+
+void usage() {
+  std::fprintf(stderr,
+               "usage: mdict-loadgen [-s socket] [-c connections] [-p pipeline] [-d seconds]\n"
+               "                     [-o lookup|suggest|fulltext] [-D dict] [-w words.txt]\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opts;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:c:p:d:o:D:w:h")) != -1) {
+    switch (opt) {
+      case 's':
+        opts.socket_path = optarg;
+        break;
+      case 'c':
+        opts.connections = std::max(1, std::atoi(optarg));
+        break;
+      case 'p':
+        opts.pipeline = std::max(1, std::atoi(optarg));
+        break;
+      case 'd':
+        opts.seconds = std::max(0.1, std::atof(optarg));
+        break;
+      case 'o':
+        if (std::strcmp(optarg, "lookup") == 0) {
+          opts.op = mdictd::OP_LOOKUP;
+        } else if (std::strcmp(optarg, "suggest") == 0) {
+          opts.op = mdictd::OP_SUGGEST;
+        } else if (std::strcmp(optarg, "fulltext") == 0) {
+          opts.op = mdictd::OP_FULLTEXT;
+        } else {
+          usage();
+          return 2;
+        }
+        break;
+      case 'D':
+        opts.dict = (uint16_t)std::atoi(optarg);
+        break;
+      case 'w':
+        opts.word_file = optarg;
+        break;
+      default:
+        usage();
+        return opt == 'h' ? 0 : 2;
+    }
+  }
+
+  int fd = connect_to(opts.socket_path);
+  if (fd < 0) {
+    std::fprintf(stderr, "mdict-loadgen: cannot connect to %s\n", opts.socket_path.c_str());
+    return 1;
+  }
+  mdictd::response resp;
+  if (!call(fd, mdictd::OP_LIST, 0, "", resp) || opts.dict >= resp.items.size()) {
+    std::fprintf(stderr, "mdict-loadgen: no dictionary %u\n", opts.dict);
+    close(fd);
+    return 1;
+  }
+  std::string dict_name = resp.items[opts.dict];
+  std::vector<std::string> words;
+  if (!opts.word_file.empty()) {
+    std::ifstream in(opts.word_file);
+    for (std::string line; std::getline(in, line);) {
+      if (!line.empty()) words.push_back(line);
+    }
+  } else {
+    words = sample_words(fd, opts.dict);
+  }
+  close(fd);
+  if (words.empty()) {
+    std::fprintf(stderr, "mdict-loadgen: no words to send, pass a word file with -w\n");
+    return 1;
+  }
+  std::fprintf(stderr, "mdict-loadgen: %s, %zu words, %u connections x %u in flight, %.1f s\n",
+               dict_name.c_str(), words.size(), opts.connections, opts.pipeline, opts.seconds);
+
+  std::vector<Stats> stats(opts.connections);
+  std::vector<std::thread> threads;
+  Clock::time_point start = Clock::now();
+  Clock::time_point deadline =
+      start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opts.seconds));
+  for (unsigned i = 0; i < opts.connections; ++i) {
+    threads.emplace_back(drive, std::cref(opts), std::cref(words), deadline, i + 1,
+                         std::ref(stats[i]));
+  }
+  for (std::thread &t : threads) t.join();
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::vector<uint32_t> all;
+  uint64_t not_found = 0, errors = 0;
+  unsigned failed = 0;
+  for (Stats &s : stats) {
+    all.insert(all.end(), s.latencies.begin(), s.latencies.end());
+    not_found += s.not_found;
+    errors += s.errors;
+    failed += s.failed;
+  }
+  std::sort(all.begin(), all.end());
+
+  std::printf("requests   %zu (%llu not found, %llu errors)\n", all.size(),
+              (unsigned long long)not_found, (unsigned long long)errors);
+  std::printf("throughput %.0f req/s\n", all.size() / elapsed);
+  std::printf("latency us p50 %u  p90 %u  p99 %u  p99.9 %u  max %u\n", percentile(all, 0.5),
+              percentile(all, 0.9), percentile(all, 0.99), percentile(all, 0.999),
+              all.empty() ? 0 : all.back());
+  if (failed) std::printf("connections lost %u\n", failed);
+  return failed ? 1 : 0;
+}
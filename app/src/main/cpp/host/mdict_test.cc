@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+/**
+ * mdict-test: checks of the engine pieces that need no dictionary file,
+ * run by ctest on the host build
+ *
+ *#| key folding tables (width, case, accents, kana)
+ *#| full-text query parsing
+ *#| the regex literal prefilter never rejects a record the regex matches
+ *#| japanese deinflection
+ *
+ * prints every failed check and exits non-zero if there was one
+ */
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "definition_search.h"
+#include "deinflector.h"
+#include "key_fold.h"
+#include "text_query.h"
+#include "text_regex.h"
+
+using namespace mdict;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                        \
+  do {                                                                     \
+    if (!(cond)) {                                                         \
+      std::fprintf(stderr, "%s:%d: failed: %s\n", __FILE__, __LINE__, #cond); \
+      ++failures;                                                          \
+    }                                                                      \
+  } while (0)
+
+static bool matches(text_query &query, const std::string &text) {
+  return query.find(text.data(), text.size(), nullptr);
+}
+
+static bool matches(text_regex &re, const std::string &text) {
+  return re.find(text.data(), text.size(), nullptr);
+}
+
+/***************************************
+ *            key folding              *
+ ***************************************/
+
+static void test_fold() {
+  // full-width latin, case and accents
+  CHECK(fold_key("Ｅｃｏｌｅ") == "ecole");
+  CHECK(fold_key("École") == "ecole");
+  CHECK(fold_key("ÉCLAIR") == fold_key("eclair"));
+  // full case folding expands
+  CHECK(fold_key("ß") == "ss");
+  CHECK(fold_key("Straße") == fold_key("STRASSE"));
+  // katakana to hiragana, half-width kana with its voicing mark composed
+  CHECK(fold_key("ガ") == "が");
+  CHECK(fold_key("ｶﾞｯｺｳ") == fold_key("がっこう"));
+  // punctuation is ignored
+  CHECK(fold_key("a priori") == fold_key("a-priori"));
+  CHECK(fold_key("...").empty());
+
+  // strict folding keeps accents and kana apart
+  CHECK(fold_key("Ｅｃｏｌｅ", KEY_FOLD_STRICT) == "ecole");
+  CHECK(fold_key("École", KEY_FOLD_STRICT) != fold_key("Ecole", KEY_FOLD_STRICT));
+  CHECK(fold_key("ガ", KEY_FOLD_STRICT) != fold_key("が", KEY_FOLD_STRICT));
+
+  // the folders are built once per mode
+  CHECK(&KeyFolder::get(KEY_FOLD_LOOSE) == &KeyFolder::get(KEY_FOLD_LOOSE));
+  CHECK(KeyFolder::get(KEY_FOLD_CASE).mode() == KEY_FOLD_CASE);
+}
+
+/***************************************
+ *          query parsing              *
+ ***************************************/
+
+static void test_query() {
+  text_query words("apple banana");
+  CHECK(words.term_count() == 2);
+  CHECK(matches(words, "<b>banana</b> and apple"));
+  CHECK(!matches(words, "apple only"));
+
+  text_query either("apple OR banana");
+  CHECK(either.term_count() == 2);
+  CHECK(matches(either, "a banana"));
+  CHECK(!matches(either, "a cherry"));
+
+  // NOT and a leading - exclude a term
+  text_query without("fruit -cherry");
+  CHECK(matches(without, "a fruit"));
+  CHECK(!matches(without, "a cherry fruit"));
+  text_query without_kw("fruit NOT cherry");
+  CHECK(!matches(without_kw, "a cherry fruit"));
+
+  // a phrase is one term
+  text_query phrase("\"quick brown\" fox");
+  CHECK(phrase.term_count() == 2);
+  CHECK(matches(phrase, "the quick  brown fox"));
+  CHECK(!matches(phrase, "the quick red brown fox"));
+
+  // keywords only count in upper case
+  text_query lower("cats and dogs");
+  CHECK(lower.term_count() == 3);
+  CHECK(!matches(lower, "cats, dogs"));
+
+  // parentheses group
+  text_query grouped("(apple OR pear) tart");
+  CHECK(matches(grouped, "pear tart"));
+  CHECK(!matches(grouped, "apple pie"));
+
+  // terms are folded like the text, tags and entities are not text
+  text_query folded("ÉCOLE");
+  CHECK(matches(folded, "<i>&eacute;cole</i>"));
+  text_query tag("div");
+  CHECK(!matches(tag, "<div>text</div>"));
+
+  CHECK(text_query("").empty());
+
+  std::string many;
+  for (size_t i = 0; i <= text_query::MAX_TERMS; ++i) many += "w" + std::to_string(i) + " ";
+  bool threw = false;
+  try {
+    text_query too_many(many);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  CHECK(threw);
+}
+
+/***************************************
+ *      regex and its prefilter        *
+ ***************************************/
+
+static void test_regex_prefilter() {
+  const std::vector<std::string> patterns = {
+      "colou?r",     "(cat|dog)s",          "^apple", "apple",
+      "n\\. .*fruit", "[0-9]+ kg",           "\\bpear\\b", "qu(ick|ack)ly",
+      "a.c",         "(?:red|green) apple", "x*",     "é.?clair",
+      "fruit$",      "ban(an)+a",           "\\d{2,3}", "(ab|cd)(ef|gh)",
+  };
+  const std::vector<std::string> texts = {
+      "<b>apple</b> <i>n.</i> a round fruit",
+      "The colour red",
+      "two cats and a dog",
+      "dogs",
+      "12 kg of pears",
+      "a pear, a peach",
+      "quickly, quackly",
+      "abc",
+      "a green apple",
+      "Éclair au chocolat",
+      "&eacute;clair",
+      "banananana",
+      "7 kg",
+      "cdgh abef",
+      "",
+      "nothing to see",
+  };
+  for (const std::string &pattern : patterns) {
+    text_regex re(pattern);
+    text_query filter = text_query::all_of(re.required_literals());
+    definition_matcher matcher = definition_matcher::regex(pattern);
+    for (const std::string &text : texts) {
+      bool regex_hit = matches(re, text);
+      // a record the regex matches always passes its prefilter
+      if (regex_hit && !filter.empty() && !matches(filter, text)) {
+        std::fprintf(stderr, "prefilter of /%s/ rejects \"%s\"\n", pattern.c_str(),
+                     text.c_str());
+        ++failures;
+      }
+      // and the matcher, prefilter then regex, agrees with the regex alone
+      if (matcher.find(text.data(), text.size(), nullptr) != regex_hit) {
+        std::fprintf(stderr, "matcher and /%s/ disagree on \"%s\"\n", pattern.c_str(),
+                     text.c_str());
+        ++failures;
+      }
+    }
+  }
+
+  text_regex color("colou?r");
+  CHECK(matches(color, "COLOR"));
+  CHECK(!matches(color, "colouur"));
+  // ^ is the start of the text, tags are not text
+  text_regex anchored("^apple");
+  CHECK(matches(anchored, "<b>apple</b> pie"));
+  CHECK(!matches(anchored, "an apple"));
+
+  bool threw = false;
+  try {
+    text_regex backreference("(a)\\1");
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  CHECK(threw);
+}
+
+/***************************************
+ *           deinflection              *
+ ***************************************/
+
+static bool deinflects_to(const std::string &word, const std::string &term) {
+  for (const deinflection &d : Deinflector::shared().deinflect(word)) {
+    if (d.term == term) return true;
+  }
+  return false;
+}
+
+static void test_deinflect() {
+  CHECK(deinflects_to("食べた", "食べる"));
+  CHECK(deinflects_to("食べさせられた", "食べる"));
+  CHECK(deinflects_to("行かなかった", "行く"));
+  CHECK(deinflects_to("書いて", "書く"));
+  CHECK(deinflects_to("見ました", "見る"));
+  CHECK(deinflects_to("高くない", "高い"));
+  CHECK(deinflects_to("来た", "来る"));
+  CHECK(deinflects_to("勉強した", "勉強する"));
+  CHECK(!deinflects_to("食べる", "食べる"));
+}
+
+int main() {
+  test_fold();
+  test_query();
+  test_regex_prefilter();
+  test_deinflect();
+  if (failures > 0) {
+    std::fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+/**
+ * mdictd: keeps dictionaries open and warm and serves them to local clients
+ * over a Unix domain socket, see mdictd_protocol.h for the wire format
+ *
+ *   mdictd [-s socket] [-w workers] [-i index_dir] [-c cache_mib] dict.mdx...
+ *
+ *#| every dictionary is opened and indexed once at startup; name.mdd,
+ *   name.1.mdd, ... next to name.mdx are its resource volumes
+ *#| each connection has a reader thread that only parses frames; requests
+ *   run on a worker pool through the engine's concurrent read path, so one
+ *   slow request (a full-text scan) does not hold up the lookups pipelined
+ *   behind it
+ *#| full-text searches fan out over the engine's shared pool, the request
+ *   workers are a separate pool so a search waiting on its blocks never
+ *   occupies the threads those blocks need
+ */
+
+#include <getopt.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/definition_search.h"
+#include "include/mdict.h"
+#include "include/resource_set.h"
+#include "include/task_pool.h"
+#include "mdictd_protocol.h"
+
+namespace {
+
+// requests of one connection queued or running before its reader waits
+constexpr size_t MAX_IN_FLIGHT = 256;
+// full-text hits per request
+constexpr size_t FULLTEXT_LIMIT = 100;
+// a client that does not read its responses for this long is dropped
+constexpr int SEND_TIMEOUT_SECONDS = 10;
+
+struct Dictionary {
+  std::string name;
+  std::unique_ptr<mdict::Mdict> mdx;
+  std::vector<std::unique_ptr<mdict::Mdict>> volumes;
+  std::unique_ptr<mdict::ResourceSet> resources;
+};
+
+// loaded before the socket opens, read-only afterwards
+std::vector<Dictionary> dictionaries;
+
+std::string socket_path;
+
+/**
+ * a client connection, shared by its reader thread and its queued requests;
+ * the socket closes when the last of them lets go
+ */
+class Connection {
+ public:
+  explicit Connection(int fd) : fd_(fd) {}
+  ~Connection() { close(fd_); }
+
+  int fd() const { return fd_; }
+
+  // wait for room for one more request
+  void acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    room_.wait(lock, [this] { return in_flight_ < MAX_IN_FLIGHT; });
+    ++in_flight_;
+  }
+
+  void release() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --in_flight_;
+    }
+    room_.notify_one();
+  }
+
+  // write a response frame whole, responses of concurrent requests never
+  // interleave
+  void send(const std::string &frame) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (closed_) return;
+    if (!mdictd::write_full(fd_, frame.data(), frame.size())) {
+      // wakes the reader, the connection goes once the queued requests finish
+      closed_ = true;
+      shutdown(fd_, SHUT_RDWR);
+    }
+  }
+
+  bool closed() const { return closed_; }
+
+ private:
+  int fd_;
+  std::mutex mutex_;
+  std::condition_variable room_;
+  size_t in_flight_ = 0;
+  std::mutex write_mutex_;
+  std::atomic<bool> closed_{false};
+};
+
+bool file_exists(const std::string &path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+std::string base_name(const std::string &path) {
+  size_t slash = path.find_last_of('/');
+  std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+  size_t dot = name.find_last_of('.');
+  return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+/**
+ * open a dictionary and its resource volumes and build what the first
+ * requests would otherwise wait for
+ * @throws std::runtime_error if the .mdx cannot be opened
+ */
+Dictionary load_dictionary(const std::string &path, const std::string &index_dir) {
+  Dictionary d;
+  d.name = base_name(path);
+  d.mdx.reset(new mdict::Mdict(path));
+  d.mdx->init();
+
+  std::string stem = path.substr(0, path.size() - 4);
+  std::vector<std::string> volume_paths;
+  if (file_exists(stem + ".mdd")) volume_paths.push_back(stem + ".mdd");
+  for (int i = 1; file_exists(stem + "." + std::to_string(i) + ".mdd"); ++i) {
+    volume_paths.push_back(stem + "." + std::to_string(i) + ".mdd");
+  }
+  std::vector<mdict::Mdict *> volumes;
+  for (const std::string &v : volume_paths) {
+    std::unique_ptr<mdict::Mdict> mdd(new mdict::Mdict(v));
+    try {
+      mdd->init();
+    } catch (const std::exception &e) {
+      std::fprintf(stderr, "mdictd: skipping %s: %s\n", v.c_str(), e.what());
+      continue;
+    }
+    volumes.push_back(mdd.get());
+    d.volumes.push_back(std::move(mdd));
+  }
+  if (!volumes.empty()) d.resources.reset(new mdict::ResourceSet(volumes));
+
+  if (!index_dir.empty()) {
+    d.mdx->set_index_dir(index_dir + "/" + d.name);
+    d.mdx->start_index_build(mdict::INDEX_NGRAM | mdict::INDEX_BLOCK_SKETCH |
+                             mdict::INDEX_KEY_FILTER);
+  }
+  // the folded key index behind suggest and the accent-insensitive lookup
+  if (d.mdx->entry_count() > 0) d.mdx->suggest(d.mdx->entry_key(0).substr(0, 1));
+  return d;
+}
+
+void fulltext(const mdictd::request &req, const Connection &conn,
+              std::vector<std::string> &items) {
+  std::vector<mdict::Mdict *> dicts;
+  std::vector<size_t> origin;
+  for (size_t i = 0; i < dictionaries.size(); ++i) {
+    if (req.dict == mdictd::ALL_DICTS || req.dict == i) {
+      dicts.push_back(dictionaries[i].mdx.get());
+      origin.push_back(i);
+    }
+  }
+  mdict::definition_matcher matcher = mdict::definition_matcher::fulltext(req.payload);
+  mdict::SearchScheduler scheduler(dicts, matcher, FULLTEXT_LIMIT);
+  // a client that stopped taking responses cancels its search
+  for (mdict::dictionary_hit &hit : scheduler.run(nullptr, [&conn] { return conn.closed(); })) {
+    items.push_back(std::to_string(origin[hit.dict]));
+    items.push_back(std::move(hit.hit.key));
+    items.push_back(std::move(hit.hit.snippet));
+  }
+}
+
+uint8_t handle(const mdictd::request &req, const Connection &conn,
+               std::vector<std::string> &items) {
+  if (req.op == mdictd::OP_LIST) {
+    for (const Dictionary &d : dictionaries) items.push_back(d.name);
+    return mdictd::STATUS_OK;
+  }
+  bool all = req.op == mdictd::OP_FULLTEXT && req.dict == mdictd::ALL_DICTS;
+  if (!all && req.dict >= dictionaries.size()) return mdictd::STATUS_BAD_REQUEST;
+
+  switch (req.op) {
+    case mdictd::OP_LOOKUP:
+      items = dictionaries[req.dict].mdx->lookup(req.payload);
+      break;
+    case mdictd::OP_SUGGEST:
+      items = dictionaries[req.dict].mdx->suggest(req.payload);
+      break;
+    case mdictd::OP_FULLTEXT:
+      fulltext(req, conn, items);
+      break;
+    case mdictd::OP_RESOURCE: {
+      const Dictionary &d = dictionaries[req.dict];
+      uint32_t volume, entry;
+      if (d.resources && d.resources->find(req.payload, volume, entry)) {
+        items.push_back(d.volumes[volume]->entry_record(entry));
+      }
+      break;
+    }
+    default:
+      return mdictd::STATUS_BAD_REQUEST;
+  }
+  return items.empty() ? mdictd::STATUS_NOT_FOUND : mdictd::STATUS_OK;
+}
+
+void run_request(const mdictd::request &req, Connection &conn) {
+  std::vector<std::string> items;
+  uint8_t status;
+  try {
+    status = handle(req, conn, items);
+  } catch (const std::invalid_argument &e) {
+    status = mdictd::STATUS_BAD_REQUEST;
+    items.assign(1, e.what());
+  } catch (const std::exception &e) {
+    status = mdictd::STATUS_ERROR;
+    items.assign(1, e.what());
+  }
+  conn.send(mdictd::encode_response(req.id, status, items));
+}
+
+void serve(std::shared_ptr<Connection> conn, mdict::TaskPool &pool) {
+  std::string body;
+  mdictd::request req;
+  while (!conn->closed() && mdictd::read_frame(conn->fd(), body)) {
+    if (!mdictd::decode_request(body, req)) break;
+    conn->acquire();
+    pool.submit(mdict::TaskLane::INTERACTIVE, [conn, req]() {
+      run_request(req, *conn);
+      conn->release();
+    });
+  }
+  // the responses still owed to a client that only closed its write side
+  // are written by the queued requests, which hold the connection
+}
+
+void on_signal(int) {
+  unlink(socket_path.c_str());
+  _exit(0);
+}
+
+int listen_on(const std::string &path) {
+  sockaddr_un addr{};
+  if (path.size() >= sizeof(addr.sun_path)) {
+    std::fprintf(stderr, "mdictd: socket path too long\n");
+    return -1;
+  }
+  addr.sun_family = AF_UNIX;
+  std::strcpy(addr.sun_path, path.c_str());
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+  // a socket left by a daemon that did not exit cleanly
+  unlink(path.c_str());
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    std::perror("mdictd: bind");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void usage() {
+  std::fprintf(stderr,
+               "usage: mdictd [-s socket] [-w workers] [-i index_dir] [-c cache_mib] dict.mdx...\n"
+               "  -s  socket path (default /tmp/mdictd.sock)\n"
+               "  -w  request worker threads (default: number of cores)\n"
+               "  -i  build and keep full-text and key filter indexes here\n"
+               "  -c  MiB of decompressed record blocks kept for lookups (default 32)\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  socket_path = "/tmp/mdictd.sock";
+  unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+  std::string index_dir;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:w:i:c:h")) != -1) {
+    switch (opt) {
+      case 's':
+        socket_path = optarg;
+        break;
+      case 'w':
+        workers = std::max(1, std::atoi(optarg));
+        break;
+      case 'i':
+        index_dir = optarg;
+        break;
+      case 'c':
+        mdict::BlockCache::shared().set_budget(static_cast<size_t>(std::max(0, std::atoi(optarg)))
+                                               << 20);
+        break;
+      default:
+        usage();
+        return opt == 'h' ? 0 : 2;
+    }
+  }
+  if (optind >= argc) {
+    usage();
+    return 2;
+  }
+
+  for (int i = optind; i < argc; ++i) {
+    try {
+      dictionaries.push_back(load_dictionary(argv[i], index_dir));
+      const Dictionary &d = dictionaries.back();
+      std::fprintf(stderr, "mdictd: [%zu] %s, %zu entries, %zu resource volumes\n",
+                   dictionaries.size() - 1, d.name.c_str(), d.mdx->entry_count(),
+                   d.volumes.size());
+    } catch (const std::exception &e) {
+      std::fprintf(stderr, "mdictd: cannot open %s: %s\n", argv[i], e.what());
+    }
+  }
+  if (dictionaries.empty() || dictionaries.size() >= mdictd::ALL_DICTS) return 1;
+
+  int listen_fd = listen_on(socket_path);
+  if (listen_fd < 0) return 1;
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  std::fprintf(stderr, "mdictd: listening on %s, %u workers\n", socket_path.c_str(), workers);
+
+  mdict::TaskPool pool(workers, 1);
+  for (;;) {
+    int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      std::perror("mdictd: accept");
+      break;
+    }
+    timeval timeout{SEND_TIMEOUT_SECONDS, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    std::thread(serve, std::make_shared<Connection>(fd), std::ref(pool)).detach();
+  }
+  unlink(socket_path.c_str());
+  return 1;
+}
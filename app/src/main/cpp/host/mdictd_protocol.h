@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * wire protocol of mdictd, the host lookup daemon
+ *
+ *#| frames are length prefixed, all integers little-endian. The length
+ *   counts the bytes after itself
+ *#| request:  u32 length | u32 id | u8 op | u8 0 | u16 dict | payload
+ *#| response: u32 length | u32 id | u8 status | u8 0 | u16 0 | u32 count |
+ *   count x (u32 length | bytes)
+ *#| a client may pipeline any number of requests on one connection; they
+ *   run concurrently and their responses come back in completion order,
+ *   matched by id
+ *#| the payload is the UTF-8 word, prefix, query or resource path; dict is
+ *   the index in the LIST response
+ */
+
+namespace mdictd {
+
+enum op : uint8_t {
+  // dictionary titles, dict and payload ignored
+  OP_LIST = 0,
+  // every definition of the payload word
+  OP_LOOKUP = 1,
+  // keys starting with the payload
+  OP_SUGGEST = 2,
+  // full-text search, three strings per hit: dict index (decimal), key,
+  // snippet; dict ALL_DICTS searches every dictionary
+  OP_FULLTEXT = 3,
+  // the bytes of a resource of the dictionary's MDD volumes
+  OP_RESOURCE = 4,
+};
+
+enum status : uint8_t {
+  STATUS_OK = 0,
+  STATUS_NOT_FOUND = 1,
+  STATUS_BAD_REQUEST = 2,
+  STATUS_ERROR = 3,
+};
+
+constexpr uint16_t ALL_DICTS = 0xffff;
+
+// bytes after the length of a request and of a response before its strings
+constexpr size_t REQUEST_HEADER = 8;
+constexpr size_t RESPONSE_HEADER = 12;
+
+// larger frames are refused, the connection is dropped
+constexpr uint32_t MAX_FRAME = 64u << 20;
+
+inline void put_u16(std::string &out, uint16_t v) {
+  out.push_back((char)(v & 0xff));
+  out.push_back((char)(v >> 8));
+}
+
+inline void put_u32(std::string &out, uint32_t v) {
+  for (int i = 0; i < 4; ++i) out.push_back((char)((v >> (8 * i)) & 0xff));
+}
+
+inline uint16_t get_u16(const char *p) {
+  return (uint16_t)((uint8_t)p[0] | (uint8_t)p[1] << 8);
+}
+
+inline uint32_t get_u32(const char *p) {
+  return (uint32_t)(uint8_t)p[0] | (uint32_t)(uint8_t)p[1] << 8 |
+         (uint32_t)(uint8_t)p[2] << 16 | (uint32_t)(uint8_t)p[3] << 24;
+}
+
+struct request {
+  uint32_t id = 0;
+  uint8_t op = 0;
+  uint16_t dict = 0;
+  std::string payload;
+};
+
+struct response {
+  uint32_t id = 0;
+  uint8_t status = STATUS_OK;
+  std::vector<std::string> items;
+};
+
+inline std::string encode_request(uint32_t id, uint8_t op, uint16_t dict,
+                                  std::string_view payload) {
+  std::string out;
+  out.reserve(4 + REQUEST_HEADER + payload.size());
+  put_u32(out, (uint32_t)(REQUEST_HEADER + payload.size()));
+  put_u32(out, id);
+  out.push_back((char)op);
+  out.push_back('\0');
+  put_u16(out, dict);
+  out.append(payload);
+  return out;
+}
+
+inline std::string encode_response(uint32_t id, uint8_t status,
+                                   const std::vector<std::string> &items) {
+  size_t size = RESPONSE_HEADER;
+  for (const std::string &s : items) size += 4 + s.size();
+  std::string out;
+  out.reserve(4 + size);
+  put_u32(out, (uint32_t)size);
+  put_u32(out, id);
+  out.push_back((char)status);
+  out.append(3, '\0');
+  put_u32(out, (uint32_t)items.size());
+  for (const std::string &s : items) {
+    put_u32(out, (uint32_t)s.size());
+    out.append(s);
+  }
+  return out;
+}
+
+// a frame body (after the length) into a request, false if malformed
+inline bool decode_request(const std::string &body, request &req) {
+  if (body.size() < REQUEST_HEADER) return false;
+  req.id = get_u32(body.data());
+  req.op = (uint8_t)body[4];
+  req.dict = get_u16(body.data() + 6);
+  req.payload.assign(body, REQUEST_HEADER, std::string::npos);
+  return true;
+}
+
+inline bool decode_response(const std::string &body, response &resp) {
+  if (body.size() < RESPONSE_HEADER) return false;
+  resp.id = get_u32(body.data());
+  resp.status = (uint8_t)body[4];
+  uint32_t count = get_u32(body.data() + 8);
+  resp.items.clear();
+  size_t pos = RESPONSE_HEADER;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (body.size() - pos < 4) return false;
+    uint32_t len = get_u32(body.data() + pos);
+    pos += 4;
+    if (body.size() - pos < len) return false;
+    resp.items.emplace_back(body, pos, len);
+    pos += len;
+  }
+  return pos == body.size();
+}
+
+inline bool write_full(int fd, const char *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    data += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+inline bool read_full(int fd, char *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = read(fd, data, len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    data += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+/**
+ * read one frame
+ * @param body receives the bytes after the length
+ * @return false on end of stream, a read error or an oversized frame
+ */
+inline bool read_frame(int fd, std::string &body) {
+  char len[4];
+  if (!read_full(fd, len, 4)) return false;
+  uint32_t size = get_u32(len);
+  if (size > MAX_FRAME) return false;
+  body.resize(size);
+  return size == 0 || read_full(fd, &body[0], size);
+}
+
+}  // namespace mdictd
@@ -0,0 +1,570 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/affix_stemmer.h"
+
+#include <algorithm>
+#include <cwctype>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "include/html_text.h"
+#include "include/mdict_log.h"
+
+#define LOG_TAG "MdictJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+namespace mdict {
+
+/***************************************
+ *              encoding               *
+ ***************************************/
+
+static std::string upper_ascii(std::string s) {
+  for (char &c : s) {
+    if (c >= 'a' && c <= 'z') c -= 32;
+  }
+  return s;
+}
+
+static bool valid_utf8(const std::string &s) {
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(s.data());
+  const unsigned char *end = p + s.size();
+  while (p < end) {
+    char32_t cp;
+    size_t n = decode_utf8(p, end, cp);
+    if (cp == 0xFFFD && n == 1) return false;
+    p += n;
+  }
+  return true;
+}
+
+// value of the SET line, empty if the affix file has none
+static std::string affix_encoding(const std::string &aff) {
+  size_t pos = 0;
+  while (pos < aff.size()) {
+    size_t eol = aff.find('\n', pos);
+    if (eol == std::string::npos) eol = aff.size();
+    if (aff.compare(pos, 4, "SET ") == 0 || aff.compare(pos, 4, "SET\t") == 0) {
+      std::istringstream line(aff.substr(pos + 4, eol - pos - 4));
+      std::string set;
+      line >> set;
+      return upper_ascii(set);
+    }
+    pos = eol + 1;
+  }
+  return "";
+}
+
+// both files use the affix file's SET, hunspell's default is ISO8859-1 but
+// files without SET are mostly utf-8 nowadays
+static std::string to_utf8(const std::string &bytes, const std::string &set) {
+  size_t skip = bytes.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+  if (set == "UTF-8" || (set.empty() && valid_utf8(bytes))) {
+    return bytes.substr(skip);
+  }
+  bool latin9 = set == "ISO8859-15" || set == "ISO-8859-15";
+  std::string out;
+  out.reserve(bytes.size() + bytes.size() / 8);
+  for (size_t i = skip; i < bytes.size(); ++i) {
+    char32_t c = static_cast<unsigned char>(bytes[i]);
+    if (latin9) {
+      switch (c) {
+        case 0xA4: c = 0x20AC; break;
+        case 0xA6: c = 0x0160; break;
+        case 0xA8: c = 0x0161; break;
+        case 0xB4: c = 0x017D; break;
+        case 0xB8: c = 0x017E; break;
+        case 0xBC: c = 0x0152; break;
+        case 0xBD: c = 0x0153; break;
+        case 0xBE: c = 0x0178; break;
+      }
+    }
+    append_utf8(out, c);
+  }
+  return out;
+}
+
+static std::u32string to_u32(const std::string &s) {
+  std::u32string out;
+  out.reserve(s.size());
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(s.data());
+  const unsigned char *end = p + s.size();
+  while (p < end) {
+    char32_t cp;
+    p += decode_utf8(p, end, cp);
+    out.push_back(cp);
+  }
+  return out;
+}
+
+static std::string from_u32(const std::u32string &s) {
+  std::string out;
+  out.reserve(s.size());
+  for (char32_t c : s) append_utf8(out, c);
+  return out;
+}
+
+static std::vector<std::string> split_fields(const std::string &line) {
+  std::vector<std::string> fields;
+  size_t i = 0;
+  while (i < line.size()) {
+    while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) ++i;
+    size_t start = i;
+    while (i < line.size() && line[i] != ' ' && line[i] != '\t') ++i;
+    if (i > start) fields.push_back(line.substr(start, i - start));
+  }
+  return fields;
+}
+
+static bool all_digits(const std::string &s) {
+  return !s.empty() && std::all_of(s.begin(), s.end(), [](char c) {
+    return c >= '0' && c <= '9';
+  });
+}
+
+/***************************************
+ *               parser                *
+ ***************************************/
+
+struct AffixStemmer::parser {
+  enum flag_mode { FLAG_CHAR, FLAG_LONG, FLAG_NUM };
+
+  explicit parser(AffixStemmer &self) : self(self) {
+    // flag set 0 is the empty set
+    self.flag_sets_.emplace_back();
+    ids[std::vector<flag_t>()] = 0;
+  }
+
+  AffixStemmer &self;
+  flag_mode mode = FLAG_CHAR;
+  std::vector<uint32_t> flag_aliases;      // AF
+  std::vector<std::string> morph_aliases;  // AM
+  bool af_header = false;
+  bool am_header = false;
+  std::map<std::vector<flag_t>, uint32_t> ids;
+  // entries still expected after a PFX/SFX header, by (is_suffix, flag)
+  std::map<std::pair<bool, flag_t>, std::pair<bool, int>> pending;
+
+  std::vector<flag_t> decode_flags(const std::string &text) const {
+    std::vector<flag_t> flags;
+    if (mode == FLAG_NUM) {
+      flag_t v = 0;
+      bool any = false;
+      for (char c : text) {
+        if (c >= '0' && c <= '9') {
+          v = v * 10 + (c - '0');
+          any = true;
+        } else if (c == ',') {
+          if (any) flags.push_back(v);
+          v = 0;
+          any = false;
+        }
+      }
+      if (any) flags.push_back(v);
+      return flags;
+    }
+    std::u32string chars = to_u32(text);
+    if (mode == FLAG_LONG) {
+      for (size_t i = 0; i + 1 < chars.size(); i += 2) {
+        flags.push_back(((chars[i] & 0xFFFF) << 16) | (chars[i + 1] & 0xFFFF));
+      }
+    } else {
+      flags.assign(chars.begin(), chars.end());
+    }
+    return flags;
+  }
+
+  flag_t single_flag(const std::string &text) const {
+    std::vector<flag_t> flags = decode_flags(text);
+    return flags.empty() ? 0 : flags[0];
+  }
+
+  uint32_t intern(std::vector<flag_t> flags) {
+    std::sort(flags.begin(), flags.end());
+    flags.erase(std::unique(flags.begin(), flags.end()), flags.end());
+    auto it = ids.find(flags);
+    if (it != ids.end()) return it->second;
+    uint32_t id = (uint32_t)self.flag_sets_.size();
+    self.flag_sets_.push_back(flags);
+    ids.emplace(std::move(flags), id);
+    return id;
+  }
+
+  // flags of a word or an affix continuation, possibly an AF alias number
+  uint32_t flag_set(const std::string &text) {
+    if (!flag_aliases.empty() && all_digits(text)) {
+      size_t n = std::stoul(text);
+      if (n >= 1 && n <= flag_aliases.size()) return flag_aliases[n - 1];
+      return 0;
+    }
+    return intern(decode_flags(text));
+  }
+
+  static std::vector<cond_char> compile_condition(const std::u32string &text) {
+    std::vector<cond_char> cond;
+    if (text == U".") return cond;
+    for (size_t i = 0; i < text.size(); ++i) {
+      cond_char c;
+      if (text[i] == '.') {
+        c.any = true;
+      } else if (text[i] == '[') {
+        ++i;
+        if (i < text.size() && text[i] == '^') {
+          c.negate = true;
+          ++i;
+        }
+        while (i < text.size() && text[i] != ']') c.chars.push_back(text[i++]);
+      } else {
+        c.chars.push_back(text[i]);
+      }
+      cond.push_back(std::move(c));
+    }
+    return cond;
+  }
+
+  void affix_line(const std::vector<std::string> &f) {
+    bool suffix = f[0] == "SFX";
+    if (f.size() < 4) return;
+    flag_t flag = single_flag(f[1]);
+    auto key = std::make_pair(suffix, flag);
+    auto it = pending.find(key);
+    if (it == pending.end() || it->second.second <= 0) {
+      // header: PFX flag cross_product count
+      pending[key] = {f[2] == "Y", all_digits(f[3]) ? std::stoi(f[3]) : 0};
+      return;
+    }
+    --it->second.second;
+
+    affix a;
+    a.flag = flag;
+    a.cross = it->second.first;
+    if (f[2] != "0") a.strip = to_u32(f[2]);
+    std::string add = f[3];
+    size_t slash = add.find('/');
+    if (slash != std::string::npos) {
+      a.cont = flag_set(add.substr(slash + 1));
+      add.erase(slash);
+    }
+    if (add != "0") a.add = to_u32(add);
+    a.cond = compile_condition(f.size() > 4 ? to_u32(f[4]) : U".");
+    if (!self.ignore_.empty()) {
+      for (char32_t c : self.ignore_) {
+        a.add.erase(std::remove(a.add.begin(), a.add.end(), c), a.add.end());
+      }
+    }
+
+    std::vector<affix> &list = suffix ? self.suffixes_ : self.prefixes_;
+    auto &index = suffix ? self.suffix_by_add_ : self.prefix_by_add_;
+    size_t &longest = suffix ? self.max_suffix_ : self.max_prefix_;
+    index[a.add].push_back((uint32_t)list.size());
+    longest = std::max(longest, a.add.size());
+    list.push_back(std::move(a));
+  }
+
+  void parse_affixes(const std::string &text) {
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+      if (!line.empty() && line.back() == '\r') line.pop_back();
+      std::vector<std::string> f = split_fields(line);
+      if (f.empty() || f[0][0] == '#') continue;
+      const std::string &cmd = f[0];
+      if (cmd == "FLAG" && f.size() > 1) {
+        std::string m = upper_ascii(f[1]);
+        mode = m == "LONG" ? FLAG_LONG : m == "NUM" ? FLAG_NUM : FLAG_CHAR;
+      } else if (cmd == "AF" && f.size() > 1) {
+        if (!af_header && all_digits(f[1]) && f.size() == 2) {
+          af_header = true;
+        } else {
+          flag_aliases.push_back(intern(decode_flags(f[1])));
+        }
+      } else if (cmd == "AM" && f.size() > 1) {
+        if (!am_header && all_digits(f[1]) && f.size() == 2) {
+          am_header = true;
+        } else {
+          std::string morph;
+          for (size_t i = 1; i < f.size(); ++i) morph += (i > 1 ? " " : "") + f[i];
+          morph_aliases.push_back(morph);
+        }
+      } else if ((cmd == "NEEDAFFIX" || cmd == "PSEUDOROOT") && f.size() > 1) {
+        self.need_affix_ = single_flag(f[1]);
+      } else if (cmd == "FORBIDDENWORD" && f.size() > 1) {
+        self.forbidden_ = single_flag(f[1]);
+      } else if (cmd == "ONLYINCOMPOUND" && f.size() > 1) {
+        self.only_in_compound_ = single_flag(f[1]);
+      } else if (cmd == "FULLSTRIP") {
+        self.full_strip_ = true;
+      } else if (cmd == "IGNORE" && f.size() > 1) {
+        self.ignore_ = to_u32(f[1]);
+      } else if (cmd == "PFX" || cmd == "SFX") {
+        affix_line(f);
+      }
+    }
+  }
+
+  // the morphological fields after a word, an AM alias number or fields
+  std::u32string stem_field(const std::string &morph) const {
+    std::vector<std::string> fields = split_fields(morph);
+    if (fields.size() == 1 && all_digits(fields[0]) && !morph_aliases.empty()) {
+      size_t n = std::stoul(fields[0]);
+      if (n < 1 || n > morph_aliases.size()) return U"";
+      fields = split_fields(morph_aliases[n - 1]);
+    }
+    for (const std::string &field : fields) {
+      if (field.compare(0, 3, "st:") == 0 && field.size() > 3) {
+        return to_u32(field.substr(3));
+      }
+    }
+    return U"";
+  }
+
+  // does a morphological field (xx:...) or an AM alias start at i?
+  bool is_morph_field(const std::string &line, size_t i) const {
+    if (i + 2 < line.size() && line[i] != ' ' && line[i] != '\t' &&
+        line[i + 1] != ' ' && line[i + 1] != '\t' && line[i + 2] == ':') {
+      return true;
+    }
+    if (morph_aliases.empty()) return false;
+    std::vector<std::string> rest = split_fields(line.substr(i));
+    return rest.size() == 1 && all_digits(rest[0]);
+  }
+
+  void parse_words(const std::string &text) {
+    std::istringstream in(text);
+    std::string line;
+    bool first = true;
+    while (std::getline(in, line)) {
+      if (!line.empty() && line.back() == '\r') line.pop_back();
+      if (line.empty() || line[0] == '\t' || line[0] == '#') continue;
+      if (first) {
+        first = false;
+        // the approximate word count
+        if (all_digits(split_fields(line)[0])) continue;
+      }
+
+      // word[/flags][ morphological fields], "\/" is a literal slash and
+      // words may contain single spaces
+      std::string word;
+      size_t i = 0;
+      for (; i < line.size(); ++i) {
+        char c = line[i];
+        if (c == '\\' && i + 1 < line.size() && line[i + 1] == '/') {
+          word += '/';
+          ++i;
+        } else if (c == '/' && !word.empty()) {
+          break;
+        } else if (c == '\t') {
+          break;
+        } else if (c == ' ' && is_morph_field(line, i + 1)) {
+          break;
+        } else {
+          word += c;
+        }
+      }
+      while (!word.empty() && word.back() == ' ') word.pop_back();
+      if (word.empty()) continue;
+
+      std::string flags;
+      if (i < line.size() && line[i] == '/') {
+        size_t end = line.find_first_of(" \t", i + 1);
+        if (end == std::string::npos) end = line.size();
+        flags = line.substr(i + 1, end - i - 1);
+        i = end;
+      }
+
+      root r;
+      r.flags = flags.empty() ? 0 : flag_set(flags);
+      if (i < line.size()) r.lemma = stem_field(line.substr(i));
+      std::u32string key = to_u32(word);
+      for (char32_t c : self.ignore_) {
+        key.erase(std::remove(key.begin(), key.end(), c), key.end());
+      }
+      self.words_[std::move(key)].push_back(std::move(r));
+    }
+  }
+};
+
+/***************************************
+ *            AffixStemmer             *
+ ***************************************/
+
+AffixStemmer::AffixStemmer(const std::string &aff, const std::string &dic) {
+  std::string set = affix_encoding(aff);
+  parser p(*this);
+  p.parse_affixes(to_utf8(aff, set));
+  p.parse_words(to_utf8(dic, set));
+  if (words_.empty()) throw std::runtime_error("the word list holds no words");
+  LOGD("AffixStemmer: %zu words, %zu prefixes, %zu suffixes, %zu flag sets",
+       words_.size(), prefixes_.size(), suffixes_.size(), flag_sets_.size());
+}
+
+static std::string read_file(const std::string &fn) {
+  std::ifstream in(fn, std::ios::binary);
+  if (!in) throw std::runtime_error("cannot open " + fn);
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+std::shared_ptr<AffixStemmer> AffixStemmer::from_files(const std::string &aff_fn,
+                                                       const std::string &dic_fn) {
+  return std::make_shared<AffixStemmer>(read_file(aff_fn), read_file(dic_fn));
+}
+
+bool AffixStemmer::has_flag(uint32_t set, flag_t flag) const {
+  const std::vector<flag_t> &flags = flag_sets_[set];
+  return std::binary_search(flags.begin(), flags.end(), flag);
+}
+
+bool AffixStemmer::cond_matches(const std::vector<cond_char> &cond,
+                                const std::u32string &s, bool at_end) {
+  if (cond.size() > s.size()) return false;
+  size_t base = at_end ? s.size() - cond.size() : 0;
+  for (size_t i = 0; i < cond.size(); ++i) {
+    const cond_char &c = cond[i];
+    if (c.any) continue;
+    bool in = c.chars.find(s[base + i]) != std::u32string::npos;
+    if (in == c.negate) return false;
+  }
+  return true;
+}
+
+void AffixStemmer::add_roots(const std::u32string &stem, flag_t a, flag_t b,
+                             bool affixed, std::vector<std::u32string> &out) const {
+  auto it = words_.find(stem);
+  if (it == words_.end()) return;
+  for (const root &r : it->second) {
+    if (forbidden_ && has_flag(r.flags, forbidden_)) continue;
+    if (only_in_compound_ && has_flag(r.flags, only_in_compound_)) continue;
+    if (!affixed && need_affix_ && has_flag(r.flags, need_affix_)) continue;
+    if (a && !has_flag(r.flags, a)) continue;
+    if (b && !has_flag(r.flags, b)) continue;
+    out.push_back(r.lemma.empty() ? stem : r.lemma);
+  }
+}
+
+void AffixStemmer::strip_suffixes(const std::u32string &word,
+                                  std::vector<std::u32string> &out) const {
+  size_t n = word.size();
+  std::u32string key;
+  for (size_t len = 0; len <= std::min(max_suffix_, n); ++len) {
+    key.assign(word, n - len, len);
+    auto found = suffix_by_add_.find(key);
+    if (found == suffix_by_add_.end()) continue;
+    for (uint32_t idx : found->second) {
+      const affix &s = suffixes_[idx];
+      if (len == n && !full_strip_) continue;
+      std::u32string stem = word.substr(0, n - len) + s.strip;
+      if (stem.empty() || !cond_matches(s.cond, stem, true)) continue;
+
+      // a suffix flagged NEEDAFFIX only appears behind another one
+      if (!need_affix_ || !has_flag(s.cont, need_affix_)) {
+        add_roots(stem, s.flag, 0, true, out);
+      }
+
+      // twofold: an inner suffix whose continuation classes allow this one
+      size_t m = stem.size();
+      std::u32string inner_key;
+      for (size_t len2 = 0; len2 <= std::min(max_suffix_, m); ++len2) {
+        inner_key.assign(stem, m - len2, len2);
+        auto inner = suffix_by_add_.find(inner_key);
+        if (inner == suffix_by_add_.end()) continue;
+        for (uint32_t idx2 : inner->second) {
+          const affix &s1 = suffixes_[idx2];
+          if (!has_flag(s1.cont, s.flag)) continue;
+          if (len2 == m && !full_strip_) continue;
+          std::u32string stem2 = stem.substr(0, m - len2) + s1.strip;
+          if (stem2.empty() || !cond_matches(s1.cond, stem2, true)) continue;
+          add_roots(stem2, s1.flag, 0, true, out);
+        }
+      }
+
+      // cross product: a prefix on the same root
+      if (!s.cross) continue;
+      std::u32string prefix_key;
+      for (size_t len2 = 0; len2 <= std::min(max_prefix_, m); ++len2) {
+        prefix_key.assign(stem, 0, len2);
+        auto pre = prefix_by_add_.find(prefix_key);
+        if (pre == prefix_by_add_.end()) continue;
+        for (uint32_t idx2 : pre->second) {
+          const affix &p = prefixes_[idx2];
+          if (!p.cross || (len2 == m && !full_strip_)) continue;
+          std::u32string root_text = p.strip + stem.substr(len2);
+          if (root_text.empty() || !cond_matches(p.cond, root_text, false)) continue;
+          add_roots(root_text, p.flag, s.flag, true, out);
+        }
+      }
+    }
+  }
+}
+
+void AffixStemmer::strip_prefixes(const std::u32string &word,
+                                  std::vector<std::u32string> &out) const {
+  size_t n = word.size();
+  std::u32string key;
+  for (size_t len = 0; len <= std::min(max_prefix_, n); ++len) {
+    key.assign(word, 0, len);
+    auto found = prefix_by_add_.find(key);
+    if (found == prefix_by_add_.end()) continue;
+    for (uint32_t idx : found->second) {
+      const affix &p = prefixes_[idx];
+      if (len == n && !full_strip_) continue;
+      if (need_affix_ && has_flag(p.cont, need_affix_)) continue;
+      std::u32string root_text = p.strip + word.substr(len);
+      if (root_text.empty() || !cond_matches(p.cond, root_text, false)) continue;
+      add_roots(root_text, p.flag, 0, true, out);
+    }
+  }
+}
+
+void AffixStemmer::stem_form(const std::u32string &word,
+                             std::vector<std::u32string> &out) const {
+  // a forbidden form has no stems, even if the rules could derive it
+  auto it = words_.find(word);
+  if (it != words_.end() && forbidden_) {
+    for (const root &r : it->second) {
+      if (has_flag(r.flags, forbidden_)) return;
+    }
+  }
+  add_roots(word, 0, 0, false, out);
+  strip_suffixes(word, out);
+  strip_prefixes(word, out);
+}
+
+std::vector<std::string> AffixStemmer::stems(const std::string &word) const {
+  std::u32string w = to_u32(word);
+  for (char32_t c : ignore_) w.erase(std::remove(w.begin(), w.end(), c), w.end());
+  if (w.empty()) return {};
+
+  // the word as typed, lower case, then capitalized (for names)
+  std::vector<std::u32string> forms{w};
+  std::u32string lower = w;
+  for (char32_t &c : lower) c = fold_char(c);
+  if (lower != w) forms.push_back(lower);
+  std::u32string title = lower;
+  title[0] = static_cast<char32_t>(std::towupper(static_cast<wint_t>(title[0])));
+  if (title != w && title != lower) forms.push_back(title);
+
+  std::vector<std::u32string> found;
+  for (const std::u32string &form : forms) stem_form(form, found);
+
+  std::vector<std::string> result;
+  std::vector<std::u32string> seen;
+  for (const std::u32string &s : found) {
+    if (std::find(seen.begin(), seen.end(), s) != seen.end()) continue;
+    seen.push_back(s);
+    result.push_back(from_u32(s));
+  }
+  return result;
+}
+
+}  // namespace mdict
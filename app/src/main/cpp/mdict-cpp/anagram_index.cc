@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/anagram_index.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "include/html_text.h"
+#include "include/key_fold.h"
+#include "include/mdict.h"
+
+namespace mdict {
+
+static const uint32_t ANAGRAM_MAGIC = 0x47414456;  // "VDAG"
+static const size_t ANAGRAM_HEADER_SIZE = 32;
+
+anagram_query make_anagram_query(std::string_view text) {
+  anagram_query q;
+  std::string tiles;
+  for (char c : text) {
+    if (c == '?' || c == '.') {
+      ++q.blanks;
+    } else {
+      tiles.push_back(c);
+    }
+  }
+  anagram_letters(fold_key(tiles, KEY_FOLD_LOOSE), q.letters);
+  q.mask = anagram_mask(q.letters);
+  return q;
+}
+
+void anagram_letters(std::string_view folded, std::u32string &out) {
+  out.clear();
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(folded.data());
+  const unsigned char *end = p + folded.size();
+  while (p < end) {
+    char32_t c;
+    p += decode_utf8(p, end, c);
+    out.push_back(c);
+  }
+  std::sort(out.begin(), out.end());
+}
+
+uint64_t anagram_mask(const std::u32string &letters) {
+  uint64_t mask = 0;
+  for (size_t i = 0; i < letters.size(); ++i) {
+    char32_t c = letters[i];
+    if (c >= 'a' && c <= 'z') {
+      // sorted, so a repeated letter follows its first occurrence
+      bool twice = i > 0 && letters[i - 1] == c;
+      mask |= 1ull << (c - 'a' + (twice ? 26 : 0));
+    } else {
+      mask |= 1ull << (52 + c % 12);
+    }
+  }
+  return mask;
+}
+
+bool anagram_match(const std::u32string &letters, const anagram_query &query,
+                   bool subset) {
+  size_t tiles = query.letters.size() + query.blanks;
+  if (letters.empty() || letters.size() > tiles) return false;
+  if (!subset && letters.size() != tiles) return false;
+  // both sorted: walk them together, a letter the tiles lack costs a blank
+  size_t missing = 0;
+  size_t t = 0;
+  for (char32_t c : letters) {
+    while (t < query.letters.size() && query.letters[t] < c) ++t;
+    if (t < query.letters.size() && query.letters[t] == c) {
+      ++t;
+    } else if (++missing > query.blanks) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/***************************************
+ *            build side               *
+ ***************************************/
+
+void AnagramJob::add_block(const Mdict &dict, const record_block_view &block) {
+  const KeyFolder &folder = KeyFolder::get(KEY_FOLD_LOOSE);
+  for (unsigned long e = block.first_entry; e < block.last_entry; ++e) {
+    folder.fold(dict.entry_key(e), folded_);
+    if (folded_.empty()) continue;
+    anagram_letters(folded_, letters_);
+    folded_.clear();
+    for (char32_t c : letters_) append_utf8(folded_, c);
+    uint32_t entry = static_cast<uint32_t>(e);
+    uint32_t len = static_cast<uint32_t>(folded_.size());
+    for (int i = 0; i < 4; ++i) buffer_.push_back((unsigned char)(entry >> (8 * i)));
+    for (int i = 0; i < 4; ++i) buffer_.push_back((unsigned char)(len >> (8 * i)));
+    buffer_.insert(buffer_.end(), folded_.begin(), folded_.end());
+    ++count_;
+  }
+}
+
+/**
+ * segment layout: u64 key count, then the keys as buffered
+ */
+bool AnagramJob::write_segment(FILE *out) {
+  bool ok = write_u64(out, count_) &&
+            std::fwrite(buffer_.data(), 1, buffer_.size(), out) == buffer_.size();
+  std::vector<unsigned char>().swap(buffer_);
+  count_ = 0;
+  return ok;
+}
+
+bool AnagramJob::merge(const Mdict &dict, const std::vector<std::string> &segments,
+                       FILE *out) {
+  std::vector<std::pair<std::string, uint32_t>> keys;
+  for (const auto &path : segments) {
+    mapped_file seg;
+    if (!seg.map(path) || seg.size() < 8) continue;
+    const unsigned char *p = seg.data() + 8;
+    const unsigned char *end = seg.data() + seg.size();
+    for (uint64_t n = load_u64(seg.data()); n > 0 && end - p >= 8; --n) {
+      uint32_t entry = load_u32(p);
+      uint32_t len = load_u32(p + 4);
+      p += 8;
+      if ((size_t)(end - p) < len) return false;
+      keys.emplace_back(std::string(reinterpret_cast<const char *>(p), len), entry);
+      p += len;
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+
+  // groups of equal letters
+  std::vector<size_t> starts;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (i == 0 || keys[i].first != keys[i - 1].first) starts.push_back(i);
+  }
+
+  bool ok = write_u32(out, ANAGRAM_MAGIC) && write_u32(out, FORMAT_VERSION) &&
+            write_u64(out, dict.fingerprint()) && write_u64(out, starts.size()) &&
+            write_u64(out, keys.size());
+  uint32_t letters_offset = 0;
+  std::u32string letters;
+  for (size_t g = 0; ok && g < starts.size(); ++g) {
+    const std::string &sig = keys[starts[g]].first;
+    anagram_letters(sig, letters);
+    ok = write_u64(out, anagram_mask(letters)) && write_u32(out, letters_offset) &&
+         write_u32(out, (uint32_t)starts[g]);
+    letters_offset += (uint32_t)sig.size();
+  }
+  ok = ok && write_u64(out, 0) && write_u32(out, letters_offset) &&
+       write_u32(out, (uint32_t)keys.size());
+  for (size_t i = 0; ok && i < keys.size(); ++i) {
+    ok = write_u32(out, keys[i].second);
+  }
+  for (size_t g = 0; ok && g < starts.size(); ++g) {
+    const std::string &sig = keys[starts[g]].first;
+    ok = std::fwrite(sig.data(), 1, sig.size(), out) == sig.size();
+  }
+  return ok;
+}
+
+/***************************************
+ *            query side               *
+ ***************************************/
+
+bool AnagramIndex::open(const std::string &path, uint64_t fingerprint) {
+  if (!file_.map(path)) return false;
+  const unsigned char *p = file_.data();
+  size_t size = file_.size();
+  if (size < ANAGRAM_HEADER_SIZE || load_u32(p) != ANAGRAM_MAGIC ||
+      load_u32(p + 4) != AnagramJob::FORMAT_VERSION ||
+      load_u64(p + 8) != fingerprint) {
+    file_.unmap();
+    return false;
+  }
+  group_count_ = load_u64(p + 16);
+  entry_count_ = load_u64(p + 24);
+  uint64_t room = size - ANAGRAM_HEADER_SIZE;
+  if (group_count_ >= room / GROUP_BYTES ||
+      entry_count_ > (room - (group_count_ + 1) * GROUP_BYTES) / 4) {
+    file_.unmap();
+    return false;
+  }
+  groups_ = p + ANAGRAM_HEADER_SIZE;
+  entries_ = groups_ + (group_count_ + 1) * GROUP_BYTES;
+  letters_ = entries_ + entry_count_ * 4;
+  if (group_entry(group_count_) != entry_count_ ||
+      group_letters(group_count_) > (uint64_t)(p + size - letters_)) {
+    file_.unmap();
+    return false;
+  }
+  return true;
+}
+
+void AnagramIndex::add_group(uint64_t g, std::vector<uint32_t> &out) const {
+  for (uint32_t i = group_entry(g); i < group_entry(g + 1) && i < entry_count_; ++i) {
+    out.push_back(load_u32(entries_ + (uint64_t)i * 4));
+  }
+}
+
+std::vector<uint32_t> AnagramIndex::search(const anagram_query &query,
+                                           bool subset) const {
+  std::vector<uint32_t> found;
+  if (!file_.data()) return found;
+
+  if (!subset && query.blanks == 0) {
+    // the exact letters: one binary search
+    std::string sig;
+    for (char32_t c : query.letters) append_utf8(sig, c);
+    uint64_t lo = 0, hi = group_count_;
+    while (lo < hi) {
+      uint64_t mid = lo + (hi - lo) / 2;
+      if (letters_of(mid) < sig) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (lo < group_count_ && letters_of(lo) == sig) add_group(lo, found);
+    return found;
+  }
+
+  // every group, most rejected by the mask alone
+  std::u32string letters;
+  for (uint64_t g = 0; g < group_count_; ++g) {
+    uint64_t lacking = group_mask(g) & ~query.mask;
+    if (lacking && (size_t)__builtin_popcountll(lacking) > query.blanks) continue;
+    anagram_letters(letters_of(g), letters);
+    if (anagram_match(letters, query, subset)) add_group(g, found);
+  }
+  return found;
+}
+
+}  // namespace mdict
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/block_cache.h"
+
+#include <atomic>
+
+#include "minilzo.h"
+
+namespace mdict {
+
+BlockCache &BlockCache::shared() {
+  // never destroyed, dictionaries may still drop their blocks during exit
+  static BlockCache *cache = new BlockCache();
+  return *cache;
+}
+
+uint64_t BlockCache::new_owner() {
+  static std::atomic<uint64_t> next{1};
+  return next.fetch_add(1);
+}
+
+BlockCache::block_ptr BlockCache::get(uint64_t owner, uint64_t block) {
+  key id{owner, block};
+  cold_block restored;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto hot = hot_index_.find(id);
+    if (hot != hot_index_.end()) {
+      hot_.splice(hot_.begin(), hot_, hot->second);
+      hot_hits_++;
+      return hot->second->data;
+    }
+    auto cold = cold_index_.find(id);
+    if (cold == cold_index_.end()) {
+      misses_++;
+      return nullptr;
+    }
+    // taken out, it comes back hot
+    restored = std::move(*cold->second);
+    cold_bytes_ -= restored.packed.size();
+    cold_raw_bytes_ -= restored.raw_size;
+    cold_.erase(cold->second);
+    cold_index_.erase(cold);
+    cold_hits_++;
+  }
+
+  auto data = std::make_shared<std::vector<uint8_t>>(restored.raw_size);
+  lzo_uint out = static_cast<lzo_uint>(restored.raw_size);
+  int err = lzo1x_decompress_safe(restored.packed.data(),
+                                  static_cast<lzo_uint>(restored.packed.size()),
+                                  data->data(), &out, nullptr);
+  if (err != LZO_E_OK || out != restored.raw_size) return nullptr;
+  put(owner, block, data);
+  return data;
+}
+
+void BlockCache::put(uint64_t owner, uint64_t block, block_ptr data) {
+  if (!data) return;
+  key id{owner, block};
+  std::vector<hot_block> demoted;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (data->size() > budget_ / 2) return;
+    auto hot = hot_index_.find(id);
+    if (hot != hot_index_.end()) {
+      hot_.splice(hot_.begin(), hot_, hot->second);
+      return;
+    }
+    auto cold = cold_index_.find(id);
+    if (cold != cold_index_.end()) {
+      cold_bytes_ -= cold->second->packed.size();
+      cold_raw_bytes_ -= cold->second->raw_size;
+      cold_.erase(cold->second);
+      cold_index_.erase(cold);
+    }
+    hot_.push_front(hot_block{id, std::move(data)});
+    hot_index_[id] = hot_.begin();
+    hot_bytes_ += hot_.front().data->size();
+    shrink_hot(demoted);
+    trim();
+  }
+  if (demoted.empty()) return;
+
+  std::vector<cold_block> packed;
+  for (const hot_block &b : demoted) {
+    cold_block c = pack(b);
+    if (!c.packed.empty()) packed.push_back(std::move(c));
+  }
+  if (!packed.empty()) insert_cold(packed);
+}
+
+void BlockCache::drop(uint64_t owner) {
+  // a block being packed right now may still arrive; owner ids are never
+  // reused, so it only ages out
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = hot_.begin(); it != hot_.end();) {
+    if (it->id.owner != owner) {
+      ++it;
+      continue;
+    }
+    hot_bytes_ -= it->data->size();
+    hot_index_.erase(it->id);
+    it = hot_.erase(it);
+  }
+  for (auto it = cold_.begin(); it != cold_.end();) {
+    if (it->id.owner != owner) {
+      ++it;
+      continue;
+    }
+    cold_bytes_ -= it->packed.size();
+    cold_raw_bytes_ -= it->raw_size;
+    cold_index_.erase(it->id);
+    it = cold_.erase(it);
+  }
+}
+
+void BlockCache::set_budget(size_t bytes) {
+  std::vector<hot_block> demoted;
+  std::lock_guard<std::mutex> lock(mutex_);
+  budget_ = bytes;
+  // a smaller budget simply drops what no longer fits
+  shrink_hot(demoted);
+  trim();
+}
+
+BlockCache::stats BlockCache::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats s;
+  s.hot_blocks = hot_.size();
+  s.hot_bytes = hot_bytes_;
+  s.cold_blocks = cold_.size();
+  s.cold_bytes = cold_bytes_;
+  s.cold_raw_bytes = cold_raw_bytes_;
+  s.hot_hits = hot_hits_;
+  s.cold_hits = cold_hits_;
+  s.misses = misses_;
+  return s;
+}
+
+void BlockCache::shrink_hot(std::vector<hot_block> &demoted) {
+  while (hot_bytes_ > budget_ / 2 && !hot_.empty()) {
+    hot_bytes_ -= hot_.back().data->size();
+    hot_index_.erase(hot_.back().id);
+    demoted.push_back(std::move(hot_.back()));
+    hot_.pop_back();
+  }
+}
+
+void BlockCache::trim() {
+  while (hot_bytes_ + cold_bytes_ > budget_ && !cold_.empty()) {
+    cold_bytes_ -= cold_.back().packed.size();
+    cold_raw_bytes_ -= cold_.back().raw_size;
+    cold_index_.erase(cold_.back().id);
+    cold_.pop_back();
+  }
+  while (hot_bytes_ > budget_ && !hot_.empty()) {
+    hot_bytes_ -= hot_.back().data->size();
+    hot_index_.erase(hot_.back().id);
+    hot_.pop_back();
+  }
+}
+
+BlockCache::cold_block BlockCache::pack(const hot_block &block) {
+  static std::once_flag lzo_ready;
+  std::call_once(lzo_ready, [] { lzo_init(); });
+  // work memory of the compressor, reused by each thread
+  thread_local std::vector<lzo_align_t> work(
+      (LZO1X_1_MEM_COMPRESS + sizeof(lzo_align_t) - 1) / sizeof(lzo_align_t));
+  thread_local std::vector<unsigned char> scratch;
+
+  cold_block c;
+  c.id = block.id;
+  c.raw_size = block.data->size();
+  if (c.raw_size == 0) return c;
+  // worst case expansion of LZO1X
+  scratch.resize(c.raw_size + c.raw_size / 16 + 64 + 3);
+  lzo_uint out = 0;
+  int err = lzo1x_1_compress(block.data->data(), static_cast<lzo_uint>(c.raw_size),
+                             scratch.data(), &out, work.data());
+  if (err != LZO_E_OK || out > c.raw_size * COLD_MAX_RATIO) return c;
+  c.packed.assign(scratch.begin(), scratch.begin() + out);
+  return c;
+}
+
+void BlockCache::insert_cold(std::vector<cold_block> &packed) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (cold_block &c : packed) {
+    // read again and cached meanwhile
+    if (hot_index_.count(c.id) || cold_index_.count(c.id)) continue;
+    // just out of the hot tier, so the most recent cold blocks
+    cold_bytes_ += c.packed.size();
+    cold_raw_bytes_ += c.raw_size;
+    key id = c.id;
+    cold_.push_front(std::move(c));
+    cold_index_[id] = cold_.begin();
+  }
+  trim();
+}
+
+}  // namespace mdict
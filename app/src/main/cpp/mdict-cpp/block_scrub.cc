@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/block_scrub.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "include/adler32.h"
+#include "include/binutils.h"
+#include "include/mdict.h"
+#include "include/mdict_log.h"
+#include "include/task_pool.h"
+#include "miniz/miniz.h"
+#include "minilzo.h"
+
+#define LOG_TAG "MdictJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+namespace mdict {
+
+static const std::chrono::milliseconds POLL_INTERVAL(50);
+// larger than any block a real dictionary has, a bigger size comes from
+// damaged block infos
+static const uint64_t MAX_BLOCK_BYTES = 256ull << 20;
+// compressed bytes checked per task at least
+static const uint64_t SCRUB_TASK_BYTES = 64ull << 10;
+
+std::string check_block(const unsigned char *data, size_t size, uint64_t decomp_size) {
+  if (size < 8) return "block too small";
+  if (decomp_size > MAX_BLOCK_BYTES) return "block size out of range";
+  // 4 bytes compression type, 4 bytes adler32 of the content
+  unsigned type = data[0];
+  uint32_t checksum = be_bin_to_u32(data + 4);
+  const unsigned char *body = data + 8;
+  size_t body_size = size - 8;
+
+  std::vector<unsigned char> inflated;
+  const unsigned char *content = body;
+  if (type == 0) {
+    if (body_size != decomp_size) return "stored block size mismatch";
+  } else if (type == 1) {
+    static std::once_flag lzo_ready;
+    std::call_once(lzo_ready, [] { lzo_init(); });
+    inflated.resize(decomp_size);
+    lzo_uint out = static_cast<lzo_uint>(decomp_size);
+    int err = lzo1x_decompress_safe(body, static_cast<lzo_uint>(body_size), inflated.data(),
+                                    &out, nullptr);
+    if (err == LZO_E_OUTPUT_OVERRUN || (err == LZO_E_OK && out != decomp_size)) {
+      return "decompressed size mismatch";
+    }
+    if (err != LZO_E_OK) return "lzo decompress failed (" + std::to_string(err) + ")";
+    content = inflated.data();
+  } else if (type == 2) {
+    inflated.resize(decomp_size);
+    mz_ulong out = static_cast<mz_ulong>(decomp_size);
+    int err = mz_uncompress(inflated.data(), &out, body, static_cast<mz_ulong>(body_size));
+    if (err == MZ_BUF_ERROR || (err == MZ_OK && out != decomp_size)) {
+      return "decompressed size mismatch";
+    }
+    if (err != MZ_OK) return "zlib decompress failed (" + std::to_string(err) + ")";
+    content = inflated.data();
+  } else {
+    return "unknown compression type " + std::to_string(type);
+  }
+  if (adler32checksum(content, static_cast<uint32_t>(decomp_size)) != checksum) {
+    return "checksum mismatch";
+  }
+  return std::string();
+}
+
+scrub_report scrub_blocks(Mdict &dict, const std::vector<scrub_block> &blocks,
+                          const std::function<void(float)> &progress,
+                          const std::function<bool()> &cancelled) {
+  uint64_t bytes_total = 0;
+  for (const scrub_block &b : blocks) bytes_total += b.comp_size;
+
+  std::mutex mutex;
+  std::condition_variable done;
+  // bytes read and not checked yet, tasks not finished
+  uint64_t ahead = 0;
+  size_t pending = 0;
+  // set while the reader waits for room, the checks only wake it then
+  bool reader_waiting = false;
+  std::vector<std::pair<size_t, std::string>> damaged;
+  std::atomic<uint64_t> bytes_done{0};
+
+  auto report_progress = [&] {
+    if (progress && bytes_total) {
+      progress(static_cast<float>(bytes_done.load()) / bytes_total);
+    }
+  };
+
+  // checks blocks [first, last) of a run, from the shared read or, if that
+  // failed, each on its own so a bad sector only costs the blocks on it
+  auto check = [&](size_t first, size_t last,
+                   std::shared_ptr<std::vector<unsigned char>> run, size_t start) {
+    std::vector<std::pair<size_t, std::string>> found;
+    uint64_t bytes = 0;
+    for (size_t k = first; k < last; ++k) {
+      const scrub_block &b = blocks[k];
+      std::string error;
+      try {
+        if (run) {
+          error = check_block(run->data() + start + bytes, b.comp_size, b.decomp_size);
+        } else {
+          std::vector<unsigned char> own(b.comp_size);
+          dict.readfile(b.offset, b.comp_size, reinterpret_cast<char *>(own.data()));
+          error = check_block(own.data(), own.size(), b.decomp_size);
+        }
+      } catch (const std::exception &e) {
+        error = e.what();
+      } catch (...) {
+        error = "unknown error";
+      }
+      if (!error.empty()) found.emplace_back(k, std::move(error));
+      bytes += b.comp_size;
+      bytes_done += b.comp_size;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &f : found) damaged.push_back(std::move(f));
+    ahead -= bytes;
+    if (--pending == 0 || reader_waiting) done.notify_all();
+  };
+
+  TaskPool &pool = TaskPool::shared();
+  size_t next = 0;
+  while (next < blocks.size()) {
+    if (cancelled && cancelled()) break;
+
+    // the blocks adjacent in the file up to SCRUB_READ_BYTES, read at once
+    size_t end = next + 1;
+    uint64_t run_bytes = blocks[next].comp_size;
+    while (end < blocks.size() &&
+           blocks[end].offset == blocks[end - 1].offset + blocks[end - 1].comp_size &&
+           run_bytes + blocks[end].comp_size <= SCRUB_READ_BYTES) {
+      run_bytes += blocks[end].comp_size;
+      end++;
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (ahead > 0 && ahead + run_bytes > SCRUB_AHEAD_BYTES) {
+        reader_waiting = true;
+        done.wait_for(lock, POLL_INTERVAL);
+        reader_waiting = false;
+        lock.unlock();
+        report_progress();
+        lock.lock();
+      }
+      ahead += run_bytes;
+    }
+
+    std::shared_ptr<std::vector<unsigned char>> run;
+    try {
+      run = std::make_shared<std::vector<unsigned char>>(run_bytes);
+      dict.readfile(blocks[next].offset, run_bytes, reinterpret_cast<char *>(run->data()));
+    } catch (const std::exception &e) {
+      LOGE("scrub: cannot read %llu bytes at %llu: %s, reading its blocks one by one",
+           (unsigned long long)run_bytes, (unsigned long long)blocks[next].offset, e.what());
+      run.reset();
+    }
+    // small blocks (key blocks are a few KiB) are checked a handful per task
+    size_t start = 0;
+    for (size_t first = next; first < end;) {
+      size_t last = first;
+      uint64_t task_bytes = 0;
+      while (last < end && (last == first || task_bytes < SCRUB_TASK_BYTES)) {
+        task_bytes += blocks[last++].comp_size;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending++;
+      }
+      // a pool shutting down drops the task, it is checked right here then
+      if (!pool.submit(TaskLane::INTERACTIVE,
+                       [&check, first, last, run, start] { check(first, last, run, start); })) {
+        check(first, last, run, start);
+      }
+      start += task_bytes;
+      first = last;
+    }
+    next = end;
+    report_progress();
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (pending > 0) {
+    done.wait_for(lock, POLL_INTERVAL);
+    lock.unlock();
+    report_progress();
+    lock.lock();
+  }
+  lock.unlock();
+
+  scrub_report report;
+  report.complete = next == blocks.size();
+  report.bytes = bytes_done.load();
+  for (size_t k = 0; k < next; ++k) {
+    if (blocks[k].kind == block_kind::KEY) {
+      report.key_blocks++;
+    } else {
+      report.record_blocks++;
+    }
+  }
+  std::sort(damaged.begin(), damaged.end());
+  for (auto &d : damaged) {
+    damaged_block block;
+    block.kind = blocks[d.first].kind;
+    block.block_id = blocks[d.first].block_id;
+    block.error = std::move(d.second);
+    report.damaged.push_back(std::move(block));
+  }
+  if (progress && report.complete) progress(1.0f);
+  LOGD("scrub: %llu key blocks, %llu record blocks, %zu damaged%s",
+       (unsigned long long)report.key_blocks, (unsigned long long)report.record_blocks,
+       report.damaged.size(), report.complete ? "" : " (cancelled)");
+  return report;
+}
+
+}  // namespace mdict
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/block_sketch.h"
+
+#include <algorithm>
+
+#include "include/html_text.h"
+#include "include/mdict.h"
+#include "include/ngram_index.h"
+
+namespace mdict {
+
+static const uint32_t SKETCH_MAGIC = 0x53424456;  // "VDBS"
+static const size_t SKETCH_HEADER_SIZE = 24;
+static const size_t SKETCH_MIN_BYTES = 32;
+static const size_t SKETCH_MAX_BYTES = 8192;
+static const int SKETCH_BITS_PER_KEY = 6;
+static const int SKETCH_PROBES = 3;
+
+static inline uint64_t mix64(uint64_t x) {
+  // splitmix64 finalizer
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
+}
+
+/**
+ * the bits a key sets, by double hashing
+ * @param nbits filter size in bits, a power of two
+ */
+static inline void probe_bits(uint64_t key, uint64_t nbits,
+                              uint64_t bits[SKETCH_PROBES]) {
+  uint64_t h = mix64(key);
+  uint64_t d = (h >> 32) | 1;
+  for (int i = 0; i < SKETCH_PROBES; ++i, h += d) bits[i] = h & (nbits - 1);
+}
+
+/***************************************
+ *            build side               *
+ ***************************************/
+
+void BlockSketchJob::add_block(const Mdict &dict,
+                               const record_block_view &block) {
+  keys_.clear();
+  for (unsigned long e = block.first_entry; e < block.last_entry; ++e) {
+    size_t start, len;
+    dict.entry_span(block, e, start, len);
+    html_to_search_text(reinterpret_cast<const char *>(block.data) + start, len,
+                        text_);
+    ngram_keys(text_, keys_);
+  }
+  std::sort(keys_.begin(), keys_.end());
+  keys_.erase(std::unique(keys_.begin(), keys_.end()), keys_.end());
+
+  size_t bytes = SKETCH_MIN_BYTES;
+  while (bytes < SKETCH_MAX_BYTES && bytes * 8 < keys_.size() * SKETCH_BITS_PER_KEY) {
+    bytes <<= 1;
+  }
+  sketch s;
+  s.block_id = block.block_id;
+  s.bits.assign(bytes, 0);
+  uint64_t nbits = bytes * 8;
+  uint64_t probes[SKETCH_PROBES];
+  for (uint64_t key : keys_) {
+    probe_bits(key, nbits, probes);
+    for (uint64_t bit : probes) s.bits[bit >> 3] |= (unsigned char)(1u << (bit & 7));
+  }
+  sketches_.push_back(std::move(s));
+}
+
+/**
+ * segment layout: u64 sketch count, then per sketch (in block order)
+ * u64 block id, u32 bitmap bytes, bitmap
+ */
+bool BlockSketchJob::write_segment(FILE *out) {
+  bool ok = write_u64(out, sketches_.size());
+  for (const sketch &s : sketches_) {
+    ok = ok && write_u64(out, s.block_id) && write_u32(out, (uint32_t)s.bits.size()) &&
+         std::fwrite(s.bits.data(), 1, s.bits.size(), out) == s.bits.size();
+    if (!ok) break;
+  }
+  std::vector<sketch>().swap(sketches_);
+  return ok;
+}
+
+bool BlockSketchJob::merge(const Mdict &dict,
+                           const std::vector<std::string> &segments, FILE *out) {
+  uint64_t block_count = dict.record_block_count();
+  // blocks that failed to decode during the build have no sketch
+  std::vector<uint64_t> sizes(block_count, 0);
+
+  // pass 1: bitmap sizes, for the offsets table
+  for (const auto &path : segments) {
+    mapped_file seg;
+    if (!seg.map(path) || seg.size() < 8) continue;
+    const unsigned char *p = seg.data() + 8;
+    const unsigned char *end = seg.data() + seg.size();
+    for (uint64_t n = load_u64(seg.data()); n > 0 && end - p >= 12; --n) {
+      uint64_t rid = load_u64(p);
+      uint32_t len = load_u32(p + 8);
+      p += 12;
+      if ((size_t)(end - p) < len) return false;
+      if (rid < block_count) sizes[rid] = len;
+      p += len;
+    }
+  }
+
+  bool ok = write_u32(out, SKETCH_MAGIC) && write_u32(out, FORMAT_VERSION) &&
+            write_u64(out, dict.fingerprint()) && write_u64(out, block_count);
+  uint64_t offset = 0;
+  for (uint64_t rid = 0; ok && rid < block_count; ++rid) {
+    ok = write_u64(out, offset);
+    offset += sizes[rid];
+  }
+  ok = ok && write_u64(out, offset);
+
+  // pass 2: bitmaps, segments hold ascending block ids
+  for (const auto &path : segments) {
+    if (!ok) break;
+    mapped_file seg;
+    if (!seg.map(path) || seg.size() < 8) continue;
+    const unsigned char *p = seg.data() + 8;
+    const unsigned char *end = seg.data() + seg.size();
+    for (uint64_t n = load_u64(seg.data()); ok && n > 0 && end - p >= 12; --n) {
+      uint64_t rid = load_u64(p);
+      uint32_t len = load_u32(p + 8);
+      p += 12;
+      if (rid < block_count) {
+        ok = std::fwrite(p, 1, len, out) == len;
+      }
+      p += len;
+    }
+  }
+  return ok;
+}
+
+/***************************************
+ *            query side               *
+ ***************************************/
+
+bool BlockSketchIndex::open(const std::string &path, uint64_t fingerprint) {
+  if (!file_.map(path)) return false;
+  const unsigned char *p = file_.data();
+  size_t size = file_.size();
+  if (size < SKETCH_HEADER_SIZE || load_u32(p) != SKETCH_MAGIC ||
+      load_u32(p + 4) != BlockSketchJob::FORMAT_VERSION ||
+      load_u64(p + 8) != fingerprint) {
+    file_.unmap();
+    return false;
+  }
+  block_count_ = load_u64(p + 16);
+  if (block_count_ >= (size - SKETCH_HEADER_SIZE) / 8) {
+    file_.unmap();
+    return false;
+  }
+  offsets_ = p + SKETCH_HEADER_SIZE;
+  bitmaps_ = offsets_ + (block_count_ + 1) * 8;
+  bitmap_bytes_ = load_u64(offsets_ + block_count_ * 8);
+  if (bitmap_bytes_ > (uint64_t)(file_.data() + size - bitmaps_)) {
+    file_.unmap();
+    return false;
+  }
+  return true;
+}
+
+bool BlockSketchIndex::may_contain(uint64_t rid,
+                                   const std::vector<uint64_t> &keys) const {
+  if (!file_.data() || rid >= block_count_) return true;
+  uint64_t begin = load_u64(offsets_ + rid * 8);
+  uint64_t end = load_u64(offsets_ + (rid + 1) * 8);
+  // no sketch, or a damaged one: cannot rule the block out
+  if (end <= begin || end > bitmap_bytes_) return true;
+  uint64_t bytes = end - begin;
+  if ((bytes & (bytes - 1)) != 0) return true;
+  const unsigned char *bits = bitmaps_ + begin;
+  uint64_t nbits = bytes * 8;
+  uint64_t probes[SKETCH_PROBES];
+  for (uint64_t key : keys) {
+    probe_bits(key, nbits, probes);
+    for (uint64_t bit : probes) {
+      if (!(bits[bit >> 3] & (1u << (bit & 7)))) return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace mdict
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/definition_search.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
+#include "include/mdict_log.h"
+#include "include/task_pool.h"
+
+#define LOG_TAG "MdictJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+namespace mdict {
+
+// how often the waiting thread reports progress and polls for cancellation
+static const std::chrono::milliseconds POLL_INTERVAL(50);
+
+/***************************************
+ *         definition_matcher          *
+ ***************************************/
+
+definition_matcher definition_matcher::fulltext(const std::string &query) {
+  text_query filter(query);
+  bool empty = filter.empty();
+  return definition_matcher(std::move(filter), nullptr, empty);
+}
+
+definition_matcher definition_matcher::regex(const std::string &pattern) {
+  std::unique_ptr<text_regex> re(new text_regex(pattern));
+  text_query filter = text_query::all_of(re->required_literals());
+  return definition_matcher(std::move(filter), std::move(re), pattern.empty());
+}
+
+definition_matcher::definition_matcher(const definition_matcher &other)
+    : filter_(other.filter_),
+      regex_(other.regex_ ? new text_regex(*other.regex_) : nullptr),
+      empty_(other.empty_) {}
+
+bool definition_matcher::find(const char *data, size_t len, text_match *match) {
+  if (!regex_) return filter_.find(data, len, match);
+  // one automaton pass over the literals rejects most entries cheaply
+  if (!filter_.empty() && !filter_.find(data, len, nullptr)) return false;
+  return regex_->find(data, len, match);
+}
+
+/***************************************
+ *           SearchScheduler           *
+ ***************************************/
+
+SearchScheduler::SearchScheduler(std::vector<Mdict *> dicts,
+                                 const definition_matcher &matcher, size_t limit)
+    : dicts_(std::move(dicts)), matcher_(matcher), limit_(limit) {}
+
+std::vector<dictionary_hit> SearchScheduler::run(
+    const std::function<void(float)> &progress,
+    const std::function<bool()> &cancelled) {
+  std::vector<dictionary_hit> hits;
+  if (matcher_.empty() || limit_ == 0) return hits;
+
+  // plan every dictionary, then interleave the blocks by their relative
+  // position so all dictionaries advance together
+  struct work {
+    size_t dict;
+    double order;
+    scan_unit unit;
+  };
+  std::vector<work> items;
+  uint64_t bytes_total = 0;
+  for (size_t d = 0; d < dicts_.size(); ++d) {
+    std::vector<scan_unit> plan;
+    try {
+      plan = dicts_[d]->plan_definition_scan(matcher_.filter(), 0);
+    } catch (const std::exception &e) {
+      LOGE("SearchScheduler: cannot plan dictionary %zu: %s", d, e.what());
+      continue;
+    }
+    uint64_t dict_bytes = 0;
+    for (const scan_unit &unit : plan) dict_bytes += unit.bytes;
+    uint64_t before = 0;
+    for (scan_unit &unit : plan) {
+      double order = (before + unit.bytes / 2.0) / std::max<uint64_t>(dict_bytes, 1);
+      before += unit.bytes;
+      items.push_back({d, order, std::move(unit)});
+    }
+    bytes_total += dict_bytes;
+  }
+  std::stable_sort(items.begin(), items.end(),
+                   [](const work &a, const work &b) { return a.order < b.order; });
+  if (items.empty()) return hits;
+
+  std::mutex mutex;
+  std::condition_variable done;
+  std::atomic<size_t> next_item(0);
+  // items from cut on are not needed any more, the limit is reached before them
+  std::atomic<size_t> cut(items.size());
+  std::atomic<bool> cancel(false);
+  std::atomic<uint64_t> bytes_done(0);
+  // each item keeps its own hits, they are merged in item order at the end so
+  // the result does not depend on which worker ran first
+  std::vector<std::vector<dictionary_hit>> item_hits(items.size());
+  // items finished, and the hits of the finished items before the first gap
+  std::vector<bool> finished(items.size(), false);
+  size_t prefix = 0;
+  size_t prefix_hits = 0;
+
+  auto search_item = [&](size_t i, definition_matcher &matcher) {
+    const work &item = items[i];
+    std::vector<dictionary_hit> &out = item_hits[i];
+    Mdict *dict = dicts_[item.dict];
+    // an item alone reaching the limit fills the result, later items may
+    // still run until the items before them are done
+    auto stopped = [&] {
+      return cancel.load(std::memory_order_relaxed) ||
+             i >= cut.load(std::memory_order_relaxed);
+    };
+    auto on_hit = [&](uint64_t entry, text_match &match) {
+      dictionary_hit hit;
+      hit.dict = item.dict;
+      hit.entry = entry;
+      hit.hit.key = dict->entry_key(entry);
+      hit.hit.snippet = std::move(match.snippet);
+      hit.hit.match_start = match.match_start;
+      hit.hit.match_end = match.match_end;
+      out.push_back(std::move(hit));
+      return out.size() < limit_ && !stopped();
+    };
+    try {
+      uint64_t next_entry;
+      dict->scan_definition_unit(item.unit, 0, matcher, on_hit, stopped, next_entry);
+    } catch (const std::exception &e) {
+      LOGE("SearchScheduler: error decoding block %lu of dictionary %zu: %s",
+           item.unit.block_id, item.dict, e.what());
+    }
+    bytes_done += item.unit.bytes;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    finished[i] = true;
+    while (prefix < items.size() && finished[prefix]) {
+      prefix_hits += item_hits[prefix++].size();
+      if (prefix_hits >= limit_) {
+        if (prefix < cut.load()) cut = prefix;
+        break;
+      }
+    }
+  };
+
+  // a few looping workers claim the items in order until none is left or
+  // the search stops, each with its own matcher since matchers keep scratch
+  // state
+  TaskPool &pool = TaskPool::shared();
+  size_t workers = std::min<size_t>(items.size(), pool.concurrency(TaskLane::INTERACTIVE));
+  size_t pending = 0;
+  auto worker = [&] {
+    definition_matcher matcher(matcher_);
+    for (;;) {
+      size_t i = next_item.fetch_add(1);
+      if (i >= cut.load() || cancel.load()) break;
+      search_item(i, matcher);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--pending == 0) done.notify_all();
+  };
+  for (size_t w = 0; w < workers; ++w) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pending++;
+    }
+    if (pool.submit(TaskLane::INTERACTIVE, worker)) continue;
+    std::lock_guard<std::mutex> lock(mutex);
+    pending--;
+    // the queued workers still go through every item
+    LOGE("SearchScheduler: task pool is shutting down, %zu of %zu workers started", w,
+         workers);
+    break;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (pending > 0) {
+    done.wait_for(lock, POLL_INTERVAL);
+    if (pending == 0) break;
+    lock.unlock();
+    if (progress && bytes_total) {
+      progress(static_cast<float>(bytes_done.load()) / bytes_total);
+    }
+    if (cancelled && cancelled()) cancel = true;
+    lock.lock();
+  }
+  lock.unlock();
+
+  for (std::vector<dictionary_hit> &part : item_hits) {
+    for (dictionary_hit &hit : part) {
+      if (hits.size() >= limit_) break;
+      hits.push_back(std::move(hit));
+    }
+  }
+  bool stopped_early = cancel || cut < items.size();
+  std::sort(hits.begin(), hits.end(), [](const dictionary_hit &a, const dictionary_hit &b) {
+    return a.dict != b.dict ? a.dict < b.dict : a.entry < b.entry;
+  });
+  if (progress) progress(1.0f);
+  LOGD("SearchScheduler: %zu blocks over %zu dictionaries, %zu hits%s", items.size(),
+       dicts_.size(), hits.size(), stopped_early ? " (stopped early)" : "");
+  return hits;
+}
+
+}  // namespace mdict
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/deinflector.h"
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <utility>
+
+namespace mdict {
+
+// bounds the breadth-first search on pathological input
+static const size_t MAX_CANDIDATES = 512;
+
+Deinflector::Deinflector() {
+  const uint32_t V1 = DEINFLECT_V1, V5 = DEINFLECT_V5, VS = DEINFLECT_VS,
+                 VK = DEINFLECT_VK, ADJ = DEINFLECT_ADJ_I, TE = DEINFLECT_TE,
+                 TA = DEINFLECT_TA, MASU = DEINFLECT_MASU;
+  // from, to, types of the inflected form (0: only as the outermost
+  // inflection), types of the result, reason
+  rules_ = {
+      // past, also reached through たら, たり and ました
+      {"かった", "い", TA, ADJ, "past"},
+      {"よかった", "いい", TA, ADJ, "past"},
+      {"た", "る", TA, V1, "past"},
+      {"いた", "く", TA, V5, "past"},
+      {"いだ", "ぐ", TA, V5, "past"},
+      {"した", "す", TA, V5, "past"},
+      {"った", "う", TA, V5, "past"},
+      {"った", "つ", TA, V5, "past"},
+      {"った", "る", TA, V5, "past"},
+      {"んだ", "ぬ", TA, V5, "past"},
+      {"んだ", "ぶ", TA, V5, "past"},
+      {"んだ", "む", TA, V5, "past"},
+      {"いった", "いく", TA, V5, "past"},
+      {"行った", "行く", TA, V5, "past"},
+      {"きた", "くる", TA, VK, "past"},
+      {"来た", "来る", TA, VK, "past"},
+      {"した", "する", TA, VS, "past"},
+      {"ました", "ます", TA, MASU, "past"},
+      {"たら", "た", 0, TA, "-tara"},
+      {"だら", "だ", 0, TA, "-tara"},
+      {"たり", "た", 0, TA, "-tari"},
+      {"だり", "だ", 0, TA, "-tari"},
+
+      // te-form, also reached through ている, てしまう, ちゃう...
+      {"くて", "い", TE, ADJ, "-te"},
+      {"よくて", "いい", TE, ADJ, "-te"},
+      {"て", "る", TE, V1, "-te"},
+      {"いて", "く", TE, V5, "-te"},
+      {"いで", "ぐ", TE, V5, "-te"},
+      {"して", "す", TE, V5, "-te"},
+      {"って", "う", TE, V5, "-te"},
+      {"って", "つ", TE, V5, "-te"},
+      {"って", "る", TE, V5, "-te"},
+      {"んで", "ぬ", TE, V5, "-te"},
+      {"んで", "ぶ", TE, V5, "-te"},
+      {"んで", "む", TE, V5, "-te"},
+      {"いって", "いく", TE, V5, "-te"},
+      {"行って", "行く", TE, V5, "-te"},
+      {"きて", "くる", TE, VK, "-te"},
+      {"来て", "来る", TE, VK, "-te"},
+      {"して", "する", TE, VS, "-te"},
+      {"ないで", "ない", 0, ADJ, "-te"},
+      {"ている", "て", V1, TE, "progressive"},
+      {"でいる", "で", V1, TE, "progressive"},
+      {"てる", "て", V1, TE, "progressive"},
+      {"でる", "で", V1, TE, "progressive"},
+      {"ておく", "て", V5, TE, "-teoku"},
+      {"でおく", "で", V5, TE, "-teoku"},
+      {"とく", "て", V5, TE, "-teoku"},
+      {"どく", "で", V5, TE, "-teoku"},
+      {"てある", "て", V5, TE, "-tearu"},
+      {"である", "で", V5, TE, "-tearu"},
+      {"てしまう", "て", V5, TE, "-teshimau"},
+      {"でしまう", "で", V5, TE, "-teshimau"},
+      {"ちゃう", "て", V5, TE, "-chau"},
+      {"じゃう", "で", V5, TE, "-chau"},
+      {"ちまう", "て", V5, TE, "-chimau"},
+      {"じまう", "で", V5, TE, "-chimau"},
+      {"てください", "て", 0, TE, "request"},
+      {"でください", "で", 0, TE, "request"},
+
+      // negative, ない inflects like an adjective
+      {"ない", "る", ADJ, V1, "negative"},
+      {"かない", "く", ADJ, V5, "negative"},
+      {"がない", "ぐ", ADJ, V5, "negative"},
+      {"さない", "す", ADJ, V5, "negative"},
+      {"たない", "つ", ADJ, V5, "negative"},
+      {"なない", "ぬ", ADJ, V5, "negative"},
+      {"ばない", "ぶ", ADJ, V5, "negative"},
+      {"まない", "む", ADJ, V5, "negative"},
+      {"らない", "る", ADJ, V5, "negative"},
+      {"わない", "う", ADJ, V5, "negative"},
+      {"こない", "くる", ADJ, VK, "negative"},
+      {"来ない", "来る", ADJ, VK, "negative"},
+      {"しない", "する", ADJ, VS, "negative"},
+      {"くない", "い", ADJ, ADJ, "negative"},
+      {"よくない", "いい", ADJ, ADJ, "negative"},
+      {"ず", "ない", 0, ADJ, "-zu"},
+      {"ずに", "ない", 0, ADJ, "-zu"},
+      {"せず", "する", 0, VS, "-zu"},
+      {"せずに", "する", 0, VS, "-zu"},
+      {"ません", "ます", 0, MASU, "negative"},
+      {"ませんでした", "ます", 0, MASU, "negative past"},
+
+      // polite
+      {"ます", "る", MASU, V1, "polite"},
+      {"います", "う", MASU, V5, "polite"},
+      {"きます", "く", MASU, V5, "polite"},
+      {"ぎます", "ぐ", MASU, V5, "polite"},
+      {"します", "す", MASU, V5, "polite"},
+      {"ちます", "つ", MASU, V5, "polite"},
+      {"にます", "ぬ", MASU, V5, "polite"},
+      {"びます", "ぶ", MASU, V5, "polite"},
+      {"みます", "む", MASU, V5, "polite"},
+      {"ります", "る", MASU, V5, "polite"},
+      {"きます", "くる", MASU, VK, "polite"},
+      {"来ます", "来る", MASU, VK, "polite"},
+      {"します", "する", MASU, VS, "polite"},
+      {"ましょう", "ます", 0, MASU, "volitional"},
+
+      // passive and potential, the result inflects as an ichidan verb
+      {"られる", "る", V1, V1, "potential or passive"},
+      {"れる", "る", V1, V1, "potential"},
+      {"かれる", "く", V1, V5, "passive"},
+      {"がれる", "ぐ", V1, V5, "passive"},
+      {"される", "す", V1, V5, "passive"},
+      {"たれる", "つ", V1, V5, "passive"},
+      {"なれる", "ぬ", V1, V5, "passive"},
+      {"ばれる", "ぶ", V1, V5, "passive"},
+      {"まれる", "む", V1, V5, "passive"},
+      {"われる", "う", V1, V5, "passive"},
+      {"られる", "る", V1, V5, "passive"},
+      {"こられる", "くる", V1, VK, "potential or passive"},
+      {"来られる", "来る", V1, VK, "potential or passive"},
+      {"される", "する", V1, VS, "passive"},
+      {"ける", "く", V1, V5, "potential"},
+      {"げる", "ぐ", V1, V5, "potential"},
+      {"せる", "す", V1, V5, "potential"},
+      {"てる", "つ", V1, V5, "potential"},
+      {"ねる", "ぬ", V1, V5, "potential"},
+      {"べる", "ぶ", V1, V5, "potential"},
+      {"める", "む", V1, V5, "potential"},
+      {"れる", "る", V1, V5, "potential"},
+      {"える", "う", V1, V5, "potential"},
+      {"できる", "する", V1, VS, "potential"},
+
+      // causative
+      {"させる", "る", V1, V1, "causative"},
+      {"かせる", "く", V1, V5, "causative"},
+      {"がせる", "ぐ", V1, V5, "causative"},
+      {"させる", "す", V1, V5, "causative"},
+      {"たせる", "つ", V1, V5, "causative"},
+      {"なせる", "ぬ", V1, V5, "causative"},
+      {"ばせる", "ぶ", V1, V5, "causative"},
+      {"ませる", "む", V1, V5, "causative"},
+      {"らせる", "る", V1, V5, "causative"},
+      {"わせる", "う", V1, V5, "causative"},
+      {"こさせる", "くる", V1, VK, "causative"},
+      {"来させる", "来る", V1, VK, "causative"},
+      {"させる", "する", V1, VS, "causative"},
+      {"かされる", "く", V1, V5, "causative passive"},
+      {"がされる", "ぐ", V1, V5, "causative passive"},
+      {"たされる", "つ", V1, V5, "causative passive"},
+      {"なされる", "ぬ", V1, V5, "causative passive"},
+      {"ばされる", "ぶ", V1, V5, "causative passive"},
+      {"まされる", "む", V1, V5, "causative passive"},
+      {"らされる", "る", V1, V5, "causative passive"},
+      {"わされる", "う", V1, V5, "causative passive"},
+
+      // volitional
+      {"よう", "る", 0, V1, "volitional"},
+      {"おう", "う", 0, V5, "volitional"},
+      {"こう", "く", 0, V5, "volitional"},
+      {"ごう", "ぐ", 0, V5, "volitional"},
+      {"そう", "す", 0, V5, "volitional"},
+      {"とう", "つ", 0, V5, "volitional"},
+      {"のう", "ぬ", 0, V5, "volitional"},
+      {"ぼう", "ぶ", 0, V5, "volitional"},
+      {"もう", "む", 0, V5, "volitional"},
+      {"ろう", "る", 0, V5, "volitional"},
+      {"こよう", "くる", 0, VK, "volitional"},
+      {"来よう", "来る", 0, VK, "volitional"},
+      {"しよう", "する", 0, VS, "volitional"},
+      {"かろう", "い", 0, ADJ, "volitional"},
+
+      // imperative
+      {"ろ", "る", 0, V1, "imperative"},
+      {"よ", "る", 0, V1, "imperative"},
+      {"え", "う", 0, V5, "imperative"},
+      {"け", "く", 0, V5, "imperative"},
+      {"げ", "ぐ", 0, V5, "imperative"},
+      {"せ", "す", 0, V5, "imperative"},
+      {"て", "つ", 0, V5, "imperative"},
+      {"ね", "ぬ", 0, V5, "imperative"},
+      {"べ", "ぶ", 0, V5, "imperative"},
+      {"め", "む", 0, V5, "imperative"},
+      {"れ", "る", 0, V5, "imperative"},
+      {"こい", "くる", 0, VK, "imperative"},
+      {"来い", "来る", 0, VK, "imperative"},
+      {"しろ", "する", 0, VS, "imperative"},
+      {"せよ", "する", 0, VS, "imperative"},
+
+      // conditional
+      {"ければ", "い", 0, ADJ, "-ba"},
+      {"よければ", "いい", 0, ADJ, "-ba"},
+      {"れば", "る", 0, V1 | V5 | VK | VS, "-ba"},
+      {"えば", "う", 0, V5, "-ba"},
+      {"けば", "く", 0, V5, "-ba"},
+      {"げば", "ぐ", 0, V5, "-ba"},
+      {"せば", "す", 0, V5, "-ba"},
+      {"てば", "つ", 0, V5, "-ba"},
+      {"ねば", "ぬ", 0, V5, "-ba"},
+      {"べば", "ぶ", 0, V5, "-ba"},
+      {"めば", "む", 0, V5, "-ba"},
+
+      // desire, たい inflects like an adjective
+      {"たい", "る", ADJ, V1, "-tai"},
+      {"いたい", "う", ADJ, V5, "-tai"},
+      {"きたい", "く", ADJ, V5, "-tai"},
+      {"ぎたい", "ぐ", ADJ, V5, "-tai"},
+      {"したい", "す", ADJ, V5, "-tai"},
+      {"ちたい", "つ", ADJ, V5, "-tai"},
+      {"にたい", "ぬ", ADJ, V5, "-tai"},
+      {"びたい", "ぶ", ADJ, V5, "-tai"},
+      {"みたい", "む", ADJ, V5, "-tai"},
+      {"りたい", "る", ADJ, V5, "-tai"},
+      {"きたい", "くる", ADJ, VK, "-tai"},
+      {"来たい", "来る", ADJ, VK, "-tai"},
+      {"したい", "する", ADJ, VS, "-tai"},
+
+      // adjective stems
+      {"く", "い", 0, ADJ, "adv"},
+      {"よく", "いい", 0, ADJ, "adv"},
+      {"さ", "い", 0, ADJ, "noun"},
+      {"そう", "い", 0, ADJ, "-sou"},
+      {"すぎる", "い", V1, ADJ, "-sugiru"},
+      {"すぎる", "る", V1, V1, "-sugiru"},
+  };
+
+  for (uint32_t i = 0; i < rules_.size(); ++i) {
+    by_ending_[rules_[i].from].push_back(i);
+    max_ending_ = std::max(max_ending_, std::strlen(rules_[i].from));
+  }
+}
+
+const Deinflector &Deinflector::shared() {
+  static const Deinflector instance;
+  return instance;
+}
+
+std::vector<deinflection> Deinflector::deinflect(const std::string &word) const {
+  // breadth first, so candidates come out by number of steps
+  std::vector<deinflection> queue;
+  std::set<std::pair<std::string, uint32_t>> seen;
+  queue.push_back({word, 0, {}});
+  seen.emplace(word, 0);
+
+  for (size_t i = 0; i < queue.size() && queue.size() < MAX_CANDIDATES; ++i) {
+    // rules are matched on whole characters
+    // copies, pushing to the queue moves its elements
+    const std::string term = queue[i].term;
+    const uint32_t types = queue[i].types;
+    const std::vector<std::string> reasons = queue[i].reasons;
+    size_t stop = term.size() > max_ending_ ? term.size() - max_ending_ : 0;
+    for (size_t pos = term.size(); pos-- > stop;) {
+      if ((static_cast<unsigned char>(term[pos]) & 0xC0) == 0x80) continue;
+      auto found = by_ending_.find(term.substr(pos));
+      if (found == by_ending_.end()) continue;
+      for (uint32_t r : found->second) {
+        const rule &rl = rules_[r];
+        // the outermost inflection may be anything, inner ones must fit
+        if (types != 0 && (types & rl.types_in) == 0) continue;
+        std::string next = term.substr(0, pos) + rl.to;
+        // a lone kana is never the intended dictionary form
+        if (pos == 0 && next.size() <= 3) continue;
+        if (!seen.emplace(next, rl.types_out).second) continue;
+
+        deinflection d;
+        d.term = std::move(next);
+        d.types = rl.types_out;
+        d.reasons.reserve(reasons.size() + 1);
+        d.reasons.push_back(rl.reason);
+        d.reasons.insert(d.reasons.end(), reasons.begin(), reasons.end());
+        queue.push_back(std::move(d));
+      }
+    }
+  }
+
+  std::vector<deinflection> result;
+  std::set<std::string> terms;
+  for (size_t i = 1; i < queue.size(); ++i) {
+    if ((queue[i].types & DEINFLECT_DICTIONARY_FORM) == 0) continue;
+    if (!terms.insert(queue[i].term).second) continue;
+    result.push_back(std::move(queue[i]));
+  }
+  return result;
+}
+
+}  // namespace mdict
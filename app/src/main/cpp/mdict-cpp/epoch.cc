@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/epoch.h"
+
+#include <algorithm>
+
+namespace mdict {
+
+static const int NO_SLOT = -1;
+static const int UNASSIGNED = -2;
+
+struct EpochDomain::thread_state {
+  int slot = UNASSIGNED;
+  unsigned depth = 0;
+
+  ~thread_state() {
+    if (slot >= 0) EpochDomain::shared().release_slot(slot);
+  }
+};
+
+EpochDomain &EpochDomain::shared() {
+  // never destroyed, threads may still leave guards during exit
+  static EpochDomain *domain = new EpochDomain();
+  return *domain;
+}
+
+EpochDomain::thread_state &EpochDomain::this_thread() {
+  thread_local thread_state state;
+  return state;
+}
+
+int EpochDomain::acquire_slot() {
+  for (size_t i = 0; i < MAX_SLOTS; ++i) {
+    bool expected = false;
+    if (!slots_[i].owned.load(std::memory_order_relaxed) &&
+        slots_[i].owned.compare_exchange_strong(expected, true)) {
+      return static_cast<int>(i);
+    }
+  }
+  return NO_SLOT;
+}
+
+void EpochDomain::release_slot(int slot) {
+  slots_[slot].epoch.store(IDLE);
+  slots_[slot].owned.store(false);
+}
+
+void EpochDomain::retire(std::function<void()> deleter) {
+  // readers pinned after this see the new version, since it was published
+  // before the epoch moved on
+  uint64_t epoch = epoch_.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lock(retired_mutex_);
+    retired_.emplace_back(epoch, std::move(deleter));
+  }
+  collect();
+}
+
+void EpochDomain::collect() {
+  std::vector<std::function<void()>> ready;
+  {
+    std::lock_guard<std::mutex> lock(retired_mutex_);
+    if (retired_.empty() || unslotted_readers_.load() > 0) return;
+    uint64_t oldest = IDLE;
+    for (const slot &s : slots_) oldest = std::min(oldest, s.epoch.load());
+    auto kept = std::stable_partition(
+        retired_.begin(), retired_.end(),
+        [oldest](const std::pair<uint64_t, std::function<void()>> &r) {
+          return r.first >= oldest;
+        });
+    for (auto it = kept; it != retired_.end(); ++it) {
+      ready.push_back(std::move(it->second));
+    }
+    retired_.erase(kept, retired_.end());
+  }
+  // outside the lock, a deleter may retire something itself
+  for (auto &deleter : ready) deleter();
+}
+
+EpochGuard::EpochGuard() {
+  EpochDomain::thread_state &t = EpochDomain::this_thread();
+  if (t.depth++ > 0) return;
+  EpochDomain &domain = EpochDomain::shared();
+  if (t.slot == UNASSIGNED) t.slot = domain.acquire_slot();
+  if (t.slot >= 0) {
+    domain.slots_[t.slot].epoch.store(domain.epoch_.load());
+  } else {
+    domain.unslotted_readers_.fetch_add(1);
+  }
+}
+
+EpochGuard::~EpochGuard() {
+  EpochDomain::thread_state &t = EpochDomain::this_thread();
+  if (--t.depth > 0) return;
+  EpochDomain &domain = EpochDomain::shared();
+  if (t.slot >= 0) {
+    domain.slots_[t.slot].epoch.store(EpochDomain::IDLE);
+  } else {
+    domain.unslotted_readers_.fetch_sub(1);
+  }
+}
+
+}  // namespace mdict
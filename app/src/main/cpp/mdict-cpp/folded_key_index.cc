@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/folded_key_index.h"
+
+#include <algorithm>
+
+#include "include/mdict.h"
+
+namespace mdict {
+
+static const uint32_t FOLDED_MAGIC = 0x4B464456;  // "VDFK"
+static const size_t FOLDED_HEADER_SIZE = 32;
+
+/***************************************
+ *            build side               *
+ ***************************************/
+
+void FoldedKeysJob::add_block(const Mdict &dict, const record_block_view &block) {
+  const KeyFolder &folder = KeyFolder::get(KEY_FOLD_LOOSE);
+  for (unsigned long e = block.first_entry; e < block.last_entry; ++e) {
+    folder.fold(dict.entry_key(e), folded_);
+    uint32_t entry = static_cast<uint32_t>(e);
+    uint32_t len = static_cast<uint32_t>(folded_.size());
+    for (int i = 0; i < 4; ++i) buffer_.push_back((unsigned char)(entry >> (8 * i)));
+    for (int i = 0; i < 4; ++i) buffer_.push_back((unsigned char)(len >> (8 * i)));
+    buffer_.insert(buffer_.end(), folded_.begin(), folded_.end());
+    ++count_;
+  }
+}
+
+/**
+ * segment layout: u64 key count, then the keys as buffered
+ */
+bool FoldedKeysJob::write_segment(FILE *out) {
+  bool ok = write_u64(out, count_) &&
+            std::fwrite(buffer_.data(), 1, buffer_.size(), out) == buffer_.size();
+  std::vector<unsigned char>().swap(buffer_);
+  count_ = 0;
+  return ok;
+}
+
+bool FoldedKeysJob::merge(const Mdict &dict, const std::vector<std::string> &segments,
+                          FILE *out) {
+  // the arena in entry order; an entry no block covers keeps an empty key
+  size_t count = dict.entry_count();
+  std::vector<std::string> keys(count);
+  for (const auto &path : segments) {
+    mapped_file seg;
+    if (!seg.map(path) || seg.size() < 8) continue;
+    const unsigned char *p = seg.data() + 8;
+    const unsigned char *end = seg.data() + seg.size();
+    for (uint64_t n = load_u64(seg.data()); n > 0 && end - p >= 8; --n) {
+      uint32_t entry = load_u32(p);
+      uint32_t len = load_u32(p + 4);
+      p += 8;
+      if ((size_t)(end - p) < len || entry >= count) return false;
+      keys[entry].assign(reinterpret_cast<const char *>(p), len);
+      p += len;
+    }
+  }
+  std::string arena;
+  std::vector<uint32_t> starts;
+  starts.reserve(count + 1);
+  for (const std::string &key : keys) {
+    if (arena.size() + key.size() > 0xFFFFFFFFu) return false;
+    starts.push_back((uint32_t)arena.size());
+    arena.append(key);
+  }
+  starts.push_back((uint32_t)arena.size());
+  std::vector<std::string>().swap(keys);
+
+  std::vector<uint32_t> sorted(count);
+  for (size_t i = 0; i < count; ++i) sorted[i] = static_cast<uint32_t>(i);
+  auto key_of = [&](uint32_t e) {
+    return std::string_view(arena.data() + starts[e], starts[e + 1] - starts[e]);
+  };
+  std::sort(sorted.begin(), sorted.end(), [&](uint32_t a, uint32_t b) {
+    int c = key_of(a).compare(key_of(b));
+    return c != 0 ? c < 0 : a < b;
+  });
+
+  bool ok = write_u32(out, FOLDED_MAGIC) && write_u32(out, FORMAT_VERSION) &&
+            write_u64(out, dict.fingerprint()) && write_u64(out, count) &&
+            write_u64(out, arena.size());
+  for (size_t i = 0; ok && i < starts.size(); ++i) ok = write_u32(out, starts[i]);
+  for (size_t i = 0; ok && i < sorted.size(); ++i) ok = write_u32(out, sorted[i]);
+  return ok && std::fwrite(arena.data(), 1, arena.size(), out) == arena.size();
+}
+
+/***************************************
+ *            query side               *
+ ***************************************/
+
+bool FoldedKeyIndex::open(const std::string &path, uint64_t fingerprint, size_t count) {
+  if (!file_.map(path)) return false;
+  const unsigned char *p = file_.data();
+  size_t size = file_.size();
+  if (size < FOLDED_HEADER_SIZE || load_u32(p) != FOLDED_MAGIC ||
+      load_u32(p + 4) != FoldedKeysJob::FORMAT_VERSION ||
+      load_u64(p + 8) != fingerprint || load_u64(p + 16) != count) {
+    file_.unmap();
+    return false;
+  }
+  uint64_t arena_bytes = load_u64(p + 24);
+  uint64_t room = size - FOLDED_HEADER_SIZE;
+  if (count > room / 8 || arena_bytes > room ||
+      (count * 2 + 1) * 4 + arena_bytes != room) {
+    file_.unmap();
+    return false;
+  }
+  const unsigned char *starts = p + FOLDED_HEADER_SIZE;
+  const unsigned char *sorted = starts + (count + 1) * 4;
+  arena_ = reinterpret_cast<const char *>(sorted + count * 4);
+  starts_.resize(count + 1);
+  sorted_.resize(count);
+  for (size_t i = 0; i <= count; ++i) {
+    starts_[i] = load_u32(starts + i * 4);
+    if (starts_[i] > arena_bytes || (i > 0 && starts_[i] < starts_[i - 1])) {
+      file_.unmap();
+      return false;
+    }
+  }
+  if (starts_[count] != arena_bytes) {
+    file_.unmap();
+    return false;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    sorted_[i] = load_u32(sorted + i * 4);
+    if (sorted_[i] >= count) {
+      file_.unmap();
+      return false;
+    }
+  }
+  return true;
+}
+
+FoldedKeyIndex::range FoldedKeyIndex::equal_range(
+    std::string_view folded) const {
+  auto first = std::lower_bound(
+      sorted_.begin(), sorted_.end(), folded,
+      [this](uint32_t e, std::string_view v) { return this->folded(e) < v; });
+  auto last = std::upper_bound(
+      first, sorted_.end(), folded,
+      [this](std::string_view v, uint32_t e) { return v < this->folded(e); });
+  return range(sorted_.data() + (first - sorted_.begin()),
+               sorted_.data() + (last - sorted_.begin()));
+}
+
+FoldedKeyIndex::range FoldedKeyIndex::prefix_range(
+    std::string_view folded) const {
+  auto first = std::lower_bound(
+      sorted_.begin(), sorted_.end(), folded,
+      [this](uint32_t e, std::string_view v) { return this->folded(e) < v; });
+  auto last = std::upper_bound(
+      first, sorted_.end(), folded,
+      [this](std::string_view v, uint32_t e) {
+        return v < this->folded(e).substr(0, v.size());
+      });
+  return range(sorted_.data() + (first - sorted_.begin()),
+               sorted_.data() + (last - sorted_.begin()));
+}
+
+std::vector<std::pair<size_t, FoldedKeyIndex::range>>
+FoldedKeyIndex::common_prefixes(std::string_view folded,
+                                size_t max_length) const {
+  std::vector<std::pair<size_t, range>> found;
+  auto lo = sorted_.begin();
+  auto hi = sorted_.end();
+  size_t n = std::min(folded.size(), max_length);
+  for (size_t depth = 0; depth < n && lo != hi; ++depth) {
+    // keys in [lo, hi) share folded[0, depth); keys of exactly that length
+    // sort first, so narrow on the next byte past them
+    unsigned char b = folded[depth];
+    auto byte_at = [this, depth](uint32_t e) -> int {
+      std::string_view k = this->folded(e);
+      return depth < k.size() ? static_cast<unsigned char>(k[depth]) : -1;
+    };
+    lo = std::lower_bound(lo, hi, static_cast<int>(b),
+                          [&](uint32_t e, int v) { return byte_at(e) < v; });
+    hi = std::upper_bound(lo, hi, static_cast<int>(b),
+                          [&](int v, uint32_t e) { return v < byte_at(e); });
+    if (lo == hi) break;
+    if (this->folded(*lo).size() == depth + 1) {
+      auto end = lo;
+      while (end != hi && this->folded(*end).size() == depth + 1) ++end;
+      found.emplace_back(depth + 1,
+                         range(sorted_.data() + (lo - sorted_.begin()),
+                               sorted_.data() + (end - sorted_.begin())));
+    }
+  }
+  return found;
+}
+
+}  // namespace mdict
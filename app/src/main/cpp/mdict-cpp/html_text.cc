@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/html_text.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#include "include/key_fold.h"
+
+namespace mdict {
+
+char32_t fold_char(char32_t c) {
+  if (c < 0x80) {
+    return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+  }
+  // the case tables of the folded key index, towlower() only knows ascii in
+  // the C locale
+  static const KeyFolder &folder = KeyFolder::get(KEY_FOLD_CASE);
+  return folder.fold_char(c);
+}
+
+bool is_cjk(char32_t c) {
+  return (c >= 0x3040 && c <= 0x30FF) ||    // hiragana, katakana
+         (c >= 0x3400 && c <= 0x4DBF) ||    // CJK extension A
+         (c >= 0x4E00 && c <= 0x9FFF) ||    // CJK unified ideographs
+         (c >= 0xAC00 && c <= 0xD7AF) ||    // hangul syllables
+         (c >= 0xF900 && c <= 0xFAFF) ||    // CJK compatibility ideographs
+         (c >= 0xFF66 && c <= 0xFF9F) ||    // half-width katakana
+         (c >= 0x20000 && c <= 0x3134F);    // CJK extensions B..G
+}
+
+size_t decode_utf8(const unsigned char *p, const unsigned char *end,
+                   char32_t &cp) {
+  unsigned char c = p[0];
+  size_t need;
+  if (c < 0x80) {
+    cp = c;
+    return 1;
+  } else if ((c & 0xE0) == 0xC0) {
+    cp = c & 0x1F;
+    need = 1;
+  } else if ((c & 0xF0) == 0xE0) {
+    cp = c & 0x0F;
+    need = 2;
+  } else if ((c & 0xF8) == 0xF0) {
+    cp = c & 0x07;
+    need = 3;
+  } else {
+    cp = 0xFFFD;
+    return 1;
+  }
+  if (static_cast<size_t>(end - p) <= need) {
+    cp = 0xFFFD;
+    return 1;
+  }
+  for (size_t i = 1; i <= need; ++i) {
+    if ((p[i] & 0xC0) != 0x80) {
+      cp = 0xFFFD;
+      return 1;
+    }
+    cp = (cp << 6) | (p[i] & 0x3F);
+  }
+  return need + 1;
+}
+
+void append_utf8(std::string &out, char32_t cp) {
+  if (cp < 0x80) {
+    out.push_back(static_cast<char>(cp));
+  } else if (cp < 0x800) {
+    out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else if (cp < 0x10000) {
+    out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else {
+    out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  }
+}
+
+bool html_is_space(char32_t c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' ||
+         c == 0 || c == 0xA0 || c == 0x3000;
+}
+
+void fold_text(const std::string &text, std::u32string &out) {
+  out.clear();
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(text.data());
+  const unsigned char *end = p + text.size();
+  while (p < end) {
+    char32_t c;
+    p += decode_utf8(p, end, c);
+    if (html_is_space(c)) {
+      if (!out.empty() && out.back() != ' ') out.push_back(' ');
+    } else {
+      out.push_back(fold_char(c));
+    }
+  }
+  if (!out.empty() && out.back() == ' ') out.pop_back();
+}
+
+size_t html_decode_entity(const char *p, const char *end, char32_t &cp) {
+  const char *semi = p + 1;
+  while (semi < end && semi - p <= 10 && *semi != ';') ++semi;
+  if (semi >= end || *semi != ';') return 0;
+  size_t n = semi - p - 1;
+  const char *name = p + 1;
+  if (n >= 2 && name[0] == '#') {
+    char32_t v = 0;
+    bool hex = name[1] == 'x' || name[1] == 'X';
+    for (size_t i = hex ? 2 : 1; i < n; ++i) {
+      char c = name[i];
+      int d;
+      if (c >= '0' && c <= '9') {
+        d = c - '0';
+      } else if (hex && c >= 'a' && c <= 'f') {
+        d = c - 'a' + 10;
+      } else if (hex && c >= 'A' && c <= 'F') {
+        d = c - 'A' + 10;
+      } else {
+        return 0;
+      }
+      v = v * (hex ? 16 : 10) + d;
+      if (v > 0x10FFFF) return 0;
+    }
+    cp = v;
+    return n + 2;
+  }
+  // the html 4 entities (latin-1, greek, symbols and punctuation) and &apos;,
+  // sorted by name
+  struct named_entity {
+    const char *name;
+    char32_t cp;
+  };
+  static const named_entity named[] = {
+      {"AElig", 0x00C6}, {"Aacute", 0x00C1}, {"Acirc", 0x00C2},
+      {"Agrave", 0x00C0}, {"Alpha", 0x0391}, {"Aring", 0x00C5},
+      {"Atilde", 0x00C3}, {"Auml", 0x00C4}, {"Beta", 0x0392},
+      {"Ccedil", 0x00C7}, {"Chi", 0x03A7}, {"Dagger", 0x2021},
+      {"Delta", 0x0394}, {"ETH", 0x00D0}, {"Eacute", 0x00C9}, {"Ecirc", 0x00CA},
+      {"Egrave", 0x00C8}, {"Epsilon", 0x0395}, {"Eta", 0x0397},
+      {"Euml", 0x00CB}, {"Gamma", 0x0393}, {"Iacute", 0x00CD},
+      {"Icirc", 0x00CE}, {"Igrave", 0x00CC}, {"Iota", 0x0399}, {"Iuml", 0x00CF},
+      {"Kappa", 0x039A}, {"Lambda", 0x039B}, {"Mu", 0x039C}, {"Ntilde", 0x00D1},
+      {"Nu", 0x039D}, {"OElig", 0x0152}, {"Oacute", 0x00D3}, {"Ocirc", 0x00D4},
+      {"Ograve", 0x00D2}, {"Omega", 0x03A9}, {"Omicron", 0x039F},
+      {"Oslash", 0x00D8}, {"Otilde", 0x00D5}, {"Ouml", 0x00D6}, {"Phi", 0x03A6},
+      {"Pi", 0x03A0}, {"Prime", 0x2033}, {"Psi", 0x03A8}, {"Rho", 0x03A1},
+      {"Scaron", 0x0160}, {"Sigma", 0x03A3}, {"THORN", 0x00DE}, {"Tau", 0x03A4},
+      {"Theta", 0x0398}, {"Uacute", 0x00DA}, {"Ucirc", 0x00DB},
+      {"Ugrave", 0x00D9}, {"Upsilon", 0x03A5}, {"Uuml", 0x00DC}, {"Xi", 0x039E},
+      {"Yacute", 0x00DD}, {"Yuml", 0x0178}, {"Zeta", 0x0396},
+      {"aacute", 0x00E1}, {"acirc", 0x00E2}, {"acute", 0x00B4},
+      {"aelig", 0x00E6}, {"agrave", 0x00E0}, {"alefsym", 0x2135},
+      {"alpha", 0x03B1}, {"amp", '&'}, {"and", 0x2227}, {"ang", 0x2220},
+      {"apos", '\''}, {"aring", 0x00E5}, {"asymp", 0x2248}, {"atilde", 0x00E3},
+      {"auml", 0x00E4}, {"bdquo", 0x201E}, {"beta", 0x03B2}, {"brvbar", 0x00A6},
+      {"bull", 0x2022}, {"cap", 0x2229}, {"ccedil", 0x00E7}, {"cedil", 0x00B8},
+      {"cent", 0x00A2}, {"chi", 0x03C7}, {"circ", 0x02C6}, {"clubs", 0x2663},
+      {"cong", 0x2245}, {"copy", 0x00A9}, {"crarr", 0x21B5}, {"cup", 0x222A},
+      {"curren", 0x00A4}, {"dArr", 0x21D3}, {"dagger", 0x2020},
+      {"darr", 0x2193}, {"deg", 0x00B0}, {"delta", 0x03B4}, {"diams", 0x2666},
+      {"divide", 0x00F7}, {"eacute", 0x00E9}, {"ecirc", 0x00EA},
+      {"egrave", 0x00E8}, {"empty", 0x2205}, {"emsp", 0x2003}, {"ensp", 0x2002},
+      {"epsilon", 0x03B5}, {"equiv", 0x2261}, {"eta", 0x03B7}, {"eth", 0x00F0},
+      {"euml", 0x00EB}, {"euro", 0x20AC}, {"exist", 0x2203}, {"fnof", 0x0192},
+      {"forall", 0x2200}, {"frac12", 0x00BD}, {"frac14", 0x00BC},
+      {"frac34", 0x00BE}, {"frasl", 0x2044}, {"gamma", 0x03B3}, {"ge", 0x2265},
+      {"gt", '>'}, {"hArr", 0x21D4}, {"harr", 0x2194}, {"hearts", 0x2665},
+      {"hellip", 0x2026}, {"iacute", 0x00ED}, {"icirc", 0x00EE},
+      {"iexcl", 0x00A1}, {"igrave", 0x00EC}, {"image", 0x2111},
+      {"infin", 0x221E}, {"int", 0x222B}, {"iota", 0x03B9}, {"iquest", 0x00BF},
+      {"isin", 0x2208}, {"iuml", 0x00EF}, {"kappa", 0x03BA}, {"lArr", 0x21D0},
+      {"lambda", 0x03BB}, {"lang", 0x2329}, {"laquo", 0x00AB}, {"larr", 0x2190},
+      {"lceil", 0x2308}, {"ldquo", 0x201C}, {"le", 0x2264}, {"lfloor", 0x230A},
+      {"lowast", 0x2217}, {"loz", 0x25CA}, {"lrm", 0x200E}, {"lsaquo", 0x2039},
+      {"lsquo", 0x2018}, {"lt", '<'}, {"macr", 0x00AF}, {"mdash", 0x2014},
+      {"micro", 0x00B5}, {"middot", 0x00B7}, {"minus", 0x2212}, {"mu", 0x03BC},
+      {"nabla", 0x2207}, {"nbsp", 0x00A0}, {"ndash", 0x2013}, {"ne", 0x2260},
+      {"ni", 0x220B}, {"not", 0x00AC}, {"notin", 0x2209}, {"nsub", 0x2284},
+      {"ntilde", 0x00F1}, {"nu", 0x03BD}, {"oacute", 0x00F3}, {"ocirc", 0x00F4},
+      {"oelig", 0x0153}, {"ograve", 0x00F2}, {"oline", 0x203E},
+      {"omega", 0x03C9}, {"omicron", 0x03BF}, {"oplus", 0x2295}, {"or", 0x2228},
+      {"ordf", 0x00AA}, {"ordm", 0x00BA}, {"oslash", 0x00F8},
+      {"otilde", 0x00F5}, {"otimes", 0x2297}, {"ouml", 0x00F6},
+      {"para", 0x00B6}, {"part", 0x2202}, {"permil", 0x2030}, {"perp", 0x22A5},
+      {"phi", 0x03C6}, {"pi", 0x03C0}, {"piv", 0x03D6}, {"plusmn", 0x00B1},
+      {"pound", 0x00A3}, {"prime", 0x2032}, {"prod", 0x220F}, {"prop", 0x221D},
+      {"psi", 0x03C8}, {"quot", '"'}, {"rArr", 0x21D2}, {"radic", 0x221A},
+      {"rang", 0x232A}, {"raquo", 0x00BB}, {"rarr", 0x2192}, {"rceil", 0x2309},
+      {"rdquo", 0x201D}, {"real", 0x211C}, {"reg", 0x00AE}, {"rfloor", 0x230B},
+      {"rho", 0x03C1}, {"rlm", 0x200F}, {"rsaquo", 0x203A}, {"rsquo", 0x2019},
+      {"sbquo", 0x201A}, {"scaron", 0x0161}, {"sdot", 0x22C5}, {"sect", 0x00A7},
+      {"shy", 0x00AD}, {"sigma", 0x03C3}, {"sigmaf", 0x03C2}, {"sim", 0x223C},
+      {"spades", 0x2660}, {"sub", 0x2282}, {"sube", 0x2286}, {"sum", 0x2211},
+      {"sup", 0x2283}, {"sup1", 0x00B9}, {"sup2", 0x00B2}, {"sup3", 0x00B3},
+      {"supe", 0x2287}, {"szlig", 0x00DF}, {"tau", 0x03C4}, {"there4", 0x2234},
+      {"theta", 0x03B8}, {"thetasym", 0x03D1}, {"thinsp", 0x2009},
+      {"thorn", 0x00FE}, {"tilde", 0x02DC}, {"times", 0x00D7},
+      {"trade", 0x2122}, {"uArr", 0x21D1}, {"uacute", 0x00FA}, {"uarr", 0x2191},
+      {"ucirc", 0x00FB}, {"ugrave", 0x00F9}, {"uml", 0x00A8}, {"upsih", 0x03D2},
+      {"upsilon", 0x03C5}, {"uuml", 0x00FC}, {"weierp", 0x2118}, {"xi", 0x03BE},
+      {"yacute", 0x00FD}, {"yen", 0x00A5}, {"yuml", 0x00FF}, {"zeta", 0x03B6},
+      {"zwj", 0x200D}, {"zwnj", 0x200C}
+  };
+  std::string_view want(name, n);
+  const named_entity *last = named + sizeof(named) / sizeof(named[0]);
+  const named_entity *e = std::lower_bound(
+      named, last, want,
+      [](const named_entity &a, std::string_view b) { return a.name < b; });
+  if (e != last && e->name == want) {
+    cp = e->cp;
+    return n + 2;
+  }
+  return 0;
+}
+
+static inline bool is_alpha(char c) {
+  return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+}
+
+static bool tag_is(const char *name, size_t n, const char *want) {
+  size_t w = std::strlen(want);
+  if (n != w) return false;
+  for (size_t i = 0; i < n; ++i) {
+    if ((name[i] | 0x20) != want[i]) return false;
+  }
+  return true;
+}
+
+// tags that separate words when rendered
+static bool is_block_tag(const char *name, size_t n) {
+  static const char *const block[] = {"br", "p",  "div", "li", "tr", "td",
+                                      "th", "dt", "dd",  "hr", "h1", "h2",
+                                      "h3", "h4", "h5",  "h6", "ul", "ol",
+                                      "table"};
+  for (const char *b : block) {
+    if (tag_is(name, n, b)) return true;
+  }
+  return false;
+}
+
+const char *html_skip_tag(const char *p, const char *end, bool &separates) {
+  separates = false;
+  if (end - p >= 4 && std::memcmp(p, "<!--", 4) == 0) {
+    for (const char *q = p + 4; q + 3 <= end; ++q) {
+      if (q[0] == '-' && q[1] == '-' && q[2] == '>') return q + 3;
+    }
+    return end;
+  }
+  const char *q = p + 1;
+  bool closing = q < end && *q == '/';
+  if (closing) ++q;
+  const char *name = q;
+  while (q < end && (is_alpha(*q) || (*q >= '0' && *q <= '9'))) {
+    ++q;
+  }
+  size_t name_len = q - name;
+  char quote = 0;
+  for (; q < end; ++q) {
+    if (quote) {
+      if (*q == quote) quote = 0;
+    } else if (*q == '"' || *q == '\'') {
+      quote = *q;
+    } else if (*q == '>') {
+      ++q;
+      break;
+    }
+  }
+  separates = is_block_tag(name, name_len);
+  const char *raw = tag_is(name, name_len, "script")  ? "script"
+                    : tag_is(name, name_len, "style") ? "style"
+                                                      : nullptr;
+  if (!closing && raw) {
+    // raw text element: drop everything up to the closing tag
+    for (const char *r = q; r + 2 + name_len <= end; ++r) {
+      if (r[0] == '<' && r[1] == '/' && tag_is(r + 2, name_len, raw)) {
+        const char *gt = static_cast<const char *>(std::memchr(r, '>', end - r));
+        return gt ? gt + 1 : end;
+      }
+    }
+    return end;
+  }
+  return q;
+}
+
+void html_to_search_text(const char *data, size_t len, std::u32string &out) {
+  out.clear();
+  out.reserve(len);
+  walk_html(data, len, [&out](char32_t c) {
+    out.push_back(fold_char(c));
+    return true;
+  });
+}
+
+std::string html_preview(const char *data, size_t len, size_t max_chars) {
+  std::string out;
+  size_t n = 0;
+  bool cut = false;
+  walk_html(data, len, [&](char32_t c) {
+    if (n == max_chars) {
+      cut = true;
+      return false;
+    }
+    append_utf8(out, c);
+    ++n;
+    return true;
+  });
+  // no trailing space before the ellipsis
+  if (cut) {
+    if (!out.empty() && out.back() == ' ') out.pop_back();
+    append_utf8(out, 0x2026);
+  }
+  return out;
+}
+
+}  // namespace mdict
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * stemming with hunspell affix (.aff) and word list (.dic) files
+ *
+ *#| the files are parsed once: affix rules are indexed by the text they
+ *   append, conditions are compiled to character sets and the word list is
+ *   a hash table, so stemming a word is a handful of hash probes per
+ *   possible affix length
+ *#| supported: SET (utf-8 and the latin-1 family), FLAG short/long/num/UTF-8,
+ *   AF and AM aliases, PFX/SFX with cross products, twofold suffixes
+ *   (continuation classes), NEEDAFFIX, FORBIDDENWORD, ONLYINCOMPOUND,
+ *   IGNORE, FULLSTRIP and the st: (stem) morphological field, which is how
+ *   word lists map irregular forms (mice st:mouse) to their lemma
+ *#| compounding, suggestion tables (REP, MAP...) and conversion tables are
+ *   ignored, they do not produce stems
+ */
+
+namespace mdict {
+
+class AffixStemmer {
+ public:
+  /**
+   * parse the contents of an affix file and a word list
+   * @param aff affix file bytes
+   * @param dic word list bytes
+   * @throws std::runtime_error if the word list holds no words
+   */
+  AffixStemmer(const std::string &aff, const std::string &dic);
+
+  /**
+   * load an affix file and a word list from disk
+   * @throws std::runtime_error if a file cannot be read or holds no words
+   */
+  static std::shared_ptr<AffixStemmer> from_files(const std::string &aff_fn,
+                                                  const std::string &dic_fn);
+
+  /**
+   * @param word utf-8 word, in any case
+   * @return the lemmas the word list derives the word from (the word itself
+   * first if it is listed), without duplicates, in utf-8
+   */
+  std::vector<std::string> stems(const std::string &word) const;
+
+  size_t word_count() const { return words_.size(); }
+
+ private:
+  typedef uint32_t flag_t;
+
+  // one position of an affix condition
+  struct cond_char {
+    bool any = false;
+    bool negate = false;
+    std::u32string chars;
+  };
+
+  struct affix {
+    flag_t flag = 0;
+    bool cross = false;
+    std::u32string strip;
+    std::u32string add;
+    uint32_t cont = 0;  // flag set of continuation classes
+    std::vector<cond_char> cond;
+  };
+
+  struct root {
+    uint32_t flags = 0;  // flag set
+    std::u32string lemma;  // st: field, empty if none
+  };
+
+  struct parser;
+
+  bool has_flag(uint32_t set, flag_t flag) const;
+  static bool cond_matches(const std::vector<cond_char> &cond,
+                           const std::u32string &s, bool at_end);
+
+  // collect the lemmas of `stem` if listed with flags a and b (0 for none)
+  void add_roots(const std::u32string &stem, flag_t a, flag_t b, bool affixed,
+                 std::vector<std::u32string> &out) const;
+  void strip_suffixes(const std::u32string &word,
+                      std::vector<std::u32string> &out) const;
+  void strip_prefixes(const std::u32string &word,
+                      std::vector<std::u32string> &out) const;
+  void stem_form(const std::u32string &word,
+                 std::vector<std::u32string> &out) const;
+
+  std::unordered_map<std::u32string, std::vector<root>> words_;
+  std::vector<std::vector<flag_t>> flag_sets_;
+  std::vector<affix> prefixes_;
+  std::vector<affix> suffixes_;
+  // affix indexes keyed by the appended text
+  std::unordered_map<std::u32string, std::vector<uint32_t>> prefix_by_add_;
+  std::unordered_map<std::u32string, std::vector<uint32_t>> suffix_by_add_;
+  size_t max_prefix_ = 0;
+  size_t max_suffix_ = 0;
+
+  flag_t need_affix_ = 0;
+  flag_t forbidden_ = 0;
+  flag_t only_in_compound_ = 0;
+  bool full_strip_ = false;
+  std::u32string ignore_;
+};
+
+}  // namespace mdict
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "index_builder.h"
+#include "index_io.h"
+
+/**
+ * headwords by their letters, for word games: the keys using exactly some
+ * letters (anagrams) or only letters from some tiles (sub-anagrams)
+ *
+ *#| a key's letters are its code points folded with KEY_FOLD_LOOSE (case,
+ *   accents, spaces and hyphens are gone), sorted; keys with the same
+ *   letters form one group
+ *#| every group carries a 64 bit letter mask: bits 0-25 "has a-z", bits
+ *   26-51 "has a-z twice", bits 52-63 "has some other letter" (code point
+ *   mod 12). A group can only fit the tiles if each of its bits the tiles
+ *   lack costs a blank, so most groups are rejected with one and-not
+ *#| anagram.idx layout (little-endian)
+ *    | [0:4]   magic "VDAG"
+ *    | [4:8]   format version
+ *    | [8:16]  dictionary fingerprint
+ *    | [16:24] group count
+ *    | [24:32] entry count
+ *    | groups: (group count + 1) x {u64 mask, u32 letters offset,
+ *    |         u32 first entry}, ordered by letters; the last one only ends
+ *    |         the ranges
+ *    | entries: entry count x u32 key list index
+ *    | letters: the sorted letters of each group, utf-8
+ */
+
+namespace mdict {
+
+class Mdict;
+
+/**
+ * a parsed letter query
+ */
+struct anagram_query {
+  std::u32string letters;  // folded and sorted
+  size_t blanks = 0;       // '?' or '.' tiles, any letter
+  uint64_t mask = 0;
+};
+
+/**
+ * @param text the letters, '?' and '.' are blanks
+ */
+anagram_query make_anagram_query(std::string_view text);
+
+/**
+ * @param folded a key folded with KEY_FOLD_LOOSE
+ * @param out receives its code points, sorted
+ */
+void anagram_letters(std::string_view folded, std::u32string &out);
+
+/**
+ * @param letters sorted letters
+ * @return the letter mask described above
+ */
+uint64_t anagram_mask(const std::u32string &letters);
+
+/**
+ * @param letters a key's sorted letters
+ * @param query the tiles
+ * @param subset true if the key may leave tiles unused
+ * @return true if the key can be spelled with the tiles
+ */
+bool anagram_match(const std::u32string &letters, const anagram_query &query,
+                   bool subset);
+
+class AnagramJob : public IndexJob {
+ public:
+  static const uint32_t FORMAT_VERSION = 1;
+
+  std::string name() const override { return "anagram"; }
+  uint32_t format_version() const override { return FORMAT_VERSION; }
+  bool needs_records() const override { return false; }
+  void add_block(const Mdict &dict, const record_block_view &block) override;
+  bool write_segment(FILE *out) override;
+  bool merge(const Mdict &dict, const std::vector<std::string> &segments,
+             FILE *out) override;
+
+ private:
+  // u32 entry, u32 length, sorted letters (utf-8), per key
+  std::vector<unsigned char> buffer_;
+  uint64_t count_ = 0;
+  std::string folded_;
+  std::u32string letters_;
+};
+
+/**
+ * read side of anagram.idx, memory mapped
+ */
+class AnagramIndex {
+ public:
+  /**
+   * map an anagram file
+   * @param path anagram.idx path
+   * @param fingerprint the dictionary fingerprint it must have been built for
+   * @return false if the file is missing, stale or malformed
+   */
+  bool open(const std::string &path, uint64_t fingerprint);
+
+  /**
+   * @param query the tiles
+   * @param subset false for anagrams (all tiles used), true for sub-anagrams
+   * @return key list indexes of the matching keys, grouped by letters
+   */
+  std::vector<uint32_t> search(const anagram_query &query, bool subset) const;
+
+ private:
+  static const size_t GROUP_BYTES = 16;
+
+  uint64_t group_mask(uint64_t g) const { return load_u64(groups_ + g * GROUP_BYTES); }
+  uint32_t group_letters(uint64_t g) const {
+    return load_u32(groups_ + g * GROUP_BYTES + 8);
+  }
+  uint32_t group_entry(uint64_t g) const {
+    return load_u32(groups_ + g * GROUP_BYTES + 12);
+  }
+  std::string_view letters_of(uint64_t g) const {
+    return std::string_view(reinterpret_cast<const char *>(letters_) + group_letters(g),
+                            group_letters(g + 1) - group_letters(g));
+  }
+  void add_group(uint64_t g, std::vector<uint32_t> &out) const;
+
+  mapped_file file_;
+  uint64_t group_count_ = 0;
+  uint64_t entry_count_ = 0;
+  const unsigned char *groups_ = nullptr;
+  const unsigned char *entries_ = nullptr;
+  const unsigned char *letters_ = nullptr;
+};
+
+}  // namespace mdict
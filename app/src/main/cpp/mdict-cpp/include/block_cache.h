@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * process-wide cache of decompressed record blocks, shared by every
+ * dictionary under one memory budget
+ *
+ *#| hot tier: blocks as decompressed, least recently used out first; it
+ *   holds up to half of the budget
+ *#| cold tier: the blocks pushed out of the hot tier, recompressed with
+ *   LZO1X-1 (minilzo), which restores them several times faster than
+ *   reading and inflating them again. A hit moves the block back to the
+ *   hot tier. Blocks that do not shrink to COLD_MAX_RATIO of their size are
+ *   not kept cold
+ *#| both tiers together stay within the budget, the cold tier gives way
+ *   first. Compression and decompression run outside the lock
+ *#| lookups read through it (Mdict::record_block); scans and index builds
+ *   read every block once and bypass it
+ */
+
+namespace mdict {
+
+class BlockCache {
+ public:
+  typedef std::shared_ptr<const std::vector<uint8_t>> block_ptr;
+
+  static const size_t DEFAULT_BUDGET = 32u << 20;
+  // a cold block keeps at most this fraction of its decompressed size
+  static constexpr double COLD_MAX_RATIO = 0.75;
+
+  struct stats {
+    size_t hot_blocks = 0;
+    size_t hot_bytes = 0;
+    size_t cold_blocks = 0;
+    // compressed bytes held, and the decompressed bytes they stand for
+    size_t cold_bytes = 0;
+    size_t cold_raw_bytes = 0;
+    uint64_t hot_hits = 0;
+    uint64_t cold_hits = 0;
+    uint64_t misses = 0;
+  };
+
+  /**
+   * process-wide cache used by every dictionary
+   */
+  static BlockCache &shared();
+
+  /**
+   * @return an id no other dictionary has, to key its blocks
+   */
+  static uint64_t new_owner();
+
+  explicit BlockCache(size_t budget = DEFAULT_BUDGET) : budget_(budget) {}
+  BlockCache(const BlockCache &) = delete;
+  BlockCache &operator=(const BlockCache &) = delete;
+
+  /**
+   * a cached block, restored from the cold tier if it is there
+   * @param owner the dictionary's id
+   * @param block record block id
+   * @return the block, null if not cached
+   */
+  block_ptr get(uint64_t owner, uint64_t block);
+
+  /**
+   * cache a block just read, pushing the least recent ones to the cold tier
+   */
+  void put(uint64_t owner, uint64_t block, block_ptr data);
+
+  /**
+   * forget every block of a dictionary
+   */
+  void drop(uint64_t owner);
+
+  /**
+   * change the memory budget of both tiers, 0 disables the cache
+   */
+  void set_budget(size_t bytes);
+
+  stats statistics() const;
+
+ private:
+  struct key {
+    uint64_t owner;
+    uint64_t block;
+    bool operator==(const key &other) const {
+      return owner == other.owner && block == other.block;
+    }
+  };
+  struct key_hash {
+    size_t operator()(const key &k) const {
+      return std::hash<uint64_t>()(k.owner * 0x9e3779b97f4a7c15ull ^ k.block);
+    }
+  };
+  struct hot_block {
+    key id;
+    block_ptr data;
+  };
+  struct cold_block {
+    key id;
+    size_t raw_size = 0;
+    std::vector<unsigned char> packed;
+  };
+
+  // hot blocks beyond half the budget move to demoted; lock held
+  void shrink_hot(std::vector<hot_block> &demoted);
+  // drop cold then hot blocks until both fit the budget; lock held
+  void trim();
+  // LZO copy of a hot block, empty packed if it does not shrink enough
+  static cold_block pack(const hot_block &block);
+  void insert_cold(std::vector<cold_block> &packed);
+
+  mutable std::mutex mutex_;
+  size_t budget_;
+  // most recent first
+  std::list<hot_block> hot_;
+  std::list<cold_block> cold_;
+  std::unordered_map<key, std::list<hot_block>::iterator, key_hash> hot_index_;
+  std::unordered_map<key, std::list<cold_block>::iterator, key_hash> cold_index_;
+  size_t hot_bytes_ = 0;
+  size_t cold_bytes_ = 0;
+  size_t cold_raw_bytes_ = 0;
+  uint64_t hot_hits_ = 0;
+  uint64_t cold_hits_ = 0;
+  uint64_t misses_ = 0;
+};
+
+}  // namespace mdict
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * integrity scrub of a dictionary file
+ *
+ *#| every key block and record block is read in file order, up to
+ *   SCRUB_READ_BYTES per read, and checked on the shared pool's interactive
+ *   lane, one task per block: the stored size, the inflated size and the
+ *   Adler-32 of the inflated bytes. Reads run ahead of the checks by at most
+ *   SCRUB_AHEAD_BYTES, so the disk stays busy while the cores check
+ *#| a damaged block does not stop the scrub, every one is reported with the
+ *   entries stored in it
+ *#| once a scrub finds nothing, read_record_block() skips the Adler-32 of
+ *   the blocks it inflates (zlib still checks its own stream). The result
+ *   is kept in the index dir as scrub.mark, tied to the file's size and
+ *   modification time
+ */
+
+namespace mdict {
+
+class Mdict;
+
+enum class block_kind { KEY = 0, RECORD = 1 };
+
+/**
+ * where a block is stored, as listed by the key block and record block
+ * infos
+ */
+struct scrub_block {
+  block_kind kind = block_kind::RECORD;
+  uint64_t block_id = 0;
+  // readfile() offset of the block's 8 byte header
+  uint64_t offset = 0;
+  uint64_t comp_size = 0;
+  uint64_t decomp_size = 0;
+};
+
+/**
+ * one block a scrub found damaged
+ */
+struct damaged_block {
+  block_kind kind = block_kind::RECORD;
+  uint64_t block_id = 0;
+  // entries [first_entry, last_entry) stored in the block, numbered in file
+  // order (the key list index while no key block is lost). For a key block
+  // the range also holds the entry before it when that entry's record could
+  // not be told apart from the lost ones
+  uint64_t first_entry = 0;
+  uint64_t last_entry = 0;
+  // what is wrong with it
+  std::string error;
+};
+
+struct scrub_report {
+  // blocks checked
+  uint64_t key_blocks = 0;
+  uint64_t record_blocks = 0;
+  // compressed bytes read
+  uint64_t bytes = 0;
+  // in file order
+  std::vector<damaged_block> damaged;
+  // false if the scrub was cancelled before the last block
+  bool complete = false;
+
+  bool ok() const { return complete && damaged.empty(); }
+};
+
+// bytes read at once
+static const uint64_t SCRUB_READ_BYTES = 4ull << 20;
+// bytes read but not checked yet, bounds the memory of a scrub
+static const uint64_t SCRUB_AHEAD_BYTES = 32ull << 20;
+
+/**
+ * check one block as stored in the file: compression type, sizes and the
+ * Adler-32 of its content (stored, LZO or zlib)
+ * @param data the block, from its 8 byte header on
+ * @param size compressed size
+ * @param decomp_size the size the block infos give
+ * @return empty if the block is intact, else what is wrong
+ */
+std::string check_block(const unsigned char *data, size_t size, uint64_t decomp_size);
+
+/**
+ * read and check blocks in parallel
+ * @param dict the dictionary to read from
+ * @param blocks the blocks, in file order
+ * @param progress receives the fraction of the bytes checked, may be empty
+ * @param cancelled polled before each read, may be empty
+ * @return the counts and the damaged blocks, without their entry ranges
+ */
+scrub_report scrub_blocks(Mdict &dict, const std::vector<scrub_block> &blocks,
+                          const std::function<void(float)> &progress,
+                          const std::function<bool()> &cancelled);
+
+}  // namespace mdict
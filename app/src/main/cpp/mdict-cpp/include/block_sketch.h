@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "index_builder.h"
+#include "index_io.h"
+
+/**
+ * per record block Bloom sketches of the definition grams
+ *
+ *#| a much lighter alternative to the n-gram postings: one small Bloom
+ *   filter per record block over the grams of its plain text (the same grams
+ *   ngram_keys produces). A full-text scan tests the query's grams first and
+ *   skips blocks that cannot contain it without reading or inflating them.
+ *#| filters use ~6 bits per distinct gram and 3 probes, clamped to
+ *   [32, 8192] bytes per block and rounded to a power of two
+ *#| blocksketch.idx layout (little-endian)
+ *    | [0:4]   magic "VDBS"
+ *    | [4:8]   format version
+ *    | [8:16]  dictionary fingerprint
+ *    | [16:24] block count
+ *    | offsets: (block count + 1) x u64, relative to the bitmap area
+ *    | bitmaps: one per block, an empty bitmap means "unknown, scan it"
+ */
+
+namespace mdict {
+
+class BlockSketchJob : public IndexJob {
+ public:
+  // 2: unicode case folding and the html 4 entities
+  static const uint32_t FORMAT_VERSION = 2;
+
+  std::string name() const override { return "blocksketch"; }
+  uint32_t format_version() const override { return FORMAT_VERSION; }
+  void add_block(const Mdict &dict, const record_block_view &block) override;
+  bool write_segment(FILE *out) override;
+  bool merge(const Mdict &dict, const std::vector<std::string> &segments,
+             FILE *out) override;
+
+ private:
+  struct sketch {
+    uint64_t block_id;
+    std::vector<unsigned char> bits;
+  };
+
+  std::vector<sketch> sketches_;
+  // scratch buffers reused across blocks
+  std::u32string text_;
+  std::vector<uint64_t> keys_;
+};
+
+/**
+ * read side of blocksketch.idx, memory mapped
+ */
+class BlockSketchIndex {
+ public:
+  /**
+   * map a sketch file
+   * @param path blocksketch.idx path
+   * @param fingerprint the dictionary fingerprint it must have been built for
+   * @return false if the file is missing, stale or malformed
+   */
+  bool open(const std::string &path, uint64_t fingerprint);
+
+  /**
+   * @param rid record block id
+   * @param keys gram keys of the query (ngram_query_keys)
+   * @return false only if the block certainly holds no entry with all grams
+   */
+  bool may_contain(uint64_t rid, const std::vector<uint64_t> &keys) const;
+
+ private:
+  mapped_file file_;
+  uint64_t block_count_ = 0;
+  const unsigned char *offsets_ = nullptr;
+  const unsigned char *bitmaps_ = nullptr;
+  uint64_t bitmap_bytes_ = 0;
+};
+
+}  // namespace mdict
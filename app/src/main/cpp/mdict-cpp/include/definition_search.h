@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mdict.h"
+#include "text_query.h"
+#include "text_regex.h"
+
+/**
+ * searches over the definitions of one or many dictionaries
+ *
+ *#| definition_matcher is a compiled search, full-text (text_query) or regex
+ *   (text_regex behind a literal prefilter): the filter narrows the scan
+ *   through the optional indexes, find() confirms each entry
+ *#| SearchScheduler runs one search over a whole collection: every planned
+ *   record block of every dictionary is a work item, claimed in order by a
+ *   few looping workers on the shared pool's interactive lane, so big and
+ *   small dictionaries share the cores until the end. Items are interleaved
+ *   by relative position, so every dictionary advances at the same pace.
+ *   The result is the first hits up to the limit in item order, whatever
+ *   the timing of the workers, and progress is weighted by the compressed
+ *   bytes of the planned blocks.
+ */
+
+namespace mdict {
+
+class definition_matcher {
+ public:
+  /**
+   * @param query full-text query, see text_query for the syntax
+   * @throws std::invalid_argument on queries with too many terms
+   */
+  static definition_matcher fulltext(const std::string &query);
+
+  /**
+   * @param pattern regular expression, matched case-insensitively
+   * @throws std::invalid_argument if the pattern does not compile
+   */
+  static definition_matcher regex(const std::string &pattern);
+
+  // matchers keep scratch state, copy one for each thread
+  definition_matcher(const definition_matcher &other);
+  definition_matcher &operator=(const definition_matcher &) = delete;
+
+  /**
+   * @return true if the search cannot match anything (empty query)
+   */
+  bool empty() const { return empty_; }
+
+  /**
+   * @return the literal part of the search, for postings and sketches
+   */
+  const text_query &filter() const { return filter_; }
+
+  /**
+   * match one record, see text_query::find
+   */
+  bool find(const char *data, size_t len, text_match *match);
+
+ private:
+  definition_matcher(text_query filter, std::unique_ptr<text_regex> regex,
+                     bool empty)
+      : filter_(std::move(filter)), regex_(std::move(regex)), empty_(empty) {}
+
+  text_query filter_;
+  std::unique_ptr<text_regex> regex_;
+  bool empty_;
+};
+
+/**
+ * one hit of a search over several dictionaries
+ */
+struct dictionary_hit {
+  // index of the dictionary in the list searched
+  size_t dict = 0;
+  uint64_t entry = 0;
+  fulltext_hit hit;
+};
+
+class SearchScheduler {
+ public:
+  /**
+   * @param dicts dictionaries to search, they must outlive run()
+   * @param matcher the compiled search
+   * @param limit maximum number of hits over all dictionaries, the items
+   *   after the one that reaches it are not searched
+   */
+  SearchScheduler(std::vector<Mdict *> dicts, const definition_matcher &matcher,
+                  size_t limit);
+
+  /**
+   * run the search, the calling thread only waits on the workers, reports
+   * progress and polls for cancellation (so both callbacks run on it)
+   * @param progress receives the fraction of the planned bytes searched
+   * @param cancelled polled while waiting, returning true stops the search
+   * @return the hits ordered by dictionary then entry
+   */
+  std::vector<dictionary_hit> run(const std::function<void(float)> &progress,
+                                  const std::function<bool()> &cancelled);
+
+ private:
+  std::vector<Mdict *> dicts_;
+  definition_matcher matcher_;
+  size_t limit_;
+};
+
+}  // namespace mdict
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * rule based deinflection of japanese verbs and adjectives
+ *
+ *#| a rule rewrites a kana ending (た -> る) and says which word types the
+ *   inflected form must have and which the result has, so rules chain:
+ *   食べさせられた -> 食べさせられる (past) -> 食べさせる (passive) -> 食べる
+ *   (causative)
+ *#| intermediate forms (te-form, past, polite) are pseudo types, which lets
+ *   たら, ている, ました... reuse the past, te and masu rules instead of
+ *   spelling out every combination
+ *#| the rules are indexed by ending, so a word costs a few hash probes per
+ *   candidate; candidates are not checked here, the caller validates them
+ *   against its keys (Mdict::deinflect)
+ */
+
+namespace mdict {
+
+enum DeinflectType : uint32_t {
+  DEINFLECT_V1 = 1,      // ichidan verb
+  DEINFLECT_V5 = 2,      // godan verb
+  DEINFLECT_VS = 4,      // suru verb
+  DEINFLECT_VK = 8,      // kuru verb
+  DEINFLECT_ADJ_I = 16,  // i-adjective
+  DEINFLECT_TE = 32,     // te-form, pseudo type
+  DEINFLECT_TA = 64,     // past form, pseudo type
+  DEINFLECT_MASU = 128,  // polite ます form, pseudo type
+  // types a dictionary form can have
+  DEINFLECT_DICTIONARY_FORM = DEINFLECT_V1 | DEINFLECT_V5 | DEINFLECT_VS |
+                              DEINFLECT_VK | DEINFLECT_ADJ_I
+};
+
+/**
+ * one candidate dictionary form
+ */
+struct deinflection {
+  std::string term;
+  // DeinflectType bits the form can have
+  uint32_t types = 0;
+  // inflections undone, from the dictionary form outwards ("causative",
+  // "passive", "past")
+  std::vector<std::string> reasons;
+};
+
+class Deinflector {
+ public:
+  /**
+   * @return the deinflector with the built-in rule table
+   */
+  static const Deinflector &shared();
+
+  /**
+   * @param word utf-8 inflected word
+   * @return candidate dictionary forms, fewest steps first, the word itself
+   * excluded
+   */
+  std::vector<deinflection> deinflect(const std::string &word) const;
+
+ private:
+  struct rule {
+    const char *from;
+    const char *to;
+    uint32_t types_in;   // types the inflected form may have, 0 if final
+    uint32_t types_out;  // types of the result
+    const char *reason;
+  };
+
+  Deinflector();
+
+  std::vector<rule> rules_;
+  // rule indexes by the ending they remove
+  std::unordered_map<std::string, std::vector<uint32_t>> by_ending_;
+  size_t max_ending_ = 0;
+};
+
+}  // namespace mdict
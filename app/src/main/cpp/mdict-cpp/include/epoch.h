@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * epoch-based reclamation, for data that readers load from an atomic
+ * pointer while writers replace it
+ *
+ *#| a reader pins the current epoch with an EpochGuard for as long as it
+ *   uses what it loaded. Pinning stores the epoch in a slot owned by the
+ *   thread: no lock, no shared counter, nothing a writer can hold up
+ *#| a writer swaps the new version in, then retires the old one, which is
+ *   stamped with the epoch it was replaced in and freed once every pinned
+ *   thread has moved past that epoch (by that or a later retire() or
+ *   collect())
+ *#| a thread takes a slot on its first guard and gives it back when it
+ *   exits. Past MAX_SLOTS threads the extra readers share a counter, and
+ *   nothing is freed while any of them is pinned
+ */
+
+namespace mdict {
+
+class EpochDomain {
+ public:
+  static const size_t MAX_SLOTS = 128;
+
+  /**
+   * process-wide domain, used by every dictionary
+   */
+  static EpochDomain &shared();
+
+  /**
+   * free something once no reader can still see it; call after it has
+   * been unpublished
+   * @param deleter frees it, run on the thread of a later retire() or
+   * collect()
+   */
+  void retire(std::function<void()> deleter);
+
+  /**
+   * free what was retired before the oldest pinned epoch
+   */
+  void collect();
+
+ private:
+  friend class EpochGuard;
+  static constexpr uint64_t IDLE = UINT64_MAX;
+
+  struct alignas(64) slot {
+    std::atomic<uint64_t> epoch{IDLE};
+    std::atomic<bool> owned{false};
+  };
+  // the calling thread's slot and guard nesting
+  struct thread_state;
+  static thread_state &this_thread();
+
+  EpochDomain() = default;
+  // a free slot for the calling thread, -1 if all are taken
+  int acquire_slot();
+  void release_slot(int slot);
+
+  std::atomic<uint64_t> epoch_{1};
+  std::atomic<uint64_t> unslotted_readers_{0};
+  slot slots_[MAX_SLOTS];
+  std::mutex retired_mutex_;
+  std::vector<std::pair<uint64_t, std::function<void()>>> retired_;
+};
+
+/**
+ * pins the calling thread in EpochDomain::shared() for its scope; guards
+ * nest
+ */
+class EpochGuard {
+ public:
+  EpochGuard();
+  ~EpochGuard();
+  EpochGuard(const EpochGuard &) = delete;
+  EpochGuard &operator=(const EpochGuard &) = delete;
+};
+
+}  // namespace mdict
@@ -8,7 +8,11 @@
 
 #pragma once
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <cstdio>
+#include <string>
 
 /**
  * Gets the size of a binary file in bytes
@@ -28,3 +32,37 @@ inline static int64_t fsizeof(const char* fpath) {
   std::fclose(f);
   return size;
 }
+
+/**
+ * Flushes a stdio stream down to the storage device and closes it
+ *
+ * @param f The stream to close
+ * @return bool True if every byte reached the disk, false otherwise
+ */
+inline static bool fclose_durable(FILE* f) {
+  if (!f) return false;
+  bool ok = std::fflush(f) == 0 && fsync(fileno(f)) == 0;
+  ok = (std::fclose(f) == 0) && ok;
+  return ok;
+}
+
+/**
+ * Atomically replaces dst with an already durable tmp file
+ * Readers see either the old file or the complete new one, never a partial
+ * write, even if the process is killed in between
+ *
+ * @param tmp Path of the fully written and fsynced temporary file
+ * @param dst Final path, in the same directory as tmp
+ * @return bool True if the rename and the directory sync succeeded
+ */
+inline static bool publish_file(const std::string& tmp, const std::string& dst) {
+  if (std::rename(tmp.c_str(), dst.c_str()) != 0) return false;
+  // persist the directory entry as well, otherwise the rename may be lost
+  std::string dir = dst.substr(0, dst.find_last_of('/'));
+  int dfd = open(dir.empty() ? "/" : dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (dfd >= 0) {
+    fsync(dfd);
+    close(dfd);
+  }
+  return true;
+}
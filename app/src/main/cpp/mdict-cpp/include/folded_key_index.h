@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "index_builder.h"
+#include "index_io.h"
+#include "key_fold.h"
+
+/**
+ * the keys of a dictionary folded once and sorted by their folded form, so
+ * case, width, accent and kana insensitive lookups are binary searches
+ *
+ *#| built by the background index job like the other optional indexes;
+ *   until it is published, lookups fall back to a binary search of the key
+ *   list with the ASCII-only _s() comparison
+ *#| folded keys live back to back in one arena, indexed by entry id; the
+ *   sorted array holds the entry ids ordered by (folded key, entry id)
+ *#| foldedkeys.idx layout (little-endian)
+ *    | [0:4]   magic "VDFK"
+ *    | [4:8]   format version
+ *    | [8:16]  dictionary fingerprint
+ *    | [16:24] key count
+ *    | [24:32] arena bytes
+ *    | key starts: (key count + 1) x u32 arena offset
+ *    | sorted: key count x u32 entry id
+ *    | arena
+ */
+
+namespace mdict {
+
+class Mdict;
+
+class FoldedKeysJob : public IndexJob {
+ public:
+  // 1: KEY_FOLD_LOOSE with unicode case folding
+  static const uint32_t FORMAT_VERSION = 1;
+
+  std::string name() const override { return "foldedkeys"; }
+  uint32_t format_version() const override { return FORMAT_VERSION; }
+  bool needs_records() const override { return false; }
+  void add_block(const Mdict &dict, const record_block_view &block) override;
+  bool write_segment(FILE *out) override;
+  bool merge(const Mdict &dict, const std::vector<std::string> &segments,
+             FILE *out) override;
+
+ private:
+  // u32 entry, u32 length, folded key, per key
+  std::vector<unsigned char> buffer_;
+  uint64_t count_ = 0;
+  std::string folded_;
+};
+
+/**
+ * read side of foldedkeys.idx; the arena stays mapped, the two arrays are
+ * loaded so ranges can point into them
+ */
+class FoldedKeyIndex {
+ public:
+  using range = std::pair<const uint32_t *, const uint32_t *>;
+
+  /**
+   * map a folded key file
+   * @param path foldedkeys.idx path
+   * @param fingerprint the dictionary fingerprint it must have been built for
+   * @param count the number of entries of the dictionary
+   * @return false if the file is missing, stale or malformed
+   */
+  bool open(const std::string &path, uint64_t fingerprint, size_t count);
+
+  // how the keys are folded
+  const KeyFolder &folder() const { return KeyFolder::get(KEY_FOLD_LOOSE); }
+  size_t size() const { return sorted_.size(); }
+
+  /**
+   * @return the folded key of an entry
+   */
+  std::string_view folded(uint32_t entry) const {
+    return std::string_view(arena_ + starts_[entry], starts_[entry + 1] - starts_[entry]);
+  }
+
+  /**
+   * @param folded an already folded key
+   * @return entry ids whose folded key is equal, in entry order
+   */
+  range equal_range(std::string_view folded) const;
+
+  /**
+   * @param folded an already folded prefix, not empty
+   * @return entry ids whose folded key starts with it, in folded order
+   */
+  range prefix_range(std::string_view folded) const;
+
+  /**
+   * walk the sorted keys along a text like a trie, each byte narrowing the
+   * range of keys that can still match
+   * @param folded an already folded text
+   * @param max_length stop after this many bytes
+   * @return (length, entries) of every prefix of the text that is a key,
+   * shortest first
+   */
+  std::vector<std::pair<size_t, range>> common_prefixes(
+      std::string_view folded, size_t max_length = 256) const;
+
+ private:
+  mapped_file file_;
+  const char *arena_ = nullptr;
+  std::vector<uint32_t> starts_;
+  std::vector<uint32_t> sorted_;
+};
+
+}  // namespace mdict
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * plain-text view of html definitions, shared by the full-text search and
+ * the indexes built for it, so both see exactly the same characters
+ */
+
+namespace mdict {
+
+/**
+ * case fold one code point (locale independent)
+ */
+char32_t fold_char(char32_t c);
+
+/**
+ * @return true for ideographs, kana and hangul, which are not space
+ * delimited
+ */
+bool is_cjk(char32_t c);
+
+/**
+ * decode one utf-8 code point, invalid bytes decode as U+FFFD
+ * @param p current position, must be < end
+ * @param end end of the buffer
+ * @param cp receives the code point
+ * @return number of bytes consumed (at least 1)
+ */
+size_t decode_utf8(const unsigned char *p, const unsigned char *end,
+                   char32_t &cp);
+
+/**
+ * append a code point to a utf-8 string
+ */
+void append_utf8(std::string &out, char32_t cp);
+
+/**
+ * fold plain utf-8 text (a query) the same way as html_to_search_text
+ * @param text utf-8 text
+ * @param out receives the folded text
+ */
+void fold_text(const std::string &text, std::u32string &out);
+
+/**
+ * extract the searchable text of an html record
+ * tags, comments, script and style bodies are skipped, common entities are
+ * decoded, block tags and whitespace runs become a single space and every
+ * character is case folded
+ * @param data record bytes (utf-8)
+ * @param len record length, a trailing null is ignored
+ * @param out receives the folded text (cleared first)
+ */
+void html_to_search_text(const char *data, size_t len, std::u32string &out);
+
+/**
+ * the start of the plain text of an html record, as rendered (not folded)
+ * @param data record bytes (utf-8)
+ * @param len record length
+ * @param max_chars characters kept, an ellipsis marks a cut
+ */
+std::string html_preview(const char *data, size_t len, size_t max_chars);
+
+/**
+ * @return true for the whitespace characters html rendering collapses
+ * (plus null, nbsp and the ideographic space)
+ */
+bool html_is_space(char32_t c);
+
+/**
+ * decode the entity starting at p (pointing at '&')
+ * @return bytes consumed, 0 if this is not an entity we know
+ */
+size_t html_decode_entity(const char *p, const char *end, char32_t &cp);
+
+/**
+ * skip the tag starting at p (pointing at '<')
+ * @param separates set if the tag separates words when rendered
+ * @return position after the tag (and after the element body for script and
+ * style)
+ */
+const char *html_skip_tag(const char *p, const char *end, bool &separates);
+
+/**
+ * @return true if p (pointing at '<') starts a tag, comment or declaration
+ */
+inline bool html_is_tag_start(const char *p, const char *end) {
+  if (p + 1 >= end) return false;
+  char c = p[1];
+  return ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || c == '/' || c == '!' ||
+         c == '?';
+}
+
+/**
+ * walk the plain text of an html record, in one pass
+ * sink(c) receives every character (not folded) with whitespace runs
+ * collapsed to a single ' ' and no leading or trailing space, and returns
+ * false to stop the walk
+ */
+template <class Sink>
+void walk_html(const char *data, size_t len, Sink &&sink) {
+  const char *p = data;
+  const char *end = data + len;
+  bool pending_space = false;
+  bool any = false;
+  auto emit = [&](char32_t c) {
+    if (html_is_space(c)) {
+      pending_space = any;
+      return true;
+    }
+    if (pending_space) {
+      pending_space = false;
+      if (!sink(U' ')) return false;
+    }
+    any = true;
+    return sink(c);
+  };
+  while (p < end) {
+    char32_t cp;
+    if (*p == '<' && html_is_tag_start(p, end)) {
+      bool separates;
+      p = html_skip_tag(p, end, separates);
+      if (separates) emit(U' ');
+      continue;
+    } else if (*p == '&') {
+      size_t n = html_decode_entity(p, end, cp);
+      if (n) {
+        p += n;
+      } else {
+        cp = '&';
+        ++p;
+      }
+    } else {
+      p += decode_utf8(reinterpret_cast<const unsigned char *>(p),
+                       reinterpret_cast<const unsigned char *>(end), cp);
+    }
+    if (!emit(cp)) return;
+  }
+}
+
+}  // namespace mdict
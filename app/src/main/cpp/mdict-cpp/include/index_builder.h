@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * background index build
+ *
+ *#| the builder makes one pass over all record blocks and feeds every pending
+ *   job. Every ~CHECKPOINT_BYTES of decompressed input it asks each job to
+ *   flush its in-memory state into a segment file, then durably writes a
+ *   checkpoint naming the next block and the number of complete segments.
+ *#| index dir layout (one dir per dictionary, under the app cache dir)
+ *    | build.ckpt        - last durable checkpoint
+ *    | <job>.seg<n>      - segment n of a job, valid only if n < checkpoint
+ *    |                     segment count
+ *    | <job>.idx         - the published index
+ *#| after process death the builder reloads build.ckpt, drops orphan
+ *   segments and continues with the next block. When all blocks are done,
+ *   each job merges its segments into <job>.idx.tmp, which is fsynced and
+ *   renamed over <job>.idx, so readers only ever map a complete index.
+ */
+
+namespace mdict {
+
+class Mdict;
+struct record_block_view;
+
+/**
+ * one optional index structure built from the record blocks
+ */
+class IndexJob {
+ public:
+  virtual ~IndexJob() = default;
+
+  /**
+   * stable job name, used for the segment and index file names
+   */
+  virtual std::string name() const = 0;
+
+  /**
+   * on-disk format version, a checkpoint from another version is discarded
+   */
+  virtual uint32_t format_version() const = 0;
+
+  /**
+   * false if the job only reads the entry range of each block; when no job
+   * needs them the builder does not read or inflate the records
+   */
+  virtual bool needs_records() const { return true; }
+
+  /**
+   * consume one decoded record block (called in block order)
+   * @param dict the dictionary being indexed
+   * @param block the decompressed block and its entry range
+   */
+  virtual void add_block(const Mdict &dict, const record_block_view &block) = 0;
+
+  /**
+   * persist the state accumulated since the last segment and reset it
+   * @param out the segment file
+   * @return true on success
+   */
+  virtual bool write_segment(FILE *out) = 0;
+
+  /**
+   * merge all segments (in block order) into the final index
+   * @param dict the dictionary being indexed
+   * @param segments segment file paths
+   * @param out the index file
+   * @return true on success
+   */
+  virtual bool merge(const Mdict &dict, const std::vector<std::string> &segments,
+                     FILE *out) = 0;
+};
+
+enum class IndexBuildState {
+  IDLE = 0,
+  RUNNING = 1,
+  DONE = 2,
+  CANCELLED = 3,
+  FAILED = 4
+};
+
+/**
+ * resumable, checkpointed index builder running on the background lane
+ */
+class IndexBuilder {
+ public:
+  /**
+   * constructor
+   * @param dict the dictionary to index, must outlive the builder
+   * @param dir the index dir of this dictionary
+   */
+  IndexBuilder(Mdict *dict, std::string dir);
+
+  /**
+   * deconstructor, cancels and waits for the running build
+   */
+  ~IndexBuilder();
+
+  /**
+   * start building in the background
+   * @param jobs the jobs to build, empty means nothing to do
+   * @param on_published invoked with the job name once its index is in place
+   * @return false if a build is already running, there is nothing to do or
+   * the task pool is shutting down (state() is then FAILED)
+   */
+  bool start(std::vector<std::unique_ptr<IndexJob>> jobs,
+             std::function<void(const std::string &)> on_published);
+
+  /**
+   * request cancellation; the build stops after the current block and
+   * resumes from the last checkpoint next time
+   */
+  void cancel();
+
+  /**
+   * block until the running build (if any) has stopped
+   */
+  void wait();
+
+  IndexBuildState state() const { return state_.load(); }
+
+  /**
+   * @return fraction of record blocks processed by the current build
+   */
+  float progress() const;
+
+ private:
+  // decompressed bytes between two checkpoints
+  static const uint64_t CHECKPOINT_BYTES = 16ull << 20;
+
+  struct checkpoint {
+    uint64_t next_block = 0;
+    uint32_t segments = 0;
+  };
+
+  void run();
+  bool load_checkpoint(checkpoint &ckpt);
+  bool save_checkpoint(const checkpoint &ckpt);
+  void remove_segments(uint32_t from);
+  std::string segment_path(const IndexJob &job, uint32_t n) const;
+
+  Mdict *dict_;
+  const std::string dir_;
+  std::vector<std::unique_ptr<IndexJob>> jobs_;
+  std::function<void(const std::string &)> on_published_;
+
+  std::atomic<IndexBuildState> state_{IndexBuildState::IDLE};
+  std::atomic<bool> cancel_{false};
+  std::atomic<uint64_t> blocks_done_{0};
+  uint64_t blocks_total_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable done_cv_;
+  bool running_ = false;
+};
+
+}  // namespace mdict
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+ * Helpers for the index sidecar files in the cache dir
+ * All numbers are little-endian, unlike the big-endian mdict format
+ */
+
+inline bool write_u32(FILE *f, uint32_t v) {
+  unsigned char b[4] = {(unsigned char)v, (unsigned char)(v >> 8),
+                        (unsigned char)(v >> 16), (unsigned char)(v >> 24)};
+  return std::fwrite(b, 1, 4, f) == 4;
+}
+
+inline bool write_u64(FILE *f, uint64_t v) {
+  return write_u32(f, (uint32_t)v) && write_u32(f, (uint32_t)(v >> 32));
+}
+
+inline bool read_u32(FILE *f, uint32_t &v) {
+  unsigned char b[4];
+  if (std::fread(b, 1, 4, f) != 4) return false;
+  v = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+  return true;
+}
+
+inline bool read_u64(FILE *f, uint64_t &v) {
+  uint32_t lo = 0, hi = 0;
+  if (!read_u32(f, lo) || !read_u32(f, hi)) return false;
+  v = ((uint64_t)hi << 32) | lo;
+  return true;
+}
+
+inline uint32_t load_u32(const unsigned char *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline uint64_t load_u64(const unsigned char *p) {
+  return ((uint64_t)load_u32(p + 4) << 32) | load_u32(p);
+}
+
+/**
+ * append an unsigned LEB128 varint
+ */
+inline void put_varint(std::vector<unsigned char> &out, uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back((unsigned char)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((unsigned char)v);
+}
+
+/**
+ * decode an unsigned LEB128 varint
+ * @return pointer past the varint, or nullptr if it runs past end
+ */
+inline const unsigned char *get_varint(const unsigned char *p,
+                                       const unsigned char *end, uint64_t &v) {
+  v = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    unsigned char b = *p++;
+    v |= (uint64_t)(b & 0x7f) << shift;
+    if (!(b & 0x80)) return p;
+  }
+  return nullptr;
+}
+
+/**
+ * read-only memory mapping of a whole file
+ */
+class mapped_file {
+ public:
+  mapped_file() = default;
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+  ~mapped_file() { unmap(); }
+
+  /**
+   * map a file
+   * @param path file path
+   * @return false if the file is missing, empty or cannot be mapped
+   */
+  bool map(const std::string &path) {
+    unmap();
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+      close(fd);
+      return false;
+    }
+    void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return false;
+    data_ = static_cast<const unsigned char *>(p);
+    size_ = (size_t)st.st_size;
+    return true;
+  }
+
+  void unmap() {
+    if (data_) munmap(const_cast<unsigned char *>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  const unsigned char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const unsigned char *data_ = nullptr;
+  size_t size_ = 0;
+};
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "index_builder.h"
+#include "index_io.h"
+
+/**
+ * per dictionary Bloom filter over the folded keys, so a collection lookup
+ * can skip the dictionaries that certainly lack a word
+ *
+ *#| keys are folded with KEY_FOLD_LOOSE, the folding lookup() matches
+ *   with, so a word the filter rejects has no entry to look up
+ *#| the filter is blocked: the first hash picks one 64 byte block and all
+ *   KEY_FILTER_PROBES bits are set inside it, so a query touches one cache
+ *   line. ~12 bits per key, about 0.5% false positives
+ *#| built from the key list only, the job does not need the record blocks
+ *#| keyfilter.idx layout (little-endian)
+ *    | [0:4]   magic "VDKF"
+ *    | [4:8]   format version
+ *    | [8:16]  dictionary fingerprint
+ *    | [16:24] key count
+ *    | [24:32] block count
+ *    | [32:64] reserved, zero
+ *    | blocks: block count x 64 bytes
+ */
+
+namespace mdict {
+
+class Mdict;
+
+/**
+ * @param folded a key folded with KEY_FOLD_LOOSE
+ * @return its filter hash
+ */
+uint64_t key_filter_hash(std::string_view folded);
+
+class KeyFilterJob : public IndexJob {
+ public:
+  static const uint32_t FORMAT_VERSION = 1;
+
+  std::string name() const override { return "keyfilter"; }
+  uint32_t format_version() const override { return FORMAT_VERSION; }
+  bool needs_records() const override { return false; }
+  void add_block(const Mdict &dict, const record_block_view &block) override;
+  bool write_segment(FILE *out) override;
+  bool merge(const Mdict &dict, const std::vector<std::string> &segments,
+             FILE *out) override;
+
+ private:
+  std::vector<uint64_t> hashes_;
+  std::string folded_;
+};
+
+/**
+ * read side of keyfilter.idx, memory mapped
+ */
+class KeyFilter {
+ public:
+  /**
+   * map a filter file
+   * @param path keyfilter.idx path
+   * @param fingerprint the dictionary fingerprint it must have been built for
+   * @return false if the file is missing, stale or malformed
+   */
+  bool open(const std::string &path, uint64_t fingerprint);
+
+  /**
+   * @param hash key_filter_hash() of the folded word
+   * @return false only if no key folds to the word
+   */
+  bool may_contain(uint64_t hash) const;
+
+ private:
+  mapped_file file_;
+  uint64_t block_count_ = 0;
+  const unsigned char *blocks_ = nullptr;
+};
+
+/**
+ * which dictionaries of a collection may have a word, the word is folded
+ * and hashed once
+ * @param dicts dictionaries searched together
+ * @param word the word to look up
+ * @return indexes into dicts, ascending; dictionaries without a filter are
+ * always included
+ */
+std::vector<uint32_t> dictionaries_may_contain(const std::vector<Mdict *> &dicts,
+                                               const std::string &word);
+
+}  // namespace mdict
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * unicode folding of headwords, so a query finds its key whatever the case,
+ * width, accents or kana script it is typed in
+ *
+ *#| the steps, each optional, in this order:
+ *    | width:       full-width ascii -> ascii, half-width katakana ->
+ *                   katakana (ｶﾞ -> ガ), ideographic / no-break space -> space,
+ *                   ligatures (ﬁ -> fi); the width part of NFKC
+ *    | case:        simple case folding for Latin, Greek, Cyrillic, Armenian
+ *                   and Georgian, plus ß -> ss
+ *    | diacritics:  Latin and Greek letters lose their marks (é -> e,
+ *                   ά -> α, ё -> е), æ -> ae, œ -> oe, combining marks go
+ *    | kana:        katakana -> hiragana
+ *    | punctuation: the separators _s() ignores, and their CJK forms
+ *#| the steps are compiled once per mode into a table of 256 pages of 256
+ *   code points (pages nothing maps share one empty page), so folding costs
+ *   one lookup per character; code points above the BMP are kept as is
+ *#| the folded form is only used to compare and sort, never shown
+ */
+
+namespace mdict {
+
+enum KeyFold : uint32_t {
+  KEY_FOLD_CASE = 1,
+  KEY_FOLD_WIDTH = 2,
+  KEY_FOLD_PUNCTUATION = 4,
+  KEY_FOLD_DIACRITICS = 8,
+  KEY_FOLD_KANA = 16,
+  // what an exact lookup ignores, a superset of _s()
+  KEY_FOLD_STRICT = KEY_FOLD_CASE | KEY_FOLD_WIDTH | KEY_FOLD_PUNCTUATION,
+  // what the folded key index ignores
+  KEY_FOLD_LOOSE = KEY_FOLD_STRICT | KEY_FOLD_DIACRITICS | KEY_FOLD_KANA
+};
+
+class KeyFolder {
+ public:
+  /**
+   * @param mode KeyFold bits
+   * @return the folder of that mode, built on first use and kept
+   */
+  static const KeyFolder &get(uint32_t mode);
+
+  uint32_t mode() const { return mode_; }
+
+  /**
+   * @param text utf-8 text, invalid bytes fold to U+FFFD
+   * @return the folded text (utf-8)
+   */
+  std::string fold(std::string_view text) const;
+
+  /**
+   * @param text utf-8 text
+   * @param out receives the folded text (cleared first)
+   */
+  void fold(std::string_view text, std::string &out) const;
+
+  /**
+   * @return c folded on its own; c itself where the mode expands it to
+   * several code points or drops it
+   */
+  char32_t fold_char(char32_t c) const {
+    if (c > 0xFFFF) return c;
+    uint32_t entry = this->pages_[c >> 8][c & 0xFF];
+    return entry == 0 || entry == FOLD_REMOVE || (entry & FOLD_EXPAND) ? c : entry;
+  }
+
+ private:
+  explicit KeyFolder(uint32_t mode);
+
+  // page entries: 0 keeps the code point, FOLD_REMOVE drops it,
+  // FOLD_EXPAND | i writes expansions_[i], anything else replaces it
+  static const uint32_t FOLD_REMOVE = 0xFFFFFFFFu;
+  static const uint32_t FOLD_EXPAND = 0x80000000u;
+
+  uint32_t mode_;
+  const uint32_t *pages_[256];
+  std::vector<std::unique_ptr<uint32_t[]>> owned_pages_;
+  std::vector<std::u32string> expansions_;
+};
+
+/**
+ * @return text folded with KeyFolder::get(mode)
+ */
+std::string fold_key(std::string_view text, uint32_t mode = KEY_FOLD_LOOSE);
+
+}  // namespace mdict
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "index_builder.h"
+#include "index_io.h"
+
+/**
+ * suffix array over the folded headwords, for infix and suffix key search
+ * ("graph" in "autograph", "tion" at the end) without scanning the key list
+ *
+ *#| keys are folded with KEY_FOLD_LOOSE and stored back to back, each ended
+ *   by a NUL; the array holds every position of the arena that starts a
+ *   code point, sorted by the NUL terminated text from there. A substring is
+ *   the prefix of a range of suffixes (two binary searches), a key suffix is
+ *   the same with the NUL included
+ *#| keysuffix.idx layout (little-endian)
+ *    | [0:4]   magic "VDSA"
+ *    | [4:8]   format version
+ *    | [8:16]  dictionary fingerprint
+ *    | [16:24] key count
+ *    | [24:32] suffix count
+ *    | [32:40] arena bytes
+ *    | key starts: (key count + 1) x u32 arena offset
+ *    | key entries: key count x u32 key list index
+ *    | suffixes: suffix count x u32 arena offset
+ *    | arena
+ */
+
+namespace mdict {
+
+class Mdict;
+
+class KeySuffixJob : public IndexJob {
+ public:
+  static const uint32_t FORMAT_VERSION = 1;
+
+  std::string name() const override { return "keysuffix"; }
+  uint32_t format_version() const override { return FORMAT_VERSION; }
+  bool needs_records() const override { return false; }
+  void add_block(const Mdict &dict, const record_block_view &block) override;
+  bool write_segment(FILE *out) override;
+  bool merge(const Mdict &dict, const std::vector<std::string> &segments,
+             FILE *out) override;
+
+ private:
+  // u32 entry, u32 length, folded key, per key
+  std::vector<unsigned char> buffer_;
+  uint64_t count_ = 0;
+  std::string folded_;
+};
+
+/**
+ * read side of keysuffix.idx, memory mapped
+ */
+class KeySuffixIndex {
+ public:
+  /**
+   * map a suffix array file
+   * @param path keysuffix.idx path
+   * @param fingerprint the dictionary fingerprint it must have been built for
+   * @return false if the file is missing, stale or malformed
+   */
+  bool open(const std::string &path, uint64_t fingerprint);
+
+  /**
+   * @param folded text folded with KEY_FOLD_LOOSE, not empty
+   * @param at_end only keys ending with it
+   * @return key list indexes of the keys containing it, ascending
+   */
+  std::vector<uint32_t> find(std::string_view folded, bool at_end) const;
+
+  /**
+   * @return the number of places the text occurs at (at most one per key
+   * with at_end), without listing them
+   */
+  size_t count(std::string_view folded, bool at_end) const;
+
+ private:
+  uint32_t offset_at(uint64_t i) const { return load_u32(suffixes_ + i * 4); }
+  // [first, last) of the sorted suffixes starting with the text
+  std::pair<uint64_t, uint64_t> range(std::string_view folded, bool at_end) const;
+  // the suffix starting at an arena offset, up to its NUL
+  std::string_view suffix(uint32_t offset) const;
+
+  mapped_file file_;
+  uint64_t key_count_ = 0;
+  uint64_t suffix_count_ = 0;
+  uint64_t arena_bytes_ = 0;
+  const unsigned char *starts_ = nullptr;
+  const unsigned char *entries_ = nullptr;
+  const unsigned char *suffixes_ = nullptr;
+  const char *arena_ = nullptr;
+};
+
+}  // namespace mdict
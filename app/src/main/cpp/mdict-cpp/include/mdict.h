@@ -10,15 +10,35 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>  // std::stof
+#include <unordered_map>
 #include <vector>
 
+#include "affix_stemmer.h"
+#include "anagram_index.h"
+#include "block_cache.h"
+#include "block_scrub.h"
+#include "block_sketch.h"
+#include "deinflector.h"
+#include "epoch.h"
+#include "folded_key_index.h"
+#include "index_builder.h"
+#include "key_filter.h"
+#include "key_fold.h"
+#include "key_suffix_index.h"
 #include "mdict_extern.h"
+#include "ngram_index.h"
 #include "ripemd128.h"
+#include "term_index.h"
+#include "text_query.h"
+#include "transliterator.h"
 
 /**
  * mdx struct analysis
@@ -156,6 +176,9 @@ class key_block_info {
   // key block decompressed size
   unsigned long key_block_decomp_size;
   unsigned long key_block_decomp_accumulator;
+  // number of entries in this key block, and in the blocks before it
+  unsigned long num_entries = 0;
+  unsigned long entries_accumulator = 0;
 
   /**
    * constructor
@@ -233,6 +256,109 @@ class record {
   }
 };
 
+/**
+ * optional index kinds, a bitmask for Mdict::start_index_build
+ */
+enum index_kind : uint32_t {
+  INDEX_NGRAM = 1u << 0,         // character n-gram postings for full-text search
+  INDEX_BLOCK_SKETCH = 1u << 1,  // per record block gram sketches
+  INDEX_KEY_FILTER = 1u << 2,    // Bloom filter over the folded keys
+  INDEX_ANAGRAM = 1u << 3,       // keys grouped by their sorted letters
+  INDEX_KEY_SUFFIX = 1u << 4,    // suffix array over the folded keys
+  INDEX_TERMS = 1u << 5,         // word postings with frequencies, for ranked search
+  INDEX_FOLDED_KEYS = 1u << 6,   // keys folded and sorted, for insensitive lookups
+};
+
+/**
+ * everything a dictionary builds or loads beside its key list, as one
+ * immutable value: a change publishes a new snapshot instead of changing
+ * this one, so lookups read it without locks (see epoch.h)
+ */
+struct index_snapshot {
+  std::shared_ptr<NgramIndex> ngram;
+  std::shared_ptr<BlockSketchIndex> block_sketch;
+  std::shared_ptr<KeyFilter> key_filter;
+  std::shared_ptr<AnagramIndex> anagram;
+  std::shared_ptr<KeySuffixIndex> key_suffix;
+  std::shared_ptr<TermIndex> terms;
+  std::shared_ptr<FoldedKeyIndex> folded_keys;
+  std::shared_ptr<AffixStemmer> stemmer;
+  std::shared_ptr<RomanizedKeyIndex> romanized_keys;
+};
+
+/**
+ * one full-text search result
+ */
+struct fulltext_hit {
+  std::string key;
+  // plain text around the first match and the match range in it (UTF-16
+  // code units)
+  std::string snippet;
+  uint32_t match_start = 0;
+  uint32_t match_end = 0;
+  // relevance, from ranked_search only (0 for scans in dictionary order)
+  float score = 0;
+};
+
+/**
+ * one entry found by a lookup, without its definition (see
+ * Mdict::lookup_entries)
+ */
+struct entry_meta {
+  // key list index, for Mdict::definitions
+  uint32_t entry = 0;
+  // definition length in bytes
+  uint32_t length = 0;
+  // true if the definition is an @@@LINK= redirect to target
+  bool redirect = false;
+  std::string target;
+  // start of the definition's plain text, empty for redirects or if not
+  // asked for
+  std::string preview;
+};
+
+/**
+ * paging and control of the scans over definitions (full-text and regex)
+ */
+struct scan_options {
+  // entry id to resume from (0 for a new search), advanced to where the next
+  // page starts, entry_count() once the dictionary is exhausted
+  uint64_t cursor = 0;
+  // results per page
+  size_t limit = 50;
+  // receives the fraction of the search done
+  std::function<void(float)> progress;
+  // polled between entries, returning true stops the scan at the cursor
+  std::function<bool()> cancelled;
+};
+
+/**
+ * one record block of a planned definition scan
+ */
+struct scan_unit {
+  unsigned long block_id = 0;
+  // compressed size, weights the progress
+  uint64_t bytes = 0;
+  // candidate entries (sorted) when an index narrowed the search, otherwise
+  // every entry of the block
+  bool all_entries = true;
+  std::vector<uint32_t> entries;
+};
+
+class definition_matcher;
+
+/**
+ * a decompressed record block together with the entries stored in it
+ */
+struct record_block_view {
+  unsigned long block_id = 0;
+  const unsigned char *data = nullptr;
+  size_t size = 0;
+  // key list index range [first_entry, last_entry) of this block
+  unsigned long first_entry = 0;
+  unsigned long last_entry = 0;
+};
+
 /**
  * Mdict class definition
  */
@@ -251,10 +377,18 @@ class Mdict {
   Mdict(int fd, bool is_mdd) noexcept;
 
   /**
-   * constructor with additional files
+   * constructor for a dictionary stored at an offset of a larger file, such
+   * as an uncompressed ZIP member
+   * @param fd file descriptor, owned like above
+   * @param base_offset where the dictionary's first byte is in the file
+   */
+  Mdict(int fd, bool is_mdd, uint64_t base_offset) noexcept;
+
+  /**
+   * constructor with additional files, init() also loads the stemmer
    * @param fn dictionary file name
-   * @param aff_fn affix file name
-   * @param dic_fn dictionary file name
+   * @param aff_fn hunspell affix file name
+   * @param dic_fn hunspell word list file name
    */
   Mdict(std::string fn, std::string aff_fn, std::string dic_fn) noexcept;
 
@@ -265,11 +399,34 @@ class Mdict {
 
   /**
    * lookup the definition of a word
+   * case, width and punctuation are ignored, and accents and kana script
+   * too when nothing else matches (see key_fold.h)
    * @param word the word wich we want to search
    * @return
    */
   std::vector<std::string> lookup(std::string word);
 
+  /**
+   * first phase of a two-phase lookup: the entries lookup() returns, in
+   * the same order, with their length, redirect and an optional preview;
+   * their blocks are decompressed but no definition is copied
+   * @param word the word to look up
+   * @param preview_chars plain text characters of each definition to keep,
+   * 0 for no preview
+   * @return the entries, empty if the word has none
+   */
+  std::vector<entry_meta> lookup_entries(const std::string &word,
+                                         size_t preview_chars = 0);
+
+  /**
+   * second phase: the definitions of some entries, each record block read
+   * once however many of its entries are asked for
+   * @param entries key list indexes, from lookup_entries()
+   * @return the definitions, in the order of entries
+   * @throws std::out_of_range for an index past the key list
+   */
+  std::vector<std::string> definitions(const std::vector<uint32_t> &entries);
+
   /**
    * lookup the definition of a word by system search finction from all keys list
    * @param word the word wich we want to search
@@ -289,19 +446,33 @@ class Mdict {
 
   /**
    * suggest simuler word which matches the prefix
+   * keys are compared folded with KEY_FOLD_LOOSE, the ones that also match
+   * under KEY_FOLD_STRICT come first, then keys in other scripts whose
+   * romanized form starts with a latin prefix (see transliterator.h)
    * @param word the word's prefix
-   * @param prefix_len the word's length (optional)
    * @return
    */
   std::vector<std::string> suggest(const std::string word);
 
   /**
    * suggest words matching a regex pattern
+   * an anchored literal prefix narrows the keys by binary search, otherwise
+   * the longest literal does through the key suffix array once built
    * @param regex_str the regex pattern
    * @return vector of matching words
    */
   std::vector<std::string> regex_suggest(const std::string regex_str);
 
+  /**
+   * words spelled with some letters, for word games (see anagram_index.h);
+   * uses the anagram index once built, else scans the folded keys
+   * @param letters the tiles, '?' or '.' is a blank
+   * @param subset false for keys using every tile, true for keys using
+   * some of them
+   * @return the keys, longest first then in key order
+   */
+  std::vector<std::string> anagrams(const std::string &letters, bool subset);
+
   /**
    * search for text within definitions
    * @param query the text to search for
@@ -310,12 +481,130 @@ class Mdict {
   std::vector<std::string> fulltext_search(const std::string query, std::function<void(float)> progress_callback = nullptr);
 
   /**
-   *
-   * @param word
-   * @return
+   * search for text within definitions, matching their plain text (tags
+   * skipped, entities decoded, case folded)
+   * @param query the text to search for
+   * @param progress_callback receives the fraction of the search done
+   * @return the matching entries with a snippet around the match
+   */
+  std::vector<fulltext_hit> fulltext_search_hits(const std::string &query,
+                                                 std::function<void(float)> progress_callback = nullptr);
+
+  /**
+   * one page of a full-text search, see text_query for the query syntax
+   * @param query the text to search for
+   * @param options cursor, page size, progress and cancellation
+   * @return the matching entries with a snippet around the match
+   */
+  std::vector<fulltext_hit> fulltext_search_hits(const std::string &query,
+                                                 scan_options &options);
+
+  /**
+   * full-text search ranked by relevance: BM25 over the words of the
+   * definitions, plus a bonus for the entries whose headword is the query
+   * (or one of its words); needs the term index (INDEX_TERMS)
+   * @param query words, any of them may match; query operators are not
+   * interpreted
+   * @param limit results wanted
+   * @return the best entries, best first, with a snippet and their score;
+   * empty without a term index
+   */
+  std::vector<fulltext_hit> ranked_search(const std::string &query, size_t limit);
+
+  /**
+   * @return true once the term index is loaded, so ranked_search can answer
+   */
+  bool has_term_index();
+
+  /**
+   * one page of a regex search over the plain text of the definitions, see
+   * text_regex for the syntax
+   * @param pattern the regular expression (case-insensitive)
+   * @param options cursor, page size, progress and cancellation
+   * @return the matching entries with a snippet around the match
+   * @throws std::invalid_argument if the pattern does not compile
+   */
+  std::vector<fulltext_hit> regex_search_hits(const std::string &pattern,
+                                              scan_options &options);
+
+  /**
+   * plan a definition scan: the record blocks to read, narrowed by the
+   * n-gram postings or block sketches of the filter when they are built
+   * @param filter the literal part of the search
+   * @param cursor first entry to search
+   * @return the blocks in entry order
+   */
+  std::vector<scan_unit> plan_definition_scan(const text_query &filter,
+                                              uint64_t cursor);
+
+  /**
+   * search the entries of one planned block, safe to call from several
+   * threads with one matcher each
+   * @param unit the block and its candidate entries
+   * @param cursor entries before it are skipped
+   * @param matcher the compiled search
+   * @param on_hit receives each matching entry, returns false to stop
+   * @param cancelled polled between entries, may be empty
+   * @param next receives the entry to resume from
+   * @return false if stopped by on_hit or cancelled
+   * @throws std::runtime_error if the block cannot be read
+   */
+  bool scan_definition_unit(
+      const scan_unit &unit, uint64_t cursor, definition_matcher &matcher,
+      const std::function<bool(uint64_t, text_match &)> &on_hit,
+      const std::function<bool()> &cancelled, uint64_t &next);
+
+  /**
+   * Base forms of an inflected word that this dictionary has entries for,
+   * for lookups that miss (running -> run, mice -> mouse, 高かった -> 高い)
+   * @param word the word as looked up
+   * @return the headwords of the lemmas found: affix stems (if a stemmer is
+   * set) then japanese deinflections
    */
   std::vector<std::string> stem(const std::string word);
 
+  /**
+   * Japanese dictionary forms of a conjugated word that this dictionary has
+   * entries for
+   * @param word the word as looked up (食べさせられた)
+   * @return the forms found with the inflections undone, fewest first; term
+   * is the matching headword
+   */
+  std::vector<deinflection> deinflect(const std::string &word);
+
+  /**
+   * Use a stemmer for stem(), it may be shared by several dictionaries
+   * @param stemmer the stemmer, null to remove it
+   */
+  void set_stemmer(std::shared_ptr<AffixStemmer> stemmer);
+
+  /**
+   * Check many candidate words against the key list at once
+   * @param words candidate words, compared the way lookup() does
+   * @return for each word found, the headword of its first entry, in the
+   * order of the candidates
+   */
+  std::vector<std::string> existing_keys(const std::vector<std::string> &words);
+
+  /**
+   * the keys folded with KEY_FOLD_LOOSE and sorted, once the index build
+   * has published it (INDEX_FOLDED_KEYS)
+   * @return the index or nullptr, valid while the caller holds an
+   * EpochGuard; entry ids are key list indexes
+   */
+  const FoldedKeyIndex *folded_key_index() const { return this->indexes().folded_keys.get(); }
+
+  /**
+   * the keys whose _s() form equals a word's, or starts with it; the key
+   * list is sorted that way, so this binary search stands in for the folded
+   * key index until it is published
+   * @param word the word or prefix, not folded
+   * @param prefix whether keys only have to start with it
+   * @return the key list range [first, second)
+   */
+  std::pair<unsigned long, unsigned long> stripped_range(const std::string &word,
+                                                         bool prefix) const;
+
   /**
    * Check if a word exists in the dictionary
    * @param word The word to check
@@ -440,6 +729,134 @@ class Mdict {
   std::vector<std::pair<std::string, std::string>> decode_record_block_by_rid(
       unsigned long rid /* record id */);
 
+  /**
+   * Read one record block and decompress it, verifying its checksum
+   * Safe to call from several threads at once
+   * @param rid record block id
+   * @return the decompressed block bytes
+   */
+  std::vector<uint8_t> read_record_block(unsigned long rid);
+
+  /**
+   * One record block through the shared block cache (see block_cache.h),
+   * for lookups; a block read for a scan should use read_record_block()
+   * Safe to call from several threads at once
+   * @param rid record block id
+   * @return the decompressed block bytes, shared with the cache
+   */
+  BlockCache::block_ptr record_block(unsigned long rid);
+
+  /**
+   * Find the entries stored in a record block
+   * @param rid record block id
+   * @param first receives the first key list index in the block
+   * @param last receives one past the last key list index in the block
+   */
+  void record_block_entry_range(unsigned long rid, unsigned long &first,
+                                unsigned long &last) const;
+
+  /**
+   * Locate an entry's record inside its decompressed block
+   * @param block the block holding the entry
+   * @param entry key list index
+   * @param start receives the record offset within the block
+   * @param len receives the record length (including any trailing null)
+   */
+  void entry_span(const record_block_view &block, unsigned long entry,
+                  size_t &start, size_t &len) const;
+
+  /**
+   * Read one entry's record as stored, the resource bytes of an MDD entry
+   * @param entry key list index
+   * @return the record bytes
+   */
+  std::string entry_record(unsigned long entry);
+
+  /**
+   * Locate a record kept in a stored (uncompressed) record block, so its
+   * bytes can be streamed straight from the file without a copy
+   * the slice is not checksummed, unlike the records read_record_block()
+   * returns
+   * @param entry key list index
+   * @param fd receives the dictionary's file descriptor, still owned by it
+   * @param offset receives the record's first byte in the file
+   * @param length receives the record length
+   * @return false if the entry's block is compressed or encrypted
+   */
+  bool record_slice(unsigned long entry, int &fd, uint64_t &offset,
+                    uint64_t &length);
+
+  /**
+   * @return the headword of a key list entry
+   */
+  const std::string &entry_key(unsigned long entry) const {
+    return key_list[entry]->key_word;
+  }
+
+  /**
+   * Verify every key block and record block of the file in parallel (see
+   * block_scrub.h); if all are intact, later reads skip their checksums
+   * @param progress receives the fraction of the bytes checked
+   * @param cancelled polled between reads, returning true stops the scrub
+   * @return the damaged blocks and the entries stored in them
+   * @throws std::runtime_error if the record blocks are encrypted
+   */
+  scrub_report scrub(std::function<void(float)> progress = nullptr,
+                     std::function<bool()> cancelled = nullptr);
+
+  /**
+   * @return true once a scrub (this one or an earlier one recorded in the
+   * index dir) found every block intact
+   */
+  bool blocks_verified() const { return verified.load(); }
+
+  size_t entry_count() const { return key_list.size(); }
+
+  uint64_t record_block_count() const { return record_header.size(); }
+
+  /**
+   * @return a hash identifying this dictionary's layout, used to reject
+   * index files built from another file
+   */
+  uint64_t fingerprint() const;
+
+  /**
+   * Set the directory holding this dictionary's optional indexes and load
+   * the ones already built
+   * @param dir index directory (created if missing)
+   */
+  void set_index_dir(const std::string &dir);
+
+  /**
+   * Build the missing optional indexes in the background
+   * @param kinds bitmask of index kinds to build
+   * @return true if a build was started
+   */
+  bool start_index_build(uint32_t kinds);
+
+  /**
+   * Stop the background build; it resumes from its checkpoint next time
+   */
+  void cancel_index_build();
+
+  IndexBuildState index_build_state();
+
+  float index_build_progress();
+
+  /**
+   * Ask the key filter whether lookup() can find a word, without touching
+   * the key list
+   * @param word the word to look up
+   * @return false only if the word certainly has no entry; true when there
+   * is no filter (not built yet, or an MDD file)
+   */
+  bool may_contain(const std::string &word);
+
+  /**
+   * @param hash key_filter_hash() of the word folded with KEY_FOLD_LOOSE
+   */
+  bool may_contain_hash(uint64_t hash);
+
   /**
    * Print the dictionary header information
    */
@@ -476,6 +893,91 @@ class Mdict {
 
   // file pointer (supporting both file paths and file descriptors)
   FILE* file_ptr = nullptr;
+  // dictionary start within the file, readfile() offsets are relative to it
+  uint64_t file_base = 0;
+
+  /********************************
+   *     optional index section   *
+   ********************************/
+  std::mutex index_mutex;
+  std::string index_dir;
+  std::unique_ptr<IndexBuilder> index_builder;
+  // published indexes, the current snapshot; readers load it under an
+  // EpochGuard without locking, writers replace it under snapshot_mutex
+  std::atomic<const index_snapshot *> snapshot{new index_snapshot()};
+  std::mutex snapshot_mutex;
+
+  // the current snapshot, valid while the caller holds an EpochGuard
+  const index_snapshot &indexes() const { return *this->snapshot.load(); }
+  // publish a changed copy of the current snapshot, the old one is freed
+  // once no reader can see it
+  void publish_indexes(const std::function<void(index_snapshot &)> &change);
+
+  std::vector<std::unique_ptr<IndexJob>> make_index_jobs(uint32_t kinds);
+
+  // this dictionary's blocks in BlockCache::shared()
+  const uint64_t cache_owner = BlockCache::new_owner();
+
+  /********************************
+   *     integrity section         *
+   ********************************/
+  // set once a scrub found every block intact: read_record_block() then
+  // skips the Adler-32 of each block
+  std::atomic<bool> verified{false};
+  // key list size after each key block, for the entries of a damaged one
+  std::vector<uint64_t> key_block_entry_end;
+  // the entry before the keys of a damaged key block, by key list index,
+  // and where its record ends: the record_start of the first lost entry,
+  // or its own record_start when that could not be read. Without it the
+  // record would run on over the lost entries' records
+  std::unordered_map<unsigned long, uint64_t> record_end_cap;
+
+  // drop the keys of a damaged key block
+  // @param head the start of its decompressed bytes, to read the first lost
+  // entry's record_start from, may be null
+  void drop_key_block(long idx, const unsigned char *head, size_t head_len);
+  // the entry's number in file order, which is its key list index while no
+  // key block is lost; key_list.size() maps to the entry count
+  uint64_t file_entry_id(unsigned long entry) const;
+
+  // fingerprint() mixed with the file's size and modification time, what
+  // scrub.mark vouches for
+  uint64_t file_stamp() const;
+  // true if the index dir holds a mark for this file; index_mutex held
+  bool load_scrub_mark();
+  // record or drop the mark after a complete scrub; index_mutex held
+  void save_scrub_mark(bool intact);
+
+  /********************************
+   *     stemming section          *
+   ********************************/
+  std::string aff_filename;
+  std::string dic_filename;
+
+  // key list index of each word's first entry, -1 if it has none
+  std::vector<long> find_keys(const std::vector<std::string> &words);
+
+  /********************************
+   *     folded key section        *
+   ********************************/
+  // latin forms of the keys (see transliterator.h) live in the snapshot,
+  // rebuilt when readings are added
+  std::mutex romanized_keys_mutex;
+
+  // the romanized keys, valid while the caller holds an EpochGuard
+  const RomanizedKeyIndex &romanized_key_index();
+  // key list indexes of the entries a word looks up: the keys equal to it
+  // under KEY_FOLD_STRICT if any, else those equal under KEY_FOLD_LOOSE
+  // (under _s() until the folded key index is published)
+  std::vector<uint32_t> matching_entries(const std::string &word);
+  // the matching entries in lookup() order: by record block, the keys
+  // spelled exactly like the word first within a block
+  std::vector<uint32_t> lookup_order(const std::string &word);
+  void load_index(const std::string &name);
+
+  // one page of a definition scan over this dictionary
+  std::vector<fulltext_hit> scan_definitions(definition_matcher &matcher,
+                                             scan_options &options);
 
   /********************************
    *     header section           *
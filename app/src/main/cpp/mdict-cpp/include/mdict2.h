@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * C API v2
+ *
+ *#| handles: opening a file that is already open (same device, inode, size
+ *   and mtime) shares the indexed dictionary instead of parsing it again.
+ *   Every open returns its own handle, closing it drops one reference
+ *#| threads: the query calls only read the dictionary, any number of
+ *   threads may use the same or different handles at once. A handle must
+ *   not be closed while another thread still uses it
+ *#| errors: every call returns an mdict2_status; mdict2_last_error() has
+ *   the detail of the calling thread's last failure
+ *#| results: single strings go into a caller buffer (MDICT2_ERR_BUFFER
+ *   reports the size needed), lists into an mdict2_result arena that holds
+ *   all strings in one allocation
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  MDICT2_OK = 0,
+  MDICT2_ERR_ARGUMENT = -1,   // null handle or string, bad index
+  MDICT2_ERR_OPEN = -2,       // missing, unreadable or malformed file
+  MDICT2_ERR_NOT_FOUND = -3,  // no entry for the word
+  MDICT2_ERR_BUFFER = -4,     // caller buffer too small, see *needed
+  MDICT2_ERR_MEMORY = -5,
+  MDICT2_ERR_INTERNAL = -6    // corrupt block or other decode failure
+} mdict2_status;
+
+typedef struct mdict2_handle mdict2_handle;
+typedef struct mdict2_result mdict2_result;
+
+/**
+ * Open a dictionary, sharing it with other handles of the same file
+ * @param path Path of the .mdx or .mdd file
+ * @param out Receives the handle
+ */
+mdict2_status mdict2_open(const char *path, mdict2_handle **out);
+
+/**
+ * Open a dictionary from a file descriptor, shared like mdict2_open
+ * @param fd File descriptor, owned (closed) by the call in every case
+ * @param is_mdd Nonzero for a resource (.mdd) file
+ * @param out Receives the handle
+ */
+mdict2_status mdict2_open_fd(int fd, int is_mdd, mdict2_handle **out);
+
+/**
+ * Close a handle; the dictionary goes when its last handle does
+ */
+void mdict2_close(mdict2_handle *handle);
+
+/**
+ * @param count Receives the number of key list entries
+ */
+mdict2_status mdict2_key_count(const mdict2_handle *handle, size_t *count);
+
+/**
+ * View one key without copying it, valid while the handle is open
+ * @param index Key list index, below mdict2_key_count
+ * @param key Receives the key, NUL terminated
+ * @param len Receives its length in bytes, may be null
+ */
+mdict2_status mdict2_key_at(const mdict2_handle *handle, size_t index,
+                            const char **key, size_t *len);
+
+/**
+ * Copy the first definition of a word into a caller buffer
+ * @param buf Output buffer, NUL terminated on success; may be null if cap is 0
+ * @param cap Buffer size in bytes
+ * @param needed Receives the size a complete copy needs, NUL included; may be
+ * null
+ * @return MDICT2_ERR_BUFFER if the definition did not fit, MDICT2_ERR_NOT_FOUND
+ * if the word has none
+ */
+mdict2_status mdict2_lookup(mdict2_handle *handle, const char *word, char *buf,
+                            size_t cap, size_t *needed);
+
+/**
+ * Every definition of a word
+ * @param out Receives the definitions, free with mdict2_result_free
+ */
+mdict2_status mdict2_lookup_all(mdict2_handle *handle, const char *word,
+                                mdict2_result **out);
+
+/**
+ * The first definition of each word, looked up in one call
+ * @param words Words to look up
+ * @param count Number of words
+ * @param out Receives one string per word, in order; empty for a word
+ * without entries
+ */
+mdict2_status mdict2_lookup_batch(mdict2_handle *handle, const char *const *words,
+                                  size_t count, mdict2_result **out);
+
+/**
+ * Keys starting with a prefix, accent and width insensitive
+ * @param limit Maximum number of keys, 0 for the engine's default
+ * @param out Receives the keys
+ */
+mdict2_status mdict2_suggest(mdict2_handle *handle, const char *prefix,
+                             size_t limit, mdict2_result **out);
+
+/**
+ * Base forms of a word that have entries (needs the stemmer or the built-in
+ * deinflection rules)
+ * @param out Receives the stems
+ */
+mdict2_status mdict2_stem(mdict2_handle *handle, const char *word,
+                          mdict2_result **out);
+
+/**
+ * @return the number of strings in a result
+ */
+size_t mdict2_result_count(const mdict2_result *result);
+
+/**
+ * @param index Below mdict2_result_count
+ * @param len Receives the length in bytes, may be null
+ * @return the string, NUL terminated and owned by the result, or null if the
+ * index is out of range
+ */
+const char *mdict2_result_get(const mdict2_result *result, size_t index,
+                              size_t *len);
+
+void mdict2_result_free(mdict2_result *result);
+
+/**
+ * @return the detail of the calling thread's last failure, empty if none
+ */
+const char *mdict2_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
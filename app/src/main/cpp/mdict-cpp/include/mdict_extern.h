@@ -39,6 +39,18 @@ typedef enum {
  */
 void *mdict_init(const char *dictionary_path);
 
+/**
+ * Initialize a dictionary with a hunspell affix file and word list, used by
+ * mdict_stem
+ * @param dictionary_path Path to the dictionary file (.mdx)
+ * @param aff_path Path to the affix file (.aff)
+ * @param dic_path Path to the word list (.dic)
+ * @return A pointer to the initialized dictionary object, or NULL if
+ * initialization fails (a stemmer that fails to load is only logged)
+ */
+void *mdict_init_with_stemmer(const char *dictionary_path, const char *aff_path,
+                              const char *dic_path);
+
 /**
  * Initialize a dictionary from a File Descriptor (zero-copy on Android)
  * @param fd File descriptor from Android's DocumentsProvider or other restricted storage
@@ -47,6 +59,18 @@ void *mdict_init(const char *dictionary_path);
  */
 void *mdict_init_fd(int fd, bool is_mdd);
 
+/**
+ * Initialize a dictionary stored inside a ZIP archive
+ * A stored member is read in place, a deflated one is inflated into
+ * cache_dir on first use
+ * @param fd Archive file descriptor, owned (closed) by the call
+ * @param member Path of the .mdx or .mdd member inside the archive
+ * @param cache_dir Directory for inflated members
+ * @return A pointer to the initialized dictionary object, or NULL if
+ * initialization fails
+ */
+void *mdict_init_zip(int fd, const char *member, const char *cache_dir);
+
 /**
  * Look up a word in the dictionary and get its definition
  * @param dict Dictionary object pointer returned by mdict_init
@@ -105,16 +129,18 @@ int mdict_filetype(void *dict);
  * Get word suggestions based on input
  * @param dict Dictionary object pointer returned by mdict_init
  * @param word The input word to get suggestions for
- * @param suggested_words Array to store suggested words
+ * @param suggested_words Array to store suggested words (memory will be
+ * allocated for each word, unused slots are set to NULL)
  * @param length Maximum number of suggestions to return
  */
 void mdict_suggest(void *dict, char *word, char **suggested_words, int length);
 
 /**
  * Get word stems based on input
- * @param dict Dictionary object pointer returned by mdict_init
+ * @param dict Dictionary object pointer returned by mdict_init_with_stemmer
  * @param word The input word to get stems for
- * @param suggested_words Array to store stem words
+ * @param suggested_words Array to store stem words (memory will be allocated
+ * for each stem, unused slots are set to NULL)
  * @param length Maximum number of stems to return
  */
 void mdict_stem(void *dict, char *word, char **suggested_words, int length);
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+/**
+ * logging for the engine sources, which log through __android_log_print
+ *
+ *#| on Android this is <android/log.h>, the messages go to logcat
+ *#| on host builds (the daemon and tools) the same calls print warnings and
+ *   errors to stderr; debug and info output is dropped unless MDICT_LOG_DEBUG
+ *   is set in the environment
+ */
+
+#if defined(__ANDROID__)
+
+#include <android/log.h>
+
+#else
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+enum {
+  ANDROID_LOG_DEBUG = 3,
+  ANDROID_LOG_INFO = 4,
+  ANDROID_LOG_WARN = 5,
+  ANDROID_LOG_ERROR = 6
+};
+
+inline int __android_log_print(int priority, const char *tag, const char *fmt, ...) {
+  static const bool debug = std::getenv("MDICT_LOG_DEBUG") != nullptr;
+  if (priority < ANDROID_LOG_WARN && !debug) return 0;
+  std::fprintf(stderr, "%s: ", tag);
+  va_list args;
+  va_start(args, fmt);
+  int n = std::vfprintf(stderr, fmt, args);
+  va_end(args);
+  std::fputc('\n', stderr);
+  return n;
+}
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "index_builder.h"
+#include "index_io.h"
+
+/**
+ * character n-gram posting index over the plain text of the definitions
+ *
+ *#| every definition contributes its distinct trigrams, plus the bigrams that
+ *   touch a CJK character (two-character words are common in Chinese and
+ *   Japanese, while Latin bigrams are too unselective to be worth storing)
+ *#| a gram key packs its code points (21 bits each) into 64 bits, bit 63 is
+ *   set for bigrams, so keys are exact and never collide
+ *#| ngram.idx layout (little-endian)
+ *    | [0:4]   magic "VDNG"
+ *    | [4:8]   format version
+ *    | [8:16]  dictionary fingerprint
+ *    | [16:24] gram count
+ *    | [24:32] postings start
+ *    | gram table: gram count x (u64 key, u64 postings offset), sorted by key
+ *    | postings: per gram, varint count then varint entry id deltas
+ *      (entry id = key list index, the first delta is from 0)
+ */
+
+namespace mdict {
+
+/**
+ * append the distinct gram keys of a folded text to out (unsorted, may
+ * repeat)
+ */
+void ngram_keys(const std::u32string &text, std::vector<uint64_t> &out);
+
+/**
+ * the gram keys every match of a folded query must contain: its trigrams
+ * when it is long enough, otherwise its bigram if that kind is indexed
+ * @param query folded query text
+ * @param out receives the sorted distinct keys, empty if the query is too
+ * short to be filtered by grams
+ */
+void ngram_query_keys(const std::u32string &query, std::vector<uint64_t> &out);
+
+class NgramIndexJob : public IndexJob {
+ public:
+  // 2: unicode case folding and the html 4 entities
+  static const uint32_t FORMAT_VERSION = 2;
+
+  std::string name() const override { return "ngram"; }
+  uint32_t format_version() const override { return FORMAT_VERSION; }
+  void add_block(const Mdict &dict, const record_block_view &block) override;
+  bool write_segment(FILE *out) override;
+  bool merge(const Mdict &dict, const std::vector<std::string> &segments,
+             FILE *out) override;
+
+ private:
+  struct posting_list {
+    uint32_t count = 0;
+    uint32_t first = 0;
+    uint32_t last = 0;
+    // varint deltas of every entry after the first
+    std::vector<unsigned char> deltas;
+  };
+
+  std::unordered_map<uint64_t, posting_list> postings_;
+  // scratch buffers reused across entries
+  std::u32string text_;
+  std::vector<uint64_t> keys_;
+};
+
+/**
+ * read side of ngram.idx, memory mapped
+ */
+class NgramIndex {
+ public:
+  /**
+   * map an index file
+   * @param path ngram.idx path
+   * @param fingerprint the dictionary fingerprint it must have been built for
+   * @return false if the file is missing, stale or malformed
+   */
+  bool open(const std::string &path, uint64_t fingerprint);
+
+  /**
+   * find the entries that contain every gram of a query
+   * @param query folded query text
+   * @param entries receives the sorted candidate entry ids
+   * @return false if the query is too short to be answered by the index
+   */
+  bool candidates(const std::u32string &query,
+                  std::vector<uint32_t> &entries) const;
+
+ private:
+  bool postings(uint64_t key, std::vector<uint32_t> &out) const;
+
+  mapped_file file_;
+  uint64_t gram_count_ = 0;
+  const unsigned char *table_ = nullptr;
+  const unsigned char *postings_ = nullptr;
+};
+
+}  // namespace mdict
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "index_io.h"
+
+/**
+ * segment files of the posting indexes (ngram.idx, terms.idx)
+ *
+ *#| a segment starts with a u64 record count, then per key (sorted):
+ *   u64 key, u32 count, u32 first, u32 last, u32 byte count and the bytes
+ *   of the list after its first entry id; a job may append its own data
+ *   after the records
+ *#| segments are written in block order, so appending a key's lists in
+ *   segment order keeps its entry ids sorted; only the first id of each
+ *   part has to be re-based on the previous part's last
+ */
+
+namespace mdict {
+
+struct segment_cursor {
+  const unsigned char *p = nullptr;
+  const unsigned char *end = nullptr;
+  uint64_t remaining = 0;
+  // current record
+  uint64_t key = 0;
+  uint32_t count = 0, first = 0, last = 0, nbytes = 0;
+  const unsigned char *deltas = nullptr;
+
+  /**
+   * position on the first record of a mapped segment
+   * @return false if the segment has no record
+   */
+  bool start(const mapped_file &file) {
+    if (!file.data() || file.size() < 8) return false;
+    p = file.data() + 8;
+    end = file.data() + file.size();
+    remaining = load_u64(file.data());
+    return next();
+  }
+
+  bool next() {
+    if (remaining == 0 || end - p < 24) return false;
+    key = load_u64(p);
+    count = load_u32(p + 8);
+    first = load_u32(p + 12);
+    last = load_u32(p + 16);
+    nbytes = load_u32(p + 20);
+    deltas = p + 24;
+    if ((size_t)(end - deltas) < nbytes) return false;
+    p = deltas + nbytes;
+    remaining--;
+    return true;
+  }
+};
+
+/**
+ * k-way merge of the segments by key
+ */
+class segment_merger {
+ public:
+  explicit segment_merger(const std::vector<std::unique_ptr<mapped_file>> &files)
+      : files_(files) {}
+
+  void reset() {
+    cursors_.assign(files_.size(), segment_cursor());
+    heap_ = decltype(heap_)();
+    for (size_t i = 0; i < files_.size(); ++i) {
+      if (cursors_[i].start(*files_[i])) heap_.push({cursors_[i].key, i});
+    }
+  }
+
+  /**
+   * collect the next key and the segments that hold it (in segment order)
+   */
+  bool next(uint64_t &key, std::vector<const segment_cursor *> &parts) {
+    parts.clear();
+    scratch_.clear();
+    if (heap_.empty()) return false;
+    key = heap_.top().first;
+    while (!heap_.empty() && heap_.top().first == key) {
+      scratch_.push_back(heap_.top().second);
+      heap_.pop();
+    }
+    std::sort(scratch_.begin(), scratch_.end());
+    snapshot_.clear();
+    for (size_t i : scratch_) snapshot_.push_back(cursors_[i]);
+    for (const auto &c : snapshot_) parts.push_back(&c);
+    for (size_t i : scratch_) {
+      if (cursors_[i].next()) heap_.push({cursors_[i].key, i});
+    }
+    return true;
+  }
+
+ private:
+  typedef std::pair<uint64_t, size_t> item;
+  const std::vector<std::unique_ptr<mapped_file>> &files_;
+  std::vector<segment_cursor> cursors_;
+  std::priority_queue<item, std::vector<item>, std::greater<item>> heap_;
+  std::vector<size_t> scratch_;
+  std::vector<segment_cursor> snapshot_;
+};
+
+inline size_t varint_size(uint64_t v) {
+  size_t n = 1;
+  while (v >= 0x80) {
+    v >>= 7;
+    n++;
+  }
+  return n;
+}
+
+}  // namespace mdict
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * the resources of a multi-volume MDD set (name.mdd, name.1.mdd, ...) in
+ * one hash table, so a WebView request is one probe however many volumes
+ * the set has
+ *
+ *#| paths are normalized: '/' becomes '\', leading separators and ASCII
+ *   case are dropped ("/Img/A.png" and "\img\a.png" are the same)
+ *#| a path that misses falls back to its file name, which matches keys
+ *   stored without a directory; full paths always win over file names
+ *#| an earlier volume wins when several hold the same path
+ *#| the table is immutable once built, lookups need no lock
+ */
+
+namespace mdict {
+
+class Mdict;
+
+class ResourceSet {
+ public:
+  /**
+   * index every key of the volumes
+   * @param volumes MDD dictionaries, in volume order
+   */
+  explicit ResourceSet(const std::vector<Mdict *> &volumes);
+
+  /**
+   * @param path resource path as referenced by a definition
+   * @param volume receives the volume index
+   * @param entry receives the key list index in that volume
+   * @return false if no volume has it
+   */
+  bool find(std::string_view path, uint32_t &volume, uint32_t &entry) const;
+
+  // number of distinct normalized paths and file names
+  size_t size() const { return paths_.size(); }
+
+  static std::string normalize(std::string_view path);
+
+ private:
+  // (volume << 32) | entry
+  std::unordered_map<std::string, uint64_t> paths_;
+};
+
+}  // namespace mdict
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * longest-match segmentation of running text against dictionary keys, for
+ * pasted sentences and CJK text, which has no spaces
+ *
+ *#| the text is folded like the keys (KEY_FOLD_LOOSE) and, from the start
+ *   of each word, every dictionary's folded key index is walked like a trie
+ *   (FoldedKeyIndex::common_prefixes), or while that index is not built,
+ *   the key list is searched under _s() for ever longer runs of the text;
+ *   the longest key of any dictionary wins and the walk resumes after it
+ *#| a match may not end inside a latin, Greek or Cyrillic word (no "cat" in
+ *   "catalog"), and a match that spans a separator of the text needs a key
+ *   with as many separators ("ice cream", not "therapist" for "the rapist")
+ *#| a word no dictionary knows is one segment without entries, so is a run
+ *   of unknown CJK characters
+ */
+
+namespace mdict {
+
+class Mdict;
+
+struct text_segment {
+  // utf-8 byte range in the text
+  size_t start = 0;
+  size_t length = 0;
+  // (dictionary index, key list index) of every key the segment matches,
+  // empty for unknown text
+  std::vector<std::pair<uint32_t, uint32_t>> entries;
+};
+
+/**
+ * @param dicts dictionaries searched together
+ * @param text utf-8 text
+ * @return the segments in text order, separators between them left out
+ */
+std::vector<text_segment> segment_text(const std::vector<Mdict *> &dicts,
+                                       const std::string &text);
+
+}  // namespace mdict
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mdict {
+
+/**
+ * Scheduling lanes of the shared worker pool.
+ *
+ * Interactive work (lookups, searches and scrubs the user is waiting for) runs
+ * at normal priority. Background work (index builds) runs on its own threads at
+ * a lowered priority so it never competes with the UI for CPU.
+ */
+enum class TaskLane { INTERACTIVE = 0, BACKGROUND = 1 };
+
+/**
+ * Fixed-size worker pool with one FIFO queue per lane
+ */
+class TaskPool {
+ public:
+  /**
+   * process-wide pool shared by every dictionary
+   */
+  static TaskPool &shared();
+
+  /**
+   * constructor
+   * @param interactive_threads number of normal priority workers
+   * @param background_threads number of low priority workers
+   */
+  TaskPool(unsigned interactive_threads, unsigned background_threads);
+
+  /**
+   * deconstructor, drains nothing: queued tasks are dropped, running tasks
+   * are joined
+   */
+  ~TaskPool();
+
+  TaskPool(const TaskPool &) = delete;
+  TaskPool &operator=(const TaskPool &) = delete;
+
+  /**
+   * queue a task on a lane
+   * @param lane the lane to run on
+   * @param task the task, must not throw
+   * @return false if the pool is shutting down and the task was dropped
+   */
+  bool submit(TaskLane lane, std::function<void()> task);
+
+  /**
+   * number of workers serving a lane
+   */
+  unsigned concurrency(TaskLane lane) const;
+
+ private:
+  struct Lane {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> queue;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+  };
+
+  void worker_loop(Lane &lane, int nice_value);
+
+  Lane lanes_[2];
+};
+
+}  // namespace mdict
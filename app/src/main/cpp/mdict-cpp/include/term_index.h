@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "index_builder.h"
+#include "index_io.h"
+
+/**
+ * word posting index with term frequencies, for full-text results ranked
+ * by relevance (BM25) instead of dictionary order
+ *
+ *#| the plain text of a definition is cut into terms: runs of letters and
+ *   digits, and for CJK text (not space delimited) every two adjacent
+ *   characters, a lone one standing for itself. @@@LINK= redirects have no
+ *   terms
+ *#| a term key is the 64-bit FNV-1a hash of its code points; two terms
+ *   sharing a key would merge their postings, which at this width does not
+ *   happen for any dictionary sized vocabulary
+ *#| every term carries the upper bound of its BM25 contribution, so a query
+ *   only scores the entries that can still make the top k (MaxScore)
+ *#| terms.idx layout (little-endian)
+ *    | [0:4]   magic "VDTM"
+ *    | [4:8]   format version
+ *    | [8:16]  dictionary fingerprint
+ *    | [16:24] term count
+ *    | [24:32] entry count
+ *    | [32:40] entries with terms (redirects and empty ones have none)
+ *    | [40:48] total terms of all entries
+ *    | [48:56] postings start
+ *    | entry lengths: entry count x u32 terms in the definition
+ *    | term table: term count x (u64 key, u64 postings offset, u32 entry
+ *      count, f32 score bound), sorted by key
+ *    | postings: per term, (varint entry id delta, varint frequency) pairs
+ *      (entry id = key list index, the first delta is from 0)
+ */
+
+namespace mdict {
+
+/**
+ * append the term keys of a folded text to out, in text order (repeats
+ * kept, one per occurrence)
+ */
+void term_keys(const std::u32string &text, std::vector<uint64_t> &out);
+
+/**
+ * the terms of a folded text as strings, in text order, without repeats
+ */
+std::vector<std::u32string> term_texts(const std::u32string &text);
+
+class TermIndexJob : public IndexJob {
+ public:
+  // 2: unicode case folding and the html 4 entities
+  static const uint32_t FORMAT_VERSION = 2;
+
+  std::string name() const override { return "terms"; }
+  uint32_t format_version() const override { return FORMAT_VERSION; }
+  void add_block(const Mdict &dict, const record_block_view &block) override;
+  bool write_segment(FILE *out) override;
+  bool merge(const Mdict &dict, const std::vector<std::string> &segments,
+             FILE *out) override;
+
+ private:
+  struct posting_list {
+    uint32_t count = 0;
+    uint32_t first = 0;
+    uint32_t last = 0;
+    // frequency of the first entry, then (delta, frequency) of the others
+    std::vector<unsigned char> bytes;
+  };
+
+  std::unordered_map<uint64_t, posting_list> postings_;
+  // term count of each entry since the segment's first one
+  uint64_t first_entry_ = 0;
+  std::vector<uint32_t> lengths_;
+  // scratch buffers reused across entries
+  std::u32string text_;
+  std::vector<uint64_t> keys_;
+};
+
+/**
+ * an entry and its score
+ */
+struct scored_entry {
+  uint32_t entry = 0;
+  float score = 0;
+};
+
+/**
+ * entries with a fixed score added to whatever the terms give them (e.g.
+ * headword matches)
+ */
+struct score_boost {
+  // sorted, distinct key list indexes
+  std::vector<uint32_t> entries;
+  float score = 0;
+};
+
+/**
+ * read side of terms.idx, memory mapped
+ */
+class TermIndex {
+ public:
+  // BM25 parameters
+  static constexpr float BM25_K1 = 1.2f;
+  static constexpr float BM25_B = 0.75f;
+
+  /**
+   * map an index file
+   * @param path terms.idx path
+   * @param fingerprint the dictionary fingerprint it must have been built for
+   * @return false if the file is missing, stale or malformed
+   */
+  bool open(const std::string &path, uint64_t fingerprint);
+
+  /**
+   * the highest BM25 score a term can add to an entry, 0 if it never occurs
+   */
+  float score_bound(uint64_t key) const;
+
+  /**
+   * @return the number of terms in an entry's definition, 0 for redirects
+   */
+  uint32_t entry_length(uint32_t entry) const {
+    return entry < entry_count_ ? load_u32(lengths_ + 4 * (size_t)entry) : 0;
+  }
+
+  /**
+   * the k entries scoring highest for some terms, an entry scoring the sum
+   * of its terms' BM25 and of the boosts it is in (any term is enough)
+   * @param keys distinct term keys of the query
+   * @param boosts extra scores
+   * @param k results wanted
+   * @return the entries, best first (ties in entry order)
+   */
+  std::vector<scored_entry> top_k(const std::vector<uint64_t> &keys,
+                                  const std::vector<score_boost> &boosts,
+                                  size_t k) const;
+
+ private:
+  struct term_info {
+    uint64_t offset = 0;
+    uint32_t count = 0;
+    float bound = 0;
+  };
+
+  bool find(uint64_t key, term_info &info) const;
+  bool decode(const term_info &info, std::vector<uint32_t> &entries,
+              std::vector<uint32_t> &freqs) const;
+  float idf(uint32_t count) const;
+
+  mapped_file file_;
+  uint64_t term_count_ = 0;
+  uint64_t entry_count_ = 0;
+  uint64_t documents_ = 0;
+  float average_length_ = 1;
+  const unsigned char *lengths_ = nullptr;
+  const unsigned char *table_ = nullptr;
+  const unsigned char *postings_ = nullptr;
+};
+
+}  // namespace mdict
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * boolean full-text queries over the plain text of html records
+ *
+ *#| syntax
+ *   | words separated by spaces must all occur (implicit AND)
+ *   | "quoted text" is a single phrase term
+ *   | OR (or |) between terms, NOT (or a leading -) excludes a term
+ *   | AND is optional, parentheses group
+ *   | keywords are only recognised in upper case, so "and" is a word
+ *#| every distinct term goes into one Aho-Corasick automaton over the
+ *   folded characters, so a record is walked once whatever the number of
+ *   terms, and the expression is evaluated on the set of terms seen
+ */
+
+namespace mdict {
+
+/**
+ * a full-text hit, in the plain text of the record
+ */
+struct text_match {
+  // utf-8 plain text around the match, with an ellipsis where it was cut
+  std::string snippet;
+  // match range within the snippet, in UTF-16 code units (java string
+  // indices)
+  uint32_t match_start = 0;
+  uint32_t match_end = 0;
+};
+
+/**
+ * cut a snippet out of the plain text of a record
+ * @param text the plain text walked so far
+ * @param begin match start in text (code points)
+ * @param end match end in text, 0 for "no match to show": the snippet is
+ * then the start of the text
+ * @param context characters kept on each side of the match
+ * @param cut_short set if the record continues after text
+ * @param match receives the snippet
+ */
+void make_snippet(const std::u32string &text, size_t begin, size_t end,
+                  size_t context, bool cut_short, text_match &match);
+
+/**
+ * a parsed full-text query
+ * not thread safe, use one per search
+ */
+class text_query {
+ public:
+  static const size_t MAX_TERMS = 64;
+
+  /**
+   * parse a query
+   * @param query the query text
+   * @param context snippet characters kept on each side of the match
+   * @throws std::invalid_argument if the query has more than MAX_TERMS terms
+   */
+  explicit text_query(const std::string &query, size_t context = 40);
+
+  /**
+   * build a query from literals instead of query text (used as a prefilter)
+   * @param clauses every clause must have one of its (already folded)
+   * alternatives present
+   * @throws std::invalid_argument if there are more than MAX_TERMS literals
+   */
+  static text_query all_of(
+      const std::vector<std::vector<std::u32string>> &clauses,
+      size_t context = 40);
+
+  /**
+   * @return true if the query has no terms
+   */
+  bool empty() const { return root_ < 0; }
+
+  size_t term_count() const { return terms_.size(); }
+
+  /**
+   * @return a term, folded with fold_text
+   */
+  const std::u32string &term(size_t i) const { return terms_[i]; }
+
+  /**
+   * search one record
+   * @param data record bytes (utf-8)
+   * @param len record length
+   * @param match receives a snippet around the first occurrence of a
+   * (non-excluded) term, may be null
+   * @return true if the record satisfies the query
+   */
+  bool find(const char *data, size_t len, text_match *match);
+
+  /**
+   * evaluate the query from per-term "may occur" answers (e.g. a sketch)
+   * excluded terms cannot rule anything out, so they count as satisfied
+   * @return false only if no record with those terms can match
+   */
+  bool may_match(const std::function<bool(size_t)> &term_may_occur) const;
+
+  /**
+   * narrow the query to candidate entries using posting lists
+   * @param postings fills the sorted entry ids of a term, returns false if
+   * the term cannot be answered (too short, no index)
+   * @param entries receives the sorted candidate entry ids
+   * @return false if the query cannot be narrowed and needs a full scan
+   */
+  bool candidates(
+      const std::function<bool(size_t, std::vector<uint32_t> &)> &postings,
+      std::vector<uint32_t> &entries) const;
+
+ private:
+  enum op_t { OP_TERM, OP_AND, OP_OR, OP_NOT };
+  struct node {
+    op_t op;
+    size_t term;
+    std::vector<int> kids;
+  };
+  enum token_t { TOK_END, TOK_WORD, TOK_PHRASE, TOK_AND, TOK_OR, TOK_NOT,
+                 TOK_LPAREN, TOK_RPAREN };
+  struct candidate_set {
+    bool all = true;
+    std::vector<uint32_t> ids;
+  };
+
+  // parser
+  token_t peek();
+  void advance();
+  int parse_or();
+  int parse_and();
+  int parse_unary();
+  explicit text_query(size_t context) : context_(context) {}
+  int add_term(const std::string &text);
+  int add_folded_term(const std::u32string &folded);
+  void finish();
+  void mark_positive(int n, bool negated);
+
+  bool eval(int n, uint64_t seen) const;
+  bool eval_may(int n, const std::function<bool(size_t)> &may) const;
+  candidate_set eval_candidates(
+      int n,
+      const std::function<bool(size_t, std::vector<uint32_t> &)> &postings)
+      const;
+
+  // Aho-Corasick automaton over folded code points
+  void build_automaton();
+  uint32_t step(uint32_t state, char32_t c) const;
+  static uint64_t edge(uint32_t state, char32_t c) {
+    return ((uint64_t)state << 21) | c;
+  }
+
+  std::string text_;
+  size_t pos_ = 0;
+  token_t tok_ = TOK_END;
+  bool tok_ready_ = false;
+  std::string tok_text_;
+
+  std::vector<node> nodes_;
+  int root_ = -1;
+  std::vector<std::u32string> terms_;
+  uint64_t positive_ = 0;  // terms not under a NOT
+  bool has_not_ = false;
+
+  std::unordered_map<uint64_t, uint32_t> goto_;
+  std::vector<uint32_t> fail_;
+  std::vector<uint64_t> out_;  // terms ending in a state
+
+  size_t context_;
+  // plain (unfolded) text walked so far
+  std::u32string shown_;
+};
+
+}  // namespace mdict
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "text_query.h"
+
+/**
+ * regular expressions over the plain text of html records
+ *
+ *#| a Thompson NFA simulated Pike-VM style, one step per character, so a
+ *   record is matched in time linear in its length whatever the pattern
+ *   (std::regex backtracks and can take exponential time on definitions)
+ *#| syntax is the ECMAScript subset without backtracking features:
+ *   literals, ., [classes], \d \w \s (and negations), \b \B, ^ $, groups,
+ *   (?:...), |, * + ? {m,n} and their lazy forms. Backreferences and
+ *   lookarounds are rejected. \w also matches letters outside ASCII.
+ *#| the text is the one full-text search sees: tags skipped, entities
+ *   decoded, whitespace collapsed to single spaces; ^ and $ are the start
+ *   and end of the entry
+ *#| required_literals() lists the literals every match contains, so the
+ *   caller can prefilter records (and use the n-gram index or block
+ *   sketches) before running the automaton
+ */
+
+namespace mdict {
+
+class text_regex {
+ public:
+  /**
+   * compile a pattern
+   * @param pattern utf-8 pattern
+   * @param icase match case-insensitively
+   * @param context snippet characters kept on each side of the match
+   * @throws std::invalid_argument on syntax errors, unsupported features or
+   * patterns too large to compile
+   */
+  explicit text_regex(const std::string &pattern, bool icase = true,
+                      size_t context = 40);
+
+  /**
+   * search one record for the leftmost match
+   * @param data record bytes (utf-8)
+   * @param len record length
+   * @param match receives a snippet around the match, may be null
+   * @return true if the pattern matches
+   */
+  bool find(const char *data, size_t len, text_match *match);
+
+  /**
+   * @return clauses of folded literals, every match contains one
+   * alternative of each clause
+   */
+  const std::vector<std::vector<std::u32string>> &required_literals() const {
+    return required_;
+  }
+
+ private:
+  enum op_t {
+    I_CHAR,    // c
+    I_ANY,     // any character
+    I_CLASS,   // classes_[arg]
+    I_SPLIT,   // try x, then y
+    I_JMP,     // goto x
+    I_BOL,     // start of text
+    I_EOL,     // end of text
+    I_WORDB,   // word boundary
+    I_NWORDB,  // not a word boundary
+    I_MATCH
+  };
+  struct inst {
+    op_t op;
+    char32_t c;
+    uint32_t x, y;
+  };
+  struct char_class {
+    bool negate = false;
+    uint8_t named = 0;      // NAMED_* sets included
+    uint8_t named_neg = 0;  // NAMED_* sets whose complement is included
+    std::vector<std::pair<char32_t, char32_t>> ranges;
+  };
+  enum { NAMED_DIGIT = 1, NAMED_WORD = 2, NAMED_SPACE = 4 };
+
+  struct ast;
+  struct parser;
+  struct literal_info;
+
+  void compile(const ast &node);
+  uint32_t emit(op_t op, char32_t c = 0, uint32_t x = 0, uint32_t y = 0);
+  literal_info literals(const ast &node) const;
+
+  bool class_matches(const char_class &cls, char32_t c) const;
+  bool char_matches(const inst &in, char32_t c) const;
+  static bool is_word(char32_t c);
+
+  // Pike VM
+  struct thread {
+    uint32_t pc;
+    uint32_t start;
+  };
+  void add_thread(std::vector<thread> &list, uint32_t pc, uint32_t start,
+                  char32_t prev, char32_t cur);
+
+  bool icase_;
+  size_t context_;
+  std::vector<inst> prog_;
+  std::vector<char_class> classes_;
+  std::vector<std::vector<std::u32string>> required_;
+
+  // scratch state reused across records
+  std::vector<uint32_t> mark_;
+  uint32_t generation_ = 0;
+  std::vector<uint32_t> stack_;
+  std::vector<thread> run_, next_;
+  std::u32string shown_;
+};
+
+}  // namespace mdict
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * latin spellings of headwords, so dictionaries in other scripts can be
+ * searched from a latin keyboard
+ *
+ *#| keys are folded with KEY_FOLD_LOOSE first (katakana is hiragana, accents
+ *   are gone), then each run of one script is romanized by table:
+ *    | kana:     Hepburn romaji (しゃしん -> shashin, がっこう -> gakkou), plus
+ *                the form with long vowels collapsed (gakko, ramen)
+ *    | Cyrillic: BGN/PCGN style (щи -> shchi, юг -> yug)
+ *    | Greek:    modern and classical (ψυχή -> psychi, psyche)
+ *    | Han:      the readings added with add_readings(), there is no built-in
+ *                table; tone marks and tone numbers are dropped
+ *#| a key with a character none of these cover has no romanized form, nor
+ *   has a key that is latin already
+ *#| a key has at most MAX_FORMS forms, the first readings win
+ */
+
+namespace mdict {
+
+class Transliterator {
+ public:
+  static const size_t MAX_FORMS = 4;
+
+  /**
+   * @return the process wide transliterator
+   */
+  static Transliterator &shared();
+
+  /**
+   * add Han readings, one character per line: the character (or U+XXXX),
+   * an optional Unihan field name, then its readings ("U+4E2D kMandarin
+   * zhōng", "行 xing2 hang2"); '#' starts a comment
+   * @param table the lines
+   * @return number of characters that got a new reading
+   */
+  size_t add_readings(const std::string &table);
+
+  /**
+   * @return bumped by every add_readings() that changed something, indexes
+   * built before are stale
+   */
+  uint64_t generation() const;
+
+  /**
+   * @param key a headword
+   * @return its romanized forms, folded with KEY_FOLD_LOOSE
+   */
+  std::vector<std::string> romanize(std::string_view key) const;
+
+  /**
+   * fold a latin query the way romanized forms are (tone numbers dropped)
+   * @return the folded query, empty if it is not latin
+   */
+  static std::string fold_query(std::string_view query);
+
+ private:
+  using readings_map = std::unordered_map<char32_t, std::vector<std::string>>;
+
+  Transliterator() : readings_(std::make_shared<readings_map>()) {}
+
+  std::mutex mutex_;
+  // replaced, never modified, once published
+  std::shared_ptr<const readings_map> readings_;
+  std::atomic<uint64_t> generation_{0};
+};
+
+/**
+ * the romanized forms of a dictionary's keys, sorted, so latin prefix
+ * queries are a binary search like the folded key index
+ *
+ *#| forms live back to back in one buffer; sorted_ holds the form ids
+ *   ordered by (form, entry id)
+ */
+class RomanizedKeyIndex {
+ public:
+  /**
+   * @param transliterator makes the forms
+   * @param count number of entries
+   * @param key_of key of an entry id in [0, count)
+   */
+  RomanizedKeyIndex(const Transliterator &transliterator, size_t count,
+                    const std::function<const std::string &(size_t)> &key_of);
+
+  // Transliterator::generation() when it was built
+  uint64_t generation() const { return generation_; }
+  // number of forms
+  size_t size() const { return entries_.size(); }
+
+  /**
+   * @param romanized a query folded with Transliterator::fold_query
+   * @param limit maximum number of entries
+   * @return entry ids with a form starting with it, each once, in form order
+   */
+  std::vector<uint32_t> prefix(std::string_view romanized, size_t limit) const;
+
+ private:
+  std::string_view form(uint32_t id) const {
+    return std::string_view(arena_.data() + offsets_[id],
+                            offsets_[id + 1] - offsets_[id]);
+  }
+
+  uint64_t generation_;
+  std::string arena_;
+  std::vector<uint32_t> offsets_;
+  // entry id of each form
+  std::vector<uint32_t> entries_;
+  std::vector<uint32_t> sorted_;
+};
+
+}  // namespace mdict
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * dictionaries kept inside a ZIP archive, opened without extracting them
+ *
+ *#| a stored (method 0) member is read in place: its data is a plain byte
+ *   range of the archive, so the dictionary reads the archive fd at an
+ *   offset, as fast as a loose file
+ *#| a deflated member cannot be read at random offsets; it is inflated
+ *   once into the cache dir and opened from there. The cache file is named
+ *   after the member's CRC and size, so a changed archive inflates again and
+ *   an unchanged one reuses it across launches
+ *#| the archive is read with pread through a miniz reader callback and is
+ *   never seeked, the fd stays usable for the dictionary
+ */
+
+namespace mdict {
+
+struct zip_member {
+  // path inside the archive
+  std::string name;
+  // first data byte in the archive, valid for stored members
+  uint64_t data_offset = 0;
+  // uncompressed size
+  uint64_t size = 0;
+  // CRC-32 of the uncompressed data
+  uint32_t crc = 0;
+  bool stored = false;
+};
+
+/**
+ * the .mdx and .mdd members of an archive
+ * @param fd archive file descriptor, not closed
+ * @return members in archive order, encrypted and unsupported ones left out
+ * @throws std::runtime_error if fd is not a readable ZIP archive
+ */
+std::vector<zip_member> list_zip_dictionaries(int fd);
+
+/**
+ * inflate a member into the cache dir, unless an earlier call already did
+ * @param fd archive file descriptor, not closed
+ * @param member a member returned by list_zip_dictionaries
+ * @param cache_dir existing directory for the inflated files of this archive
+ * only; older versions of the member found there are removed
+ * @return path of the inflated file, with the member's extension
+ * @throws std::runtime_error if the member cannot be inflated or written
+ */
+std::string inflate_zip_member(int fd, const zip_member &member,
+                               const std::string &cache_dir);
+
+}  // namespace mdict
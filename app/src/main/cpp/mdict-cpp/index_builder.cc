@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/index_builder.h"
+
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+#include "include/adler32.h"
+#include "include/fileutils.h"
+#include "include/index_io.h"
+#include "include/mdict.h"
+#include "include/mdict_log.h"
+#include "include/task_pool.h"
+
+#define LOG_TAG "MdictJNI"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+namespace mdict {
+
+static const uint32_t CHECKPOINT_MAGIC = 0x4b434456;  // "VDCK"
+static const uint32_t CHECKPOINT_VERSION = 1;
+
+IndexBuilder::IndexBuilder(Mdict *dict, std::string dir)
+    : dict_(dict), dir_(std::move(dir)) {}
+
+IndexBuilder::~IndexBuilder() {
+  cancel();
+  wait();
+}
+
+bool IndexBuilder::start(std::vector<std::unique_ptr<IndexJob>> jobs,
+                         std::function<void(const std::string &)> on_published) {
+  if (jobs.empty()) return false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return false;
+    running_ = true;
+  }
+  jobs_ = std::move(jobs);
+  on_published_ = std::move(on_published);
+  cancel_ = false;
+  blocks_done_ = 0;
+  blocks_total_ = dict_->record_block_count();
+  state_ = IndexBuildState::RUNNING;
+
+  bool queued = TaskPool::shared().submit(TaskLane::BACKGROUND, [this] {
+    try {
+      run();
+    } catch (const std::exception &e) {
+      LOGE("IndexBuilder: build failed: %s", e.what());
+      state_ = IndexBuildState::FAILED;
+    } catch (...) {
+      LOGE("IndexBuilder: build failed");
+      state_ = IndexBuildState::FAILED;
+    }
+    jobs_.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+    done_cv_.notify_all();
+  });
+  if (!queued) {
+    LOGE("IndexBuilder: task pool is shutting down, not building");
+    jobs_.clear();
+    state_ = IndexBuildState::FAILED;
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+    done_cv_.notify_all();
+    return false;
+  }
+  return true;
+}
+
+void IndexBuilder::cancel() { cancel_ = true; }
+
+void IndexBuilder::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return !running_; });
+}
+
+float IndexBuilder::progress() const {
+  if (blocks_total_ == 0) return state_ == IndexBuildState::DONE ? 1.0f : 0.0f;
+  return static_cast<float>(blocks_done_.load()) / blocks_total_;
+}
+
+std::string IndexBuilder::segment_path(const IndexJob &job, uint32_t n) const {
+  return dir_ + "/" + job.name() + ".seg" + std::to_string(n);
+}
+
+void IndexBuilder::remove_segments(uint32_t from) {
+  for (const auto &job : jobs_) {
+    for (uint32_t n = from;; ++n) {
+      if (std::remove(segment_path(*job, n).c_str()) != 0) break;
+    }
+  }
+}
+
+/**
+ * checkpoint layout:
+ * [0:4] magic, [4:8] version, [8:16] dictionary fingerprint,
+ * [16:24] next block, [24:28] segment count, [28:32] job count,
+ * per job: u32 name length, name, u32 format version,
+ * trailing u32 adler32 of everything before it
+ */
+bool IndexBuilder::save_checkpoint(const checkpoint &ckpt) {
+  std::string tmp = dir_ + "/build.ckpt.tmp";
+  FILE *f = std::fopen(tmp.c_str(), "wb");
+  if (!f) return false;
+
+  std::vector<unsigned char> body;
+  auto put32 = [&body](uint32_t v) {
+    for (int i = 0; i < 4; ++i) body.push_back((unsigned char)(v >> (8 * i)));
+  };
+  auto put64 = [&put32](uint64_t v) {
+    put32((uint32_t)v);
+    put32((uint32_t)(v >> 32));
+  };
+  put32(CHECKPOINT_MAGIC);
+  put32(CHECKPOINT_VERSION);
+  put64(dict_->fingerprint());
+  put64(ckpt.next_block);
+  put32(ckpt.segments);
+  put32((uint32_t)jobs_.size());
+  for (const auto &job : jobs_) {
+    std::string name = job->name();
+    put32((uint32_t)name.size());
+    body.insert(body.end(), name.begin(), name.end());
+    put32(job->format_version());
+  }
+  put32(adler32checksum(body.data(), (uint32_t)body.size()));
+
+  bool ok = std::fwrite(body.data(), 1, body.size(), f) == body.size();
+  ok = fclose_durable(f) && ok;
+  return ok && publish_file(tmp, dir_ + "/build.ckpt");
+}
+
+bool IndexBuilder::load_checkpoint(checkpoint &ckpt) {
+  FILE *f = std::fopen((dir_ + "/build.ckpt").c_str(), "rb");
+  if (!f) return false;
+  std::vector<unsigned char> buf;
+  unsigned char chunk[512];
+  size_t n;
+  while ((n = std::fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    buf.insert(buf.end(), chunk, chunk + n);
+  }
+  std::fclose(f);
+
+  if (buf.size() < 36) return false;
+  size_t body_len = buf.size() - 4;
+  if (adler32checksum(buf.data(), (uint32_t)body_len) !=
+      load_u32(buf.data() + body_len)) {
+    LOGE("IndexBuilder: checkpoint checksum mismatch, restarting");
+    return false;
+  }
+  const unsigned char *p = buf.data();
+  if (load_u32(p) != CHECKPOINT_MAGIC || load_u32(p + 4) != CHECKPOINT_VERSION ||
+      load_u64(p + 8) != dict_->fingerprint()) {
+    return false;
+  }
+  checkpoint loaded;
+  loaded.next_block = load_u64(p + 16);
+  loaded.segments = load_u32(p + 24);
+  uint32_t job_count = load_u32(p + 28);
+
+  std::vector<std::pair<std::string, uint32_t>> saved_jobs;
+  size_t off = 32;
+  for (uint32_t i = 0; i < job_count; ++i) {
+    if (off + 4 > body_len) return false;
+    uint32_t len = load_u32(p + off);
+    off += 4;
+    if (off + len + 4 > body_len) return false;
+    std::string name(reinterpret_cast<const char *>(p + off), len);
+    off += len;
+    saved_jobs.emplace_back(name, load_u32(p + off));
+    off += 4;
+  }
+  // jobs that were published before the process died drop out of the
+  // pending set, every remaining job must have been part of the checkpoint
+  for (const auto &job : jobs_) {
+    bool found = false;
+    for (const auto &saved : saved_jobs) {
+      if (saved.first == job->name() && saved.second == job->format_version()) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) return false;
+  }
+  if (loaded.next_block > blocks_total_) return false;
+  ckpt = loaded;
+  return true;
+}
+
+void IndexBuilder::run() {
+  std::error_code ec;
+  std::filesystem::create_directories(dir_, ec);
+
+  checkpoint ckpt;
+  if (load_checkpoint(ckpt)) {
+    LOGD("IndexBuilder: resuming at block %llu with %u segments",
+         (unsigned long long)ckpt.next_block, ckpt.segments);
+    // segments written after the last checkpoint are incomplete
+    remove_segments(ckpt.segments);
+  } else {
+    ckpt = checkpoint();
+    std::remove((dir_ + "/build.ckpt").c_str());
+    remove_segments(0);
+  }
+  blocks_done_ = ckpt.next_block;
+
+  bool read_records = false;
+  for (const auto &job : jobs_) read_records = read_records || job->needs_records();
+
+  uint64_t pending_bytes = 0;
+  for (uint64_t rid = ckpt.next_block; rid < blocks_total_; ++rid) {
+    if (cancel_) {
+      LOGD("IndexBuilder: cancelled at block %llu", (unsigned long long)rid);
+      state_ = IndexBuildState::CANCELLED;
+      return;
+    }
+
+    try {
+      std::vector<uint8_t> data;
+      if (read_records) data = dict_->read_record_block(rid);
+      record_block_view view;
+      view.block_id = rid;
+      view.data = data.data();
+      view.size = data.size();
+      dict_->record_block_entry_range(rid, view.first_entry, view.last_entry);
+      for (const auto &job : jobs_) job->add_block(*dict_, view);
+      pending_bytes += data.size();
+    } catch (const std::exception &e) {
+      // a damaged block must not wedge the build; its entries stay unindexed
+      LOGE("IndexBuilder: skipping block %llu: %s", (unsigned long long)rid,
+           e.what());
+    }
+    blocks_done_ = rid + 1;
+
+    if (pending_bytes >= CHECKPOINT_BYTES || rid + 1 == blocks_total_) {
+      for (const auto &job : jobs_) {
+        std::string path = segment_path(*job, ckpt.segments);
+        FILE *f = std::fopen(path.c_str(), "wb");
+        if (!f) throw std::runtime_error("cannot create segment " + path);
+        bool ok = job->write_segment(f);
+        if (!fclose_durable(f) || !ok) {
+          throw std::runtime_error("cannot write segment " + path);
+        }
+      }
+      ckpt.segments++;
+      ckpt.next_block = rid + 1;
+      if (!save_checkpoint(ckpt)) {
+        throw std::runtime_error("cannot write checkpoint");
+      }
+      pending_bytes = 0;
+    }
+  }
+
+  for (const auto &job : jobs_) {
+    if (cancel_) {
+      state_ = IndexBuildState::CANCELLED;
+      return;
+    }
+    std::vector<std::string> segments;
+    for (uint32_t n = 0; n < ckpt.segments; ++n) {
+      segments.push_back(segment_path(*job, n));
+    }
+    std::string final_path = dir_ + "/" + job->name() + ".idx";
+    std::string tmp = final_path + ".tmp";
+    FILE *f = std::fopen(tmp.c_str(), "wb");
+    if (!f) throw std::runtime_error("cannot create " + tmp);
+    bool ok = job->merge(*dict_, segments, f);
+    if (!fclose_durable(f) || !ok || !publish_file(tmp, final_path)) {
+      std::remove(tmp.c_str());
+      throw std::runtime_error("cannot publish " + final_path);
+    }
+    for (const auto &seg : segments) std::remove(seg.c_str());
+    LOGD("IndexBuilder: published %s", final_path.c_str());
+    if (on_published_) on_published_(job->name());
+  }
+  std::remove((dir_ + "/build.ckpt").c_str());
+  state_ = IndexBuildState::DONE;
+}
+
+}  // namespace mdict
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/key_filter.h"
+
+#include <algorithm>
+
+#include "include/key_fold.h"
+#include "include/mdict.h"
+
+namespace mdict {
+
+static const uint32_t KEY_FILTER_MAGIC = 0x464b4456;  // "VDKF"
+static const size_t KEY_FILTER_HEADER_SIZE = 64;
+static const size_t KEY_FILTER_BLOCK_BYTES = 64;
+static const uint64_t KEY_FILTER_BLOCK_BITS = KEY_FILTER_BLOCK_BYTES * 8;
+static const uint64_t KEY_FILTER_BITS_PER_KEY = 12;
+static const int KEY_FILTER_PROBES = 8;
+
+static inline uint64_t mix64(uint64_t x) {
+  // splitmix64 finalizer
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
+}
+
+uint64_t key_filter_hash(std::string_view folded) {
+  // FNV-1a, then mixed so every bit of the hash depends on every byte
+  uint64_t h = 1469598103934665603ull;
+  for (unsigned char c : folded) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  return mix64(h);
+}
+
+/**
+ * the block of a hash (high half, by multiply-shift) and the bits it sets in
+ * that block (low half, by double hashing)
+ */
+static inline uint64_t filter_block(uint64_t hash, uint64_t block_count) {
+  return ((hash >> 32) * block_count) >> 32;
+}
+
+static inline void probe_bits(uint64_t hash, uint32_t bits[KEY_FILTER_PROBES]) {
+  uint32_t a = (uint32_t)hash;
+  uint32_t d = (uint32_t)(hash >> 9) | 1;
+  for (int i = 0; i < KEY_FILTER_PROBES; ++i, a += d) {
+    bits[i] = a & (KEY_FILTER_BLOCK_BITS - 1);
+  }
+}
+
+/***************************************
+ *            build side               *
+ ***************************************/
+
+void KeyFilterJob::add_block(const Mdict &dict, const record_block_view &block) {
+  const KeyFolder &folder = KeyFolder::get(KEY_FOLD_LOOSE);
+  for (unsigned long e = block.first_entry; e < block.last_entry; ++e) {
+    folder.fold(dict.entry_key(e), folded_);
+    // lookup() finds nothing for a key that folds to nothing
+    if (folded_.empty()) continue;
+    hashes_.push_back(key_filter_hash(folded_));
+  }
+}
+
+/**
+ * segment layout: u64 hash count, then the hashes
+ */
+bool KeyFilterJob::write_segment(FILE *out) {
+  bool ok = write_u64(out, hashes_.size());
+  for (uint64_t h : hashes_) {
+    if (!(ok = write_u64(out, h))) break;
+  }
+  std::vector<uint64_t>().swap(hashes_);
+  return ok;
+}
+
+bool KeyFilterJob::merge(const Mdict &dict,
+                         const std::vector<std::string> &segments, FILE *out) {
+  // pass 1: key count, for the filter size
+  uint64_t key_count = 0;
+  for (const auto &path : segments) {
+    mapped_file seg;
+    if (!seg.map(path) || seg.size() < 8) continue;
+    key_count += std::min<uint64_t>(load_u64(seg.data()), (seg.size() - 8) / 8);
+  }
+  uint64_t block_count =
+      (key_count * KEY_FILTER_BITS_PER_KEY + KEY_FILTER_BLOCK_BITS - 1) /
+      KEY_FILTER_BLOCK_BITS;
+  if (block_count == 0) block_count = 1;
+
+  // pass 2: set the bits
+  std::vector<unsigned char> blocks(block_count * KEY_FILTER_BLOCK_BYTES, 0);
+  uint32_t probes[KEY_FILTER_PROBES];
+  for (const auto &path : segments) {
+    mapped_file seg;
+    if (!seg.map(path) || seg.size() < 8) continue;
+    uint64_t n = std::min<uint64_t>(load_u64(seg.data()), (seg.size() - 8) / 8);
+    for (const unsigned char *p = seg.data() + 8; n > 0; --n, p += 8) {
+      uint64_t h = load_u64(p);
+      unsigned char *bits =
+          blocks.data() + filter_block(h, block_count) * KEY_FILTER_BLOCK_BYTES;
+      probe_bits(h, probes);
+      for (uint32_t bit : probes) bits[bit >> 3] |= (unsigned char)(1u << (bit & 7));
+    }
+  }
+
+  bool ok = write_u32(out, KEY_FILTER_MAGIC) && write_u32(out, FORMAT_VERSION) &&
+            write_u64(out, dict.fingerprint()) && write_u64(out, key_count) &&
+            write_u64(out, block_count);
+  for (size_t i = 32; ok && i < KEY_FILTER_HEADER_SIZE; i += 8) {
+    ok = write_u64(out, 0);
+  }
+  return ok && std::fwrite(blocks.data(), 1, blocks.size(), out) == blocks.size();
+}
+
+/***************************************
+ *            query side               *
+ ***************************************/
+
+bool KeyFilter::open(const std::string &path, uint64_t fingerprint) {
+  if (!file_.map(path)) return false;
+  const unsigned char *p = file_.data();
+  size_t size = file_.size();
+  if (size < KEY_FILTER_HEADER_SIZE || load_u32(p) != KEY_FILTER_MAGIC ||
+      load_u32(p + 4) != KeyFilterJob::FORMAT_VERSION ||
+      load_u64(p + 8) != fingerprint) {
+    file_.unmap();
+    return false;
+  }
+  block_count_ = load_u64(p + 24);
+  if (block_count_ == 0 || block_count_ > 0xFFFFFFFFu ||
+      block_count_ > (size - KEY_FILTER_HEADER_SIZE) / KEY_FILTER_BLOCK_BYTES) {
+    file_.unmap();
+    return false;
+  }
+  blocks_ = p + KEY_FILTER_HEADER_SIZE;
+  return true;
+}
+
+bool KeyFilter::may_contain(uint64_t hash) const {
+  if (!file_.data()) return true;
+  const unsigned char *bits =
+      blocks_ + filter_block(hash, block_count_) * KEY_FILTER_BLOCK_BYTES;
+  uint32_t probes[KEY_FILTER_PROBES];
+  probe_bits(hash, probes);
+  for (uint32_t bit : probes) {
+    if (!(bits[bit >> 3] & (1u << (bit & 7)))) return false;
+  }
+  return true;
+}
+
+std::vector<uint32_t> dictionaries_may_contain(const std::vector<Mdict *> &dicts,
+                                               const std::string &word) {
+  std::string folded = fold_key(word, KEY_FOLD_LOOSE);
+  std::vector<uint32_t> found;
+  if (folded.empty()) return found;
+  uint64_t hash = key_filter_hash(folded);
+  for (size_t i = 0; i < dicts.size(); ++i) {
+    if (dicts[i]->may_contain_hash(hash)) found.push_back(static_cast<uint32_t>(i));
+  }
+  return found;
+}
+
+}  // namespace mdict
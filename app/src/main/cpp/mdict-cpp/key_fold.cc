@@ -0,0 +1,478 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/key_fold.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include "include/html_text.h"
+
+namespace mdict {
+
+/********************************
+ *     tables                    *
+ ********************************/
+
+// half-width katakana FF61..FF9F as their full-width forms, the voiced
+// sound marks as the combining ones (composed by KeyFolder::fold)
+static const char16_t HALF_WIDTH_KANA[] = {
+    0x3002, 0x300C, 0x300D, 0x3001, 0x30FB, 0x30F2, 0x30A1, 0x30A3,
+    0x30A5, 0x30A7, 0x30A9, 0x30E3, 0x30E5, 0x30E7, 0x30C3, 0x30FC,
+    0x30A2, 0x30A4, 0x30A6, 0x30A8, 0x30AA, 0x30AB, 0x30AD, 0x30AF,
+    0x30B1, 0x30B3, 0x30B5, 0x30B7, 0x30B9, 0x30BB, 0x30BD, 0x30BF,
+    0x30C1, 0x30C4, 0x30C6, 0x30C8, 0x30CA, 0x30CB, 0x30CC, 0x30CD,
+    0x30CE, 0x30CF, 0x30D2, 0x30D5, 0x30D8, 0x30DB, 0x30DE, 0x30DF,
+    0x30E0, 0x30E1, 0x30E2, 0x30E4, 0x30E6, 0x30E8, 0x30E9, 0x30EA,
+    0x30EB, 0x30EC, 0x30ED, 0x30EF, 0x30F3, 0x3099, 0x309A,
+};
+
+// kana + combining voiced / semi-voiced mark -> composed kana
+static const char16_t KANA_COMPOSITIONS[][3] = {
+    {0x3046, 0x3099, 0x3094}, {0x304B, 0x3099, 0x304C}, {0x304D, 0x3099, 0x304E},
+    {0x304F, 0x3099, 0x3050}, {0x3051, 0x3099, 0x3052}, {0x3053, 0x3099, 0x3054},
+    {0x3055, 0x3099, 0x3056}, {0x3057, 0x3099, 0x3058}, {0x3059, 0x3099, 0x305A},
+    {0x305B, 0x3099, 0x305C}, {0x305D, 0x3099, 0x305E}, {0x305F, 0x3099, 0x3060},
+    {0x3061, 0x3099, 0x3062}, {0x3064, 0x3099, 0x3065}, {0x3066, 0x3099, 0x3067},
+    {0x3068, 0x3099, 0x3069}, {0x306F, 0x3099, 0x3070}, {0x306F, 0x309A, 0x3071},
+    {0x3072, 0x3099, 0x3073}, {0x3072, 0x309A, 0x3074}, {0x3075, 0x3099, 0x3076},
+    {0x3075, 0x309A, 0x3077}, {0x3078, 0x3099, 0x3079}, {0x3078, 0x309A, 0x307A},
+    {0x307B, 0x3099, 0x307C}, {0x307B, 0x309A, 0x307D}, {0x309D, 0x3099, 0x309E},
+    {0x30A6, 0x3099, 0x30F4}, {0x30AB, 0x3099, 0x30AC}, {0x30AD, 0x3099, 0x30AE},
+    {0x30AF, 0x3099, 0x30B0}, {0x30B1, 0x3099, 0x30B2}, {0x30B3, 0x3099, 0x30B4},
+    {0x30B5, 0x3099, 0x30B6}, {0x30B7, 0x3099, 0x30B8}, {0x30B9, 0x3099, 0x30BA},
+    {0x30BB, 0x3099, 0x30BC}, {0x30BD, 0x3099, 0x30BE}, {0x30BF, 0x3099, 0x30C0},
+    {0x30C1, 0x3099, 0x30C2}, {0x30C4, 0x3099, 0x30C5}, {0x30C6, 0x3099, 0x30C7},
+    {0x30C8, 0x3099, 0x30C9}, {0x30CF, 0x3099, 0x30D0}, {0x30CF, 0x309A, 0x30D1},
+    {0x30D2, 0x3099, 0x30D3}, {0x30D2, 0x309A, 0x30D4}, {0x30D5, 0x3099, 0x30D6},
+    {0x30D5, 0x309A, 0x30D7}, {0x30D8, 0x3099, 0x30D9}, {0x30D8, 0x309A, 0x30DA},
+    {0x30DB, 0x3099, 0x30DC}, {0x30DB, 0x309A, 0x30DD}, {0x30EF, 0x3099, 0x30F7},
+    {0x30F0, 0x3099, 0x30F8}, {0x30F1, 0x3099, 0x30F9}, {0x30F2, 0x3099, 0x30FA},
+    {0x30FD, 0x3099, 0x30FE},
+};
+
+// case folding runs: [first, last] every stride code points map to cp + delta
+struct case_run {
+  char32_t first;
+  char32_t last;
+  int32_t delta;
+  int32_t stride;
+};
+
+static const case_run CASE_RUNS[] = {
+    {0x00B5, 0x00B5, 775, 1},
+    {0x00C0, 0x00D6, 32, 1},
+    {0x00D8, 0x00DE, 32, 1},
+    {0x0100, 0x012E, 1, 2},
+    {0x0132, 0x0136, 1, 2},
+    {0x0139, 0x0147, 1, 2},
+    {0x014A, 0x0176, 1, 2},
+    {0x0178, 0x0178, -121, 1},
+    {0x0179, 0x017D, 1, 2},
+    {0x017F, 0x017F, -268, 1},
+    {0x0181, 0x0181, 210, 1},
+    {0x0182, 0x0184, 1, 2},
+    {0x0186, 0x0186, 206, 1},
+    {0x0187, 0x0187, 1, 1},
+    {0x0189, 0x018A, 205, 1},
+    {0x018B, 0x018B, 1, 1},
+    {0x018E, 0x018E, 79, 1},
+    {0x018F, 0x018F, 202, 1},
+    {0x0190, 0x0190, 203, 1},
+    {0x0191, 0x0191, 1, 1},
+    {0x0193, 0x0193, 205, 1},
+    {0x0194, 0x0194, 207, 1},
+    {0x0196, 0x0196, 211, 1},
+    {0x0197, 0x0197, 209, 1},
+    {0x0198, 0x0198, 1, 1},
+    {0x019C, 0x019C, 211, 1},
+    {0x019D, 0x019D, 213, 1},
+    {0x019F, 0x019F, 214, 1},
+    {0x01A0, 0x01A4, 1, 2},
+    {0x01A6, 0x01A6, 218, 1},
+    {0x01A7, 0x01A7, 1, 1},
+    {0x01A9, 0x01A9, 218, 1},
+    {0x01AC, 0x01AC, 1, 1},
+    {0x01AE, 0x01AE, 218, 1},
+    {0x01AF, 0x01AF, 1, 1},
+    {0x01B1, 0x01B2, 217, 1},
+    {0x01B3, 0x01B5, 1, 2},
+    {0x01B7, 0x01B7, 219, 1},
+    {0x01B8, 0x01B8, 1, 1},
+    {0x01BC, 0x01BC, 1, 1},
+    {0x01C4, 0x01C4, 2, 1},
+    {0x01C5, 0x01C5, 1, 1},
+    {0x01C7, 0x01C7, 2, 1},
+    {0x01C8, 0x01C8, 1, 1},
+    {0x01CA, 0x01CA, 2, 1},
+    {0x01CB, 0x01DB, 1, 2},
+    {0x01DE, 0x01EE, 1, 2},
+    {0x01F1, 0x01F1, 2, 1},
+    {0x01F2, 0x01F4, 1, 2},
+    {0x01F6, 0x01F6, -97, 1},
+    {0x01F7, 0x01F7, -56, 1},
+    {0x01F8, 0x021E, 1, 2},
+    {0x0220, 0x0220, -130, 1},
+    {0x0222, 0x0232, 1, 2},
+    {0x023A, 0x023A, 10795, 1},
+    {0x023B, 0x023B, 1, 1},
+    {0x023D, 0x023D, -163, 1},
+    {0x023E, 0x023E, 10792, 1},
+    {0x0241, 0x0241, 1, 1},
+    {0x0243, 0x0243, -195, 1},
+    {0x0244, 0x0244, 69, 1},
+    {0x0245, 0x0245, 71, 1},
+    {0x0246, 0x024E, 1, 2},
+    {0x0345, 0x0345, 116, 1},
+    {0x0370, 0x0372, 1, 2},
+    {0x0376, 0x0376, 1, 1},
+    {0x037F, 0x037F, 116, 1},
+    {0x0386, 0x0386, 38, 1},
+    {0x0388, 0x038A, 37, 1},
+    {0x038C, 0x038C, 64, 1},
+    {0x038E, 0x038F, 63, 1},
+    {0x0391, 0x03A1, 32, 1},
+    {0x03A3, 0x03AB, 32, 1},
+    {0x03C2, 0x03C2, 1, 1},
+    {0x03CF, 0x03CF, 8, 1},
+    {0x03D0, 0x03D0, -30, 1},
+    {0x03D1, 0x03D1, -25, 1},
+    {0x03D5, 0x03D5, -15, 1},
+    {0x03D6, 0x03D6, -22, 1},
+    {0x03D8, 0x03EE, 1, 2},
+    {0x03F0, 0x03F0, -54, 1},
+    {0x03F1, 0x03F1, -48, 1},
+    {0x03F4, 0x03F4, -60, 1},
+    {0x03F5, 0x03F5, -64, 1},
+    {0x03F7, 0x03F7, 1, 1},
+    {0x03F9, 0x03F9, -7, 1},
+    {0x03FA, 0x03FA, 1, 1},
+    {0x03FD, 0x03FF, -130, 1},
+    {0x0400, 0x040F, 80, 1},
+    {0x0410, 0x042F, 32, 1},
+    {0x0460, 0x0480, 1, 2},
+    {0x048A, 0x04BE, 1, 2},
+    {0x04C0, 0x04C0, 15, 1},
+    {0x04C1, 0x04CD, 1, 2},
+    {0x04D0, 0x052E, 1, 2},
+    {0x0531, 0x0556, 48, 1},
+    {0x1E00, 0x1E94, 1, 2},
+    {0x1E9B, 0x1E9B, -58, 1},
+    {0x1EA0, 0x1EFE, 1, 2},
+    {0x1F08, 0x1F0F, -8, 1},
+    {0x1F18, 0x1F1D, -8, 1},
+    {0x1F28, 0x1F2F, -8, 1},
+    {0x1F38, 0x1F3F, -8, 1},
+    {0x1F48, 0x1F4D, -8, 1},
+    {0x1F59, 0x1F5F, -8, 2},
+    {0x1F68, 0x1F6F, -8, 1},
+    {0x1FB8, 0x1FB9, -8, 1},
+    {0x1FBA, 0x1FBB, -74, 1},
+    {0x1FBE, 0x1FBE, -7173, 1},
+    {0x1FC8, 0x1FCB, -86, 1},
+    {0x1FD8, 0x1FD9, -8, 1},
+    {0x1FDA, 0x1FDB, -100, 1},
+    {0x1FE8, 0x1FE9, -8, 1},
+    {0x1FEA, 0x1FEB, -112, 1},
+    {0x1FEC, 0x1FEC, -7, 1},
+    {0x1FF8, 0x1FF9, -128, 1},
+    {0x1FFA, 0x1FFB, -126, 1},
+    {0x2126, 0x2126, -7517, 1},
+    {0x212A, 0x212A, -8383, 1},
+    {0x212B, 0x212B, -8262, 1},
+    {0x2132, 0x2132, 28, 1},
+    {0x2160, 0x216F, 16, 1},
+    {0x2183, 0x2183, 1, 1},
+    {0x24B6, 0x24CF, 26, 1},
+    {0xFF21, 0xFF3A, 32, 1},
+};
+
+// base letter of each code point of a block, '.' when it has none
+struct base_block {
+  char32_t first;
+  const char16_t *bases;
+};
+
+static const char16_t LATIN_BASES[] =
+    u"AAAAAA.CEEEEIIIIDNOOOOO.OUUUUY..aaaaaa.ceeeeiiiidnooooo.ouuuuy.y"  // 00C0
+    u"AaAaAaCcCcCcCcDdDdEeEeEeEeEeGgGgGgGgHhHhIiIiIiIiIi..JjKk.LlLlLlL"  // 0100
+    u"lLlNnNnNn...OoOoOo..RrRrRrSsSsSsSsTtTtTtUuUuUuUuUuUuWwYyYZzZzZz."  // 0140
+    u"b................Ff....I..l.....Oo..Pp......Tt.Uu..YyZz........."  // 0180
+    u".............AaIiOoUuUuUuUuUu.AaAa..GgGgKkOoOo..j...Gg..NnAa...."  // 01C0
+    u"AaAaEeEeIiIiOoOoRrRrUuUuSsTt..Hh......AaEeOoOoOoOoYy......ACc..."  // 0200
+    u"......EeJj..RrYy";  // 0240
+
+static const char16_t LATIN_EXTENDED_BASES[] =
+    u"AaBbBbBbCcDdDdDdDdDdEeEeEeEeEeFfGgHhHhHhHhHhIiIiKkKkKkLlLlLlLlMm"  // 1E00
+    u"MmMmNnNnNnNnOoOoOoOoPpPpRrRrRrRrSsSsSsSsSsTtTtTtTtUuUuUuUuUuVvVv"  // 1E40
+    u"WwWwWwWwWwXxXxYyZzZzZzhtwy......AaAaAaAaAaAaAaAaAaAaAaAaEeEeEeEe"  // 1E80
+    u"EeEeEeEeIiIiOoOoOoOoOoOoOoOoOoOoOoOoUuUuUuUuUuUuUuYyYyYyYy";  // 1EC0
+
+static const char16_t GREEK_BASES[] =
+    u"......Α.ΕΗΙ.Ο.ΥΩι..............."  // 0380
+    u"..........ΙΥαεηιυ..............."  // 03A0
+    u"..........ιυουω";  // 03C0
+
+static const char16_t GREEK_EXTENDED_BASES[] =
+    u"ααααααααΑΑΑΑΑΑΑΑεεεεεε..ΕΕΕΕΕΕ.."  // 1F00
+    u"ηηηηηηηηΗΗΗΗΗΗΗΗιιιιιιιιΙΙΙΙΙΙΙΙ"  // 1F20
+    u"οοοοοο..ΟΟΟΟΟΟ..υυυυυυυυ.Υ.Υ.Υ.Υ"  // 1F40
+    u"ωωωωωωωωΩΩΩΩΩΩΩΩααεεηηιιοουυωω.."  // 1F60
+    u"ααααααααΑΑΑΑΑΑΑΑηηηηηηηηΗΗΗΗΗΗΗΗ"  // 1F80
+    u"ωωωωωωωωΩΩΩΩΩΩΩΩααααα.ααΑΑΑΑΑ..."  // 1FA0
+    u"..ηηη.ηηΕΕΗΗΗ...ιιιι..ιιΙΙΙΙ...."  // 1FC0
+    u"υυυυρρυυΥΥΥΥΡ.....ωωω.ωωΟΟΩΩΩ";  // 1FE0
+
+static const base_block BASE_BLOCKS[] = {
+    {0x00C0, LATIN_BASES},
+    {0x0380, GREEK_BASES},
+    {0x1E00, LATIN_EXTENDED_BASES},
+    {0x1F00, GREEK_EXTENDED_BASES},
+};
+
+// the separators _s() skips, and their CJK forms
+static const char32_t PUNCTUATION[] = {
+    ' ',    ':',    '.',    ',',    '-',    '_',    '\'',   '(',    ')',
+    '#',    '<',    '>',    '!',    '/',    '\\',   '[',    ']',    '{',
+    '}',    '@',    0x2010, 0x2011, 0x2012, 0x2013, 0x2014, 0x2015, 0x2018,
+    0x2019, 0x3001, 0x3002, 0x3008, 0x3009, 0x300A, 0x300B, 0x300C, 0x300D,
+    0x300E, 0x300F, 0x3010, 0x3011, 0x3014, 0x3015, 0x30FB,
+};
+
+/********************************
+ *     steps                     *
+ ********************************/
+
+static void fold_width(char32_t c, std::u32string &out) {
+  if (c >= 0xFF01 && c <= 0xFF5E) {
+    out.push_back(c - 0xFEE0);
+  } else if (c >= 0xFF61 && c <= 0xFF9F) {
+    out.push_back(HALF_WIDTH_KANA[c - 0xFF61]);
+  } else if (c == 0x3000 || c == 0x00A0) {
+    out.push_back(' ');
+  } else if (c >= 0xFB00 && c <= 0xFB06) {
+    static const char *const LIGATURES[] = {"ff", "fi", "fl", "ffi",
+                                            "ffl", "st", "st"};
+    for (const char *p = LIGATURES[c - 0xFB00]; *p; ++p) out.push_back(*p);
+  } else {
+    out.push_back(c);
+  }
+}
+
+static void fold_case(char32_t c, std::u32string &out) {
+  if (c < 0x80) {
+    out.push_back((c >= 'A' && c <= 'Z') ? c + 32 : c);
+    return;
+  }
+  if (c == 0x00DF || c == 0x1E9E) {  // ß, ẞ
+    out.append(U"ss");
+    return;
+  }
+  if (c == 0x0130) {  // İ
+    out.push_back('i');
+    return;
+  }
+  const case_run *end = CASE_RUNS + sizeof(CASE_RUNS) / sizeof(CASE_RUNS[0]);
+  const case_run *run = std::upper_bound(
+      CASE_RUNS, end, c,
+      [](char32_t v, const case_run &r) { return v < r.first; });
+  if (run != CASE_RUNS) {
+    --run;
+    if (c <= run->last && (c - run->first) % run->stride == 0) {
+      out.push_back(c + run->delta);
+      return;
+    }
+  }
+  out.push_back(c);
+}
+
+static void fold_diacritics(char32_t c, std::u32string &out) {
+  if (c < 0xC0) {
+    out.push_back(c);
+    return;
+  }
+  if (c >= 0x0300 && c <= 0x036F) return;  // combining marks
+  switch (c) {
+    case 0x00C6: out.append(U"AE"); return;
+    case 0x00E6: out.append(U"ae"); return;
+    case 0x0152: out.append(U"OE"); return;
+    case 0x0153: out.append(U"oe"); return;
+    case 0x0132: out.append(U"IJ"); return;
+    case 0x0133: out.append(U"ij"); return;
+    case 0x00DE: out.append(U"TH"); return;
+    case 0x00FE: out.append(U"th"); return;
+    case 0x0401: out.push_back(0x0415); return;  // Ё
+    case 0x0451: out.push_back(0x0435); return;  // ё
+    default: break;
+  }
+  for (const base_block &block : BASE_BLOCKS) {
+    if (c < block.first) break;
+    size_t i = c - block.first;
+    if (i < std::char_traits<char16_t>::length(block.bases)) {
+      char16_t base = block.bases[i];
+      out.push_back(base == u'.' ? c : base);
+      return;
+    }
+  }
+  out.push_back(c);
+}
+
+static void fold_kana(char32_t c, std::u32string &out) {
+  if (c >= 0x30A1 && c <= 0x30F6) {
+    out.push_back(c - 0x60);
+  } else if (c == 0x30FD || c == 0x30FE) {  // ヽ ヾ
+    out.push_back(c - 0x60);
+  } else {
+    out.push_back(c);
+  }
+}
+
+static void fold_punctuation(char32_t c, std::u32string &out) {
+  for (char32_t p : PUNCTUATION) {
+    if (p == c) return;
+  }
+  out.push_back(c);
+}
+
+/**
+ * run the steps of a mode over one code point
+ * @param c code point
+ * @param out receives the folded code points
+ */
+static void fold_code_point(uint32_t mode, char32_t c, std::u32string &out) {
+  typedef void (*step)(char32_t, std::u32string &);
+  static const std::pair<uint32_t, step> STEPS[] = {
+      {KEY_FOLD_WIDTH, fold_width},
+      {KEY_FOLD_CASE, fold_case},
+      {KEY_FOLD_DIACRITICS, fold_diacritics},
+      {KEY_FOLD_KANA, fold_kana},
+      {KEY_FOLD_PUNCTUATION, fold_punctuation},
+  };
+  out.assign(1, c);
+  std::u32string next;
+  for (const auto &s : STEPS) {
+    if (!(mode & s.first)) continue;
+    next.clear();
+    for (char32_t x : out) s.second(x, next);
+    out.swap(next);
+  }
+}
+
+static char32_t compose_kana(char32_t base, char32_t mark) {
+  for (const auto &k : KANA_COMPOSITIONS) {
+    if (k[0] == base && k[1] == mark) return k[2];
+  }
+  return 0;
+}
+
+/********************************
+ *     KeyFolder                 *
+ ********************************/
+
+KeyFolder::KeyFolder(uint32_t mode) : mode_(mode) {
+  static const uint32_t UNCHANGED_PAGE[256] = {};
+  std::u32string folded;
+  for (uint32_t page = 0; page < 256; ++page) {
+    pages_[page] = UNCHANGED_PAGE;
+    if (page >= 0xD8 && page <= 0xDF) continue;  // surrogates
+    std::unique_ptr<uint32_t[]> entries;
+    for (uint32_t i = 0; i < 256; ++i) {
+      char32_t c = (page << 8) | i;
+      fold_code_point(mode, c, folded);
+      uint32_t entry;
+      if (folded.empty()) {
+        entry = FOLD_REMOVE;
+      } else if (folded.size() > 1) {
+        entry = FOLD_EXPAND | static_cast<uint32_t>(expansions_.size());
+        expansions_.push_back(folded);
+      } else if (folded[0] != c) {
+        entry = folded[0];
+      } else {
+        continue;
+      }
+      if (!entries) entries.reset(new uint32_t[256]());
+      entries[i] = entry;
+    }
+    if (entries) {
+      pages_[page] = entries.get();
+      owned_pages_.push_back(std::move(entries));
+    }
+  }
+}
+
+const KeyFolder &KeyFolder::get(uint32_t mode) {
+  // one slot per combination of the five bits, each built once; after that a
+  // lookup is a single acquire load in call_once, with no lock to contend on
+  static_assert(KEY_FOLD_LOOSE == 31, "KEY_FOLD_LOOSE must hold every bit");
+  static constexpr uint32_t MODES = KEY_FOLD_LOOSE + 1;
+  struct slot {
+    std::once_flag once;
+    std::unique_ptr<KeyFolder> folder;
+  };
+  static slot slots[MODES];
+  slot &s = slots[mode & KEY_FOLD_LOOSE];
+  std::call_once(s.once, [&]() { s.folder.reset(new KeyFolder(mode & KEY_FOLD_LOOSE)); });
+  return *s.folder;
+}
+
+std::string KeyFolder::fold(std::string_view text) const {
+  std::string out;
+  this->fold(text, out);
+  return out;
+}
+
+void KeyFolder::fold(std::string_view text, std::string &out) const {
+  out.clear();
+  out.reserve(text.size());
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(text.data());
+  const unsigned char *end = p + text.size();
+  // last code point written and where it starts, for kana composition
+  char32_t last = 0;
+  size_t last_pos = 0;
+  auto put = [&](char32_t c) {
+    if ((c == 0x3099 || c == 0x309A) && (this->mode_ & KEY_FOLD_WIDTH)) {
+      char32_t composed = last ? compose_kana(last, c) : 0;
+      if (composed) {
+        out.resize(last_pos);
+        c = composed;
+      }
+    }
+    last = c;
+    last_pos = out.size();
+    append_utf8(out, c);
+  };
+  while (p < end) {
+    char32_t c;
+    if (*p < 0x80) {
+      c = *p++;
+    } else {
+      p += decode_utf8(p, end, c);
+    }
+    if (c > 0xFFFF) {
+      put(c);
+      continue;
+    }
+    uint32_t entry = this->pages_[c >> 8][c & 0xFF];
+    if (entry == 0) {
+      put(c);
+    } else if (entry == FOLD_REMOVE) {
+      continue;
+    } else if (entry & FOLD_EXPAND) {
+      for (char32_t x : this->expansions_[entry & ~FOLD_EXPAND]) put(x);
+    } else {
+      put(entry);
+    }
+  }
+}
+
+std::string fold_key(std::string_view text, uint32_t mode) {
+  return KeyFolder::get(mode).fold(text);
+}
+
+}  // namespace mdict
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/key_suffix_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "include/key_fold.h"
+#include "include/mdict.h"
+
+namespace mdict {
+
+static const uint32_t SUFFIX_MAGIC = 0x41534456;  // "VDSA"
+static const size_t SUFFIX_HEADER_SIZE = 40;
+
+/***************************************
+ *            build side               *
+ ***************************************/
+
+void KeySuffixJob::add_block(const Mdict &dict, const record_block_view &block) {
+  const KeyFolder &folder = KeyFolder::get(KEY_FOLD_LOOSE);
+  for (unsigned long e = block.first_entry; e < block.last_entry; ++e) {
+    folder.fold(dict.entry_key(e), folded_);
+    // NUL ends the keys in the arena
+    if (folded_.empty() || folded_.find('\0') != std::string::npos) continue;
+    uint32_t entry = static_cast<uint32_t>(e);
+    uint32_t len = static_cast<uint32_t>(folded_.size());
+    for (int i = 0; i < 4; ++i) buffer_.push_back((unsigned char)(entry >> (8 * i)));
+    for (int i = 0; i < 4; ++i) buffer_.push_back((unsigned char)(len >> (8 * i)));
+    buffer_.insert(buffer_.end(), folded_.begin(), folded_.end());
+    ++count_;
+  }
+}
+
+/**
+ * segment layout: u64 key count, then the keys as buffered
+ */
+bool KeySuffixJob::write_segment(FILE *out) {
+  bool ok = write_u64(out, count_) &&
+            std::fwrite(buffer_.data(), 1, buffer_.size(), out) == buffer_.size();
+  std::vector<unsigned char>().swap(buffer_);
+  count_ = 0;
+  return ok;
+}
+
+bool KeySuffixJob::merge(const Mdict &dict, const std::vector<std::string> &segments,
+                         FILE *out) {
+  // the arena, keys in entry order
+  std::string arena;
+  std::vector<uint32_t> starts;
+  std::vector<uint32_t> entries;
+  for (const auto &path : segments) {
+    mapped_file seg;
+    if (!seg.map(path) || seg.size() < 8) continue;
+    const unsigned char *p = seg.data() + 8;
+    const unsigned char *end = seg.data() + seg.size();
+    for (uint64_t n = load_u64(seg.data()); n > 0 && end - p >= 8; --n) {
+      uint32_t entry = load_u32(p);
+      uint32_t len = load_u32(p + 4);
+      p += 8;
+      if ((size_t)(end - p) < len) return false;
+      if (arena.size() + len + 1 > 0xFFFFFFFFu) return false;
+      starts.push_back((uint32_t)arena.size());
+      entries.push_back(entry);
+      arena.append(reinterpret_cast<const char *>(p), len);
+      arena.push_back('\0');
+      p += len;
+    }
+  }
+  starts.push_back((uint32_t)arena.size());
+
+  // every code point start, sorted by the text up to the key's NUL
+  std::vector<uint32_t> suffixes;
+  for (size_t i = 0; i < arena.size(); ++i) {
+    unsigned char c = (unsigned char)arena[i];
+    if (c != 0 && (c & 0xC0) != 0x80) suffixes.push_back((uint32_t)i);
+  }
+  const char *text = arena.c_str();
+  std::sort(suffixes.begin(), suffixes.end(), [text](uint32_t a, uint32_t b) {
+    int c = std::strcmp(text + a, text + b);
+    return c != 0 ? c < 0 : a < b;
+  });
+
+  bool ok = write_u32(out, SUFFIX_MAGIC) && write_u32(out, FORMAT_VERSION) &&
+            write_u64(out, dict.fingerprint()) && write_u64(out, entries.size()) &&
+            write_u64(out, suffixes.size()) && write_u64(out, arena.size());
+  for (size_t i = 0; ok && i < starts.size(); ++i) ok = write_u32(out, starts[i]);
+  for (size_t i = 0; ok && i < entries.size(); ++i) ok = write_u32(out, entries[i]);
+  for (size_t i = 0; ok && i < suffixes.size(); ++i) ok = write_u32(out, suffixes[i]);
+  return ok && std::fwrite(arena.data(), 1, arena.size(), out) == arena.size();
+}
+
+/***************************************
+ *            query side               *
+ ***************************************/
+
+bool KeySuffixIndex::open(const std::string &path, uint64_t fingerprint) {
+  if (!file_.map(path)) return false;
+  const unsigned char *p = file_.data();
+  size_t size = file_.size();
+  if (size < SUFFIX_HEADER_SIZE || load_u32(p) != SUFFIX_MAGIC ||
+      load_u32(p + 4) != KeySuffixJob::FORMAT_VERSION ||
+      load_u64(p + 8) != fingerprint) {
+    file_.unmap();
+    return false;
+  }
+  key_count_ = load_u64(p + 16);
+  suffix_count_ = load_u64(p + 24);
+  arena_bytes_ = load_u64(p + 32);
+  uint64_t room = size - SUFFIX_HEADER_SIZE;
+  if (key_count_ >= room / 8 || suffix_count_ > room / 4 ||
+      arena_bytes_ > room ||
+      (key_count_ * 2 + 1 + suffix_count_) * 4 + arena_bytes_ != room) {
+    file_.unmap();
+    return false;
+  }
+  starts_ = p + SUFFIX_HEADER_SIZE;
+  entries_ = starts_ + (key_count_ + 1) * 4;
+  suffixes_ = entries_ + key_count_ * 4;
+  arena_ = reinterpret_cast<const char *>(suffixes_ + suffix_count_ * 4);
+  if (load_u32(starts_ + key_count_ * 4) != arena_bytes_ ||
+      (arena_bytes_ > 0 && arena_[arena_bytes_ - 1] != '\0')) {
+    file_.unmap();
+    return false;
+  }
+  return true;
+}
+
+std::string_view KeySuffixIndex::suffix(uint32_t offset) const {
+  if (offset >= arena_bytes_) return std::string_view();
+  // the arena ends with a NUL, checked by open()
+  return std::string_view(arena_ + offset);
+}
+
+std::pair<uint64_t, uint64_t> KeySuffixIndex::range(std::string_view folded,
+                                                    bool at_end) const {
+  if (!file_.data() || folded.empty()) return {0, 0};
+
+  // first suffix not below the text
+  uint64_t lo = 0, hi = suffix_count_;
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    if (suffix(offset_at(mid)) < folded) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  // first suffix past the ones starting with it (or equal to it)
+  uint64_t first = lo;
+  hi = suffix_count_;
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    std::string_view s = suffix(offset_at(mid));
+    bool inside = at_end ? s == folded
+                         : s.substr(0, folded.size()) == folded;
+    if (inside) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return {first, lo};
+}
+
+size_t KeySuffixIndex::count(std::string_view folded, bool at_end) const {
+  std::pair<uint64_t, uint64_t> r = range(folded, at_end);
+  return static_cast<size_t>(r.second - r.first);
+}
+
+std::vector<uint32_t> KeySuffixIndex::find(std::string_view folded,
+                                           bool at_end) const {
+  std::vector<uint32_t> found;
+  std::pair<uint64_t, uint64_t> r = range(folded, at_end);
+
+  // arena offsets to keys
+  const unsigned char *starts_end = starts_ + key_count_ * 4;
+  for (uint64_t i = r.first; i < r.second; ++i) {
+    uint32_t offset = offset_at(i);
+    // last key start <= offset
+    uint64_t a = 0, b = key_count_;
+    while (a < b) {
+      uint64_t mid = a + (b - a) / 2;
+      if (load_u32(starts_ + (mid + 1) * 4) <= offset) {
+        a = mid + 1;
+      } else {
+        b = mid;
+      }
+    }
+    if (starts_ + a * 4 < starts_end) found.push_back(load_u32(entries_ + a * 4));
+  }
+  std::sort(found.begin(), found.end());
+  found.erase(std::unique(found.begin(), found.end()), found.end());
+  return found;
+}
+
+}  // namespace mdict
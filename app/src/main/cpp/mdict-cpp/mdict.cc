@@ -21,13 +21,20 @@
 #include <utility>
 #include <cctype>
 #include <cstdio>
-#include <android/log.h>
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "encode/char_decoder.h"
 #include "encode/api.h"
 #include "include/adler32.h"
 #include "include/binutils.h"
+#include "include/definition_search.h"
+#include "include/fileutils.h"
+#include "include/html_text.h"
+#include "include/index_io.h"
 #include "include/mdict_extern.h"
+#include "include/mdict_log.h"
 #include "include/xmlutils.h"
 #include "include/zlib_wrapper.h"
 
@@ -48,6 +55,13 @@ namespace mdict {
         }
     }
 
+// constructor with a hunspell affix file and word list for stemming
+    Mdict::Mdict(std::string fn, std::string aff_fn, std::string dic_fn) noexcept
+            : Mdict(std::move(fn)) {
+        this->aff_filename = std::move(aff_fn);
+        this->dic_filename = std::move(dic_fn);
+    }
+
 // constructor accepting file descriptor (zero-copy on Android)
     Mdict::Mdict(int fd, bool is_mdd) noexcept : filename("") {
         // Default to MDXTYPE for FD-based dictionaries
@@ -63,8 +77,18 @@ namespace mdict {
         this->file_ptr = fdopen(fd, "rb");
     }
 
+// constructor for a dictionary embedded in a larger file (stored ZIP member)
+    Mdict::Mdict(int fd, bool is_mdd, uint64_t base_offset) noexcept
+            : Mdict(fd, is_mdd) {
+        this->file_base = base_offset;
+    }
+
 // distructor
     Mdict::~Mdict() {
+        // the builder reads through file_ptr, stop it first
+        this->index_builder.reset();
+        delete this->snapshot.load();
+        BlockCache::shared().drop(this->cache_owner);
         // Close the file pointer (also closes the underlying FD if opened via fdopen)
         if (this->file_ptr) {
             fclose(this->file_ptr);
@@ -884,10 +908,14 @@ namespace mdict {
             }
             key_block = kb_uncompressed.data();
 
+            if (kb_uncompressed.size() != decomp_size) {
+                throw std::runtime_error("key block decompress size mismatch");
+            }
             uint32_t adler32cs =
                     adler32checksum(key_block, static_cast<uint32_t>(decomp_size));
-            assert(adler32cs == chksum);
-            assert(kb_uncompressed.size() == decomp_size);
+            if (adler32cs != chksum) {
+                throw std::runtime_error("key block checksum mismatch");
+            }
         } else {
             throw std::runtime_error("cannot determine the key block compress type");
         }
@@ -920,7 +948,7 @@ namespace mdict {
             // unsigned long end_ofset = i + comp_size;
             // 4 bytes comp type
             char *key_block_comp_type = (char *)calloc(4, sizeof(char));
-            memcpy(key_block_comp_type, key_block_buffer, 4 * sizeof(char));
+            memcpy(key_block_comp_type, key_block_buffer + start_ofset, 4 * sizeof(char));
             // 4 bytes adler checksum of decompressed key block
             // TODO  adler32 = unpack('>I', key_block_compressed[start + 4:start +
             // 8])[0]
@@ -934,7 +962,7 @@ namespace mdict {
 
             if ((key_block_comp_type[0] & 255) == 0) {
                 // none compressed
-                key_block = key_block_buffer + 8 * sizeof(char);
+                key_block = key_block_buffer + start_ofset + 8 * sizeof(char);
             } else if ((key_block_comp_type[0] & 255) == 1) {
                 // 01000000
                 // TODO lzo decompress
@@ -944,29 +972,62 @@ namespace mdict {
                 kb_uncompressed =
                         zlib_mem_uncompress(key_block_buffer + start_ofset + 8, comp_size);
                 if (kb_uncompressed.empty() || kb_uncompressed.size() == 0) {
-                    throw std::runtime_error("key block decompress failed");
+                    // its keys are lost, the rest of the dictionary still
+                    // opens and scrub() reports the block; the start of the
+                    // stream usually still inflates
+                    LOGE("decode_key_block: key block %ld does not inflate", idx);
+                    unsigned char head[8];
+                    mz_stream stream;
+                    std::memset(&stream, 0, sizeof(stream));
+                    size_t head_len = 0;
+                    if (mz_inflateInit(&stream) == MZ_OK) {
+                        stream.next_in = key_block_buffer + start_ofset + 8;
+                        stream.avail_in = static_cast<unsigned int>(comp_size - 8);
+                        stream.next_out = head;
+                        stream.avail_out = sizeof(head);
+                        mz_inflate(&stream, MZ_SYNC_FLUSH);
+                        head_len = sizeof(head) - stream.avail_out;
+                        mz_inflateEnd(&stream);
+                    }
+                    this->drop_key_block(idx, head, head_len);
+                    i += comp_size;
+                    continue;
                 }
                 key_block = kb_uncompressed.data();
-
-                uint32_t adler32cs =
-                        adler32checksum(key_block, static_cast<uint32_t>(decomp_size));
-                assert(adler32cs == chksum);
-                assert(kb_uncompressed.size() == decomp_size);
             } else {
                 throw std::runtime_error("cannot determine the key block compress type");
             }
 
+            // keys split from a damaged block could break the sort order every
+            // key search relies on, so they are dropped like those above
+            if (key_block != nullptr) {
+                size_t body_size = (key_block_comp_type[0] & 255) == 0
+                                           ? comp_size - 8
+                                           : kb_uncompressed.size();
+                if (body_size != decomp_size ||
+                    adler32checksum(key_block, static_cast<uint32_t>(decomp_size)) != chksum) {
+                    LOGE("decode_key_block: key block %ld is damaged, skipping its keys", idx);
+                    this->drop_key_block(idx, key_block, std::min<size_t>(body_size, 8));
+                    i += comp_size;
+                    continue;
+                }
+            }
+
             // split key
             std::vector<key_list_item *> tlist =
                     split_key_block(key_block, decomp_size, idx);
             key_list.insert(key_list.end(), tlist.begin(), tlist.end());
+            key_block_entry_end.push_back(key_list.size());
 
             // TODO HERE append keys
 
             // next round
             i += comp_size;
         }
-        assert(key_list.size() == this->entries_num);
+        if (key_list.size() != this->entries_num) {
+            LOGE("decode_key_block: %zu of %llu keys decoded", key_list.size(),
+                 (unsigned long long)this->entries_num);
+        }
         /// passed
 
         this->record_block_info_offset = this->key_block_info_start_offset +
@@ -1070,128 +1131,223 @@ namespace mdict {
         return 0;
     }
 
-    std::vector<std::pair<std::string, std::string>>
-    Mdict::decode_record_block_by_rid(unsigned long rid /* record id */) {
-        // record block start offset: record_block_offset
-        uint64_t record_offset = this->record_block_offset;
-
-        // key list index counter
-        unsigned long i = 0l;
-
-        std::vector<uint8_t> record_block_uncompressed_v;
-        unsigned char *record_block_uncompressed_b;
-        uint64_t checksum = 0l;
-
-        unsigned long idx = rid;
-
-        //  for (int idx = 0; idx < this->record_header.size(); idx++) {
-        uint64_t comp_size = record_header[idx]->compressed_size;
-        uint64_t uncomp_size = record_header[idx]->decompressed_size;
-        uint64_t comp_accu = record_header[idx]->compressed_size_accumulator;
-        uint64_t decomp_accu = record_header[idx]->decompressed_size_accumulator;
-        uint64_t previous_end = 0;
-        uint64_t previous_uncomp_size = 0;
-        if (idx > 0) {
-            previous_end = record_header[idx - 1]->decompressed_size_accumulator;
-            previous_uncomp_size = record_header[idx - 1]->decompressed_size;
+    std::vector<uint8_t> Mdict::read_record_block(unsigned long rid) {
+        if (rid >= this->record_header.size()) {
+            throw std::runtime_error("record block id out of range");
+        }
+        uint64_t comp_size = record_header[rid]->compressed_size;
+        uint64_t uncomp_size = record_header[rid]->decompressed_size;
+        uint64_t comp_accu = record_header[rid]->compressed_size_accumulator;
+        if (comp_size < 8) {
+            throw std::runtime_error("record block too small");
         }
 
         // Use std::vector for automatic memory management (RAII)
         std::vector<char> record_block_cmp_buffer(comp_size);
-
-        this->readfile(record_offset + comp_accu, comp_size, record_block_cmp_buffer.data());
+        this->readfile(this->record_block_offset + comp_accu, comp_size,
+                       record_block_cmp_buffer.data());
 
         // 4 bytes, compress type
         int comp_type = record_block_cmp_buffer[0] & 0xff;
-
         // 4 bytes adler32 checksum
-        // We can read directly from the buffer
-        checksum = be_bin_to_u32((unsigned char *)record_block_cmp_buffer.data() + 4);
+        uint32_t checksum =
+                be_bin_to_u32((unsigned char *)record_block_cmp_buffer.data() + 4);
 
-        if (comp_type == 0 /* not compressed TODO*/) {
-            throw std::runtime_error("uncompress block not support yet");
-        } else {
-            char *record_block_decrypted_buff;
-            if (this->encrypt == ENCRYPT_RECORD_ENC /* record block encrypted */) {
-                // TODO
-                throw std::runtime_error("record encrypted not support yet");
+        if (this->encrypt == ENCRYPT_RECORD_ENC /* record block encrypted */) {
+            // TODO
+            throw std::runtime_error("record encrypted not support yet");
+        }
+        char *record_block_decrypted_buff = record_block_cmp_buffer.data() + 8;
+        if (comp_type == 0 /* stored */) {
+            if (comp_size - 8 != uncomp_size) {
+                throw std::runtime_error("stored record block size mismatch");
             }
-            record_block_decrypted_buff = record_block_cmp_buffer.data() + 8 * sizeof(char);
-            // decompress
-            if (comp_type == 1 /* lzo */) {
-                throw std::runtime_error("lzo compress not support yet");
-            } else if (comp_type == 2) {
-                // zlib compress
-                record_block_uncompressed_v =
-                        zlib_mem_uncompress(record_block_decrypted_buff, comp_size);
-                if (record_block_uncompressed_v.empty()) {
-                    throw std::runtime_error("record block decompress failed size == 0");
-                }
-                record_block_uncompressed_b = record_block_uncompressed_v.data();
-                uint32_t adler32cs = adler32checksum(record_block_uncompressed_b,
-                                                     static_cast<uint32_t>(uncomp_size));
-                
-                if (record_block_uncompressed_v.size() != uncomp_size) {
-                    throw std::runtime_error("record block decompress size mismatch");
-                }
-                if (adler32cs != checksum) {
-                    throw std::runtime_error("record block checksum mismatch");
-                }
-            } else {
-                throw std::runtime_error(
-                        "cannot determine the record block compress type");
+            std::vector<uint8_t> record_block_stored(
+                    record_block_decrypted_buff, record_block_decrypted_buff + uncomp_size);
+            if (!this->verified.load(std::memory_order_relaxed) &&
+                adler32checksum(record_block_stored.data(),
+                                static_cast<uint32_t>(uncomp_size)) != checksum) {
+                throw std::runtime_error("record block checksum mismatch");
+            }
+            return record_block_stored;
+        }
+        // decompress
+        if (comp_type == 1 /* lzo */) {
+            throw std::runtime_error("lzo compress not support yet");
+        } else if (comp_type != 2) {
+            throw std::runtime_error("cannot determine the record block compress type");
+        }
+        // zlib compress
+        std::vector<uint8_t> record_block_uncompressed_v =
+                zlib_mem_uncompress(record_block_decrypted_buff, comp_size);
+        if (record_block_uncompressed_v.empty()) {
+            throw std::runtime_error("record block decompress failed size == 0");
+        }
+        if (record_block_uncompressed_v.size() != uncomp_size) {
+            throw std::runtime_error("record block decompress size mismatch");
+        }
+        // a scrubbed file was checked already, zlib still checks its stream
+        if (!this->verified.load(std::memory_order_relaxed) &&
+            adler32checksum(record_block_uncompressed_v.data(),
+                            static_cast<uint32_t>(uncomp_size)) != checksum) {
+            throw std::runtime_error("record block checksum mismatch");
+        }
+        return record_block_uncompressed_v;
+    }
+
+    BlockCache::block_ptr Mdict::record_block(unsigned long rid) {
+        BlockCache &cache = BlockCache::shared();
+        BlockCache::block_ptr block = cache.get(this->cache_owner, rid);
+        if (block) return block;
+        block = std::make_shared<const std::vector<uint8_t>>(this->read_record_block(rid));
+        cache.put(this->cache_owner, rid, block);
+        return block;
+    }
+
+    void Mdict::drop_key_block(long idx, const unsigned char *head, size_t head_len) {
+        // only the first of several damaged blocks in a row bounds a record
+        if (!key_list.empty() && !record_end_cap.count(key_list.size() - 1)) {
+            uint64_t own_start = key_list.back()->record_start;
+            uint64_t cap = own_start;
+            size_t width = this->version >= 2.0 ? 8 : 4;
+            if (head && head_len >= width) {
+                uint64_t first_lost = width == 8 ? be_bin_to_u64(head) : be_bin_to_u32(head);
+                // a damaged head can hold anything, record starts only grow
+                if (first_lost >= own_start) cap = first_lost;
+            }
+            if (cap == own_start) {
+                LOGE("decode_key_block: the record of entry %zu is lost with key block %ld",
+                     key_list.size() - 1, idx);
+            }
+            record_end_cap[key_list.size() - 1] = cap;
+        }
+        key_block_entry_end.push_back(key_list.size());
+    }
+
+    uint64_t Mdict::file_entry_id(unsigned long entry) const {
+        // the key block holding the entry: the first whose end lies past it,
+        // blocks without keys end where the one before them does
+        size_t b = std::upper_bound(key_block_entry_end.begin(), key_block_entry_end.end(),
+                                    entry) - key_block_entry_end.begin();
+        if (b >= key_block_info_list.size()) {
+            if (key_block_info_list.empty()) return entry;
+            const key_block_info *last = key_block_info_list.back();
+            return last->entries_accumulator + last->num_entries;
+        }
+        uint64_t block_first = b > 0 ? key_block_entry_end[b - 1] : 0;
+        return key_block_info_list[b]->entries_accumulator + (entry - block_first);
+    }
+
+    void Mdict::record_block_entry_range(unsigned long rid, unsigned long &first,
+                                         unsigned long &last) const {
+        uint64_t block_start = record_header[rid]->decompressed_size_accumulator;
+        uint64_t block_end = block_start + record_header[rid]->decompressed_size;
+        // key_list is ordered by record_start, so the block's entries are a
+        // contiguous run found by two binary searches
+        auto by_start = [](const key_list_item *item, uint64_t pos) {
+            return item->record_start < pos;
+        };
+        first = std::lower_bound(key_list.begin(), key_list.end(), block_start, by_start) -
+                key_list.begin();
+        last = std::lower_bound(key_list.begin() + first, key_list.end(), block_end, by_start) -
+               key_list.begin();
+    }
+
+    void Mdict::entry_span(const record_block_view &block, unsigned long entry,
+                           size_t &start, size_t &len) const {
+        uint64_t block_start =
+                record_header[block.block_id]->decompressed_size_accumulator;
+        start = key_list[entry]->record_start - block_start;
+        // a record ends where the next one starts, the last record of a block
+        // ends with the block
+        size_t end = block.size;
+        if (entry + 1 < block.last_entry) {
+            end = key_list[entry + 1]->record_start - block_start;
+        }
+        // nor past the records of the entries a damaged key block lost
+        if (!record_end_cap.empty()) {
+            auto cap = record_end_cap.find(entry);
+            if (cap != record_end_cap.end() && cap->second >= block_start &&
+                cap->second - block_start < end) {
+                end = cap->second - block_start;
             }
         }
+        if (start > block.size) start = block.size;
+        if (end < start) end = start;
+        if (end > block.size) end = block.size;
+        len = end - start;
+    }
 
-        // No need to free manual buffers anymore due to std::vector
+    std::string Mdict::entry_record(unsigned long entry) {
+        if (entry >= this->key_list.size()) return std::string();
+        record_block_view block;
+        block.block_id = reduce_record_block_offset(this->key_list[entry]->record_start);
+        BlockCache::block_ptr data = this->record_block(block.block_id);
+        block.data = data->data();
+        block.size = data->size();
+        this->record_block_entry_range(block.block_id, block.first_entry, block.last_entry);
+        size_t start, len;
+        this->entry_span(block, entry, start, len);
+        return std::string(reinterpret_cast<const char *>(data->data()) + start, len);
+    }
+
+    bool Mdict::record_slice(unsigned long entry, int &fd, uint64_t &offset,
+                             uint64_t &length) {
+        if (entry >= this->key_list.size() || !this->file_ptr) return false;
+        if (this->encrypt == ENCRYPT_RECORD_ENC) return false;
+        record_block_view block;
+        block.block_id = reduce_record_block_offset(this->key_list[entry]->record_start);
+        const record_header_item *info = this->record_header[block.block_id];
+        if (info->compressed_size < 8 ||
+            info->compressed_size - 8 != info->decompressed_size) {
+            return false;
+        }
+
+        // only the compression type is read, the data stays in the file
+        uint64_t block_offset = this->record_block_offset + info->compressed_size_accumulator;
+        char comp_type[4];
+        this->readfile(block_offset, 4, comp_type);
+        if ((comp_type[0] & 0xff) != 0) return false;
+
+        block.size = info->decompressed_size;
+        this->record_block_entry_range(block.block_id, block.first_entry, block.last_entry);
+        size_t start, len;
+        this->entry_span(block, entry, start, len);
+        fd = fileno(this->file_ptr);
+        offset = this->file_base + block_offset + 8 + start;
+        length = len;
+        return true;
+    }
+
+    std::vector<std::pair<std::string, std::string>>
+    Mdict::decode_record_block_by_rid(unsigned long rid /* record id */) {
+        BlockCache::block_ptr data = this->record_block(rid);
+
+        record_block_view block;
+        block.block_id = rid;
+        block.data = data->data();
+        block.size = data->size();
+        this->record_block_entry_range(rid, block.first_entry, block.last_entry);
 
-        unsigned char *record_block = record_block_uncompressed_b;
         /**
          * 请注意，block 是会有很多个的，而每个block都可能会被压缩
          * 而 key_list中的 record_start,
          * key_text是相对每一个block而言的，end是需要每次解析的时候算出来的
          * 所有的record_start/length/end都是针对解压后的block而言的
          */
-
         std::vector<std::pair<std::string, std::string>> vec;
+        vec.reserve(block.last_entry - block.first_entry);
 
-        while (i < this->key_list.size()) {
-            // TODO OPTIMISE
-            unsigned long record_start = key_list[i]->record_start;
-
-            std::string key_text = key_list[i]->key_word;
-            // start, skip the keys which not includes in record block
-            if (record_start < decomp_accu) {
-                i++;
-                continue;
-            }
-
-            // end important: the condition should be lgt, because, the end bound will
-            // be equal to uncompressed size
-            // this part ensures the record match to key list bound
-            if (record_start - decomp_accu >= uncomp_size) {
-                break;
-            }
-
-            unsigned long upbound = uncomp_size; // - this->key_list[i]->record_start;
-            unsigned long expect_end = 0;
-            auto expect_start = this->key_list[i]->record_start - decomp_accu;
-            if (i < this->key_list.size() - 1) {
-                expect_end =
-                        this->key_list[i + 1]->record_start - this->key_list[i]->record_start;
-                expect_start = this->key_list[i]->record_start - decomp_accu;
-            } else {
-
-                expect_end =
-                        this->record_block_size - (previous_end + previous_uncomp_size);
-            }
-            upbound = expect_end < upbound ? expect_end : upbound;
+        for (unsigned long i = block.first_entry; i < block.last_entry; ++i) {
+            size_t expect_start = 0;
+            size_t upbound = 0;
+            this->entry_span(block, i, expect_start, upbound);
 
             std::string def;
             if (this->filetype == "MDD") {
                 // FIX: Convert binary image/audio data to Hex String for safe JNI transfer
                 const char* hex_map = "0123456789ABCDEF";
-                unsigned char* data_ptr = (unsigned char*)record_block + expect_start;
+                const unsigned char* data_ptr = block.data + expect_start;
 
                 def.reserve(upbound * 2);
                 for (size_t k = 0; k < upbound; ++k) {
@@ -1204,17 +1360,316 @@ namespace mdict {
                 // Ignore the (often incorrect) 'this->encoding' flag for MDX files.
                 // The 'hiroshima' files are UTF-8, so we will *always* treat
                 // MDX content as UTF-8.
-                def = be_bin_to_utf8((char *)record_block, expect_start,
+                def = be_bin_to_utf8((char *)block.data, expect_start,
                                      upbound /* to delete null character*/);
             }
+            vec.emplace_back(key_list[i]->key_word, std::move(def));
+        }
+        return vec;
+    }
 
-            std::pair<std::string, std::string> vp(key_text, def);
-            vec.push_back(vp);
-            i++;
+    uint64_t Mdict::fingerprint() const {
+        // FNV-1a over the structural header numbers; a rewritten file with the
+        // same name changes at least one of them
+        uint64_t h = 1469598103934665603ull;
+        auto mix = [&h](uint64_t v) {
+            for (int i = 0; i < 8; ++i) {
+                h ^= (v >> (8 * i)) & 0xff;
+                h *= 1099511628211ull;
+            }
+        };
+        mix(this->key_block_num);
+        mix(this->entries_num);
+        mix(this->record_block_number);
+        mix(this->record_block_entries_number);
+        mix(this->record_block_size);
+        mix(this->record_block_offset);
+        for (const auto *item : this->record_header) {
+            mix(item->compressed_size);
         }
+        return h;
+    }
 
-        //  assert(size_counter == record_block_size);
-        return vec;
+    void Mdict::set_index_dir(const std::string &dir) {
+        std::lock_guard<std::mutex> lock(this->index_mutex);
+        if (this->index_builder) {
+            this->index_builder->cancel();
+            this->index_builder->wait();
+            this->index_builder.reset();
+        }
+        this->index_dir = dir;
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if (ec) {
+            LOGE("set_index_dir: cannot create %s: %s", dir.c_str(), ec.message().c_str());
+        }
+        for (const auto &job : this->make_index_jobs(~0u)) {
+            this->load_index(job->name());
+        }
+        if (this->load_scrub_mark()) this->verified = true;
+    }
+
+    bool Mdict::start_index_build(uint32_t kinds) {
+        std::lock_guard<std::mutex> lock(this->index_mutex);
+        if (this->index_dir.empty()) return false;
+
+        // only the indexes not published yet
+        std::vector<std::unique_ptr<IndexJob>> jobs;
+        for (auto &job : this->make_index_jobs(kinds)) {
+            if (!std::filesystem::exists(this->index_dir + "/" + job->name() + ".idx")) {
+                jobs.push_back(std::move(job));
+            }
+        }
+        if (jobs.empty()) return false;
+
+        if (!this->index_builder) {
+            this->index_builder.reset(new IndexBuilder(this, this->index_dir));
+        }
+        return this->index_builder->start(std::move(jobs), [this](const std::string &name) {
+            this->load_index(name);
+        });
+    }
+
+    void Mdict::cancel_index_build() {
+        std::lock_guard<std::mutex> lock(this->index_mutex);
+        if (this->index_builder) this->index_builder->cancel();
+    }
+
+    IndexBuildState Mdict::index_build_state() {
+        std::lock_guard<std::mutex> lock(this->index_mutex);
+        return this->index_builder ? this->index_builder->state() : IndexBuildState::IDLE;
+    }
+
+    float Mdict::index_build_progress() {
+        std::lock_guard<std::mutex> lock(this->index_mutex);
+        return this->index_builder ? this->index_builder->progress() : 0.0f;
+    }
+
+    std::vector<std::unique_ptr<IndexJob>> Mdict::make_index_jobs(uint32_t kinds) {
+        // index kinds register their jobs here
+        std::vector<std::unique_ptr<IndexJob>> jobs;
+        if (this->filetype != "MDD" && (kinds & INDEX_NGRAM)) {
+            jobs.emplace_back(new NgramIndexJob());
+        }
+        if (this->filetype != "MDD" && (kinds & INDEX_BLOCK_SKETCH)) {
+            jobs.emplace_back(new BlockSketchJob());
+        }
+        if (this->filetype != "MDD" && (kinds & INDEX_KEY_FILTER)) {
+            jobs.emplace_back(new KeyFilterJob());
+        }
+        if (this->filetype != "MDD" && (kinds & INDEX_ANAGRAM)) {
+            jobs.emplace_back(new AnagramJob());
+        }
+        if (this->filetype != "MDD" && (kinds & INDEX_KEY_SUFFIX)) {
+            jobs.emplace_back(new KeySuffixJob());
+        }
+        if (this->filetype != "MDD" && (kinds & INDEX_TERMS)) {
+            jobs.emplace_back(new TermIndexJob());
+        }
+        if (this->filetype != "MDD" && (kinds & INDEX_FOLDED_KEYS)) {
+            jobs.emplace_back(new FoldedKeysJob());
+        }
+        return jobs;
+    }
+
+    uint64_t Mdict::file_stamp() const {
+        uint64_t h = this->fingerprint();
+        auto mix = [&h](uint64_t v) {
+            for (int i = 0; i < 8; ++i) {
+                h ^= (v >> (8 * i)) & 0xff;
+                h *= 1099511628211ull;
+            }
+        };
+        struct stat st;
+        if (this->file_ptr && fstat(fileno(this->file_ptr), &st) == 0) {
+            mix(static_cast<uint64_t>(st.st_size));
+            mix(static_cast<uint64_t>(st.st_mtime));
+        }
+        return h;
+    }
+
+    // scrub.mark: [0:4] magic "VDSC", [4:8] version, [8:16] file_stamp()
+    static const uint32_t SCRUB_MARK_MAGIC = 0x43534456;
+    static const uint32_t SCRUB_MARK_VERSION = 1;
+
+    bool Mdict::load_scrub_mark() {
+        if (this->index_dir.empty()) return false;
+        FILE *f = std::fopen((this->index_dir + "/scrub.mark").c_str(), "rb");
+        if (!f) return false;
+        uint32_t magic = 0, version = 0;
+        uint64_t stamp = 0;
+        bool ok = read_u32(f, magic) && read_u32(f, version) && read_u64(f, stamp);
+        std::fclose(f);
+        return ok && magic == SCRUB_MARK_MAGIC && version == SCRUB_MARK_VERSION &&
+               stamp == this->file_stamp();
+    }
+
+    void Mdict::save_scrub_mark(bool intact) {
+        if (this->index_dir.empty()) return;
+        std::string path = this->index_dir + "/scrub.mark";
+        if (!intact) {
+            std::remove(path.c_str());
+            return;
+        }
+        std::string tmp = path + ".tmp";
+        FILE *f = std::fopen(tmp.c_str(), "wb");
+        if (!f) return;
+        bool ok = write_u32(f, SCRUB_MARK_MAGIC) && write_u32(f, SCRUB_MARK_VERSION) &&
+                  write_u64(f, this->file_stamp());
+        ok = fclose_durable(f) && ok;
+        if (!ok || !publish_file(tmp, path)) {
+            std::remove(tmp.c_str());
+            LOGE("save_scrub_mark: cannot write %s", path.c_str());
+        }
+    }
+
+    scrub_report Mdict::scrub(std::function<void(float)> progress,
+                              std::function<bool()> cancelled) {
+        if (this->encrypt == ENCRYPT_RECORD_ENC) {
+            throw std::runtime_error("record encrypted not support yet");
+        }
+        // key blocks then record blocks, in file order
+        std::vector<scrub_block> blocks;
+        blocks.reserve(this->key_block_info_list.size() + this->record_header.size());
+        for (size_t i = 0; i < this->key_block_info_list.size(); ++i) {
+            const key_block_info *info = this->key_block_info_list[i];
+            scrub_block block;
+            block.kind = block_kind::KEY;
+            block.block_id = i;
+            block.offset = this->key_block_compressed_start_offset +
+                           info->key_block_comp_accumulator;
+            block.comp_size = info->key_block_comp_size;
+            block.decomp_size = info->key_block_decomp_size;
+            blocks.push_back(block);
+        }
+        for (size_t i = 0; i < this->record_header.size(); ++i) {
+            const record_header_item *item = this->record_header[i];
+            scrub_block block;
+            block.kind = block_kind::RECORD;
+            block.block_id = i;
+            block.offset = this->record_block_offset + item->compressed_size_accumulator;
+            block.comp_size = item->compressed_size;
+            block.decomp_size = item->decompressed_size;
+            blocks.push_back(block);
+        }
+
+        scrub_report report = scrub_blocks(*this, blocks, progress, cancelled);
+        for (damaged_block &damaged : report.damaged) {
+            if (damaged.kind == block_kind::KEY) {
+                // the block infos count its entries, whether its keys were
+                // read or not
+                const key_block_info *info = this->key_block_info_list[damaged.block_id];
+                damaged.first_entry = info->entries_accumulator;
+                damaged.last_entry = info->entries_accumulator + info->num_entries;
+                // the entry before, if its record could not be bounded
+                uint64_t before = damaged.block_id > 0 && damaged.block_id - 1 < this->key_block_entry_end.size()
+                                          ? this->key_block_entry_end[damaged.block_id - 1]
+                                          : 0;
+                if (before > 0) {
+                    auto cap = this->record_end_cap.find(before - 1);
+                    if (cap != this->record_end_cap.end() &&
+                        cap->second == this->key_list[before - 1]->record_start) {
+                        damaged.first_entry = this->file_entry_id(before - 1);
+                    }
+                }
+            } else {
+                unsigned long first, last;
+                this->record_block_entry_range(damaged.block_id, first, last);
+                damaged.first_entry = this->file_entry_id(first);
+                damaged.last_entry = first < last ? this->file_entry_id(last - 1) + 1
+                                                  : damaged.first_entry;
+            }
+            LOGE("scrub: %s block %llu (entries %llu-%llu): %s",
+                 damaged.kind == block_kind::KEY ? "key" : "record",
+                 (unsigned long long)damaged.block_id, (unsigned long long)damaged.first_entry,
+                 (unsigned long long)damaged.last_entry, damaged.error.c_str());
+        }
+        // a cancelled scrub proves nothing either way
+        if (report.complete) {
+            this->verified = report.damaged.empty();
+            std::lock_guard<std::mutex> lock(this->index_mutex);
+            this->save_scrub_mark(report.damaged.empty());
+        }
+        return report;
+    }
+
+    void Mdict::load_index(const std::string &name) {
+        // also called from the builder thread once <name>.idx has been published
+        std::string path = this->index_dir + "/" + name + ".idx";
+        bool loaded = false;
+        if (name == "ngram") {
+            std::shared_ptr<NgramIndex> index = std::make_shared<NgramIndex>();
+            if (index->open(path, this->fingerprint())) {
+                this->publish_indexes([&](index_snapshot &s) { s.ngram = index; });
+                loaded = true;
+            }
+        } else if (name == "blocksketch") {
+            std::shared_ptr<BlockSketchIndex> index = std::make_shared<BlockSketchIndex>();
+            if (index->open(path, this->fingerprint())) {
+                this->publish_indexes([&](index_snapshot &s) { s.block_sketch = index; });
+                loaded = true;
+            }
+        } else if (name == "keyfilter") {
+            std::shared_ptr<KeyFilter> index = std::make_shared<KeyFilter>();
+            if (index->open(path, this->fingerprint())) {
+                this->publish_indexes([&](index_snapshot &s) { s.key_filter = index; });
+                loaded = true;
+            }
+        } else if (name == "anagram") {
+            std::shared_ptr<AnagramIndex> index = std::make_shared<AnagramIndex>();
+            if (index->open(path, this->fingerprint())) {
+                this->publish_indexes([&](index_snapshot &s) { s.anagram = index; });
+                loaded = true;
+            }
+        } else if (name == "keysuffix") {
+            std::shared_ptr<KeySuffixIndex> index = std::make_shared<KeySuffixIndex>();
+            if (index->open(path, this->fingerprint())) {
+                this->publish_indexes([&](index_snapshot &s) { s.key_suffix = index; });
+                loaded = true;
+            }
+        } else if (name == "terms") {
+            std::shared_ptr<TermIndex> index = std::make_shared<TermIndex>();
+            if (index->open(path, this->fingerprint())) {
+                this->publish_indexes([&](index_snapshot &s) { s.terms = index; });
+                loaded = true;
+            }
+        } else if (name == "foldedkeys") {
+            std::shared_ptr<FoldedKeyIndex> index = std::make_shared<FoldedKeyIndex>();
+            if (index->open(path, this->fingerprint(), this->key_list.size())) {
+                this->publish_indexes([&](index_snapshot &s) { s.folded_keys = index; });
+                loaded = true;
+            }
+        }
+        if (loaded) {
+            LOGD("load_index: loaded %s", path.c_str());
+        } else if (std::filesystem::exists(path)) {
+            // from another format version, another file or damaged; removed so
+            // the next start_index_build() builds it again
+            LOGE("load_index: rejected %s, removing it", path.c_str());
+            std::remove(path.c_str());
+        }
+    }
+
+    bool Mdict::may_contain(const std::string &word) {
+        EpochGuard guard;
+        if (!this->indexes().key_filter) return true;
+        std::string folded = fold_key(word, KEY_FOLD_LOOSE);
+        return !folded.empty() && this->may_contain_hash(key_filter_hash(folded));
+    }
+
+    bool Mdict::may_contain_hash(uint64_t hash) {
+        EpochGuard guard;
+        const KeyFilter *filter = this->indexes().key_filter.get();
+        return !filter || filter->may_contain(hash);
+    }
+
+    void Mdict::publish_indexes(const std::function<void(index_snapshot &)> &change) {
+        std::lock_guard<std::mutex> lock(this->snapshot_mutex);
+        index_snapshot *next = new index_snapshot(*this->snapshot.load());
+        change(*next);
+        const index_snapshot *old = this->snapshot.exchange(next);
+        // readers that loaded the old one may still be using it
+        EpochDomain::shared().retire([old] { delete old; });
     }
 
 // this function is used to decode the record block, it will read the record
@@ -1251,8 +1706,9 @@ namespace mdict {
             checksum = be_bin_to_u32((unsigned char *)checksum_b);
             free(checksum_b);
 
-            if (comp_type == 0 /* not compressed TODO*/) {
-                throw std::runtime_error("uncompress block not support yet");
+            if (comp_type == 0 /* stored */) {
+                record_block_uncompressed_v.assign(record_block_cmp_buffer + 8,
+                                                   record_block_cmp_buffer + comp_size);
             } else {
                 char *record_block_decrypted_buff;
                 if (this->encrypt == ENCRYPT_RECORD_ENC /* record block encrypted */) {
@@ -1564,6 +2020,8 @@ namespace mdict {
                 key_block_info *kbinfo = new key_block_info(
                         first_key, last_key, previous_start_offset, key_block_compress_size,
                         key_block_decompress_size, comp_acc, decomp_acc);
+                kbinfo->num_entries = current_entries;
+                kbinfo->entries_accumulator = num_entries_counter - current_entries;
 
                 // adjust ofset
                 previous_start_offset += key_block_compress_size;
@@ -1599,17 +2057,32 @@ namespace mdict {
     }
 
 /**
- * read in the file from the file stream using fseeko for 64-bit offset support
+ * read in the file at an absolute offset, 64-bit offset safe
  * @param offset the file start offset
  * @param len the byte length needs to read
  * @param buf the target buffer
  */
     void Mdict::readfile(uint64_t offset, uint64_t len, char *buf) {
-        if (!this->file_ptr) return;
+        if (!this->file_ptr) {
+            throw std::runtime_error("readfile: file is not open");
+        }
 
-        // Use fseeko for 64-bit offset support (Android NDK supports this)
-        fseeko(this->file_ptr, static_cast<off_t>(offset), SEEK_SET);
-        fread(buf, 1, static_cast<size_t>(len), this->file_ptr);
+        // pread keeps no shared file position, so lookups, searches and the
+        // background index builder can read the same file concurrently
+        int fd = fileno(this->file_ptr);
+        uint64_t done = 0;
+        while (done < len) {
+            ssize_t n = pread(fd, buf + done, static_cast<size_t>(len - done),
+                              static_cast<off_t>(this->file_base + offset + done));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("readfile: read failed");
+            }
+            if (n == 0) {
+                throw std::runtime_error("readfile: unexpected end of file");
+            }
+            done += static_cast<uint64_t>(n);
+        }
     }
 
 /***************************************
@@ -1639,6 +2112,15 @@ namespace mdict {
         this->read_key_block_info();
         this->read_record_block_header();
         //  this->decode_record_block(); // don't use this function, it's too slow
+
+        // stemming is optional, the dictionary works without it
+        if (!this->aff_filename.empty() && !this->dic_filename.empty()) {
+            try {
+                this->set_stemmer(AffixStemmer::from_files(this->aff_filename, this->dic_filename));
+            } catch (std::exception &e) {
+                LOGE("init: cannot load stemmer %s: %s", this->aff_filename.c_str(), e.what());
+            }
+        }
     }
 
 /**
@@ -1899,36 +2381,21 @@ namespace mdict {
 
             // --- NEW LOGIC (v5 - Return All) ---
 
-            // 1. Find all matching keys in the complete key_list and group by record block
-            std::map<unsigned long, std::vector<key_list_item*>> record_block_map;
-            std::string stripped_word = _s(word);
-
-            for (key_list_item* item : this->key_list) {
-                if (item->key_word == word || _s(item->key_word) == stripped_word) {
-                    unsigned long record_block_idx = reduce_record_block_offset(item->record_start);
-                    record_block_map[record_block_idx].push_back(item);
-                }
+            // 0. A definite miss needs neither the key list nor its index
+            if (!this->may_contain(word)) {
+                LOGD("Key filter rules out '%s'", word.c_str());
+                return {};
             }
 
-            if (record_block_map.empty()) {
+            // 1. Find the matching keys in the folded key index, in block order
+            std::vector<uint32_t> entries = this->lookup_order(word);
+            if (entries.empty()) {
                 LOGD("No matching keys found in the entire key_list for '%s'", word.c_str());
                 return {};
             }
 
-            // 2. Decode blocks and collect all raw definition strings
-            std::vector<std::string> all_results;
-
-            for (auto const& [record_idx, items] : record_block_map) {
-                LOGD("Decoding record block %lu for %zu keys", record_idx, items.size());
-
-                auto vec = decode_record_block_by_rid(record_idx);
-
-                // Get all raw definitions (HTML or @@@LINKs)
-                std::vector<std::string> defs = reduce_particial_keys_vector(vec, word);
-                
-                // Append all found definitions to the master list
-                all_results.insert(all_results.end(), defs.begin(), defs.end());
-            }
+            // 2. Decode their blocks and collect the raw definitions (HTML or @@@LINKs)
+            std::vector<std::string> all_results = this->definitions(entries);
 
             LOGD("Total results found: %zu", all_results.size());
             return all_results;
@@ -1939,6 +2406,266 @@ namespace mdict {
         return {};
     }
 
+    std::vector<uint32_t> Mdict::lookup_order(const std::string &word) {
+        std::vector<uint32_t> entries = this->matching_entries(word);
+        // entries of one block stay together, so each block is read once
+        std::stable_sort(entries.begin(), entries.end(), [&](uint32_t a, uint32_t b) {
+            unsigned long block_a = reduce_record_block_offset(this->key_list[a]->record_start);
+            unsigned long block_b = reduce_record_block_offset(this->key_list[b]->record_start);
+            if (block_a != block_b) return block_a < block_b;
+            bool exact_a = this->key_list[a]->key_word == word;
+            bool exact_b = this->key_list[b]->key_word == word;
+            if (exact_a != exact_b) return exact_a;
+            return a < b;
+        });
+        return entries;
+    }
+
+    std::vector<entry_meta> Mdict::lookup_entries(const std::string &word, size_t preview_chars) {
+        static const char LINK[] = "@@@LINK=";
+        const size_t link_len = sizeof(LINK) - 1;
+        std::vector<entry_meta> metas;
+        try {
+            if (!this->may_contain(word)) return metas;
+            record_block_view block;
+            BlockCache::block_ptr data;
+            for (uint32_t entry : this->lookup_order(word)) {
+                unsigned long rid = reduce_record_block_offset(this->key_list[entry]->record_start);
+                if (!data || rid != block.block_id) {
+                    data = this->record_block(rid);
+                    block.block_id = rid;
+                    block.data = data->data();
+                    block.size = data->size();
+                    this->record_block_entry_range(rid, block.first_entry, block.last_entry);
+                }
+                size_t start, len;
+                this->entry_span(block, entry, start, len);
+                const char *record = reinterpret_cast<const char *>(block.data) + start;
+                while (len > 0 && record[len - 1] == '\0') --len;
+
+                entry_meta meta;
+                meta.entry = entry;
+                meta.length = static_cast<uint32_t>(len);
+                if (len >= link_len && std::memcmp(record, LINK, link_len) == 0) {
+                    meta.redirect = true;
+                    size_t b = link_len, e = len;
+                    while (b < e && std::isspace(static_cast<unsigned char>(record[b]))) ++b;
+                    while (e > b && std::isspace(static_cast<unsigned char>(record[e - 1]))) --e;
+                    meta.target.assign(record + b, e - b);
+                } else if (preview_chars > 0) {
+                    meta.preview = html_preview(record, len, preview_chars);
+                }
+                metas.push_back(std::move(meta));
+            }
+        } catch (const std::exception &e) {
+            LOGE("lookup_entries: %s", e.what());
+            metas.clear();
+        }
+        return metas;
+    }
+
+    std::vector<std::string> Mdict::definitions(const std::vector<uint32_t> &entries) {
+        // visit the entries by block, fill the results in the asked order
+        std::vector<size_t> order(entries.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            if (entries[i] >= this->key_list.size()) {
+                throw std::out_of_range("definitions: entry out of range");
+            }
+            order[i] = i;
+        }
+        auto block_of = [this](uint32_t entry) {
+            return reduce_record_block_offset(this->key_list[entry]->record_start);
+        };
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return block_of(entries[a]) < block_of(entries[b]);
+        });
+
+        std::vector<std::string> results(entries.size());
+        record_block_view block;
+        BlockCache::block_ptr data;
+        for (size_t i : order) {
+            unsigned long rid = block_of(entries[i]);
+            if (!data || rid != block.block_id) {
+                data = this->record_block(rid);
+                block.block_id = rid;
+                block.data = data->data();
+                block.size = data->size();
+                this->record_block_entry_range(rid, block.first_entry, block.last_entry);
+            }
+            size_t start, len;
+            this->entry_span(block, entries[i], start, len);
+            const char *record = reinterpret_cast<const char *>(block.data) + start;
+            while (len > 0 && record[len - 1] == '\0') --len;
+            results[i].assign(record, len);
+        }
+        return results;
+    }
+
+/**
+ * base forms of a word which have entries in this dictionary
+ * @param word the word that was not found
+ * @return
+ */
+    std::vector<std::string> Mdict::stem(const std::string word) {
+        if (this->filetype == "MDD" || word.empty()) return {};
+
+        std::vector<std::string> candidates;
+        {
+            EpochGuard guard;
+            const AffixStemmer *stemmer = this->indexes().stemmer.get();
+            if (stemmer) candidates = stemmer->stems(word);
+        }
+        for (deinflection &d : Deinflector::shared().deinflect(word)) {
+            candidates.push_back(std::move(d.term));
+        }
+        // the word itself is not a stem of itself
+        const KeyFolder &folder = KeyFolder::get(KEY_FOLD_STRICT);
+        std::string folded_word = folder.fold(word);
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                        [&](const std::string &c) { return folder.fold(c) == folded_word; }),
+                         candidates.end());
+        if (candidates.empty()) return {};
+        return this->existing_keys(candidates);
+    }
+
+    void Mdict::set_stemmer(std::shared_ptr<AffixStemmer> stemmer) {
+        this->publish_indexes([&](index_snapshot &s) { s.stemmer = std::move(stemmer); });
+    }
+
+    std::vector<deinflection> Mdict::deinflect(const std::string &word) {
+        if (this->filetype == "MDD" || word.empty()) return {};
+
+        std::vector<deinflection> candidates = Deinflector::shared().deinflect(word);
+        std::vector<std::string> terms;
+        terms.reserve(candidates.size());
+        for (const deinflection &d : candidates) terms.push_back(d.term);
+        std::vector<long> entries = this->find_keys(terms);
+
+        std::vector<deinflection> found;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (entries[i] < 0) continue;
+            const std::string &key = this->key_list[entries[i]]->key_word;
+            bool seen = std::any_of(found.begin(), found.end(),
+                                    [&](const deinflection &d) { return d.term == key; });
+            if (seen) continue;
+            candidates[i].term = key;
+            found.push_back(std::move(candidates[i]));
+        }
+        return found;
+    }
+
+    std::vector<std::string> Mdict::existing_keys(const std::vector<std::string> &words) {
+        std::vector<std::string> keys;
+        for (long entry : this->find_keys(words)) {
+            if (entry < 0) continue;
+            const std::string &key = this->key_list[entry]->key_word;
+            if (std::find(keys.begin(), keys.end(), key) == keys.end()) keys.push_back(key);
+        }
+        return keys;
+    }
+
+/**
+ * check candidate words against the folded key index
+ * @param words
+ * @return
+ */
+    std::vector<long> Mdict::find_keys(const std::vector<std::string> &words) {
+        std::vector<long> found;
+        found.reserve(words.size());
+        for (const std::string &w : words) {
+            if (!this->may_contain(w)) {
+                found.push_back(-1);
+                continue;
+            }
+            std::vector<uint32_t> entries = this->matching_entries(w);
+            found.push_back(entries.empty() ? -1 : (long)entries.front());
+        }
+        return found;
+    }
+
+/**
+ * the key list range of a word under _s(), what lookups used before the
+ * folded key index
+ * @param word
+ * @param prefix
+ * @return
+ */
+    std::pair<unsigned long, unsigned long> Mdict::stripped_range(const std::string &word,
+                                                                  bool prefix) const {
+        std::string stripped = _s(word);
+        auto first = std::lower_bound(
+                this->key_list.begin(), this->key_list.end(), stripped,
+                [](const key_list_item *item, const std::string &w) { return _s(item->key_word) < w; });
+        auto last = std::upper_bound(
+                first, this->key_list.end(), stripped,
+                [prefix](const std::string &w, const key_list_item *item) {
+                    std::string key = _s(item->key_word);
+                    return w < (prefix ? key.substr(0, w.size()) : key);
+                });
+        return {first - this->key_list.begin(), last - this->key_list.begin()};
+    }
+
+/**
+ * the romanized key index, rebuilt when Han readings were added since
+ * @return
+ */
+    const RomanizedKeyIndex &Mdict::romanized_key_index() {
+        Transliterator &transliterator = Transliterator::shared();
+        const RomanizedKeyIndex *keys = this->indexes().romanized_keys.get();
+        if (keys && keys->generation() == transliterator.generation()) return *keys;
+
+        // One caller rebuilds stale forms while the others keep using them,
+        // only the very first build is waited for
+        std::unique_lock<std::mutex> lock(this->romanized_keys_mutex, std::defer_lock);
+        if (!keys) {
+            lock.lock();
+        } else if (!lock.try_lock()) {
+            return *keys;
+        }
+        keys = this->indexes().romanized_keys.get();
+        if (keys && keys->generation() == transliterator.generation()) return *keys;
+        std::shared_ptr<RomanizedKeyIndex> fresh = std::make_shared<RomanizedKeyIndex>(
+                transliterator, this->key_list.size(),
+                [this](size_t i) -> const std::string & { return this->key_list[i]->key_word; });
+        LOGD("romanized_key_index: %zu forms", fresh->size());
+        this->publish_indexes([&](index_snapshot &s) { s.romanized_keys = fresh; });
+        // the caller's guard predates this snapshot, so it outlives the call
+        return *fresh;
+    }
+
+/**
+ * entries of a word, exact folding first
+ * @param word
+ * @return
+ */
+    std::vector<uint32_t> Mdict::matching_entries(const std::string &word) {
+        std::string folded = fold_key(word, KEY_FOLD_LOOSE);
+        if (folded.empty()) return {};
+        std::vector<uint32_t> loose;
+        {
+            EpochGuard guard;
+            const FoldedKeyIndex *index = this->folded_key_index();
+            if (index) {
+                FoldedKeyIndex::range range = index->equal_range(folded);
+                loose.assign(range.first, range.second);
+            } else {
+                // not built yet: the keys equal under _s()
+                std::pair<unsigned long, unsigned long> range = this->stripped_range(word, false);
+                for (unsigned long e = range.first; e < range.second; ++e) loose.push_back(e);
+            }
+        }
+
+        const KeyFolder &strict = KeyFolder::get(KEY_FOLD_STRICT);
+        std::string strict_word = strict.fold(word);
+        std::vector<uint32_t> exact;
+        for (uint32_t e : loose) {
+            const std::string &key = this->key_list[e]->key_word;
+            if (key == word || strict.fold(key) == strict_word) exact.push_back(e);
+        }
+        if (!exact.empty()) return exact;
+        return loose;
+    }
+
     std::string Mdict::parse_definition(const std::string word,
                                         unsigned long record_start) {
         // reduce search the record block index by word record start offset
@@ -1982,52 +2709,70 @@ namespace mdict {
         std::vector<std::string> suggestions;
         if (word.empty()) return suggestions;
 
-        std::string prefix = word;
-        // Create a lowercase version of the prefix for comparison
-        std::transform(prefix.begin(), prefix.end(), prefix.begin(), ::tolower);
-
         const size_t max_suggestions = 50;
 
-        // Optimization: Use binary search to find the first key >= prefix
-        // key_list is sorted by key_word (usually).
-        // We need a custom comparator for case-insensitive comparison.
-        auto it = std::lower_bound(this->key_list.begin(), this->key_list.end(), prefix,
-            [](const key_list_item* item, const std::string& val) {
-                std::string key = item->key_word;
-                std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-                return key < val;
-            });
-
-        // Iterate from the found position
-        for (; it != this->key_list.end(); ++it) {
-            std::string key = (*it)->key_word;
-            std::string lower_key = key;
-            std::transform(lower_key.begin(), lower_key.end(), lower_key.begin(), ::tolower);
-
-            // Check if the key still starts with the prefix
-            if (lower_key.rfind(prefix, 0) == 0) {
-                suggestions.push_back(key);
-                if (suggestions.size() >= max_suggestions) {
-                    break;
-                }
+        // Binary search the folded key index for the folded prefix, so
+        // "eclair", "Éclair" and "ＥＣＬＡＩＲ" suggest the same keys; until it
+        // is built, the key list under _s()
+        std::string prefix = fold_key(word, KEY_FOLD_LOOSE);
+        if (prefix.empty()) return suggestions;
+        // a one letter prefix spans most of a large dictionary, the strict
+        // matches among the first keys are enough (cf. regex_suggest)
+        const size_t max_checked = 20000;
+        std::vector<uint32_t> candidates;
+        {
+            EpochGuard guard;
+            const FoldedKeyIndex *index = this->folded_key_index();
+            if (index) {
+                FoldedKeyIndex::range range = index->prefix_range(prefix);
+                size_t n = std::min<size_t>(range.second - range.first, max_checked);
+                candidates.assign(range.first, range.first + n);
             } else {
-                // Since the list is sorted, once we find a key that doesn't match the prefix,
-                // we can stop searching (optimization).
-                // However, we must be careful about case sensitivity sorting order vs our lowercase comparison.
-                // Generally, if "apple" < "banana", then "apple..." < "banana...".
-                // But strictly speaking, we should only break if the key is "greater" than prefix in a way that precludes matching.
-                // For safety and simplicity in this "suggest" context, checking the next 50-100 items is usually enough.
-                // But to be strictly correct with std::lower_bound, we should stop if the prefix doesn't match.
-                // Let's assume standard dictionary sorting.
-                
-                // If the current key is lexicographically larger than prefix and doesn't start with it,
-                // we are done.
-                 if (lower_key > prefix) {
-                     break; 
-                 }
+                std::pair<unsigned long, unsigned long> range = this->stripped_range(word, true);
+                for (unsigned long e = range.first; e < range.second && candidates.size() < max_checked; ++e) {
+                    candidates.push_back(e);
+                }
+            }
+        }
+
+        const KeyFolder &strict = KeyFolder::get(KEY_FOLD_STRICT);
+        std::string strict_prefix = strict.fold(word);
+        std::vector<std::string> loose;
+        std::string folded;
+        for (uint32_t e : candidates) {
+            const std::string &key = this->key_list[e]->key_word;
+            // same key, several entries
+            if (!suggestions.empty() && suggestions.back() == key) continue;
+            if (!loose.empty() && loose.back() == key) continue;
+
+            strict.fold(key, folded);
+            if (folded.compare(0, strict_prefix.size(), strict_prefix) == 0) {
+                suggestions.push_back(key);
+                if (suggestions.size() >= max_suggestions) break;
+            } else if (loose.size() < max_suggestions) {
+                loose.push_back(key);
+            }
+        }
+
+        // Keys that only match once accents or kana are folded come last
+        for (std::string &key : loose) {
+            if (suggestions.size() >= max_suggestions) break;
+            suggestions.push_back(std::move(key));
+        }
+
+        // Then keys in other scripts spelled like a latin prefix
+        // ("toukyou" -> 東京 with Han readings, "shashin" -> しゃしん)
+        std::string romanized = Transliterator::fold_query(word);
+        if (!romanized.empty() && suggestions.size() < max_suggestions) {
+            EpochGuard guard;
+            const RomanizedKeyIndex &romanized_keys = this->romanized_key_index();
+            for (uint32_t entry : romanized_keys.prefix(romanized, max_suggestions)) {
+                const std::string &key = this->key_list[entry]->key_word;
+                if (std::find(suggestions.begin(), suggestions.end(), key) != suggestions.end()) continue;
+                suggestions.push_back(key);
+                if (suggestions.size() >= max_suggestions) break;
             }
         }
-        
         return suggestions;
     }
 
@@ -2075,8 +2820,15 @@ namespace mdict {
         std::string start_prefix = "";
         std::string required_substring = "";
         bool has_start_anchor = false;
+        // With alternatives no literal is required
+        bool has_alternatives = regex_str.find('|') != std::string::npos;
+        // A literal char followed by one of these may be absent
+        auto optional_next = [&](size_t i) {
+            return i < regex_str.length() &&
+                   (regex_str[i] == '*' || regex_str[i] == '?' || regex_str[i] == '{');
+        };
 
-        if (regex_str[0] == '^') {
+        if (regex_str[0] == '^' && !has_alternatives) {
             has_start_anchor = true;
             // Extract prefix: ^abc... until special char
             size_t i = 1;
@@ -2090,17 +2842,27 @@ namespace mdict {
                 start_prefix += c;
                 i++;
             }
+            if (optional_next(i) && !start_prefix.empty()) start_prefix.pop_back();
         }
 
         // Extract longest literal substring for pre-filtering
-        // e.g. ".*tion$" -> "tion"
+        // e.g. ".*tion$" -> "tion", which must also end the key
         std::string current_literal;
-        for (char c : regex_str) {
+        bool substring_at_end = false;
+        for (size_t i = 0; i < regex_str.length() && !has_alternatives; ++i) {
+             char c = regex_str[i];
              if (c == '^' || c == '$' || c == '.' || c == '*' || c == '+' || c == '?' || 
                  c == '(' || c == ')' || c == '[' || c == ']' || c == '{' || c == '}' || 
                  c == '|' || c == '\\' || c == '-' || c == ',') {
                  if (current_literal.length() > required_substring.length()) {
                      required_substring = current_literal;
+                     substring_at_end = c == '$' && i + 1 == regex_str.length();
+                 }
+                 current_literal = "";
+             } else if (optional_next(i + 1)) {
+                 if (current_literal.length() > required_substring.length()) {
+                     required_substring = current_literal;
+                     substring_at_end = false;
                  }
                  current_literal = "";
              } else {
@@ -2109,14 +2871,13 @@ namespace mdict {
         }
         if (current_literal.length() > required_substring.length()) {
             required_substring = current_literal;
+            substring_at_end = false;
         }
 
-        // Lowercase for case-insensitive comparison
-        std::string start_prefix_lower = start_prefix;
-        std::transform(start_prefix_lower.begin(), start_prefix_lower.end(), start_prefix_lower.begin(), ::tolower);
-        
-        std::string required_substring_lower = required_substring;
-        std::transform(required_substring_lower.begin(), required_substring_lower.end(), required_substring_lower.begin(), ::tolower);
+        // Fold both like the keys of the folded key index (utf-8 safe)
+        const KeyFolder &loose_folder = KeyFolder::get(KEY_FOLD_LOOSE);
+        std::string start_prefix_folded = loose_folder.fold(start_prefix);
+        std::string required_substring_folded = loose_folder.fold(required_substring);
 
         LOGD("Regex Opt: Prefix='%s', Substring='%s'", start_prefix.c_str(), required_substring.c_str());
 
@@ -2130,69 +2891,94 @@ namespace mdict {
             return suggestions;
         }
 
-        // --- 3. Determine Start Iterator ---
-        auto it = this->key_list.begin();
-        
-        if (has_start_anchor && !start_prefix.empty()) {
-            // Optimization 1: Binary Search for Prefix
-            it = std::lower_bound(this->key_list.begin(), this->key_list.end(), start_prefix,
-                [](const key_list_item* item, const std::string& val) {
-                    std::string key = item->key_word;
-                    // We need a loose comparison because key_list might be mixed case
-                    // But standard string comparison is usually fine for finding the "start" block
-                    // Let's use case-insensitive for safety since we want to find "Apple" with "^apple"
-                    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-                    std::string val_lower = val;
-                    std::transform(val_lower.begin(), val_lower.end(), val_lower.begin(), ::tolower);
-                    return key < val_lower;
-                });
+        // icase only knows ASCII, so keys are also tried folded (case, width,
+        // accents, kana) against the pattern folded the same way, minus case
+        // which would turn \W into \w
+        const KeyFolder &key_folder = KeyFolder::get(KEY_FOLD_CASE | KEY_FOLD_WIDTH |
+                                                     KEY_FOLD_DIACRITICS | KEY_FOLD_KANA);
+        std::string folded_regex_str = KeyFolder::get(KEY_FOLD_WIDTH | KEY_FOLD_DIACRITICS |
+                                                      KEY_FOLD_KANA).fold(regex_str);
+        std::wregex folded_re = re;
+        bool pattern_folded = false;
+        if (folded_regex_str != regex_str) {
+            try {
+                folded_re = std::wregex(utf8_to_wstring(folded_regex_str), std::regex_constants::icase);
+                pattern_folded = true;
+            } catch (const std::regex_error& e) {
+                LOGD("Folded regex does not compile: %s", folded_regex_str.c_str());
+            }
+        }
+
+        // --- 3. Determine Candidates ---
+        // Anchored: the entries whose folded key starts with the folded
+        // prefix, a binary search (of the key list under _s() until the
+        // folded key index is built). Else the entries whose folded key
+        // contains the literal, from the key suffix array if it is built.
+        // Otherwise every entry in key order.
+        FoldedKeyIndex::range range(nullptr, nullptr);
+        std::pair<unsigned long, unsigned long> stripped(0, 0);
+        std::vector<uint32_t> containing;
+        bool use_prefix = has_start_anchor && !start_prefix_folded.empty();
+        EpochGuard guard;
+        const FoldedKeyIndex *index = this->folded_key_index();
+        const KeySuffixIndex *suffix_index = this->indexes().key_suffix.get();
+        bool use_suffixes = !use_prefix && suffix_index && !required_substring_folded.empty();
+        // a literal most keys contain is cheaper to scan for, the scan stops
+        // after max_suggestions
+        if (use_suffixes && suffix_index->count(required_substring_folded, substring_at_end) >
+                            this->key_list.size() / 16) {
+            use_suffixes = false;
+        }
+        if (use_prefix && index) {
+            range = index->prefix_range(start_prefix_folded);
+        } else if (use_prefix) {
+            stripped = this->stripped_range(start_prefix, true);
+        } else if (use_suffixes) {
+            containing = suffix_index->find(required_substring_folded, substring_at_end);
+            LOGD("Regex Opt: %zu keys contain the literal", containing.size());
         }
+        size_t candidate_count = use_prefix ? (index ? range.second - range.first
+                                                     : stripped.second - stripped.first)
+                               : use_suffixes ? containing.size() : this->key_list.size();
 
         // --- 4. Iterate and Filter ---
         size_t checked_count = 0;
-        for (; it != this->key_list.end(); ++it) {
-            std::string key = (*it)->key_word;
-            std::string key_lower = key;
-            std::transform(key_lower.begin(), key_lower.end(), key_lower.begin(), ::tolower);
-
-            // Optimization 1 Check: Early Exit
-            if (has_start_anchor && !start_prefix_lower.empty()) {
-                // If the key is now lexicographically smaller than prefix (shouldn't happen with lower_bound)
-                // or if it doesn't start with prefix AND is lexicographically larger
-                // Actually, just check if it starts with prefix.
-                // If it doesn't start with prefix, AND it is "after" the prefix, we can stop.
-                
-                if (key_lower.rfind(start_prefix_lower, 0) != 0) {
-                     // Mismatch. Since keys are sorted, if key_lower > start_prefix_lower, we are done.
-                     if (key_lower > start_prefix_lower) {
-                         break; 
-                     }
-                     // If key_lower < start_prefix_lower (e.g. "Abc" vs "abc" sorting quirks), continue.
-                     continue; 
+        std::string folded_key;
+        std::string loose_buffer;
+        for (size_t i = 0; i < candidate_count; ++i) {
+            uint32_t entry = use_prefix ? (index ? range.first[i] : (uint32_t)(stripped.first + i))
+                           : use_suffixes ? containing[i] : (uint32_t)i;
+
+            // Literal Pre-filtering on the folded key
+            if (!required_substring_folded.empty() && !use_suffixes) {
+                std::string_view loose_key;
+                if (index) {
+                    loose_key = index->folded(entry);
+                } else {
+                    loose_folder.fold(this->key_list[entry]->key_word, loose_buffer);
+                    loose_key = loose_buffer;
                 }
-            }
-
-            // Optimization 2 Check: Literal Pre-filtering
-            if (!required_substring_lower.empty()) {
-                if (key_lower.find(required_substring_lower) == std::string::npos) {
+                if (loose_key.find(required_substring_folded) == std::string_view::npos) {
                     continue; // Skip regex check
                 }
             }
 
             // Final Check: Full Regex
-            std::wstring wkey = utf8_to_wstring(key);
-            if (std::regex_search(wkey, re)) {
+            const std::string &key = this->key_list[entry]->key_word;
+            if (!suggestions.empty() && suggestions.back() == key) continue;
+            bool matched = std::regex_search(utf8_to_wstring(key), re);
+            if (!matched) {
+                key_folder.fold(key, folded_key);
+                matched = (pattern_folded || folded_key != key) &&
+                          std::regex_search(utf8_to_wstring(folded_key), folded_re);
+            }
+            if (matched) {
                 suggestions.push_back(key);
                 if (suggestions.size() >= max_suggestions) {
                     break;
                 }
             }
             checked_count++;
-            // Safety break for very broad queries to prevent freezing UI
-            if (checked_count > 5000 && suggestions.empty() && !has_start_anchor) {
-                 // If we scanned 5000 items and found nothing, and we aren't anchored, maybe stop?
-                 // Or just let it run. Let's limit total checks if we have some results.
-            }
             if (checked_count > 20000) break; // Hard limit to prevent ANR
         }
         
@@ -2200,61 +2986,317 @@ namespace mdict {
         return suggestions;
     }
 
+/**
+ * keys spelled with the letters of a query
+ * @param letters the tiles
+ * @param subset whether tiles may be left over
+ * @return
+ */
+    std::vector<std::string> Mdict::anagrams(const std::string &letters, bool subset) {
+        const size_t max_anagrams = 500;
+        anagram_query query = make_anagram_query(letters);
+        if (query.letters.empty() && query.blanks == 0) return {};
+
+        std::vector<uint32_t> entries;
+        EpochGuard guard;
+        const AnagramIndex *index = this->indexes().anagram.get();
+        if (index) {
+            entries = index->search(query, subset);
+        } else {
+            // not built yet: the same test on every folded key
+            const FoldedKeyIndex *keys = this->folded_key_index();
+            const KeyFolder &folder = KeyFolder::get(KEY_FOLD_LOOSE);
+            std::string folded;
+            std::u32string key_letters;
+            for (uint32_t e = 0; e < this->key_list.size(); ++e) {
+                if (keys) {
+                    anagram_letters(keys->folded(e), key_letters);
+                } else {
+                    folder.fold(this->key_list[e]->key_word, folded);
+                    anagram_letters(folded, key_letters);
+                }
+                if (anagram_match(key_letters, query, subset)) entries.push_back(e);
+            }
+        }
+
+        // longest first (in characters), so the words using most tiles lead
+        auto length = [this](uint32_t e) {
+            const std::string &key = this->key_list[e]->key_word;
+            return std::count_if(key.begin(), key.end(), [](char c) { return (c & 0xC0) != 0x80; });
+        };
+        std::sort(entries.begin(), entries.end(), [&length](uint32_t a, uint32_t b) {
+            auto la = length(a), lb = length(b);
+            return la != lb ? la > lb : a < b;
+        });
+        std::vector<std::string> words;
+        for (uint32_t e : entries) {
+            const std::string &key = this->key_list[e]->key_word;
+            if (std::find(words.begin(), words.end(), key) != words.end()) continue;
+            words.push_back(key);
+            if (words.size() >= max_anagrams) break;
+        }
+        LOGD("anagrams: %zu matches for '%s'", entries.size(), letters.c_str());
+        return words;
+    }
+
     std::vector<std::string> Mdict::fulltext_search(const std::string query, std::function<void(float)> progress_callback) {
-        std::vector<std::string> suggestions;
-        std::wstring wquery = utf8_to_wstring(query);
-        // Lowercase the query for case-insensitive check
-        std::transform(wquery.begin(), wquery.end(), wquery.begin(), ::towlower);
+        std::vector<std::string> keys;
+        for (auto &hit : this->fulltext_search_hits(query, progress_callback)) {
+            keys.push_back(std::move(hit.key));
+        }
+        return keys;
+    }
 
-        const size_t max_suggestions = 50;
-        size_t blocks_checked = 0;
+    std::vector<fulltext_hit> Mdict::fulltext_search_hits(const std::string &query, std::function<void(float)> progress_callback) {
+        scan_options options;
+        options.progress = std::move(progress_callback);
+        return this->fulltext_search_hits(query, options);
+    }
+
+    std::vector<fulltext_hit> Mdict::fulltext_search_hits(const std::string &query, scan_options &options) {
+        // Definitions are matched on their plain text (tags skipped, entities
+        // decoded, case folded), the same text the n-gram index is built from.
+        // The query (words, "phrases", AND/OR/NOT) is compiled once and each
+        // record is walked a single time whatever the number of terms.
+        definition_matcher matcher = definition_matcher::fulltext(query);
+        return this->scan_definitions(matcher, options);
+    }
+
+    std::vector<fulltext_hit> Mdict::regex_search_hits(const std::string &pattern, scan_options &options) {
+        // The literals every match must contain narrow the scan like a
+        // full-text query would (postings, sketches), and are checked with one
+        // cheap automaton pass before the regex itself runs on an entry
+        definition_matcher matcher = definition_matcher::regex(pattern);
+        return this->scan_definitions(matcher, options);
+    }
+
+    bool Mdict::has_term_index() {
+        EpochGuard guard;
+        return this->indexes().terms != nullptr;
+    }
+
+    std::vector<fulltext_hit> Mdict::ranked_search(const std::string &query, size_t limit) {
+        std::vector<fulltext_hit> hits;
+        EpochGuard guard;
+        const TermIndex *index = this->indexes().terms.get();
+        if (!index || limit == 0) return hits;
+
+        // the query is cut into terms the way the definitions were, any of
+        // them may match
+        std::u32string folded;
+        fold_text(query, folded);
+        std::vector<std::u32string> terms = term_texts(folded);
+        if (terms.empty()) return hits;
+        std::vector<uint64_t> keys;
+        for (const std::u32string &term : terms) term_keys(term, keys);
+
+        // headword bonuses: the entries of the whole query get as much as the
+        // text can give at most, so they come first; with several words, the
+        // entries of each word get half of what that word can give
+        std::vector<score_boost> boosts;
+        auto add_boost = [&](const std::string &word, float score) {
+            score_boost boost;
+            for (uint32_t e : this->matching_entries(word)) {
+                if (index->entry_length(e) > 0) boost.entries.push_back(e);  // no redirects
+            }
+            std::sort(boost.entries.begin(), boost.entries.end());
+            boost.entries.erase(std::unique(boost.entries.begin(), boost.entries.end()), boost.entries.end());
+            boost.score = score;
+            boosts.push_back(std::move(boost));
+        };
+        float text_bound = 0;
+        for (uint64_t key : keys) text_bound += index->score_bound(key);
+        add_boost(query, std::max(text_bound, 1.0f));
+        if (terms.size() > 1) {
+            for (size_t i = 0; i < terms.size(); ++i) {
+                std::string word;
+                for (char32_t c : terms[i]) append_utf8(word, c);
+                add_boost(word, index->score_bound(keys[i]) / 2);
+            }
+        }
+
+        std::vector<scored_entry> best = index->top_k(keys, boosts, limit);
+        if (best.empty()) return hits;
+
+        // snippets around the first term found, else the start of the text
+        std::string snippet_query;
+        for (size_t i = 0; i < terms.size() && i < text_query::MAX_TERMS; ++i) {
+            if (i > 0) snippet_query += " OR ";
+            for (char32_t c : terms[i]) append_utf8(snippet_query, c);
+        }
+        text_query snippets(snippet_query);
+        try {
+            std::vector<uint32_t> entries;
+            for (const scored_entry &s : best) entries.push_back(s.entry);
+            std::vector<std::string> defs = this->definitions(entries);
+            for (size_t i = 0; i < best.size(); ++i) {
+                fulltext_hit hit;
+                hit.key = this->key_list[best[i].entry]->key_word;
+                hit.score = best[i].score;
+                text_match match;
+                if (snippets.find(defs[i].data(), defs[i].size(), &match)) {
+                    hit.snippet = std::move(match.snippet);
+                    hit.match_start = match.match_start;
+                    hit.match_end = match.match_end;
+                } else {
+                    hit.snippet = html_preview(defs[i].data(), defs[i].size(), 80);
+                }
+                hits.push_back(std::move(hit));
+            }
+        } catch (const std::exception &e) {
+            LOGE("ranked_search: %s", e.what());
+            hits.clear();
+        }
+        LOGD("ranked_search: %zu terms, %zu hits for '%s'", terms.size(), hits.size(), query.c_str());
+        return hits;
+    }
+
+    std::vector<scan_unit> Mdict::plan_definition_scan(const text_query &filter, uint64_t cursor) {
+        std::vector<scan_unit> plan;
+        if (cursor >= this->key_list.size()) return plan;
+
+        // With an n-gram index the term postings are combined along the filter
+        // (AND intersects, OR unites) and only those entries are verified,
+        // everything else is never decompressed
+        EpochGuard guard;
+        const NgramIndex *index = this->indexes().ngram.get();
+        std::vector<uint32_t> candidates;
+        if (index && filter.candidates([&](size_t t, std::vector<uint32_t> &ids) {
+                return index->candidates(filter.term(t), ids);
+            }, candidates)) {
+            size_t i = std::lower_bound(candidates.begin(), candidates.end(), cursor) - candidates.begin();
+            while (i < candidates.size()) {
+                scan_unit unit;
+                unit.block_id = reduce_record_block_offset(
+                        this->key_list[candidates[i]]->record_start);
+                unit.bytes = this->record_header[unit.block_id]->compressed_size;
+                unit.all_entries = false;
+                unsigned long first, last;
+                this->record_block_entry_range(unit.block_id, first, last);
+                size_t j = i;
+                while (j < candidates.size() && candidates[j] < last) j++;
+                j = std::max(j, i + 1);
+                unit.entries.assign(candidates.begin() + i, candidates.begin() + j);
+                plan.push_back(std::move(unit));
+                i = j;
+            }
+            LOGD("Definition scan plan: %zu candidates in %zu blocks", candidates.size(), plan.size());
+            return plan;
+        }
+
+        // Blocks whose sketch rules out the filter (a required term lacks one
+        // of its grams) are skipped before they are read or inflated
+        const BlockSketchIndex *sketch = this->indexes().block_sketch.get();
+        std::vector<std::vector<uint64_t>> term_grams;
+        if (sketch) {
+            term_grams.resize(filter.term_count());
+            for (size_t t = 0; t < filter.term_count(); ++t) {
+                ngram_query_keys(filter.term(t), term_grams[t]);
+            }
+        }
+        size_t blocks_skipped = 0;
+
+        // Every record block from the one holding the cursor, decoding them
+        // all is the fallback while no index has been built
         size_t total_blocks = this->record_header.size();
+        size_t first_block = reduce_record_block_offset(this->key_list[cursor]->record_start);
+        for (size_t rid = first_block; rid < total_blocks; ++rid) {
+            if (sketch && !filter.may_match([&](size_t t) {
+                    return term_grams[t].empty() || sketch->may_contain(rid, term_grams[t]);
+                })) {
+                blocks_skipped++;
+                continue;
+            }
+            scan_unit unit;
+            unit.block_id = rid;
+            unit.bytes = this->record_header[rid]->compressed_size;
+            plan.push_back(std::move(unit));
+        }
+        LOGD("Definition scan plan: %zu blocks (%zu skipped by sketches)", plan.size(), blocks_skipped);
+        return plan;
+    }
 
-        // Iterate over ALL record blocks
-        // record_header contains info for each block.
-        for (size_t rid = 0; rid < total_blocks; ++rid) {
-            if (progress_callback && rid % 5 == 0) { // Report every 5 blocks
-                 progress_callback(static_cast<float>(rid) / total_blocks);
+    bool Mdict::scan_definition_unit(const scan_unit &unit, uint64_t cursor, definition_matcher &matcher,
+                                     const std::function<bool(uint64_t, text_match &)> &on_hit,
+                                     const std::function<bool()> &cancelled, uint64_t &next) {
+        std::vector<uint8_t> data = this->read_record_block(unit.block_id);
+        record_block_view block;
+        block.block_id = unit.block_id;
+        block.data = data.data();
+        block.size = data.size();
+        this->record_block_entry_range(unit.block_id, block.first_entry, block.last_entry);
+
+        text_match match;
+        auto visit = [&](uint64_t e) {
+            if (cancelled && cancelled()) {
+                next = e;
+                return false;
+            }
+            size_t start, len;
+            this->entry_span(block, e, start, len);
+            if (matcher.find(reinterpret_cast<const char *>(block.data) + start, len, &match) &&
+                !on_hit(e, match)) {
+                next = e + 1;
+                return false;
+            }
+            return true;
+        };
+        if (unit.all_entries) {
+            for (uint64_t e = std::max<uint64_t>(block.first_entry, cursor); e < block.last_entry; ++e) {
+                if (!visit(e)) return false;
+            }
+        } else {
+            for (uint32_t e : unit.entries) {
+                if (e < cursor || e < block.first_entry || e >= block.last_entry) continue;
+                if (!visit(e)) return false;
+            }
+        }
+        next = block.last_entry;
+        return true;
+    }
+
+    std::vector<fulltext_hit> Mdict::scan_definitions(definition_matcher &matcher, scan_options &options) {
+        std::vector<fulltext_hit> suggestions;
+        const uint64_t entry_total = this->key_list.size();
+        if (matcher.empty() || options.cursor >= entry_total) {
+            options.cursor = entry_total;
+            return suggestions;
+        }
+
+        std::vector<scan_unit> plan = this->plan_definition_scan(matcher.filter(), options.cursor);
+        uint64_t bytes_total = 0, bytes_done = 0;
+        for (const scan_unit &unit : plan) bytes_total += unit.bytes;
+
+        auto on_hit = [&](uint64_t e, text_match &match) {
+            fulltext_hit hit;
+            hit.key = this->key_list[e]->key_word;
+            hit.snippet = std::move(match.snippet);
+            hit.match_start = match.match_start;
+            hit.match_end = match.match_end;
+            suggestions.push_back(std::move(hit));
+            return suggestions.size() < options.limit;
+        };
+        for (const scan_unit &unit : plan) {
+            if (options.progress && bytes_total) {
+                options.progress(static_cast<float>(bytes_done) / bytes_total);
             }
             try {
-                // Decode the block. This returns a vector of <key, definition> pairs.
-                // This is expensive!
-                std::vector<std::pair<std::string, std::string>> block_entries = this->decode_record_block_by_rid(rid);
-
-                for (const auto& entry : block_entries) {
-                    // entry.first is Headword
-                    // entry.second is Definition (HTML/Text)
-
-                    // Convert definition to wstring for search
-                    std::wstring wdef = utf8_to_wstring(entry.second);
-                    
-                    // We need to lowercase the definition for case-insensitive search
-                    // Optimization: Search without lowercasing first? No, that misses cases.
-                    // We have to pay the price for full text search.
-                    
-                    // To avoid copying the huge wdef, we can iterate? 
-                    // transform is in-place.
-                    std::transform(wdef.begin(), wdef.end(), wdef.begin(), ::towlower);
-
-                    if (wdef.find(wquery) != std::wstring::npos) {
-                        suggestions.push_back(entry.first);
-                        if (suggestions.size() >= max_suggestions) {
-                            return suggestions;
-                        }
-                    }
+                uint64_t next;
+                if (!this->scan_definition_unit(unit, options.cursor, matcher, on_hit, options.cancelled, next)) {
+                    // page full or cancelled, resume right there
+                    options.cursor = next;
+                    return suggestions;
                 }
-                blocks_checked++;
+                options.cursor = std::max(options.cursor, next);
             } catch (const std::exception& e) {
                 // Log the error but continue searching other blocks
-                LOGE("fulltext_search: Error decoding block %zu: %s. Skipping.", rid, e.what());
-                continue;
-            } catch (...) {
-                LOGE("fulltext_search: Unknown error decoding block %zu. Skipping.", rid);
-                continue;
+                LOGE("Definition search: Error decoding block %lu: %s. Skipping.", unit.block_id, e.what());
             }
+            bytes_done += unit.bytes;
         }
-        
-        LOGD("Full-text search checked %zu blocks, found %zu results", blocks_checked, suggestions.size());
+        options.cursor = entry_total;
+
+        LOGD("Definition search checked %zu blocks, found %zu results", plan.size(), suggestions.size());
         return suggestions;
     }
 
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/mdict2.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "include/mdict.h"
+
+struct mdict2_handle {
+  std::shared_ptr<mdict::Mdict> dict;
+};
+
+struct mdict2_result {
+  // the strings back to back, each followed by a NUL
+  std::string arena;
+  // (offset, length) per string
+  std::vector<std::pair<size_t, size_t>> spans;
+
+  void add(const std::string &s) {
+    spans.emplace_back(arena.size(), s.size());
+    arena.append(s);
+    arena.push_back('\0');
+  }
+};
+
+namespace {
+
+thread_local std::string last_error;
+
+mdict2_status fail(mdict2_status status, std::string detail) {
+  last_error = std::move(detail);
+  return status;
+}
+
+/**
+ * the identity of an opened file: a replaced or rewritten file is a new
+ * dictionary, a second open of the same one is not
+ */
+struct file_id {
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  int64_t mtime_ns;
+  bool is_mdd;
+
+  bool operator<(const file_id &o) const {
+    return std::tie(dev, ino, size, mtime_ns, is_mdd) <
+           std::tie(o.dev, o.ino, o.size, o.mtime_ns, o.is_mdd);
+  }
+};
+
+file_id make_file_id(const struct stat &st, bool is_mdd) {
+  return {st.st_dev, st.st_ino, st.st_size,
+          (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec, is_mdd};
+}
+
+/**
+ * one file's place in the registry: the dictionary, held weakly since the
+ * handles own it, and a mutex held while it is opened
+ */
+struct open_slot {
+  std::mutex mutex;
+  std::weak_ptr<mdict::Mdict> dict;
+};
+
+// guards the map only, never held while a dictionary is parsed
+std::mutex registry_mutex;
+std::map<file_id, std::shared_ptr<open_slot>> registry;
+
+/**
+ * the registered dictionary of a file, or a new one made by open; the first
+ * thread to open a file parses it under that file's slot, threads opening
+ * the same file wait for it and the others go on
+ */
+template <typename Open>
+mdict2_status share(const file_id &id, Open open, mdict2_handle **out) {
+  std::shared_ptr<open_slot> slot;
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    std::shared_ptr<open_slot> &entry = registry[id];
+    if (!entry) entry = std::make_shared<open_slot>();
+    slot = entry;
+  }
+
+  std::shared_ptr<mdict::Mdict> dict;
+  {
+    std::lock_guard<std::mutex> lock(slot->mutex);
+    dict = slot->dict.lock();
+    if (!dict) {
+      dict = open();
+      if (dict) slot->dict = dict;
+    }
+  }
+
+  {
+    // drop the slots of dictionaries that were closed since; a slot only the
+    // map holds cannot be taken by another thread while the lock is held
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (auto it = registry.begin(); it != registry.end();) {
+      bool closed = false;
+      if (it->second.use_count() == 1) {
+        std::lock_guard<std::mutex> idle(it->second->mutex);
+        closed = it->second->dict.expired();
+      }
+      it = closed ? registry.erase(it) : std::next(it);
+    }
+  }
+  if (!dict) return MDICT2_ERR_OPEN;
+  *out = new mdict2_handle{std::move(dict)};
+  return MDICT2_OK;
+}
+
+bool ends_with_mdd(const char *path) {
+  size_t n = std::strlen(path);
+  return n >= 4 && std::strcmp(path + n - 4, ".mdd") == 0;
+}
+
+// exceptions never cross the C boundary
+template <typename Body>
+mdict2_status guarded(Body body) {
+  try {
+    return body();
+  } catch (const std::bad_alloc &) {
+    return fail(MDICT2_ERR_MEMORY, "out of memory");
+  } catch (const std::exception &e) {
+    return fail(MDICT2_ERR_INTERNAL, e.what());
+  }
+}
+
+}  // namespace
+
+extern "C" {
+
+mdict2_status mdict2_open(const char *path, mdict2_handle **out) {
+  if (!path || !out) return fail(MDICT2_ERR_ARGUMENT, "null argument");
+  *out = nullptr;
+  struct stat st;
+  if (stat(path, &st) != 0) return fail(MDICT2_ERR_OPEN, std::string("cannot stat ") + path);
+  return guarded([&]() {
+    std::string error;
+    mdict2_status status = share(make_file_id(st, ends_with_mdd(path)), [&]() {
+      auto dict = std::make_shared<mdict::Mdict>(std::string(path));
+      try {
+        dict->init();
+      } catch (const std::exception &e) {
+        error = e.what();
+        dict.reset();
+      }
+      return dict;
+    }, out);
+    return status == MDICT2_OK ? status : fail(status, error);
+  });
+}
+
+mdict2_status mdict2_open_fd(int fd, int is_mdd, mdict2_handle **out) {
+  if (fd < 0 || !out) {
+    if (fd >= 0) close(fd);
+    return fail(MDICT2_ERR_ARGUMENT, "bad argument");
+  }
+  *out = nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return fail(MDICT2_ERR_OPEN, "cannot stat descriptor");
+  }
+  // set once a dictionary owns the descriptor
+  bool adopted = false;
+  mdict2_status result = guarded([&]() {
+    std::string error;
+    mdict2_status status = share(make_file_id(st, is_mdd != 0), [&]() {
+      auto dict = std::make_shared<mdict::Mdict>(fd, is_mdd != 0);
+      adopted = true;
+      dict->set_file_type(is_mdd != 0);
+      try {
+        dict->init();
+      } catch (const std::exception &e) {
+        error = e.what();
+        dict.reset();
+      }
+      return dict;
+    }, out);
+    return status == MDICT2_OK ? status : fail(status, error);
+  });
+  // an already open dictionary does not need the descriptor, nor does a call
+  // that threw before handing it over
+  if (!adopted) close(fd);
+  return result;
+}
+
+void mdict2_close(mdict2_handle *handle) { delete handle; }
+
+mdict2_status mdict2_key_count(const mdict2_handle *handle, size_t *count) {
+  if (!handle || !count) return fail(MDICT2_ERR_ARGUMENT, "null argument");
+  *count = handle->dict->entry_count();
+  return MDICT2_OK;
+}
+
+mdict2_status mdict2_key_at(const mdict2_handle *handle, size_t index,
+                            const char **key, size_t *len) {
+  if (!handle || !key) return fail(MDICT2_ERR_ARGUMENT, "null argument");
+  if (index >= handle->dict->entry_count()) {
+    return fail(MDICT2_ERR_ARGUMENT, "key index out of range");
+  }
+  const std::string &k = handle->dict->entry_key(index);
+  *key = k.c_str();
+  if (len) *len = k.size();
+  return MDICT2_OK;
+}
+
+mdict2_status mdict2_lookup(mdict2_handle *handle, const char *word, char *buf,
+                            size_t cap, size_t *needed) {
+  if (!handle || !word || (!buf && cap > 0)) {
+    return fail(MDICT2_ERR_ARGUMENT, "null argument");
+  }
+  return guarded([&]() {
+    std::vector<std::string> results = handle->dict->lookup(word);
+    if (results.empty()) return fail(MDICT2_ERR_NOT_FOUND, word);
+    const std::string &s = results.front();
+    if (needed) *needed = s.size() + 1;
+    if (cap < s.size() + 1) return fail(MDICT2_ERR_BUFFER, "buffer too small");
+    std::memcpy(buf, s.c_str(), s.size() + 1);
+    return MDICT2_OK;
+  });
+}
+
+mdict2_status mdict2_lookup_all(mdict2_handle *handle, const char *word,
+                                mdict2_result **out) {
+  if (!handle || !word || !out) return fail(MDICT2_ERR_ARGUMENT, "null argument");
+  *out = nullptr;
+  return guarded([&]() {
+    std::vector<std::string> results = handle->dict->lookup(word);
+    if (results.empty()) return fail(MDICT2_ERR_NOT_FOUND, word);
+    auto result = std::make_unique<mdict2_result>();
+    for (const std::string &s : results) result->add(s);
+    *out = result.release();
+    return MDICT2_OK;
+  });
+}
+
+mdict2_status mdict2_lookup_batch(mdict2_handle *handle, const char *const *words,
+                                  size_t count, mdict2_result **out) {
+  if (!handle || (!words && count > 0) || !out) {
+    return fail(MDICT2_ERR_ARGUMENT, "null argument");
+  }
+  *out = nullptr;
+  return guarded([&]() {
+    auto result = std::make_unique<mdict2_result>();
+    result->spans.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      if (!words[i]) return fail(MDICT2_ERR_ARGUMENT, "null word");
+      std::vector<std::string> results = handle->dict->lookup(words[i]);
+      result->add(results.empty() ? std::string() : results.front());
+    }
+    *out = result.release();
+    return MDICT2_OK;
+  });
+}
+
+mdict2_status mdict2_suggest(mdict2_handle *handle, const char *prefix,
+                             size_t limit, mdict2_result **out) {
+  if (!handle || !prefix || !out) return fail(MDICT2_ERR_ARGUMENT, "null argument");
+  *out = nullptr;
+  return guarded([&]() {
+    std::vector<std::string> keys = handle->dict->suggest(prefix);
+    if (limit > 0 && keys.size() > limit) keys.resize(limit);
+    auto result = std::make_unique<mdict2_result>();
+    for (const std::string &k : keys) result->add(k);
+    *out = result.release();
+    return MDICT2_OK;
+  });
+}
+
+mdict2_status mdict2_stem(mdict2_handle *handle, const char *word,
+                          mdict2_result **out) {
+  if (!handle || !word || !out) return fail(MDICT2_ERR_ARGUMENT, "null argument");
+  *out = nullptr;
+  return guarded([&]() {
+    auto result = std::make_unique<mdict2_result>();
+    for (const std::string &s : handle->dict->stem(word)) result->add(s);
+    *out = result.release();
+    return MDICT2_OK;
+  });
+}
+
+size_t mdict2_result_count(const mdict2_result *result) {
+  return result ? result->spans.size() : 0;
+}
+
+const char *mdict2_result_get(const mdict2_result *result, size_t index,
+                              size_t *len) {
+  if (!result || index >= result->spans.size()) return nullptr;
+  if (len) *len = result->spans[index].second;
+  return result->arena.c_str() + result->spans[index].first;
+}
+
+void mdict2_result_free(mdict2_result *result) { delete result; }
+
+const char *mdict2_last_error(void) { return last_error.c_str(); }
+
+}  // extern "C"
@@ -8,7 +8,7 @@
 
 #include "include/mdict_extern.h"
 
-#include <jni.h>
+#include <unistd.h>
 #include <algorithm>
 #include <string>
 #include <unordered_map>
@@ -16,8 +16,12 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <mutex>
 #include <type_traits>
 #include "include/mdict.h"
+#include "include/mdict2.h"
+#include "include/zip_source.h"
 
 std::string mime_detect(const std::string &filename) {
   static const std::unordered_map<std::string, std::string> mime_map = {
@@ -68,6 +72,21 @@ void *mdict_init(const char *dictionary_path) {
   return mydict;
 }
 
+/**
+ init the dictionary with a hunspell affix file and word list for stemming
+ */
+void *mdict_init_with_stemmer(const char *dictionary_path, const char *aff_path,
+                              const char *dic_path) {
+  auto *mydict = new mdict::Mdict(dictionary_path, aff_path, dic_path);
+  try {
+    mydict->init();
+    return mydict;
+  } catch (const std::exception &e) {
+    delete mydict;
+    return nullptr;
+  }
+}
+
 /**
  init the dictionary from a File Descriptor (zero-copy on Android)
  */
@@ -90,6 +109,39 @@ void *mdict_init_fd(int fd, bool is_mdd) {
   }
 }
 
+/**
+ init the dictionary from a member of a ZIP archive
+ */
+void *mdict_init_zip(int fd, const char *member, const char *cache_dir) {
+  mdict::Mdict *mydict = nullptr;
+  try {
+    for (const auto &m : mdict::list_zip_dictionaries(fd)) {
+      if (m.name != member) continue;
+      std::string ext = m.name.substr(m.name.size() - 4);
+      std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+      bool is_mdd = ext == ".mdd";
+      if (m.stored) {
+        // the archive fd is the dictionary's from here on
+        mydict = new mdict::Mdict(fd, is_mdd, m.data_offset);
+        fd = -1;
+      } else {
+        mydict = new mdict::Mdict(mdict::inflate_zip_member(fd, m, cache_dir));
+      }
+      mydict->set_file_type(is_mdd);
+      break;
+    }
+    if (fd >= 0) close(fd);
+    fd = -1;
+    if (!mydict) return nullptr;
+    mydict->init();
+    return mydict;
+  } catch (const std::exception &e) {
+    if (fd >= 0) close(fd);
+    delete mydict;
+    return nullptr;
+  }
+}
+
 /**
  lookup a word
  */
@@ -259,13 +311,41 @@ int mdict_filetype(void *dict) {
 suggest  a word
 */
 void mdict_suggest(void *dict, char *word, char **suggested_words, int length) {
+  auto *self = (mdict::Mdict *)dict;
+  if (length <= 0) return;
+  std::fill(suggested_words, suggested_words + length, nullptr);
+  if (!word) return;
 
+  std::vector<std::string> keys;
+  try {
+    keys = self->suggest(word);
+  } catch (const std::exception &e) {
+    return;
+  }
+  for (int i = 0; i < length && i < (int)keys.size(); ++i) {
+    suggested_words[i] = strdup(keys[i].c_str());
+  }
 }
 
 /**
- return a stem
+ return the stems of a word that have entries, unused slots are set to null
  */
-void mdict_stem(void *dict, char *word, char **suggested_words, int length) {}
+void mdict_stem(void *dict, char *word, char **suggested_words, int length) {
+  auto *self = (mdict::Mdict *)dict;
+  if (length <= 0) return;
+  std::fill(suggested_words, suggested_words + length, nullptr);
+  if (!word) return;
+
+  std::vector<std::string> stems;
+  try {
+    stems = self->stem(word);
+  } catch (const std::exception &e) {
+    return;
+  }
+  for (int i = 0; i < length && i < (int)stems.size(); ++i) {
+    suggested_words[i] = strdup(stems[i].c_str());
+  }
+}
 
 int mdict_destory(void *dict) {
   auto *self = (mdict::Mdict *)dict;
@@ -282,34 +362,53 @@ const char* c_mime_detect(const char* filename) {
 
 // this is a variant of mdict_lookup with does "atomic" lookups.
 // by atomic, we mean that each lookup is done isolated from each other, preventing memory bugs
+// the parsed dictionary is shared through the v2 handles and the last few stay
+// open, so a lookup no longer indexes the whole file again
 extern "C" char* mdict_atomic_lookup(const char* dictPath, const char* key) {
-    try {
-        mdict::Mdict dict(dictPath);
-        dict.init();
-
-        std::vector<std::string> results = dict.lookup(key);
-        std::string html = results.empty() ? "" : results[0];
-      
-        // Copy to heap 
-        char* result = (char*)malloc(html.size() + 1);
-        std::memcpy(result, html.c_str(), html.size() + 1);
-        return result;
+    static const size_t max_recent = 8;
+    static std::mutex recent_mutex;
+    static std::deque<std::pair<std::string, mdict2_handle*>> recent;
 
-    } catch (const std::exception& e) {
-        // Catch anything derived from std::exception
-        const std::string msg = std::string("ERROR: ") + e.what();
-        char* result = (char*)malloc(msg.size() + 1);
-        std::memcpy(result, msg.c_str(), msg.size() + 1);
-        result[msg.size()] = '\0';
+    auto copy_out = [](const std::string &s) {
+        char* result = (char*)malloc(s.size() + 1);
+        if (result) std::memcpy(result, s.c_str(), s.size() + 1);
         return result;
+    };
 
-    } catch (...) {
-        // Catch everything else
-        const char* msg = "ERROR: unknown exception";
-        char* result = (char*)malloc(strlen(msg) + 1);
-        strcpy(result, msg);
-        return result;
+    mdict2_handle* handle = nullptr;
+    if (mdict2_open(dictPath, &handle) != MDICT2_OK) {
+        return copy_out(std::string("ERROR: ") + mdict2_last_error());
+    }
+
+    std::string html;
+    mdict2_result* results = nullptr;
+    mdict2_status status = mdict2_lookup_all(handle, key, &results);
+    if (status == MDICT2_OK) {
+        html = mdict2_result_get(results, 0, nullptr);
+        mdict2_result_free(results);
+    } else if (status != MDICT2_ERR_NOT_FOUND) {
+        html = std::string("ERROR: ") + mdict2_last_error();
+    }
+
+    // keep the dictionary alive for the next call, newest first
+    std::vector<mdict2_handle*> dropped;
+    {
+        std::lock_guard<std::mutex> lock(recent_mutex);
+        for (auto it = recent.begin(); it != recent.end(); ++it) {
+            if (it->first == dictPath) {
+                dropped.push_back(it->second);
+                recent.erase(it);
+                break;
+            }
+        }
+        recent.emplace_front(dictPath, handle);
+        if (recent.size() > max_recent) {
+            dropped.push_back(recent.back().second);
+            recent.pop_back();
+        }
     }
+    for (mdict2_handle* h : dropped) mdict2_close(h);
+    return copy_out(html);
 }
   
 
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/ngram_index.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "include/html_text.h"
+#include "include/mdict.h"
+#include "include/posting_segments.h"
+
+namespace mdict {
+
+static const uint32_t NGRAM_MAGIC = 0x474e4456;  // "VDNG"
+static const size_t NGRAM_HEADER_SIZE = 32;
+static const size_t NGRAM_TABLE_ENTRY = 16;
+
+static inline uint64_t trigram_key(char32_t a, char32_t b, char32_t c) {
+  return ((uint64_t)a << 42) | ((uint64_t)b << 21) | (uint64_t)c;
+}
+
+static inline uint64_t bigram_key(char32_t a, char32_t b) {
+  return (1ull << 63) | ((uint64_t)a << 21) | (uint64_t)b;
+}
+
+void ngram_keys(const std::u32string &text, std::vector<uint64_t> &out) {
+  size_t n = text.size();
+  for (size_t i = 0; i + 1 < n; ++i) {
+    if (is_cjk(text[i]) || is_cjk(text[i + 1])) {
+      out.push_back(bigram_key(text[i], text[i + 1]));
+    }
+    if (i + 2 < n) {
+      out.push_back(trigram_key(text[i], text[i + 1], text[i + 2]));
+    }
+  }
+}
+
+void ngram_query_keys(const std::u32string &q, std::vector<uint64_t> &out) {
+  if (q.size() >= 3) {
+    for (size_t i = 0; i + 2 < q.size(); ++i) {
+      out.push_back(trigram_key(q[i], q[i + 1], q[i + 2]));
+    }
+  } else if (q.size() == 2 && (is_cjk(q[0]) || is_cjk(q[1]))) {
+    out.push_back(bigram_key(q[0], q[1]));
+  }
+  std::sort(out.begin(), out.end());
+  out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+/***************************************
+ *            build side               *
+ ***************************************/
+
+void NgramIndexJob::add_block(const Mdict &dict,
+                              const record_block_view &block) {
+  for (unsigned long e = block.first_entry; e < block.last_entry; ++e) {
+    size_t start, len;
+    dict.entry_span(block, e, start, len);
+    html_to_search_text(reinterpret_cast<const char *>(block.data) + start, len,
+                        text_);
+    keys_.clear();
+    ngram_keys(text_, keys_);
+    std::sort(keys_.begin(), keys_.end());
+    keys_.erase(std::unique(keys_.begin(), keys_.end()), keys_.end());
+
+    uint32_t id = static_cast<uint32_t>(e);
+    for (uint64_t key : keys_) {
+      posting_list &list = postings_[key];
+      if (list.count == 0) {
+        list.first = id;
+      } else {
+        put_varint(list.deltas, id - list.last);
+      }
+      list.last = id;
+      list.count++;
+    }
+  }
+}
+
+/**
+ * segment layout: u64 gram count, then per gram (sorted by key)
+ * u64 key, u32 count, u32 first, u32 last, u32 delta bytes, delta bytes
+ */
+bool NgramIndexJob::write_segment(FILE *out) {
+  std::vector<uint64_t> keys;
+  keys.reserve(postings_.size());
+  for (const auto &kv : postings_) keys.push_back(kv.first);
+  std::sort(keys.begin(), keys.end());
+
+  bool ok = write_u64(out, keys.size());
+  for (uint64_t key : keys) {
+    const posting_list &list = postings_[key];
+    ok = ok && write_u64(out, key) && write_u32(out, list.count) &&
+         write_u32(out, list.first) && write_u32(out, list.last) &&
+         write_u32(out, (uint32_t)list.deltas.size());
+    if (ok && !list.deltas.empty()) {
+      ok = std::fwrite(list.deltas.data(), 1, list.deltas.size(), out) ==
+           list.deltas.size();
+    }
+    if (!ok) break;
+  }
+  std::unordered_map<uint64_t, posting_list>().swap(postings_);
+  return ok;
+}
+
+bool NgramIndexJob::merge(const Mdict &dict,
+                          const std::vector<std::string> &segments, FILE *out) {
+  std::vector<std::unique_ptr<mapped_file>> files;
+  for (const auto &path : segments) {
+    files.emplace_back(new mapped_file());
+    files.back()->map(path);  // an empty segment simply maps to nothing
+  }
+  segment_merger merger(files);
+  uint64_t key;
+  std::vector<const segment_cursor *> parts;
+
+  // pass 1: the gram table, postings offsets follow from the list sizes
+  bool ok = write_u32(out, NGRAM_MAGIC) && write_u32(out, FORMAT_VERSION) &&
+            write_u64(out, dict.fingerprint()) && write_u64(out, 0) &&
+            write_u64(out, 0);
+  uint64_t gram_count = 0;
+  uint64_t offset = 0;
+  merger.reset();
+  while (ok && merger.next(key, parts)) {
+    ok = write_u64(out, key) && write_u64(out, offset);
+    uint32_t count = 0;
+    uint32_t prev = 0;
+    uint64_t bytes = 0;
+    for (const segment_cursor *c : parts) {
+      count += c->count;
+      bytes += varint_size(c->first - prev) + c->nbytes;
+      prev = c->last;
+    }
+    offset += varint_size(count) + bytes;
+    gram_count++;
+  }
+  uint64_t postings_start = NGRAM_HEADER_SIZE + gram_count * NGRAM_TABLE_ENTRY;
+
+  // pass 2: the postings, re-basing the first id of each segment's list
+  std::vector<unsigned char> buf;
+  merger.reset();
+  while (ok && merger.next(key, parts)) {
+    buf.clear();
+    uint32_t count = 0;
+    for (const segment_cursor *c : parts) count += c->count;
+    put_varint(buf, count);
+    uint32_t prev = 0;
+    for (const segment_cursor *c : parts) {
+      put_varint(buf, c->first - prev);
+      buf.insert(buf.end(), c->deltas, c->deltas + c->nbytes);
+      prev = c->last;
+    }
+    ok = std::fwrite(buf.data(), 1, buf.size(), out) == buf.size();
+  }
+
+  ok = ok && std::fseek(out, 16, SEEK_SET) == 0 && write_u64(out, gram_count) &&
+       write_u64(out, postings_start);
+  return ok;
+}
+
+/***************************************
+ *            query side               *
+ ***************************************/
+
+bool NgramIndex::open(const std::string &path, uint64_t fingerprint) {
+  if (!file_.map(path)) return false;
+  const unsigned char *p = file_.data();
+  size_t size = file_.size();
+  if (size < NGRAM_HEADER_SIZE || load_u32(p) != NGRAM_MAGIC ||
+      load_u32(p + 4) != NgramIndexJob::FORMAT_VERSION ||
+      load_u64(p + 8) != fingerprint) {
+    file_.unmap();
+    return false;
+  }
+  gram_count_ = load_u64(p + 16);
+  uint64_t postings_start = load_u64(p + 24);
+  if (gram_count_ > (size - NGRAM_HEADER_SIZE) / NGRAM_TABLE_ENTRY ||
+      postings_start != NGRAM_HEADER_SIZE + gram_count_ * NGRAM_TABLE_ENTRY) {
+    file_.unmap();
+    return false;
+  }
+  table_ = p + NGRAM_HEADER_SIZE;
+  postings_ = p + postings_start;
+  return true;
+}
+
+bool NgramIndex::postings(uint64_t key, std::vector<uint32_t> &out) const {
+  out.clear();
+  // binary search the gram table
+  uint64_t lo = 0, hi = gram_count_;
+  while (lo < hi) {
+    uint64_t mid = lo + ((hi - lo) >> 1);
+    if (load_u64(table_ + mid * NGRAM_TABLE_ENTRY) < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == gram_count_ || load_u64(table_ + lo * NGRAM_TABLE_ENTRY) != key) {
+    return true;  // gram never occurs
+  }
+  const unsigned char *end = file_.data() + file_.size();
+  const unsigned char *p =
+      postings_ + load_u64(table_ + lo * NGRAM_TABLE_ENTRY + 8);
+  if (p >= end) return false;
+  uint64_t count, v;
+  if (!(p = get_varint(p, end, count))) return false;
+  out.reserve(count);
+  uint64_t id = 0;
+  for (uint64_t i = 0; i < count; ++i) {
+    if (!(p = get_varint(p, end, v))) return false;
+    id += v;
+    out.push_back(static_cast<uint32_t>(id));
+  }
+  return true;
+}
+
+bool NgramIndex::candidates(const std::u32string &query,
+                            std::vector<uint32_t> &entries) const {
+  entries.clear();
+  if (!file_.data()) return false;
+  std::vector<uint64_t> keys;
+  ngram_query_keys(query, keys);
+  if (keys.empty()) return false;
+
+  std::vector<std::vector<uint32_t>> lists(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (!postings(keys[i], lists[i])) return false;  // damaged, let caller scan
+    if (lists[i].empty()) return true;               // no entry can match
+  }
+  // intersect from the shortest list up
+  std::sort(lists.begin(), lists.end(),
+            [](const std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+              return a.size() < b.size();
+            });
+  entries.swap(lists[0]);
+  std::vector<uint32_t> tmp;
+  for (size_t i = 1; i < lists.size() && !entries.empty(); ++i) {
+    tmp.clear();
+    std::set_intersection(entries.begin(), entries.end(), lists[i].begin(),
+                          lists[i].end(), std::back_inserter(tmp));
+    entries.swap(tmp);
+  }
+  return true;
+}
+
+}  // namespace mdict
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/resource_set.h"
+
+#include "include/mdict.h"
+#include "include/mdict_log.h"
+
+#define LOG_TAG "MdictJNI"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+namespace mdict {
+
+std::string ResourceSet::normalize(std::string_view path) {
+  std::string out;
+  out.reserve(path.size());
+  for (char c : path) {
+    if (c == '/') c = '\\';
+    if (c == '\\' && out.empty()) continue;
+    if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    out.push_back(c);
+  }
+  return out;
+}
+
+static std::string_view file_name(std::string_view normalized) {
+  size_t slash = normalized.rfind('\\');
+  return slash == std::string_view::npos ? normalized : normalized.substr(slash + 1);
+}
+
+ResourceSet::ResourceSet(const std::vector<Mdict *> &volumes) {
+  size_t total = 0;
+  for (const Mdict *v : volumes) total += v->entry_count();
+  paths_.reserve(total + total / 2);
+
+  // full paths first, emplace keeps the earlier volume's entry
+  for (size_t v = 0; v < volumes.size(); ++v) {
+    for (size_t e = 0; e < volumes[v]->entry_count(); ++e) {
+      paths_.emplace(normalize(volumes[v]->entry_key(e)), ((uint64_t)v << 32) | e);
+    }
+  }
+  // then file names, for requests whose directory differs from the key's
+  for (size_t v = 0; v < volumes.size(); ++v) {
+    for (size_t e = 0; e < volumes[v]->entry_count(); ++e) {
+      std::string key = normalize(volumes[v]->entry_key(e));
+      std::string_view name = file_name(key);
+      if (name.size() != key.size()) {
+        paths_.emplace(std::string(name), ((uint64_t)v << 32) | e);
+      }
+    }
+  }
+  LOGD("ResourceSet: %zu paths over %zu volumes", paths_.size(), volumes.size());
+}
+
+bool ResourceSet::find(std::string_view path, uint32_t &volume,
+                       uint32_t &entry) const {
+  std::string key = normalize(path);
+  auto it = paths_.find(key);
+  if (it == paths_.end()) {
+    std::string_view name = file_name(key);
+    if (name.size() == key.size()) return false;
+    it = paths_.find(std::string(name));
+    if (it == paths_.end()) return false;
+  }
+  volume = static_cast<uint32_t>(it->second >> 32);
+  entry = static_cast<uint32_t>(it->second);
+  return true;
+}
+
+}  // namespace mdict
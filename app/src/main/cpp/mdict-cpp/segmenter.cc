@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/segmenter.h"
+
+#include <algorithm>
+#include <string_view>
+
+#include "include/html_text.h"
+#include "include/key_fold.h"
+#include "include/mdict.h"
+
+namespace mdict {
+
+// a character with the marks that follow it
+struct text_unit {
+  size_t start;       // bytes in the text
+  size_t end;
+  size_t fold_start;  // bytes in the folded text
+  size_t fold_end;
+  bool word;          // letter or digit of a space delimited script
+};
+
+static bool is_mark(char32_t c) {
+  return (c >= 0x0300 && c <= 0x036F) || c == 0x3099 || c == 0x309A ||
+         c == 0xFF9E || c == 0xFF9F;
+}
+
+static bool is_word_char(char32_t c) {
+  if (c < 0x80) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+           (c >= 'A' && c <= 'Z');
+  }
+  // Latin, Greek, Cyrillic... up to the general punctuation block
+  return c >= 0xC0 && c < 0x2000 && c != 0xD7 && c != 0xF7;
+}
+
+/**
+ * number of separator runs (characters folding to nothing) in a key
+ */
+static size_t separator_runs(const std::string &key, const KeyFolder &folder) {
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(key.data());
+  const unsigned char *end = p + key.size();
+  size_t runs = 0;
+  bool in_run = false;
+  std::string folded;
+  while (p < end) {
+    char32_t c;
+    size_t n = decode_utf8(p, end, c);
+    folder.fold(std::string_view(reinterpret_cast<const char *>(p), n), folded);
+    p += n;
+    if (folded.empty()) {
+      if (!in_run) ++runs;
+      in_run = true;
+    } else {
+      in_run = false;
+    }
+  }
+  return runs;
+}
+
+// (folded length, entries) of every key the text at unit u starts with,
+// shortest first: a walk of the folded key index, or until it is built, a
+// binary search of the key list under _s() for each run of whole units
+static std::vector<std::pair<size_t, std::vector<uint32_t>>> key_prefixes(
+    Mdict &dict, const std::string &text, const std::vector<text_unit> &units,
+    size_t u, std::string_view rest) {
+  const size_t max_length = 256;
+  std::vector<std::pair<size_t, std::vector<uint32_t>>> found;
+  EpochGuard guard;
+  const FoldedKeyIndex *index = dict.folded_key_index();
+  if (index) {
+    for (auto &prefix : index->common_prefixes(rest, max_length)) {
+      found.emplace_back(prefix.first, std::vector<uint32_t>(prefix.second.first,
+                                                             prefix.second.second));
+    }
+    return found;
+  }
+  for (size_t v = u; v < units.size(); ++v) {
+    size_t length = units[v].fold_end - units[u].fold_start;
+    if (length > max_length) break;
+    if (units[v].fold_end == units[v].fold_start) continue;  // separator
+    std::string piece = text.substr(units[u].start, units[v].end - units[u].start);
+    // no key goes on with it, none goes on with a longer run either
+    std::pair<unsigned long, unsigned long> range = dict.stripped_range(piece, true);
+    if (range.first == range.second) break;
+    range = dict.stripped_range(piece, false);
+    if (range.first == range.second) continue;
+    std::vector<uint32_t> entries;
+    for (unsigned long e = range.first; e < range.second; ++e) entries.push_back(e);
+    found.emplace_back(length, std::move(entries));
+  }
+  return found;
+}
+
+std::vector<text_segment> segment_text(const std::vector<Mdict *> &dicts,
+                                       const std::string &text) {
+  const KeyFolder &folder = KeyFolder::get(KEY_FOLD_LOOSE);
+
+  // 1. split into units and fold each on its own, so folded offsets map
+  // back to the text
+  std::vector<text_unit> units;
+  std::string folded;
+  std::string piece;
+  const unsigned char *begin =
+      reinterpret_cast<const unsigned char *>(text.data());
+  const unsigned char *end = begin + text.size();
+  const unsigned char *p = begin;
+  while (p < end) {
+    text_unit unit;
+    unit.start = p - begin;
+    char32_t c;
+    p += decode_utf8(p, end, c);
+    unit.word = is_word_char(c);
+    while (p < end) {
+      char32_t mark;
+      size_t n = decode_utf8(p, end, mark);
+      if (!is_mark(mark)) break;
+      p += n;
+    }
+    unit.end = p - begin;
+    folder.fold(std::string_view(text.data() + unit.start, unit.end - unit.start),
+                piece);
+    unit.fold_start = folded.size();
+    folded += piece;
+    unit.fold_end = folded.size();
+    units.push_back(unit);
+  }
+
+  // unit whose folded form ends at each folded offset
+  std::vector<long> unit_ending_at(folded.size() + 1, -1);
+  for (size_t u = 0; u < units.size(); ++u) {
+    if (units[u].fold_end > units[u].fold_start) {
+      unit_ending_at[units[u].fold_end] = static_cast<long>(u);
+    }
+  }
+  auto is_separator = [&](size_t u) {
+    return units[u].fold_end == units[u].fold_start;
+  };
+
+  // 2. longest match from each segment start
+  std::vector<text_segment> segments;
+  long unknown_end = -1;  // last unit of the trailing unknown segment
+  size_t u = 0;
+  while (u < units.size()) {
+    if (is_separator(u)) {
+      ++u;
+      continue;
+    }
+    std::string_view rest(folded.data() + units[u].fold_start,
+                          folded.size() - units[u].fold_start);
+    long best = -1;
+    std::vector<std::pair<uint32_t, uint32_t>> matched;
+    for (size_t d = 0; d < dicts.size(); ++d) {
+      auto prefixes = key_prefixes(*dicts[d], text, units, u, rest);
+      for (auto it = prefixes.rbegin(); it != prefixes.rend(); ++it) {
+        long last = unit_ending_at[units[u].fold_start + it->first];
+        if (last < 0) continue;  // ends inside a unit (ß -> s)
+        if (last < best) break;  // shorter than another dictionary's match
+        size_t next = static_cast<size_t>(last) + 1;
+        if (next < units.size() && units[last].word && units[next].word) {
+          continue;  // inside a word
+        }
+        size_t text_runs = 0;
+        for (size_t i = u + 1; i < static_cast<size_t>(last); ++i) {
+          if (is_separator(i) && !is_separator(i - 1)) ++text_runs;
+        }
+        std::vector<std::pair<uint32_t, uint32_t>> found;
+        for (uint32_t e : it->second) {
+          if (text_runs == 0 ||
+              separator_runs(dicts[d]->entry_key(e), folder) >= text_runs) {
+            found.emplace_back(static_cast<uint32_t>(d), e);
+          }
+        }
+        if (found.empty()) continue;
+        // keys spelled like the text first, as lookup() does
+        const KeyFolder &strict = KeyFolder::get(KEY_FOLD_STRICT);
+        std::string surface = strict.fold(std::string_view(
+            text.data() + units[u].start, units[last].end - units[u].start));
+        auto loose_only = std::stable_partition(
+            found.begin(), found.end(), [&](const std::pair<uint32_t, uint32_t> &e) {
+              return strict.fold(dicts[d]->entry_key(e.second)) == surface;
+            });
+        if (loose_only != found.begin()) found.erase(loose_only, found.end());
+        if (last > best) {
+          best = last;
+          matched.clear();
+        }
+        matched.insert(matched.end(), found.begin(), found.end());
+        break;
+      }
+    }
+
+    if (best >= 0) {
+      text_segment segment;
+      segment.start = units[u].start;
+      segment.length = units[best].end - units[u].start;
+      segment.entries = std::move(matched);
+      segments.push_back(std::move(segment));
+      u = best + 1;
+      continue;
+    }
+
+    // unknown: the rest of the word, or one CJK character
+    size_t last = u;
+    while (last + 1 < units.size() && units[last].word &&
+           units[last + 1].word) {
+      ++last;
+    }
+    if (unknown_end >= 0 && static_cast<size_t>(unknown_end) + 1 == u) {
+      segments.back().length = units[last].end - segments.back().start;
+    } else {
+      text_segment segment;
+      segment.start = units[u].start;
+      segment.length = units[last].end - units[u].start;
+      segments.push_back(std::move(segment));
+    }
+    unknown_end = static_cast<long>(last);
+    u = last + 1;
+  }
+  return segments;
+}
+
+}  // namespace mdict
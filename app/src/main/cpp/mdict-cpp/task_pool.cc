@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/task_pool.h"
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace mdict {
+
+// matches android.os.Process.THREAD_PRIORITY_BACKGROUND
+static const int BACKGROUND_NICE = 10;
+
+TaskPool &TaskPool::shared() {
+  // leave one core for the UI thread, keep background work on a single thread
+  static TaskPool pool(
+      std::max(2u, std::thread::hardware_concurrency()) - 1, 1);
+  return pool;
+}
+
+TaskPool::TaskPool(unsigned interactive_threads, unsigned background_threads) {
+  Lane &interactive = lanes_[static_cast<int>(TaskLane::INTERACTIVE)];
+  Lane &background = lanes_[static_cast<int>(TaskLane::BACKGROUND)];
+  for (unsigned i = 0; i < std::max(1u, interactive_threads); ++i) {
+    interactive.workers.emplace_back(
+        [this, &interactive] { worker_loop(interactive, 0); });
+  }
+  for (unsigned i = 0; i < std::max(1u, background_threads); ++i) {
+    background.workers.emplace_back(
+        [this, &background] { worker_loop(background, BACKGROUND_NICE); });
+  }
+}
+
+TaskPool::~TaskPool() {
+  for (Lane &lane : lanes_) {
+    {
+      std::lock_guard<std::mutex> lock(lane.mutex);
+      lane.stopping = true;
+      lane.queue.clear();
+    }
+    lane.cv.notify_all();
+  }
+  for (Lane &lane : lanes_) {
+    for (std::thread &t : lane.workers) {
+      if (t.joinable()) t.join();
+    }
+  }
+}
+
+bool TaskPool::submit(TaskLane lane_id, std::function<void()> task) {
+  Lane &lane = lanes_[static_cast<int>(lane_id)];
+  {
+    std::lock_guard<std::mutex> lock(lane.mutex);
+    if (lane.stopping) return false;
+    lane.queue.push_back(std::move(task));
+  }
+  lane.cv.notify_one();
+  return true;
+}
+
+unsigned TaskPool::concurrency(TaskLane lane) const {
+  return static_cast<unsigned>(lanes_[static_cast<int>(lane)].workers.size());
+}
+
+void TaskPool::worker_loop(Lane &lane, int nice_value) {
+  if (nice_value != 0) {
+    // per-thread priority: on Linux/Android setpriority with a tid only
+    // affects that thread
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)),
+                nice_value);
+  }
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(lane.mutex);
+      lane.cv.wait(lock, [&lane] { return lane.stopping || !lane.queue.empty(); });
+      if (lane.stopping) return;
+      task = std::move(lane.queue.front());
+      lane.queue.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace mdict
@@ -0,0 +1,461 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/term_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include "include/html_text.h"
+#include "include/mdict.h"
+#include "include/posting_segments.h"
+
+namespace mdict {
+
+static const uint32_t TERM_MAGIC = 0x4d544456;  // "VDTM"
+static const size_t TERM_HEADER_SIZE = 56;
+static const size_t TERM_TABLE_ENTRY = 24;
+// longer runs are base64, urls and the like, never searched for
+static const size_t MAX_TERM_CHARS = 64;
+
+static inline bool is_term_char(char32_t c) {
+  if (c < 0x80) {
+    return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+  }
+  // letters of other scripts, minus spaces, latin-1 signs and the
+  // punctuation blocks
+  return !html_is_space(c) && !(c >= 0xA0 && c <= 0xBF) && c != 0xD7 &&
+         c != 0xF7 && !(c >= 0x2000 && c <= 0x206F) &&
+         !(c >= 0x3000 && c <= 0x303F) && !(c >= 0xFF00 && c <= 0xFF0F) &&
+         c != 0xFFFD;
+}
+
+static inline uint64_t term_key(const char32_t *p, size_t n) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < n; ++i) {
+    h ^= (uint64_t)p[i];
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+/**
+ * call f(start, length) for every term of a folded text, in text order
+ */
+template <typename F>
+static void for_each_term(const std::u32string &text, F &&f) {
+  size_t i = 0, n = text.size();
+  while (i < n) {
+    if (!is_term_char(text[i])) {
+      ++i;
+      continue;
+    }
+    size_t j = i + 1;
+    if (is_cjk(text[i])) {
+      while (j < n && is_cjk(text[j])) ++j;
+      if (j - i == 1) {
+        f(i, 1);
+      } else {
+        for (size_t p = i; p + 1 < j; ++p) f(p, 2);
+      }
+    } else {
+      while (j < n && is_term_char(text[j]) && !is_cjk(text[j])) ++j;
+      if (j - i <= MAX_TERM_CHARS) f(i, j - i);
+    }
+    i = j;
+  }
+}
+
+void term_keys(const std::u32string &text, std::vector<uint64_t> &out) {
+  for_each_term(text, [&](size_t start, size_t len) {
+    out.push_back(term_key(text.data() + start, len));
+  });
+}
+
+std::vector<std::u32string> term_texts(const std::u32string &text) {
+  std::vector<std::u32string> terms;
+  for_each_term(text, [&](size_t start, size_t len) {
+    std::u32string term = text.substr(start, len);
+    if (std::find(terms.begin(), terms.end(), term) == terms.end()) {
+      terms.push_back(std::move(term));
+    }
+  });
+  return terms;
+}
+
+static inline float bm25_idf(uint64_t documents, uint32_t count) {
+  return (float)std::log(1.0 + ((double)documents - count + 0.5) / (count + 0.5));
+}
+
+static inline float bm25(float idf, uint32_t freq, uint32_t length,
+                         float average_length) {
+  float norm = TermIndex::BM25_K1 * (1 - TermIndex::BM25_B +
+                                TermIndex::BM25_B * length / average_length);
+  return idf * freq * (TermIndex::BM25_K1 + 1) / (freq + norm);
+}
+
+/***************************************
+ *            build side               *
+ ***************************************/
+
+void TermIndexJob::add_block(const Mdict &dict, const record_block_view &block) {
+  static const char LINK[] = "@@@LINK=";
+  const size_t link_len = sizeof(LINK) - 1;
+  if (lengths_.empty()) first_entry_ = block.first_entry;
+  // blocks come in entry order, a gap would only be a block without entries
+  lengths_.resize(block.first_entry - first_entry_, 0);
+
+  for (unsigned long e = block.first_entry; e < block.last_entry; ++e) {
+    size_t start, len;
+    dict.entry_span(block, e, start, len);
+    const char *record = reinterpret_cast<const char *>(block.data) + start;
+    keys_.clear();
+    if (len < link_len || std::memcmp(record, LINK, link_len) != 0) {
+      html_to_search_text(record, len, text_);
+      term_keys(text_, keys_);
+    }
+    lengths_.push_back(static_cast<uint32_t>(keys_.size()));
+    std::sort(keys_.begin(), keys_.end());
+
+    uint32_t id = static_cast<uint32_t>(e);
+    for (size_t i = 0; i < keys_.size();) {
+      size_t j = i + 1;
+      while (j < keys_.size() && keys_[j] == keys_[i]) ++j;
+      posting_list &list = postings_[keys_[i]];
+      if (list.count == 0) {
+        list.first = id;
+      } else {
+        put_varint(list.bytes, id - list.last);
+      }
+      put_varint(list.bytes, j - i);
+      list.last = id;
+      list.count++;
+      i = j;
+    }
+  }
+}
+
+/**
+ * segment layout: the posting records of posting_segments.h, then u64 first
+ * entry, u64 entry count and a u32 term count per entry
+ */
+bool TermIndexJob::write_segment(FILE *out) {
+  std::vector<uint64_t> keys;
+  keys.reserve(postings_.size());
+  for (const auto &kv : postings_) keys.push_back(kv.first);
+  std::sort(keys.begin(), keys.end());
+
+  bool ok = write_u64(out, keys.size());
+  for (uint64_t key : keys) {
+    const posting_list &list = postings_[key];
+    ok = ok && write_u64(out, key) && write_u32(out, list.count) &&
+         write_u32(out, list.first) && write_u32(out, list.last) &&
+         write_u32(out, (uint32_t)list.bytes.size()) &&
+         std::fwrite(list.bytes.data(), 1, list.bytes.size(), out) ==
+             list.bytes.size();
+    if (!ok) break;
+  }
+  ok = ok && write_u64(out, first_entry_) && write_u64(out, lengths_.size());
+  for (size_t i = 0; ok && i < lengths_.size(); ++i) {
+    ok = write_u32(out, lengths_[i]);
+  }
+  std::unordered_map<uint64_t, posting_list>().swap(postings_);
+  std::vector<uint32_t>().swap(lengths_);
+  return ok;
+}
+
+bool TermIndexJob::merge(const Mdict &dict,
+                         const std::vector<std::string> &segments, FILE *out) {
+  std::vector<std::unique_ptr<mapped_file>> files;
+  for (const auto &path : segments) {
+    files.emplace_back(new mapped_file());
+    files.back()->map(path);
+  }
+
+  // pass 0: the entry lengths, stored after each segment's records
+  std::vector<uint32_t> lengths(dict.entry_count(), 0);
+  for (const auto &file : files) {
+    segment_cursor c;
+    if (!file->data()) continue;
+    if (c.start(*file)) {
+      while (c.next()) {
+      }
+    }
+    if (c.remaining != 0 || c.end - c.p < 16) return false;
+    uint64_t first = load_u64(c.p);
+    uint64_t count = load_u64(c.p + 8);
+    if (first + count > lengths.size() ||
+        (uint64_t)(c.end - c.p - 16) / 4 < count) {
+      return false;
+    }
+    for (uint64_t i = 0; i < count; ++i) {
+      lengths[first + i] = load_u32(c.p + 16 + 4 * i);
+    }
+  }
+  uint64_t documents = 0, total = 0;
+  for (uint32_t len : lengths) {
+    documents += len > 0;
+    total += len;
+  }
+  float average_length = documents ? (float)total / documents : 1;
+
+  segment_merger merger(files);
+  uint64_t key;
+  std::vector<const segment_cursor *> parts;
+
+  // pass 1: the term table, with the best score of each term over its
+  // entries
+  bool ok = write_u32(out, TERM_MAGIC) && write_u32(out, FORMAT_VERSION) &&
+            write_u64(out, dict.fingerprint()) && write_u64(out, 0) &&
+            write_u64(out, lengths.size()) && write_u64(out, documents) &&
+            write_u64(out, total) && write_u64(out, 0);
+  for (size_t i = 0; ok && i < lengths.size(); ++i) {
+    ok = write_u32(out, lengths[i]);
+  }
+  uint64_t term_count = 0;
+  uint64_t offset = 0;
+  merger.reset();
+  while (ok && merger.next(key, parts)) {
+    uint32_t count = 0;
+    for (const segment_cursor *c : parts) count += c->count;
+    float idf = bm25_idf(documents, count);
+    float bound = 0;
+    uint32_t prev = 0;
+    uint64_t bytes = 0;
+    for (const segment_cursor *c : parts) {
+      bytes += varint_size(c->first - prev) + c->nbytes;
+      prev = c->last;
+      const unsigned char *p = c->deltas, *end = c->deltas + c->nbytes;
+      uint64_t id = c->first, freq, delta;
+      for (uint32_t i = 0; i < c->count && p; ++i) {
+        if (i > 0 && (p = get_varint(p, end, delta))) id += delta;
+        if (p && (p = get_varint(p, end, freq)) && id < lengths.size()) {
+          bound = std::max(bound, bm25(idf, (uint32_t)freq, lengths[id],
+                                       average_length));
+        }
+      }
+      if (!p) return false;
+    }
+    uint32_t bits;
+    std::memcpy(&bits, &bound, 4);
+    ok = write_u64(out, key) && write_u64(out, offset) &&
+         write_u32(out, count) && write_u32(out, bits);
+    offset += bytes;
+    term_count++;
+  }
+  uint64_t postings_start = TERM_HEADER_SIZE + lengths.size() * 4 +
+                            term_count * TERM_TABLE_ENTRY;
+
+  // pass 2: the postings, re-basing the first id of each segment's list
+  std::vector<unsigned char> buf;
+  merger.reset();
+  while (ok && merger.next(key, parts)) {
+    buf.clear();
+    uint32_t prev = 0;
+    for (const segment_cursor *c : parts) {
+      put_varint(buf, c->first - prev);
+      buf.insert(buf.end(), c->deltas, c->deltas + c->nbytes);
+      prev = c->last;
+    }
+    ok = std::fwrite(buf.data(), 1, buf.size(), out) == buf.size();
+  }
+
+  ok = ok && std::fseek(out, 16, SEEK_SET) == 0 && write_u64(out, term_count) &&
+       std::fseek(out, 48, SEEK_SET) == 0 && write_u64(out, postings_start);
+  return ok;
+}
+
+/***************************************
+ *            query side               *
+ ***************************************/
+
+bool TermIndex::open(const std::string &path, uint64_t fingerprint) {
+  if (!file_.map(path)) return false;
+  const unsigned char *p = file_.data();
+  size_t size = file_.size();
+  if (size < TERM_HEADER_SIZE || load_u32(p) != TERM_MAGIC ||
+      load_u32(p + 4) != TermIndexJob::FORMAT_VERSION ||
+      load_u64(p + 8) != fingerprint) {
+    file_.unmap();
+    return false;
+  }
+  term_count_ = load_u64(p + 16);
+  entry_count_ = load_u64(p + 24);
+  documents_ = load_u64(p + 32);
+  uint64_t total = load_u64(p + 40);
+  uint64_t postings_start = load_u64(p + 48);
+  if (entry_count_ > (size - TERM_HEADER_SIZE) / 4 ||
+      term_count_ > (size - TERM_HEADER_SIZE - entry_count_ * 4) / TERM_TABLE_ENTRY ||
+      postings_start != TERM_HEADER_SIZE + entry_count_ * 4 +
+                            term_count_ * TERM_TABLE_ENTRY) {
+    file_.unmap();
+    return false;
+  }
+  average_length_ = documents_ ? (float)total / documents_ : 1;
+  lengths_ = p + TERM_HEADER_SIZE;
+  table_ = lengths_ + entry_count_ * 4;
+  postings_ = p + postings_start;
+  return true;
+}
+
+float TermIndex::idf(uint32_t count) const {
+  return bm25_idf(documents_, count);
+}
+
+bool TermIndex::find(uint64_t key, term_info &info) const {
+  uint64_t lo = 0, hi = term_count_;
+  while (lo < hi) {
+    uint64_t mid = lo + ((hi - lo) >> 1);
+    if (load_u64(table_ + mid * TERM_TABLE_ENTRY) < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == term_count_ || load_u64(table_ + lo * TERM_TABLE_ENTRY) != key) {
+    return false;
+  }
+  const unsigned char *e = table_ + lo * TERM_TABLE_ENTRY;
+  info.offset = load_u64(e + 8);
+  info.count = load_u32(e + 16);
+  uint32_t bits = load_u32(e + 20);
+  std::memcpy(&info.bound, &bits, 4);
+  return true;
+}
+
+bool TermIndex::decode(const term_info &info, std::vector<uint32_t> &entries,
+                       std::vector<uint32_t> &freqs) const {
+  const unsigned char *end = file_.data() + file_.size();
+  const unsigned char *p = postings_ + info.offset;
+  if (info.offset >= (uint64_t)(end - postings_)) return false;
+  entries.resize(info.count);
+  freqs.resize(info.count);
+  uint64_t id = 0, v;
+  for (uint32_t i = 0; i < info.count; ++i) {
+    if (!(p = get_varint(p, end, v))) return false;
+    id += v;
+    if (id >= entry_count_) return false;
+    entries[i] = static_cast<uint32_t>(id);
+    if (!(p = get_varint(p, end, v))) return false;
+    freqs[i] = static_cast<uint32_t>(v);
+  }
+  return true;
+}
+
+float TermIndex::score_bound(uint64_t key) const {
+  term_info info;
+  return file_.data() && find(key, info) ? info.bound : 0;
+}
+
+std::vector<scored_entry> TermIndex::top_k(
+    const std::vector<uint64_t> &keys, const std::vector<score_boost> &boosts,
+    size_t k) const {
+  std::vector<scored_entry> results;
+  if (!file_.data() || k == 0) return results;
+
+  // one list per term and per boost; a boost scores the same everywhere
+  struct list {
+    std::vector<uint32_t> entries;
+    std::vector<uint32_t> freqs;  // empty for a boost
+    float idf = 0;
+    float bound = 0;
+    size_t pos = 0;
+  };
+  std::vector<list> lists;
+  for (uint64_t key : keys) {
+    term_info info;
+    if (!find(key, info) || info.count == 0) continue;
+    list l;
+    if (!decode(info, l.entries, l.freqs)) continue;  // damaged, skip the term
+    l.idf = idf(info.count);
+    // the bound was summed in another order, leave room for rounding
+    l.bound = info.bound * 1.0001f;
+    lists.push_back(std::move(l));
+  }
+  for (const score_boost &boost : boosts) {
+    if (boost.entries.empty() || boost.score <= 0) continue;
+    list l;
+    l.entries = boost.entries;
+    l.bound = boost.score;
+    lists.push_back(std::move(l));
+  }
+  if (lists.empty()) return results;
+
+  // MaxScore: lists by increasing bound; once the k-th best score reaches
+  // the bounds of the lowest lists together, an entry found only in those
+  // cannot make it, so candidates come from the others ("essential") and
+  // the low lists are only probed for them
+  std::sort(lists.begin(), lists.end(),
+            [](const list &a, const list &b) { return a.bound < b.bound; });
+  std::vector<float> bound_sum(lists.size());
+  float sum = 0;
+  for (size_t i = 0; i < lists.size(); ++i) bound_sum[i] = sum += lists[i].bound;
+
+  auto score_at = [&](const list &l, uint32_t entry) {
+    if (l.freqs.empty()) return l.bound;
+    return bm25(l.idf, l.freqs[l.pos], load_u32(lengths_ + 4 * entry),
+                average_length_);
+  };
+  // min-heap on the score, a later entry losing ties
+  auto worse = [](const scored_entry &a, const scored_entry &b) {
+    return a.score != b.score ? a.score > b.score : a.entry < b.entry;
+  };
+  std::vector<scored_entry> heap;
+  float threshold = 0;
+  size_t essential = 0;
+  while (essential < lists.size()) {
+    uint32_t entry = UINT32_MAX;
+    for (size_t i = essential; i < lists.size(); ++i) {
+      const list &l = lists[i];
+      if (l.pos < l.entries.size()) entry = std::min(entry, l.entries[l.pos]);
+    }
+    if (entry == UINT32_MAX) break;
+
+    float score = 0;
+    for (size_t i = essential; i < lists.size(); ++i) {
+      list &l = lists[i];
+      if (l.pos < l.entries.size() && l.entries[l.pos] == entry) {
+        score += score_at(l, entry);
+        l.pos++;
+      }
+    }
+    for (size_t i = essential; i-- > 0;) {
+      // entries come in increasing order, so an equal score loses too
+      if (heap.size() == k && score + bound_sum[i] <= threshold) break;
+      list &l = lists[i];
+      l.pos = std::lower_bound(l.entries.begin() + l.pos, l.entries.end(), entry) -
+              l.entries.begin();
+      if (l.pos < l.entries.size() && l.entries[l.pos] == entry) {
+        score += score_at(l, entry);
+        l.pos++;
+      }
+    }
+
+    if (heap.size() < k) {
+      heap.push_back({entry, score});
+      std::push_heap(heap.begin(), heap.end(), worse);
+    } else if (score > threshold) {
+      std::pop_heap(heap.begin(), heap.end(), worse);
+      heap.back() = {entry, score};
+      std::push_heap(heap.begin(), heap.end(), worse);
+    }
+    if (heap.size() == k) {
+      threshold = heap.front().score;
+      while (essential < lists.size() && bound_sum[essential] <= threshold) {
+        essential++;
+      }
+    }
+  }
+
+  std::sort_heap(heap.begin(), heap.end(), worse);
+  return heap;
+}
+
+}  // namespace mdict
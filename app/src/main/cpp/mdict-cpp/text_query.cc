@@ -0,0 +1,450 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/text_query.h"
+
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <stdexcept>
+
+#include "include/html_text.h"
+
+namespace mdict {
+
+/***************************************
+ *               parser                *
+ ***************************************/
+
+static inline bool is_query_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+text_query::text_query(const std::string &query, size_t context)
+    : text_(query), context_(context) {
+  root_ = parse_or();
+  // stray closing parentheses: keep parsing what follows
+  while (peek() != TOK_END) {
+    advance();
+    int rest = parse_or();
+    if (rest < 0) continue;
+    if (root_ < 0) {
+      root_ = rest;
+    } else {
+      nodes_.push_back({OP_AND, 0, {root_, rest}});
+      root_ = (int)nodes_.size() - 1;
+    }
+  }
+  finish();
+}
+
+text_query text_query::all_of(
+    const std::vector<std::vector<std::u32string>> &clauses, size_t context) {
+  text_query q(context);
+  for (const auto &clause : clauses) {
+    // an empty alternative satisfies the clause by itself
+    if (std::find(clause.begin(), clause.end(), std::u32string()) != clause.end()) {
+      continue;
+    }
+    int any = -1;
+    for (const auto &literal : clause) {
+      int t = q.add_folded_term(literal);
+      if (t < 0) continue;
+      if (any < 0) {
+        any = t;
+      } else {
+        q.nodes_.push_back({OP_OR, 0, {any, t}});
+        any = (int)q.nodes_.size() - 1;
+      }
+    }
+    if (any < 0) continue;
+    if (q.root_ < 0) {
+      q.root_ = any;
+    } else {
+      q.nodes_.push_back({OP_AND, 0, {q.root_, any}});
+      q.root_ = (int)q.nodes_.size() - 1;
+    }
+  }
+  q.finish();
+  return q;
+}
+
+void text_query::finish() {
+  if (root_ >= 0) {
+    mark_positive(root_, false);
+    build_automaton();
+  }
+}
+
+text_query::token_t text_query::peek() {
+  if (tok_ready_) return tok_;
+  tok_ready_ = true;
+  tok_text_.clear();
+  while (pos_ < text_.size() && is_query_space(text_[pos_])) ++pos_;
+  if (pos_ >= text_.size()) return tok_ = TOK_END;
+
+  char c = text_[pos_];
+  if (c == '(') {
+    ++pos_;
+    return tok_ = TOK_LPAREN;
+  }
+  if (c == ')') {
+    ++pos_;
+    return tok_ = TOK_RPAREN;
+  }
+  if (c == '|') {
+    ++pos_;
+    return tok_ = TOK_OR;
+  }
+  if (c == '-' && pos_ + 1 < text_.size() && !is_query_space(text_[pos_ + 1])) {
+    ++pos_;
+    return tok_ = TOK_NOT;
+  }
+  if (c == '"') {
+    // an unterminated phrase runs to the end of the query
+    size_t close = text_.find('"', pos_ + 1);
+    size_t stop = close == std::string::npos ? text_.size() : close;
+    tok_text_ = text_.substr(pos_ + 1, stop - pos_ - 1);
+    pos_ = close == std::string::npos ? text_.size() : close + 1;
+    return tok_ = TOK_PHRASE;
+  }
+  size_t start = pos_;
+  while (pos_ < text_.size() && !is_query_space(text_[pos_]) &&
+         text_[pos_] != '(' && text_[pos_] != ')' && text_[pos_] != '"') {
+    ++pos_;
+  }
+  tok_text_ = text_.substr(start, pos_ - start);
+  if (tok_text_ == "AND") return tok_ = TOK_AND;
+  if (tok_text_ == "OR") return tok_ = TOK_OR;
+  if (tok_text_ == "NOT") return tok_ = TOK_NOT;
+  return tok_ = TOK_WORD;
+}
+
+void text_query::advance() {
+  peek();
+  tok_ready_ = false;
+}
+
+int text_query::parse_or() {
+  int left = parse_and();
+  while (peek() == TOK_OR) {
+    advance();
+    int right = parse_and();
+    if (right < 0) continue;
+    if (left < 0) {
+      left = right;
+      continue;
+    }
+    nodes_.push_back({OP_OR, 0, {left, right}});
+    left = (int)nodes_.size() - 1;
+  }
+  return left;
+}
+
+int text_query::parse_and() {
+  int left = -1;
+  for (;;) {
+    token_t t = peek();
+    if (t == TOK_AND) {
+      advance();
+      continue;
+    }
+    if (t == TOK_END || t == TOK_OR || t == TOK_RPAREN) break;
+    int right = parse_unary();
+    if (right < 0) continue;
+    if (left < 0) {
+      left = right;
+    } else {
+      nodes_.push_back({OP_AND, 0, {left, right}});
+      left = (int)nodes_.size() - 1;
+    }
+  }
+  return left;
+}
+
+int text_query::parse_unary() {
+  token_t t = peek();
+  if (t == TOK_NOT) {
+    advance();
+    int operand = parse_unary();
+    if (operand < 0) return -1;
+    nodes_.push_back({OP_NOT, 0, {operand}});
+    has_not_ = true;
+    return (int)nodes_.size() - 1;
+  }
+  if (t == TOK_LPAREN) {
+    advance();
+    int inner = parse_or();
+    if (peek() == TOK_RPAREN) advance();
+    return inner;
+  }
+  advance();
+  if (t == TOK_WORD || t == TOK_PHRASE) return add_term(tok_text_);
+  return -1;
+}
+
+int text_query::add_term(const std::string &text) {
+  std::u32string folded;
+  fold_text(text, folded);
+  return add_folded_term(folded);
+}
+
+int text_query::add_folded_term(const std::u32string &folded) {
+  if (folded.empty()) return -1;
+  size_t id = std::find(terms_.begin(), terms_.end(), folded) - terms_.begin();
+  if (id == terms_.size()) {
+    if (terms_.size() == MAX_TERMS) {
+      throw std::invalid_argument("too many terms in full-text query");
+    }
+    terms_.push_back(folded);
+  }
+  nodes_.push_back({OP_TERM, id, {}});
+  return (int)nodes_.size() - 1;
+}
+
+void text_query::mark_positive(int n, bool negated) {
+  const node &nd = nodes_[n];
+  if (nd.op == OP_TERM) {
+    if (!negated) positive_ |= 1ull << nd.term;
+    return;
+  }
+  for (int kid : nd.kids) mark_positive(kid, negated != (nd.op == OP_NOT));
+}
+
+/***************************************
+ *             evaluation              *
+ ***************************************/
+
+bool text_query::eval(int n, uint64_t seen) const {
+  const node &nd = nodes_[n];
+  switch (nd.op) {
+    case OP_TERM:
+      return (seen >> nd.term) & 1;
+    case OP_AND:
+      return eval(nd.kids[0], seen) && eval(nd.kids[1], seen);
+    case OP_OR:
+      return eval(nd.kids[0], seen) || eval(nd.kids[1], seen);
+    case OP_NOT:
+      return !eval(nd.kids[0], seen);
+  }
+  return false;
+}
+
+bool text_query::eval_may(int n, const std::function<bool(size_t)> &may) const {
+  const node &nd = nodes_[n];
+  switch (nd.op) {
+    case OP_TERM:
+      return may(nd.term);
+    case OP_AND:
+      return eval_may(nd.kids[0], may) && eval_may(nd.kids[1], may);
+    case OP_OR:
+      return eval_may(nd.kids[0], may) || eval_may(nd.kids[1], may);
+    case OP_NOT:
+      return true;
+  }
+  return true;
+}
+
+bool text_query::may_match(const std::function<bool(size_t)> &term_may_occur) const {
+  return root_ < 0 || eval_may(root_, term_may_occur);
+}
+
+text_query::candidate_set text_query::eval_candidates(
+    int n,
+    const std::function<bool(size_t, std::vector<uint32_t> &)> &postings) const {
+  const node &nd = nodes_[n];
+  candidate_set result;
+  switch (nd.op) {
+    case OP_TERM:
+      result.all = !postings(nd.term, result.ids);
+      if (result.all) result.ids.clear();
+      break;
+    case OP_AND: {
+      candidate_set a = eval_candidates(nd.kids[0], postings);
+      candidate_set b = eval_candidates(nd.kids[1], postings);
+      if (a.all) return b;
+      if (b.all) return a;
+      result.all = false;
+      std::set_intersection(a.ids.begin(), a.ids.end(), b.ids.begin(),
+                            b.ids.end(), std::back_inserter(result.ids));
+      break;
+    }
+    case OP_OR: {
+      candidate_set a = eval_candidates(nd.kids[0], postings);
+      if (a.all) return a;
+      candidate_set b = eval_candidates(nd.kids[1], postings);
+      if (b.all) return b;
+      result.all = false;
+      std::set_union(a.ids.begin(), a.ids.end(), b.ids.begin(), b.ids.end(),
+                     std::back_inserter(result.ids));
+      break;
+    }
+    case OP_NOT:
+      // absence cannot be read from postings of substrings
+      break;
+  }
+  return result;
+}
+
+bool text_query::candidates(
+    const std::function<bool(size_t, std::vector<uint32_t> &)> &postings,
+    std::vector<uint32_t> &entries) const {
+  entries.clear();
+  if (root_ < 0) return false;
+  candidate_set set = eval_candidates(root_, postings);
+  if (set.all) return false;
+  entries.swap(set.ids);
+  return true;
+}
+
+/***************************************
+ *       Aho-Corasick automaton        *
+ ***************************************/
+
+void text_query::build_automaton() {
+  fail_.assign(1, 0);
+  out_.assign(1, 0);
+  for (size_t t = 0; t < terms_.size(); ++t) {
+    uint32_t s = 0;
+    for (char32_t c : terms_[t]) {
+      auto it = goto_.find(edge(s, c));
+      if (it == goto_.end()) {
+        uint32_t next = (uint32_t)fail_.size();
+        fail_.push_back(0);
+        out_.push_back(0);
+        goto_.emplace(edge(s, c), next);
+        s = next;
+      } else {
+        s = it->second;
+      }
+    }
+    out_[s] |= 1ull << t;
+  }
+
+  // breadth first: a state's failure link is the longest proper suffix
+  // that is also a trie path, outputs are inherited along it
+  std::vector<std::vector<std::pair<char32_t, uint32_t>>> children(fail_.size());
+  for (const auto &kv : goto_) {
+    children[kv.first >> 21].push_back({(char32_t)(kv.first & 0x1FFFFF), kv.second});
+  }
+  std::deque<uint32_t> queue;
+  for (const auto &ch : children[0]) queue.push_back(ch.second);
+  while (!queue.empty()) {
+    uint32_t s = queue.front();
+    queue.pop_front();
+    out_[s] |= out_[fail_[s]];
+    for (const auto &ch : children[s]) {
+      uint32_t f = fail_[s];
+      for (;;) {
+        auto it = goto_.find(edge(f, ch.first));
+        if (it != goto_.end() && it->second != ch.second) {
+          fail_[ch.second] = it->second;
+          break;
+        }
+        if (f == 0) {
+          fail_[ch.second] = 0;
+          break;
+        }
+        f = fail_[f];
+      }
+      queue.push_back(ch.second);
+    }
+  }
+}
+
+uint32_t text_query::step(uint32_t state, char32_t c) const {
+  for (;;) {
+    auto it = goto_.find(edge(state, c));
+    if (it != goto_.end()) return it->second;
+    if (state == 0) return 0;
+    state = fail_[state];
+  }
+}
+
+/***************************************
+ *               search                *
+ ***************************************/
+
+static uint32_t utf16_length(const char32_t *p, size_t n) {
+  uint32_t len = 0;
+  for (size_t i = 0; i < n; ++i) len += p[i] >= 0x10000 ? 2 : 1;
+  return len;
+}
+
+void make_snippet(const std::u32string &text, size_t begin, size_t end,
+                  size_t context, bool cut_short, text_match &match) {
+  size_t from = begin > context ? begin - context : 0;
+  size_t to = std::min(text.size(), end + context);
+  if (end == 0) to = std::min(text.size(), 2 * context);
+  // do not start or end a snippet in the middle of a space run
+  while (from < begin && text[from] == ' ') ++from;
+  while (to > end && text[to - 1] == ' ') --to;
+
+  match.snippet.clear();
+  uint32_t prefix = 0;
+  if (from > 0) {
+    append_utf8(match.snippet, 0x2026);  // ellipsis
+    prefix = 1;
+  }
+  for (size_t i = from; i < to; ++i) append_utf8(match.snippet, text[i]);
+  if (cut_short || to < text.size()) append_utf8(match.snippet, 0x2026);
+  match.match_start = prefix + utf16_length(text.data() + from, begin - from);
+  match.match_end = match.match_start + utf16_length(text.data() + begin, end - begin);
+}
+
+bool text_query::find(const char *data, size_t len, text_match *match) {
+  if (root_ < 0) return false;
+  const uint64_t all = terms_.size() == 64 ? ~0ull : (1ull << terms_.size()) - 1;
+  shown_.clear();
+  uint32_t state = 0;
+  uint64_t seen = 0;
+  size_t anchor_begin = 0, anchor_end = 0;  // anchor_end 0: no anchor yet
+  bool decided = false;
+  bool cut_short = false;
+
+  walk_html(data, len, [&](char32_t c) {
+    if (decided && shown_.size() >= anchor_end + context_) {
+      // enough trailing context, the rest of the record is never decoded
+      cut_short = true;
+      return false;
+    }
+    shown_.push_back(c);
+    if (decided) return true;
+    state = step(state, fold_char(c));
+    uint64_t hits = out_[state];
+    if (!hits) return true;
+    seen |= hits;
+    uint64_t anchors = hits & positive_;
+    if (!anchor_end && anchors) {
+      // snippet around the first occurrence of a wanted term
+      size_t t = 0;
+      while (!((anchors >> t) & 1)) ++t;
+      anchor_end = shown_.size();
+      anchor_begin = anchor_end - terms_[t].size();
+    }
+    // the outcome cannot change any more once every term was seen, or when
+    // nothing is excluded and the expression already holds
+    if (seen == all || (!has_not_ && eval(root_, seen))) {
+      decided = true;
+      if (!anchor_end) anchor_end = shown_.size();
+      return match != nullptr && context_ > 0;
+    }
+    return true;
+  });
+  if (!eval(root_, seen)) return false;
+  if (!match) return true;
+
+  if (!(positive_ & seen)) {
+    // matched by exclusion only: show the start of the text
+    anchor_begin = anchor_end = 0;
+  }
+  make_snippet(shown_, anchor_begin, anchor_end, context_, cut_short, *match);
+  return true;
+}
+
+}  // namespace mdict
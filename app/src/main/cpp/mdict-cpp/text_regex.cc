@@ -0,0 +1,762 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/text_regex.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <wctype.h>
+
+#include "include/html_text.h"
+
+namespace mdict {
+
+// before the first and after the last character
+static const char32_t NO_CHAR = 0x110000;
+// program size and repetition limits, a pattern beyond them is rejected
+static const size_t MAX_PROGRAM = 20000;
+static const int MAX_REPEAT = 1000;
+static const int MAX_DEPTH = 200;
+// largest literal set tracked by the prefilter analysis
+static const size_t MAX_LITERAL_SET = 16;
+
+/***************************************
+ *               parser                *
+ ***************************************/
+
+struct text_regex::ast {
+  enum kind_t { EMPTY, CHAR, ANY, CLASS, CAT, ALT, REPEAT, ASSERT };
+  kind_t kind = EMPTY;
+  char32_t c = 0;
+  uint32_t cls = 0;
+  op_t assertion = I_BOL;
+  int min = 0, max = 0;  // max -1: unbounded
+  bool greedy = true;
+  std::vector<ast> kids;
+};
+
+struct text_regex::parser {
+  text_regex &re;
+  std::u32string p;
+  size_t i = 0;
+  int depth = 0;
+
+  parser(text_regex &owner, const std::string &pattern) : re(owner) {
+    auto *s = reinterpret_cast<const unsigned char *>(pattern.data());
+    auto *end = s + pattern.size();
+    while (s < end) {
+      char32_t cp;
+      s += decode_utf8(s, end, cp);
+      p.push_back(cp);
+    }
+  }
+
+  [[noreturn]] void fail(const char *what) const {
+    throw std::invalid_argument(std::string("regex: ") + what);
+  }
+
+  bool more() const { return i < p.size(); }
+
+  ast parse() {
+    ast root = parse_alt();
+    if (more()) fail("unmatched )");
+    return root;
+  }
+
+  ast parse_alt() {
+    if (++depth > MAX_DEPTH) fail("pattern nested too deeply");
+    ast node;
+    node.kind = ast::ALT;
+    node.kids.push_back(parse_cat());
+    while (more() && p[i] == '|') {
+      ++i;
+      node.kids.push_back(parse_cat());
+    }
+    --depth;
+    if (node.kids.size() == 1) return std::move(node.kids[0]);
+    return node;
+  }
+
+  ast parse_cat() {
+    ast node;
+    node.kind = ast::CAT;
+    while (more() && p[i] != '|' && p[i] != ')') node.kids.push_back(parse_repeat());
+    if (node.kids.empty()) return ast();
+    if (node.kids.size() == 1) return std::move(node.kids[0]);
+    return node;
+  }
+
+  // {m}, {m,} or {m,n} at i, false (and i unchanged) if it is not one
+  bool parse_braces(int &min, int &max) {
+    size_t j = i + 1;
+    auto number = [&](int &out) {
+      size_t start = j;
+      long v = 0;
+      while (j < p.size() && p[j] >= '0' && p[j] <= '9') {
+        v = std::min<long>(v * 10 + (p[j] - '0'), MAX_REPEAT + 1);
+        ++j;
+      }
+      out = (int)v;
+      return j > start;
+    };
+    if (!number(min)) return false;
+    max = min;
+    if (j < p.size() && p[j] == ',') {
+      ++j;
+      if (!number(max)) max = -1;
+    }
+    if (j >= p.size() || p[j] != '}') return false;
+    i = j + 1;
+    return true;
+  }
+
+  bool at_quantifier() {
+    if (!more()) return false;
+    if (p[i] == '*' || p[i] == '+' || p[i] == '?') return true;
+    if (p[i] != '{') return false;
+    size_t saved = i;
+    int min, max;
+    bool ok = parse_braces(min, max);
+    i = saved;
+    return ok;
+  }
+
+  ast parse_repeat() {
+    ast atom = parse_atom();
+    if (!at_quantifier()) return atom;
+    if (atom.kind == ast::ASSERT) fail("nothing to repeat");
+    ast node;
+    node.kind = ast::REPEAT;
+    char32_t q = p[i];
+    if (q == '*') {
+      node.min = 0, node.max = -1, ++i;
+    } else if (q == '+') {
+      node.min = 1, node.max = -1, ++i;
+    } else if (q == '?') {
+      node.min = 0, node.max = 1, ++i;
+    } else {
+      parse_braces(node.min, node.max);
+      if (node.min > MAX_REPEAT || node.max > MAX_REPEAT) fail("repetition too large");
+      if (node.max >= 0 && node.max < node.min) fail("numbers out of order in {}");
+    }
+    if (more() && p[i] == '?') {
+      node.greedy = false;
+      ++i;
+    }
+    if (at_quantifier()) fail("nothing to repeat");
+    node.kids.push_back(std::move(atom));
+    return node;
+  }
+
+  char32_t parse_hex(size_t digits) {
+    char32_t v = 0;
+    for (size_t k = 0; k < digits; ++k) {
+      if (!more() || !iswxdigit(p[i])) fail("bad hex escape");
+      char32_t d = p[i++];
+      v = v * 16 + (d <= '9' ? d - '0' : (d | 0x20) - 'a' + 10);
+    }
+    return v;
+  }
+
+  // escape after '\', for a class item when in_class; returns false and sets
+  // named / named_neg for \d \w \s and their negations
+  bool parse_escape(char32_t &c, uint8_t &named, uint8_t &named_neg, bool in_class) {
+    if (!more()) fail("trailing backslash");
+    char32_t e = p[i++];
+    named = named_neg = 0;
+    switch (e) {
+      case 'd': named = NAMED_DIGIT; return false;
+      case 'w': named = NAMED_WORD; return false;
+      case 's': named = NAMED_SPACE; return false;
+      case 'D': named_neg = NAMED_DIGIT; return false;
+      case 'W': named_neg = NAMED_WORD; return false;
+      case 'S': named_neg = NAMED_SPACE; return false;
+      case 'n': c = '\n'; return true;
+      case 't': c = '\t'; return true;
+      case 'r': c = '\r'; return true;
+      case 'f': c = '\f'; return true;
+      case 'v': c = '\v'; return true;
+      case '0': c = 0; return true;
+      case 'b':
+        if (in_class) {
+          c = '\b';
+          return true;
+        }
+        break;
+      case 'x': c = parse_hex(2); return true;
+      case 'u':
+        if (more() && p[i] == '{') {
+          ++i;
+          c = 0;
+          while (more() && p[i] != '}') {
+            c = c * 16 + parse_hex(1);
+            if (c > 0x10FFFF) fail("bad unicode escape");
+          }
+          if (!more()) fail("bad unicode escape");
+          ++i;
+        } else {
+          c = parse_hex(4);
+        }
+        return true;
+      case 'k':
+        fail("backreferences are not supported");
+      default:
+        if (e >= '1' && e <= '9') fail("backreferences are not supported");
+        c = e;
+        return true;
+    }
+    c = e;
+    return true;
+  }
+
+  ast parse_class() {
+    char_class cls;
+    if (more() && p[i] == '^') {
+      cls.negate = true;
+      ++i;
+    }
+    for (;;) {
+      if (!more()) fail("missing ]");
+      if (p[i] == ']') {
+        ++i;
+        break;
+      }
+      char32_t lo;
+      uint8_t named = 0, named_neg = 0;
+      if (p[i] == '\\') {
+        ++i;
+        if (!parse_escape(lo, named, named_neg, true)) {
+          cls.named |= named;
+          cls.named_neg |= named_neg;
+          continue;
+        }
+      } else {
+        lo = p[i++];
+      }
+      char32_t hi = lo;
+      if (i + 1 < p.size() && p[i] == '-' && p[i + 1] != ']') {
+        size_t saved = i++;
+        if (p[i] == '\\') {
+          ++i;
+          if (!parse_escape(hi, named, named_neg, true)) {
+            // [a-\d] is a, '-' and digits
+            i = saved;
+            hi = lo;
+          }
+        } else {
+          hi = p[i++];
+        }
+        if (hi < lo) fail("range out of order in character class");
+      }
+      cls.ranges.push_back({lo, hi});
+    }
+    ast node;
+    node.kind = ast::CLASS;
+    node.cls = (uint32_t)re.classes_.size();
+    re.classes_.push_back(std::move(cls));
+    return node;
+  }
+
+  ast parse_atom() {
+    ast node;
+    char32_t c = p[i++];
+    switch (c) {
+      case '(': {
+        if (more() && p[i] == '?') {
+          if (i + 1 < p.size() && p[i + 1] == ':') {
+            i += 2;
+          } else if (i + 2 < p.size() && p[i + 1] == '<' && p[i + 2] != '=' &&
+                     p[i + 2] != '!') {
+            // named group, captures are not reported so it is a plain group
+            while (more() && p[i] != '>') ++i;
+            if (!more()) fail("bad group name");
+            ++i;
+          } else {
+            fail("lookarounds are not supported");
+          }
+        }
+        node = parse_alt();
+        if (!more() || p[i] != ')') fail("missing )");
+        ++i;
+        return node;
+      }
+      case '[':
+        return parse_class();
+      case '.':
+        node.kind = ast::ANY;
+        return node;
+      case '^':
+        node.kind = ast::ASSERT;
+        node.assertion = I_BOL;
+        return node;
+      case '$':
+        node.kind = ast::ASSERT;
+        node.assertion = I_EOL;
+        return node;
+      case '*':
+      case '+':
+      case '?':
+        fail("nothing to repeat");
+      case '{': {
+        --i;
+        if (at_quantifier()) fail("nothing to repeat");
+        ++i;
+        break;
+      }
+      case '\\': {
+        uint8_t named, named_neg;
+        if (more() && (p[i] == 'b' || p[i] == 'B')) {
+          node.kind = ast::ASSERT;
+          node.assertion = p[i++] == 'b' ? I_WORDB : I_NWORDB;
+          return node;
+        }
+        if (!parse_escape(c, named, named_neg, false)) {
+          char_class cls;
+          cls.named = named;
+          cls.named_neg = named_neg;
+          node.kind = ast::CLASS;
+          node.cls = (uint32_t)re.classes_.size();
+          re.classes_.push_back(std::move(cls));
+          return node;
+        }
+        break;
+      }
+      default:
+        break;
+    }
+    node.kind = ast::CHAR;
+    node.c = c;
+    return node;
+  }
+};
+
+/***************************************
+ *              compiler               *
+ ***************************************/
+
+uint32_t text_regex::emit(op_t op, char32_t c, uint32_t x, uint32_t y) {
+  if (prog_.size() >= MAX_PROGRAM) throw std::invalid_argument("regex: pattern too large");
+  prog_.push_back({op, c, x, y});
+  return (uint32_t)prog_.size() - 1;
+}
+
+void text_regex::compile(const ast &node) {
+  switch (node.kind) {
+    case ast::EMPTY:
+      break;
+    case ast::CHAR:
+      emit(I_CHAR, icase_ ? fold_char(node.c) : node.c);
+      break;
+    case ast::ANY:
+      emit(I_ANY);
+      break;
+    case ast::CLASS:
+      emit(I_CLASS, 0, node.cls);
+      break;
+    case ast::ASSERT:
+      emit(node.assertion);
+      break;
+    case ast::CAT:
+      for (const ast &kid : node.kids) compile(kid);
+      break;
+    case ast::ALT: {
+      std::vector<uint32_t> exits;
+      for (size_t k = 0; k < node.kids.size(); ++k) {
+        if (k + 1 == node.kids.size()) {
+          compile(node.kids[k]);
+          break;
+        }
+        uint32_t split = emit(I_SPLIT);
+        prog_[split].x = split + 1;
+        compile(node.kids[k]);
+        exits.push_back(emit(I_JMP));
+        prog_[split].y = (uint32_t)prog_.size();
+      }
+      for (uint32_t j : exits) prog_[j].x = (uint32_t)prog_.size();
+      break;
+    }
+    case ast::REPEAT: {
+      const ast &kid = node.kids[0];
+      for (int k = 0; k < node.min; ++k) compile(kid);
+      // the preferred branch of a split is x: continue repeating when
+      // greedy, leave when lazy
+      auto branch = [&](uint32_t split, uint32_t body, uint32_t out) {
+        prog_[split].x = node.greedy ? body : out;
+        prog_[split].y = node.greedy ? out : body;
+      };
+      if (node.max < 0) {
+        uint32_t split = emit(I_SPLIT);
+        compile(kid);
+        emit(I_JMP, 0, split);
+        branch(split, split + 1, (uint32_t)prog_.size());
+      } else {
+        std::vector<uint32_t> splits;
+        for (int k = node.min; k < node.max; ++k) {
+          splits.push_back(emit(I_SPLIT));
+          compile(kid);
+        }
+        for (uint32_t split : splits) branch(split, split + 1, (uint32_t)prog_.size());
+      }
+      break;
+    }
+  }
+}
+
+/***************************************
+ *         literal prefilters          *
+ ***************************************/
+
+struct text_regex::literal_info {
+  // the node matches exactly one string of set
+  bool exact = false;
+  std::vector<std::u32string> set;
+  // otherwise: every match contains one string of each clause
+  std::vector<std::vector<std::u32string>> required;
+};
+
+static void add_clause(std::vector<std::vector<std::u32string>> &clauses,
+                       const std::vector<std::u32string> &set) {
+  if (set.empty()) return;
+  for (const auto &s : set) {
+    if (s.empty()) return;
+  }
+  clauses.push_back(set);
+}
+
+// concatenations of every pair, empty if there would be too many
+static std::vector<std::u32string> cross(const std::vector<std::u32string> &a,
+                                         const std::vector<std::u32string> &b) {
+  std::vector<std::u32string> out;
+  if (a.size() * b.size() > MAX_LITERAL_SET) return out;
+  for (const auto &x : a) {
+    for (const auto &y : b) out.push_back(x + y);
+  }
+  std::sort(out.begin(), out.end());
+  out.erase(std::unique(out.begin(), out.end()), out.end());
+  return out;
+}
+
+text_regex::literal_info text_regex::literals(const ast &node) const {
+  literal_info info;
+  switch (node.kind) {
+    case ast::EMPTY:
+    case ast::ASSERT:
+      info.exact = true;
+      info.set.push_back(U"");
+      break;
+    case ast::CHAR:
+      info.exact = true;
+      info.set.push_back(std::u32string(1, fold_char(node.c)));
+      break;
+    case ast::ANY:
+      break;
+    case ast::CLASS: {
+      // small positive classes ([sz], [aeiou]) are alternatives
+      const char_class &cls = classes_[node.cls];
+      if (cls.negate || cls.named || cls.named_neg) break;
+      std::vector<std::u32string> set;
+      for (const auto &r : cls.ranges) {
+        if (r.second - r.first >= MAX_LITERAL_SET) return info;
+        for (char32_t c = r.first; c <= r.second; ++c) {
+          set.push_back(std::u32string(1, fold_char(c)));
+        }
+      }
+      std::sort(set.begin(), set.end());
+      set.erase(std::unique(set.begin(), set.end()), set.end());
+      if (set.empty() || set.size() > MAX_LITERAL_SET) break;
+      info.exact = true;
+      info.set = std::move(set);
+      break;
+    }
+    case ast::CAT: {
+      // runs of exact nodes concatenate into longer literals
+      std::vector<std::u32string> run{U""};
+      info.exact = true;
+      for (const ast &kid : node.kids) {
+        literal_info k = literals(kid);
+        if (k.exact) {
+          std::vector<std::u32string> joined = cross(run, k.set);
+          if (joined.empty()) {
+            add_clause(info.required, run);
+            info.exact = false;
+            run = k.set;
+          } else {
+            run = std::move(joined);
+          }
+          continue;
+        }
+        info.exact = false;
+        const literal_info *inner = nullptr;
+        literal_info repeated;
+        if (kid.kind == ast::REPEAT && kid.min >= 1) {
+          repeated = literals(kid.kids[0]);
+          if (repeated.exact) inner = &repeated;
+        }
+        if (inner) {
+          // x+ both ends and starts with x
+          if (run.size() > 1 || !run[0].empty()) {
+            std::vector<std::u32string> joined = cross(run, inner->set);
+            add_clause(info.required, joined.empty() ? run : joined);
+          }
+          run = inner->set;
+        } else {
+          add_clause(info.required, run);
+          info.required.insert(info.required.end(), k.required.begin(), k.required.end());
+          run.assign(1, U"");
+        }
+      }
+      if (info.exact) {
+        info.set = std::move(run);
+      } else {
+        add_clause(info.required, run);
+      }
+      break;
+    }
+    case ast::ALT: {
+      std::vector<literal_info> kids;
+      bool all_exact = true;
+      for (const ast &kid : node.kids) {
+        kids.push_back(literals(kid));
+        all_exact = all_exact && kids.back().exact;
+      }
+      // a match contains the best clause of the branch it took
+      std::vector<std::u32string> any;
+      for (const literal_info &k : kids) {
+        const std::vector<std::u32string> *best = k.exact ? &k.set : nullptr;
+        size_t best_len = 0;
+        for (const auto &clause : k.required) {
+          size_t len = SIZE_MAX;
+          for (const auto &s : clause) len = std::min(len, s.size());
+          if (!best || len > best_len) {
+            best = &clause;
+            best_len = len;
+          }
+        }
+        if (!best) {
+          any.clear();
+          all_exact = false;
+          break;
+        }
+        any.insert(any.end(), best->begin(), best->end());
+      }
+      std::sort(any.begin(), any.end());
+      any.erase(std::unique(any.begin(), any.end()), any.end());
+      if (any.size() > MAX_LITERAL_SET) break;
+      if (all_exact) {
+        info.exact = true;
+        info.set = std::move(any);
+      } else {
+        add_clause(info.required, any);
+      }
+      break;
+    }
+    case ast::REPEAT: {
+      literal_info k = literals(node.kids[0]);
+      if (node.min == 0) {
+        if (node.max == 1 && k.exact && k.set.size() < MAX_LITERAL_SET) {
+          info.exact = true;
+          info.set = std::move(k.set);
+          info.set.push_back(U"");
+        }
+        break;
+      }
+      if (k.exact && node.min == node.max) {
+        std::vector<std::u32string> run{U""};
+        for (int n = 0; n < node.min && !run.empty(); ++n) run = cross(run, k.set);
+        if (!run.empty()) {
+          info.exact = true;
+          info.set = std::move(run);
+          break;
+        }
+      }
+      if (k.exact) {
+        add_clause(info.required, k.set);
+      } else {
+        info.required = std::move(k.required);
+      }
+      break;
+    }
+  }
+  return info;
+}
+
+text_regex::text_regex(const std::string &pattern, bool icase, size_t context)
+    : icase_(icase), context_(context) {
+  parser ps(*this, pattern);
+  ast root = ps.parse();
+  compile(root);
+  emit(I_MATCH);
+  mark_.assign(prog_.size(), 0);
+
+  // keep the prefilter within what a text_query can hold, dropping clauses
+  // only makes it weaker
+  literal_info info = literals(root);
+  if (info.exact) {
+    required_.push_back(info.set);
+  } else {
+    required_ = std::move(info.required);
+  }
+  size_t total = 0;
+  auto fits = [&](const std::vector<std::u32string> &clause) {
+    total += clause.size();
+    return total <= text_query::MAX_TERMS;
+  };
+  required_.erase(std::stable_partition(required_.begin(), required_.end(), fits),
+                  required_.end());
+}
+
+/***************************************
+ *               matcher               *
+ ***************************************/
+
+bool text_regex::is_word(char32_t c) {
+  if (c == NO_CHAR) return false;
+  if (c < 0x80) {
+    return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || c == '_';
+  }
+  // letters of other scripts, minus spaces and punctuation blocks
+  return !html_is_space(c) && !(c >= 0x2000 && c <= 0x206F) &&
+         !(c >= 0x3000 && c <= 0x303F) && !(c >= 0xFF00 && c <= 0xFF0F);
+}
+
+bool text_regex::class_matches(const char_class &cls, char32_t c) const {
+  auto test = [&cls](char32_t ch) {
+    for (const auto &r : cls.ranges) {
+      if (ch >= r.first && ch <= r.second) return true;
+    }
+    auto in_named = [ch](uint8_t set) {
+      return ((set & NAMED_DIGIT) && ch >= '0' && ch <= '9') ||
+             ((set & NAMED_WORD) && is_word(ch)) ||
+             ((set & NAMED_SPACE) && html_is_space(ch));
+    };
+    if (in_named(cls.named)) return true;
+    if (cls.named_neg) {
+      for (uint8_t bit = 1; bit <= NAMED_SPACE; bit <<= 1) {
+        if ((cls.named_neg & bit) && !in_named(bit)) return true;
+      }
+    }
+    return false;
+  };
+  bool hit = test(c);
+  if (!hit && icase_) {
+    char32_t lower = fold_char(c);
+    char32_t upper = (char32_t)towupper((wint_t)c);
+    hit = (lower != c && test(lower)) || (upper != c && test(upper));
+  }
+  return hit != cls.negate;
+}
+
+bool text_regex::char_matches(const inst &in, char32_t c) const {
+  switch (in.op) {
+    case I_CHAR:
+      return (icase_ ? fold_char(c) : c) == in.c;
+    case I_ANY:
+      return true;
+    case I_CLASS:
+      return class_matches(classes_[in.x], c);
+    default:
+      return false;
+  }
+}
+
+void text_regex::add_thread(std::vector<thread> &list, uint32_t pc, uint32_t start,
+                            char32_t prev, char32_t cur) {
+  // depth first in priority order, marking on pop keeps x ahead of y
+  stack_.clear();
+  stack_.push_back(pc);
+  while (!stack_.empty()) {
+    pc = stack_.back();
+    stack_.pop_back();
+    if (mark_[pc] == generation_) continue;
+    mark_[pc] = generation_;
+    const inst &in = prog_[pc];
+    switch (in.op) {
+      case I_JMP:
+        stack_.push_back(in.x);
+        break;
+      case I_SPLIT:
+        stack_.push_back(in.y);
+        stack_.push_back(in.x);
+        break;
+      case I_BOL:
+        if (prev == NO_CHAR) stack_.push_back(pc + 1);
+        break;
+      case I_EOL:
+        if (cur == NO_CHAR) stack_.push_back(pc + 1);
+        break;
+      case I_WORDB:
+        if (is_word(prev) != is_word(cur)) stack_.push_back(pc + 1);
+        break;
+      case I_NWORDB:
+        if (is_word(prev) == is_word(cur)) stack_.push_back(pc + 1);
+        break;
+      default:
+        list.push_back({pc, start});
+        break;
+    }
+  }
+}
+
+bool text_regex::find(const char *data, size_t len, text_match *match) {
+  shown_.clear();
+  next_.clear();
+  bool found = false;
+  bool done = false;
+  bool cut_short = false;
+  size_t match_begin = 0, match_end = 0;
+  char32_t prev = NO_CHAR;
+  // a pattern that must start at the beginning gets a single start thread
+  const bool anchored = prog_[0].op == I_BOL;
+
+  // one step of the simulation at position pos, with c the character there
+  // (NO_CHAR at the end); threads in next_ wait for their epsilon closure
+  // until the character after them is known, for $ and \b
+  auto step = [&](char32_t c, uint32_t pos) {
+    if (++generation_ == 0) {
+      std::fill(mark_.begin(), mark_.end(), 0);
+      generation_ = 1;
+    }
+    run_.clear();
+    for (const thread &t : next_) add_thread(run_, t.pc, t.start, prev, c);
+    if (!found && (!anchored || pos == 0)) add_thread(run_, 0, pos, prev, c);
+    next_.clear();
+    for (const thread &t : run_) {
+      const inst &in = prog_[t.pc];
+      if (in.op == I_MATCH) {
+        // threads after this one have lower priority
+        found = true;
+        match_begin = t.start;
+        match_end = pos;
+        break;
+      }
+      if (c != NO_CHAR && char_matches(in, c)) next_.push_back({t.pc + 1, t.start});
+    }
+    prev = c;
+    if (next_.empty() && (found || anchored)) done = true;
+  };
+
+  walk_html(data, len, [&](char32_t c) {
+    if (done) {
+      if (!found || shown_.size() >= match_end + context_) {
+        cut_short = true;
+        return false;
+      }
+      shown_.push_back(c);
+      return true;
+    }
+    step(c, (uint32_t)shown_.size());
+    shown_.push_back(c);
+    return !done || (found && match != nullptr && context_ > 0);
+  });
+  if (!done) step(NO_CHAR, (uint32_t)shown_.size());
+  if (!found) return false;
+  if (match) make_snippet(shown_, match_begin, match_end, context_, cut_short, *match);
+  return true;
+}
+
+}  // namespace mdict
@@ -0,0 +1,409 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/transliterator.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "include/html_text.h"
+#include "include/key_fold.h"
+
+namespace mdict {
+
+/********************************
+ *     tables                    *
+ ********************************/
+
+// Hepburn romaji of hiragana 3041..3096; っ (3063) is handled apart
+static const char *const KANA_ROMAJI[] = {
+    "a",  "a",  "i",  "i",  "u",   "u",  "e",  "e",  "o",  "o",  "ka", "ga",
+    "ki", "gi", "ku", "gu", "ke",  "ge", "ko", "go", "sa", "za", "shi", "ji",
+    "su", "zu", "se", "ze", "so",  "zo", "ta", "da", "chi", "ji", "",  "tsu",
+    "zu", "te", "de", "to", "do",  "na", "ni", "nu", "ne", "no", "ha", "ba",
+    "pa", "hi", "bi", "pi", "fu",  "bu", "pu", "he", "be", "pe", "ho", "bo",
+    "po", "ma", "mi", "mu", "me",  "mo", "ya", "ya", "yu", "yu", "yo", "yo",
+    "ra", "ri", "ru", "re", "ro",  "wa", "wa", "i",  "e",  "o",  "n",  "vu",
+    "ka", "ke",
+};
+
+// katakana ヷ..ヺ, which have no hiragana
+static const char *const KANA_V_ROMAJI[] = {"va", "vi", "ve", "vo"};
+
+// BGN/PCGN romanization of Cyrillic 0430..045F
+static const char *const CYRILLIC_LATIN[] = {
+    "a",  "b",  "v",  "g",  "d",  "e",  "zh", "z",  "i",  "y",    "k",
+    "l",  "m",  "n",  "o",  "p",  "r",  "s",  "t",  "u",  "f",    "kh",
+    "ts", "ch", "sh", "shch", "", "y",  "",   "e",  "yu", "ya",
+    // 0450..045F
+    "e",  "yo", "dj", "gj", "ye", "dz", "i",  "yi", "j",  "lj",   "nj",
+    "c",  "kj", "i",  "u",  "dz",
+};
+
+// modern and classical romanization of Greek 03B1..03C9
+static const char *const GREEK_LATIN[][2] = {
+    {"a", "a"},   {"v", "b"},   {"g", "g"},   {"d", "d"},   {"e", "e"},
+    {"z", "z"},   {"i", "e"},   {"th", "th"}, {"i", "i"},   {"k", "k"},
+    {"l", "l"},   {"m", "m"},   {"n", "n"},   {"x", "x"},   {"o", "o"},
+    {"p", "p"},   {"r", "r"},   {"s", "s"},   {"s", "s"},   {"t", "t"},
+    {"y", "y"},   {"f", "ph"},  {"ch", "ch"}, {"ps", "ps"}, {"o", "o"},
+};
+
+/********************************
+ *     scripts                   *
+ ********************************/
+
+static bool is_kana(char32_t c) {
+  return (c >= 0x3041 && c <= 0x3096) || c == 0x309D || c == 0x309E ||
+         (c >= 0x30F7 && c <= 0x30FA) || c == 0x30FC;
+}
+
+static bool is_greek(char32_t c) { return c >= 0x03B1 && c <= 0x03C9; }
+
+static bool is_cyrillic(char32_t c) {
+  return (c >= 0x0430 && c <= 0x045F) || c == 0x0491;
+}
+
+static bool is_vowel(char c) {
+  return c == 'a' || c == 'i' || c == 'u' || c == 'e' || c == 'o';
+}
+
+static bool ends_with(const std::string &s, const char *suffix) {
+  size_t n = std::char_traits<char>::length(suffix);
+  return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+/**
+ * Hepburn romaji of a run of hiragana
+ */
+static std::string romanize_kana(const char32_t *p, const char32_t *end) {
+  std::string out;
+  std::string last;  // last syllable, for ゝ
+  bool sokuon = false;
+  for (; p < end; ++p) {
+    char32_t c = *p;
+    if (c == 0x3063) {  // っ doubles the next consonant
+      sokuon = true;
+      continue;
+    }
+    if (c == 0x30FC) {  // ー lengthens the vowel before it
+      if (!out.empty() && is_vowel(out.back())) out += out.back();
+      continue;
+    }
+    std::string s;
+    if (c >= 0x30F7 && c <= 0x30FA) {
+      s = KANA_V_ROMAJI[c - 0x30F7];
+    } else if (c == 0x309D || c == 0x309E) {  // ゝ ゞ repeat
+      s = last;
+    } else {
+      s = KANA_ROMAJI[c - 0x3041];
+    }
+    bool small_y = c == 0x3083 || c == 0x3085 || c == 0x3087;
+    bool small_vowel = c == 0x3041 || c == 0x3043 || c == 0x3045 ||
+                       c == 0x3047 || c == 0x3049;
+    size_t n = out.size();
+    if (small_y && n >= 2 && out[n - 1] == 'i' && !is_vowel(out[n - 2])) {
+      // きゃ -> kya, しゃ -> sha, ちゅ -> chu, じょ -> jo
+      out.pop_back();
+      if (!ends_with(out, "sh") && !ends_with(out, "ch") && out.back() != 'j') {
+        out += 'y';
+      }
+      out += s[1];
+      continue;
+    }
+    if (small_vowel && n >= 2 && is_vowel(out[n - 1]) &&
+        !is_vowel(out[n - 2])) {
+      // ふぁ -> fa, てぃ -> ti, ちぇ -> che
+      out[n - 1] = s[0];
+      continue;
+    }
+    if (sokuon && !s.empty() && !is_vowel(s[0])) {
+      out += s.compare(0, 2, "ch") == 0 ? 't' : s[0];
+    }
+    sokuon = false;
+    out += s;
+    last = s;
+  }
+  return out;
+}
+
+/**
+ * romaji as usually typed: long vowels written once (gakkou -> gakko,
+ * raamen -> ramen)
+ */
+static std::string collapse_long_vowels(const std::string &romaji) {
+  std::string out;
+  out.reserve(romaji.size());
+  for (char c : romaji) {
+    if (!out.empty()) {
+      char prev = out.back();
+      if ((prev == 'o' && (c == 'u' || c == 'o')) ||
+          (c == prev && (c == 'a' || c == 'u' || c == 'e'))) {
+        continue;
+      }
+    }
+    out += c;
+  }
+  return out;
+}
+
+static void romanize_greek(const char32_t *p, const char32_t *end,
+                           std::string &modern, std::string &classical) {
+  for (; p < end; ++p) {
+    // γ before γ, κ, ξ, χ is nasal: άγγελος -> angelos
+    if (*p == 0x03B3 && p + 1 < end &&
+        (p[1] == 0x03B3 || p[1] == 0x03BA || p[1] == 0x03BE ||
+         p[1] == 0x03C7)) {
+      modern += 'n';
+      classical += 'n';
+      continue;
+    }
+    const char *const *latin = GREEK_LATIN[*p - 0x03B1];
+    modern += latin[0];
+    classical += latin[1];
+  }
+}
+
+static std::string romanize_cyrillic(const char32_t *p, const char32_t *end) {
+  std::string out;
+  for (; p < end; ++p) {
+    out += *p == 0x0491 ? "g" : CYRILLIC_LATIN[*p - 0x0430];
+  }
+  return out;
+}
+
+/**
+ * fold a reading and drop its tone numbers (zhōng, zhong1 -> zhong)
+ * @return empty if it is not latin
+ */
+static std::string fold_reading(std::string_view reading) {
+  std::string folded = fold_key(reading, KEY_FOLD_LOOSE);
+  std::string out;
+  out.reserve(folded.size());
+  for (size_t i = 0; i < folded.size(); ++i) {
+    unsigned char c = folded[i];
+    if (c >= 0x80) return "";
+    if (c >= '0' && c <= '9' && i > 0 && folded[i - 1] >= 'a' &&
+        folded[i - 1] <= 'z') {
+      continue;
+    }
+    out += static_cast<char>(c);
+  }
+  return out;
+}
+
+/********************************
+ *     Transliterator            *
+ ********************************/
+
+Transliterator &Transliterator::shared() {
+  static Transliterator transliterator;
+  return transliterator;
+}
+
+uint64_t Transliterator::generation() const { return generation_.load(); }
+
+size_t Transliterator::add_readings(const std::string &table) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto readings = std::make_shared<readings_map>(*std::atomic_load(&readings_));
+  size_t changed = 0;
+
+  size_t pos = 0;
+  while (pos < table.size()) {
+    size_t eol = table.find('\n', pos);
+    if (eol == std::string::npos) eol = table.size();
+    std::string_view line(table.data() + pos, eol - pos);
+    pos = eol + 1;
+    size_t hash = line.find('#');
+    if (hash != std::string_view::npos) line = line.substr(0, hash);
+
+    // split on blanks
+    std::vector<std::string_view> fields;
+    size_t i = 0;
+    while (i < line.size()) {
+      while (i < line.size() && (line[i] == ' ' || line[i] == '\t' ||
+                                 line[i] == '\r')) {
+        ++i;
+      }
+      size_t start = i;
+      while (i < line.size() && line[i] != ' ' && line[i] != '\t' &&
+             line[i] != '\r') {
+        ++i;
+      }
+      if (i > start) fields.push_back(line.substr(start, i - start));
+    }
+    if (fields.size() < 2) continue;
+
+    char32_t cp = 0;
+    std::string_view head = fields[0];
+    if (head.size() > 2 && head[0] == 'U' && head[1] == '+') {
+      cp = static_cast<char32_t>(
+          std::strtoul(std::string(head.substr(2)).c_str(), nullptr, 16));
+    } else {
+      const unsigned char *p =
+          reinterpret_cast<const unsigned char *>(head.data());
+      if (decode_utf8(p, p + head.size(), cp) != head.size()) continue;
+    }
+    if (cp < 0x80) continue;
+
+    std::vector<std::string> &known = (*readings)[cp];
+    bool added = false;
+    for (size_t f = 1; f < fields.size(); ++f) {
+      std::string_view field = fields[f];
+      // Unihan field names (kMandarin), kHanyuPinyin's "10001.010:" locations
+      if (field.size() > 1 && field[0] == 'k' && field[1] >= 'A' &&
+          field[1] <= 'Z') {
+        continue;
+      }
+      size_t colon = field.rfind(':');
+      if (colon != std::string_view::npos) field = field.substr(colon + 1);
+      size_t start = 0;
+      while (start <= field.size()) {
+        size_t comma = field.find(',', start);
+        if (comma == std::string_view::npos) comma = field.size();
+        std::string reading = fold_reading(field.substr(start, comma - start));
+        if (!reading.empty() &&
+            std::find(known.begin(), known.end(), reading) == known.end()) {
+          known.push_back(std::move(reading));
+          added = true;
+        }
+        start = comma + 1;
+      }
+    }
+    if (known.empty()) readings->erase(cp);
+    if (added) ++changed;
+  }
+
+  if (changed) {
+    std::atomic_store(&readings_,
+                      std::shared_ptr<const readings_map>(std::move(readings)));
+    generation_.fetch_add(1);
+  }
+  return changed;
+}
+
+std::vector<std::string> Transliterator::romanize(std::string_view key) const {
+  std::shared_ptr<const readings_map> readings = std::atomic_load(&readings_);
+  std::string folded = fold_key(key, KEY_FOLD_LOOSE);
+  std::u32string text;
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(folded.data());
+  const unsigned char *end = p + folded.size();
+  while (p < end) {
+    char32_t c;
+    p += decode_utf8(p, end, c);
+    text.push_back(c);
+  }
+
+  std::vector<std::string> forms(1);
+  std::vector<std::string> options;
+  std::vector<std::string> next;
+  bool romanized = false;
+  const char32_t *s = text.data();
+  const char32_t *s_end = s + text.size();
+  while (s < s_end) {
+    options.clear();
+    const char32_t *run = s;
+    if (*s < 0x80) {
+      while (s < s_end && *s < 0x80) ++s;
+      options.emplace_back(run, s);
+    } else if (is_kana(*s)) {
+      while (s < s_end && is_kana(*s)) ++s;
+      options.push_back(romanize_kana(run, s));
+      std::string collapsed = collapse_long_vowels(options[0]);
+      if (collapsed != options[0]) options.push_back(std::move(collapsed));
+    } else if (is_greek(*s)) {
+      while (s < s_end && is_greek(*s)) ++s;
+      std::string modern, classical;
+      romanize_greek(run, s, modern, classical);
+      options.push_back(modern);
+      if (classical != modern) options.push_back(classical);
+    } else if (is_cyrillic(*s)) {
+      while (s < s_end && is_cyrillic(*s)) ++s;
+      options.push_back(romanize_cyrillic(run, s));
+    } else {
+      auto it = readings->find(*s);
+      if (it == readings->end()) return {};
+      options = it->second;
+      ++s;
+    }
+    if (*run >= 0x80) romanized = true;
+
+    next.clear();
+    for (const std::string &form : forms) {
+      for (const std::string &option : options) {
+        if (next.size() == MAX_FORMS) break;
+        next.push_back(form + option);
+      }
+    }
+    forms.swap(next);
+  }
+  if (!romanized) return {};
+
+  std::vector<std::string> unique;
+  for (std::string &form : forms) {
+    if (!form.empty() &&
+        std::find(unique.begin(), unique.end(), form) == unique.end()) {
+      unique.push_back(std::move(form));
+    }
+  }
+  return unique;
+}
+
+std::string Transliterator::fold_query(std::string_view query) {
+  return fold_reading(query);
+}
+
+/********************************
+ *     RomanizedKeyIndex         *
+ ********************************/
+
+RomanizedKeyIndex::RomanizedKeyIndex(
+    const Transliterator &transliterator, size_t count,
+    const std::function<const std::string &(size_t)> &key_of)
+    : generation_(transliterator.generation()) {
+  offsets_.push_back(0);
+  for (size_t i = 0; i < count; ++i) {
+    for (const std::string &form : transliterator.romanize(key_of(i))) {
+      arena_.append(form);
+      offsets_.push_back(static_cast<uint32_t>(arena_.size()));
+      entries_.push_back(static_cast<uint32_t>(i));
+    }
+  }
+  arena_.shrink_to_fit();
+  offsets_.shrink_to_fit();
+  entries_.shrink_to_fit();
+
+  sorted_.resize(entries_.size());
+  for (size_t i = 0; i < sorted_.size(); ++i) {
+    sorted_[i] = static_cast<uint32_t>(i);
+  }
+  std::sort(sorted_.begin(), sorted_.end(), [this](uint32_t a, uint32_t b) {
+    int c = this->form(a).compare(this->form(b));
+    return c != 0 ? c < 0 : entries_[a] < entries_[b];
+  });
+}
+
+std::vector<uint32_t> RomanizedKeyIndex::prefix(std::string_view romanized,
+                                                size_t limit) const {
+  std::vector<uint32_t> found;
+  if (romanized.empty()) return found;
+  auto it = std::lower_bound(
+      sorted_.begin(), sorted_.end(), romanized,
+      [this](uint32_t id, std::string_view v) { return this->form(id) < v; });
+  for (; it != sorted_.end() && found.size() < limit; ++it) {
+    std::string_view f = this->form(*it);
+    if (f.compare(0, romanized.size(), romanized) != 0) break;
+    uint32_t entry = entries_[*it];
+    if (std::find(found.begin(), found.end(), entry) == found.end()) {
+      found.push_back(entry);
+    }
+  }
+  return found;
+}
+
+}  // namespace mdict
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2025-Present
+ * All rights reserved.
+ *
+ * This code is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for details.
+ */
+
+#include "include/zip_source.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+#include "include/fileutils.h"
+#include "include/mdict_log.h"
+#include "miniz/miniz_zip.h"
+
+#define LOG_TAG "MdictJNI"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+namespace mdict {
+
+static const uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+static const size_t LOCAL_HEADER_SIZE = 30;
+
+// miniz read callback: positional reads, the fd offset is left alone
+static size_t pread_archive(void *opaque, mz_uint64 offset, void *buf, size_t n) {
+  int fd = *static_cast<int *>(opaque);
+  size_t done = 0;
+  while (done < n) {
+    ssize_t r = pread(fd, static_cast<char *>(buf) + done, n - done,
+                      static_cast<off_t>(offset + done));
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) break;
+    done += static_cast<size_t>(r);
+  }
+  return done;
+}
+
+static size_t write_cache(void *opaque, mz_uint64 /* offset */, const void *buf,
+                          size_t n) {
+  return std::fwrite(buf, 1, n, static_cast<FILE *>(opaque));
+}
+
+/**
+ * a miniz reader over an fd it does not own
+ */
+class ArchiveReader {
+ public:
+  explicit ArchiveReader(int fd) : fd_(fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) throw std::runtime_error("zip: cannot stat archive");
+    size_ = static_cast<uint64_t>(st.st_size);
+    mz_zip_zero_struct(&zip_);
+    zip_.m_pRead = pread_archive;
+    zip_.m_pIO_opaque = &fd_;
+    if (!mz_zip_reader_init(&zip_, size_, 0)) {
+      throw std::runtime_error(std::string("zip: ") +
+                               mz_zip_get_error_string(mz_zip_get_last_error(&zip_)));
+    }
+  }
+  ~ArchiveReader() { mz_zip_reader_end(&zip_); }
+  ArchiveReader(const ArchiveReader &) = delete;
+  ArchiveReader &operator=(const ArchiveReader &) = delete;
+
+  mz_zip_archive *get() { return &zip_; }
+  int fd() const { return fd_; }
+  uint64_t size() const { return size_; }
+
+ private:
+  int fd_;
+  uint64_t size_ = 0;
+  mz_zip_archive zip_;
+};
+
+static bool ends_with_ci(const std::string &s, const char *suffix) {
+  size_t n = std::char_traits<char>::length(suffix);
+  if (s.size() < n) return false;
+  for (size_t i = 0; i < n; ++i) {
+    char c = s[s.size() - n + i];
+    if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    if (c != suffix[i]) return false;
+  }
+  return true;
+}
+
+// the member's file name, archives made on Windows may use '\'
+static std::string base_name(const std::string &name) {
+  size_t slash = name.find_last_of("/\\");
+  return slash == std::string::npos ? name : name.substr(slash + 1);
+}
+
+// the member's path as one file name: '/', '\' and '%' are escaped, so
+// same-named members of different folders get different files
+static std::string flat_name(const std::string &name) {
+  std::string flat;
+  for (char c : name) {
+    if (c == '/') {
+      flat += "%2F";
+    } else if (c == '\\') {
+      flat += "%5C";
+    } else if (c == '%') {
+      flat += "%25";
+    } else {
+      flat += c;
+    }
+  }
+  return flat;
+}
+
+// "zip-<crc>-<size>-<file>" for any crc and size
+static bool is_cache_of(const std::string &name, const std::string &file) {
+  if (name.size() < 15 + file.size() || name.compare(0, 4, "zip-") != 0 ||
+      name[12] != '-') {
+    return false;
+  }
+  size_t dash = name.find('-', 13);
+  return dash != std::string::npos && dash > 13 &&
+         name.find_first_not_of("0123456789", 13) == dash &&
+         name.compare(dash + 1, std::string::npos, file) == 0;
+}
+
+/**
+ * the central directory has the local header's offset, the data starts past
+ * the local header's own (possibly different) name and extra fields
+ */
+static bool data_offset(ArchiveReader &archive, const mz_zip_archive_file_stat &st,
+                        uint64_t &offset) {
+  unsigned char h[LOCAL_HEADER_SIZE];
+  int fd = archive.fd();
+  if (pread_archive(&fd, st.m_local_header_ofs, h, sizeof(h)) != sizeof(h)) {
+    return false;
+  }
+  uint32_t signature = h[0] | (h[1] << 8) | (h[2] << 16) | ((uint32_t)h[3] << 24);
+  if (signature != LOCAL_HEADER_SIGNATURE) return false;
+  uint64_t name_len = h[26] | (h[27] << 8);
+  uint64_t extra_len = h[28] | (h[29] << 8);
+  offset = st.m_local_header_ofs + LOCAL_HEADER_SIZE + name_len + extra_len;
+  return offset <= archive.size() && st.m_comp_size <= archive.size() - offset;
+}
+
+std::vector<zip_member> list_zip_dictionaries(int fd) {
+  ArchiveReader archive(fd);
+  std::vector<zip_member> members;
+  mz_uint count = mz_zip_reader_get_num_files(archive.get());
+  for (mz_uint i = 0; i < count; ++i) {
+    mz_zip_archive_file_stat st;
+    if (!mz_zip_reader_file_stat(archive.get(), i, &st)) continue;
+    if (st.m_is_directory || st.m_is_encrypted || !st.m_is_supported) continue;
+    zip_member m;
+    m.name = st.m_filename;
+    if (!ends_with_ci(m.name, ".mdx") && !ends_with_ci(m.name, ".mdd")) continue;
+    m.size = st.m_uncomp_size;
+    m.crc = st.m_crc32;
+    m.stored = st.m_method == 0 && st.m_comp_size == st.m_uncomp_size;
+    if (m.stored && !data_offset(archive, st, m.data_offset)) continue;
+    members.push_back(std::move(m));
+  }
+  return members;
+}
+
+std::string inflate_zip_member(int fd, const zip_member &member,
+                               const std::string &cache_dir) {
+  std::string base = base_name(member.name);
+  if (base.empty() || base == "." || base == "..") {
+    throw std::runtime_error("zip: bad member name " + member.name);
+  }
+  std::string file = flat_name(member.name);
+  char tag[32];
+  std::snprintf(tag, sizeof(tag), "zip-%08x-%llu-", member.crc,
+                static_cast<unsigned long long>(member.size));
+  std::string path = cache_dir + "/" + tag + file;
+
+  std::error_code ec;
+  if (std::filesystem::file_size(path, ec) == member.size && !ec) return path;
+
+  ArchiveReader archive(fd);
+  int index = mz_zip_reader_locate_file(archive.get(), member.name.c_str(), nullptr,
+                                        MZ_ZIP_FLAG_CASE_SENSITIVE);
+  mz_zip_archive_file_stat st;
+  if (index < 0 || !mz_zip_reader_file_stat(archive.get(), index, &st) ||
+      st.m_crc32 != member.crc || st.m_uncomp_size != member.size) {
+    throw std::runtime_error("zip: member changed " + member.name);
+  }
+
+  // the extraction checks the CRC, a damaged archive never gets published
+  std::string tmp = path + ".tmp";
+  FILE *out = std::fopen(tmp.c_str(), "wb");
+  if (!out) throw std::runtime_error("zip: cannot create " + tmp);
+  bool ok = mz_zip_reader_extract_to_callback(archive.get(), index, write_cache, out, 0);
+  if (!fclose_durable(out) || !ok || !publish_file(tmp, path)) {
+    std::remove(tmp.c_str());
+    throw std::runtime_error("zip: cannot inflate " + member.name);
+  }
+  LOGD("zip: inflated %s (%llu bytes)", member.name.c_str(),
+       static_cast<unsigned long long>(member.size));
+
+  // earlier versions of the same member are dead weight now; the cache dir
+  // belongs to this archive, other archives' members are never touched
+  for (const auto &entry : std::filesystem::directory_iterator(cache_dir, ec)) {
+    std::string name = entry.path().filename().string();
+    if (name != tag + file && is_cache_of(name, file)) {
+      std::filesystem::remove(entry.path(), ec);
+    }
+  }
+  return path;
+}
+
+}  // namespace mdict
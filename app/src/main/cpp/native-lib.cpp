@@ -1,10 +1,21 @@
 #include <jni.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <string>
+#include <algorithm>
 #include <cstdlib>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 #include <android/log.h>
+#include "mdict-cpp/include/definition_search.h"
+#include "mdict-cpp/include/html_text.h"
+#include "mdict-cpp/include/key_filter.h"
 #include "mdict-cpp/include/mdict_extern.h"
 #include "mdict-cpp/include/mdict.h"
+#include "mdict-cpp/include/resource_set.h"
+#include "mdict-cpp/include/segmenter.h"
+#include "mdict-cpp/include/zip_source.h"
 
 // Logging helper
 #define LOG_TAG "MdictJNI"
@@ -202,86 +213,977 @@ Java_com_waltermelon_vibedict_data_MdictEngine_getRegexSuggestionsNative(
 }
 
 // ----------------------------------------------------------------------------
-// 8. Get Full Text Suggestions
+// 8. Get Full Text Hits
 // ----------------------------------------------------------------------------
+
+// NewStringUTF expects modified UTF-8, which rejects 4-byte sequences
+// (emoji, CJK extension B) that show up in definition snippets
+static jstring utf8_to_jstring(JNIEnv* env, const std::string& s) {
+    std::vector<jchar> utf16;
+    utf16.reserve(s.size());
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(s.data());
+    const unsigned char* end = p + s.size();
+    while (p < end) {
+        char32_t cp;
+        p += mdict::decode_utf8(p, end, cp);
+        if (cp >= 0x10000) {
+            cp -= 0x10000;
+            utf16.push_back(static_cast<jchar>(0xD800 + (cp >> 10)));
+            utf16.push_back(static_cast<jchar>(0xDC00 + (cp & 0x3FF)));
+        } else {
+            utf16.push_back(static_cast<jchar>(cp));
+        }
+    }
+    return env->NewString(utf16.data(), static_cast<jsize>(utf16.size()));
+}
+
+// Progress and cancellation of a definition scan go to the Kotlin listener,
+// the paging cursor travels in a one-element long array (in and out)
+static void bind_scan_options(JNIEnv* env, jobject listener, jlongArray cursor,
+                              mdict::scan_options& options, unsigned poll_stride = 16) {
+    if (cursor != nullptr && env->GetArrayLength(cursor) > 0) {
+        jlong value = 0;
+        env->GetLongArrayRegion(cursor, 0, 1, &value);
+        options.cursor = value > 0 ? static_cast<uint64_t>(value) : 0;
+    }
+    if (listener == nullptr) return;
+
+    jclass listenerClass = env->GetObjectClass(listener);
+    jmethodID onProgressMethod = env->GetMethodID(listenerClass, "onProgress", "(F)V");
+    jmethodID isCancelledMethod = env->GetMethodID(listenerClass, "isCancelled", "()Z");
+    env->DeleteLocalRef(listenerClass);
+    if (env->ExceptionCheck()) env->ExceptionClear();
+
+    if (onProgressMethod != nullptr) {
+        options.progress = [env, listener, onProgressMethod](float progress) {
+            env->CallVoidMethod(listener, onProgressMethod, progress);
+        };
+    }
+    if (isCancelledMethod != nullptr) {
+        // scans poll between entries, asking Kotlin every few entries is enough
+        auto polls = std::make_shared<unsigned>(0);
+        options.cancelled = [env, listener, isCancelledMethod, polls, poll_stride]() {
+            if (++*polls % poll_stride != 0) return false;
+            return env->CallBooleanMethod(listener, isCancelledMethod) == JNI_TRUE;
+        };
+    }
+}
+
+static void store_scan_cursor(JNIEnv* env, jlongArray cursor, const mdict::scan_options& options) {
+    if (cursor == nullptr || env->GetArrayLength(cursor) == 0) return;
+    jlong value = static_cast<jlong>(options.cursor);
+    env->SetLongArrayRegion(cursor, 0, 1, &value);
+}
+
+static jobjectArray hits_to_jarray(JNIEnv* env, const std::vector<mdict::fulltext_hit>& hits) {
+    jclass hitClass = env->FindClass("com/waltermelon/vibedict/data/FullTextHit");
+    if (hitClass == nullptr) return nullptr;
+    jmethodID hitCtor = env->GetMethodID(hitClass, "<init>", "(Ljava/lang/String;Ljava/lang/String;IIF)V");
+    if (hitCtor == nullptr) return nullptr;
+
+    jobjectArray hitArray = env->NewObjectArray(hits.size(), hitClass, nullptr);
+    if (hitArray == nullptr) return nullptr;
+
+    for (size_t i = 0; i < hits.size(); ++i) {
+        jstring key = utf8_to_jstring(env, hits[i].key);
+        jstring snippet = utf8_to_jstring(env, hits[i].snippet);
+        jobject hit = env->NewObject(hitClass, hitCtor, key, snippet,
+                                     static_cast<jint>(hits[i].match_start),
+                                     static_cast<jint>(hits[i].match_end),
+                                     static_cast<jfloat>(hits[i].score));
+        env->SetObjectArrayElement(hitArray, i, hit);
+        env->DeleteLocalRef(hit);
+        env->DeleteLocalRef(snippet);
+        env->DeleteLocalRef(key);
+    }
+    return hitArray;
+}
+
 JNIEXPORT jobjectArray JNICALL
-Java_com_waltermelon_vibedict_data_MdictEngine_getFullTextSuggestionsNative(
+Java_com_waltermelon_vibedict_data_MdictEngine_getFullTextHitsNative(
         JNIEnv* env,
         jobject /* this */,
         jlong dictHandle,
         jstring query,
-        jobject listener) {
+        jobject listener,
+        jlongArray cursor) {
+
+    if (dictHandle == 0) return nullptr;
+    auto* dict = reinterpret_cast<mdict::Mdict*>(dictHandle);
+
+    const char* s_query = env->GetStringUTFChars(query, nullptr);
+    std::string cpp_query(s_query);
+    env->ReleaseStringUTFChars(query, s_query);
+
+    try {
+        mdict::scan_options options;
+        bind_scan_options(env, listener, cursor, options);
+
+        LOGD("getFullTextHitsNative called with: %s", cpp_query.c_str());
+        std::vector<mdict::fulltext_hit> hits = dict->fulltext_search_hits(cpp_query, options);
+        LOGD("Found %zu full-text matches", hits.size());
+
+        store_scan_cursor(env, cursor, options);
+        return hits_to_jarray(env, hits);
+    } catch (const std::exception& e) {
+        LOGE("Exception in getFullTextHitsNative: %s", e.what());
+        return nullptr;
+    } catch (...) {
+        LOGE("Unknown exception in getFullTextHitsNative");
+        return nullptr;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 9. Background Index Build
+// ----------------------------------------------------------------------------
+JNIEXPORT void JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_setIndexDirectoryNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle,
+        jstring dir) {
+
+    if (dictHandle == 0) return;
+    auto* dict = reinterpret_cast<mdict::Mdict*>(dictHandle);
+
+    const char* c_dir = env->GetStringUTFChars(dir, 0);
+    std::string s_dir(c_dir);
+    env->ReleaseStringUTFChars(dir, c_dir);
+
+    try {
+        dict->set_index_dir(s_dir);
+    } catch (const std::exception& e) {
+        LOGE("Exception in setIndexDirectoryNative: %s", e.what());
+    }
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_startIndexBuildNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle,
+        jint kinds) {
+
+    if (dictHandle == 0) return JNI_FALSE;
+    auto* dict = reinterpret_cast<mdict::Mdict*>(dictHandle);
+    try {
+        return dict->start_index_build(static_cast<uint32_t>(kinds)) ? JNI_TRUE : JNI_FALSE;
+    } catch (const std::exception& e) {
+        LOGE("Exception in startIndexBuildNative: %s", e.what());
+        return JNI_FALSE;
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_cancelIndexBuildNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle) {
+
+    if (dictHandle == 0) return;
+    reinterpret_cast<mdict::Mdict*>(dictHandle)->cancel_index_build();
+}
+
+JNIEXPORT jint JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_getIndexBuildStateNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle) {
+
+    if (dictHandle == 0) return 0;
+    return static_cast<jint>(reinterpret_cast<mdict::Mdict*>(dictHandle)->index_build_state());
+}
+
+JNIEXPORT jfloat JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_getIndexBuildProgressNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle) {
+
+    if (dictHandle == 0) return 0.0f;
+    return reinterpret_cast<mdict::Mdict*>(dictHandle)->index_build_progress();
+}
+
+// ----------------------------------------------------------------------------
+// 10. Regex Search over Definitions
+// ----------------------------------------------------------------------------
+JNIEXPORT jobjectArray JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_getDefinitionRegexHitsNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle,
+        jstring pattern,
+        jobject listener,
+        jlongArray cursor) {
+
+    if (dictHandle == 0) return nullptr;
+    auto* dict = reinterpret_cast<mdict::Mdict*>(dictHandle);
+
+    const char* s_pattern = env->GetStringUTFChars(pattern, nullptr);
+    std::string cpp_pattern(s_pattern);
+    env->ReleaseStringUTFChars(pattern, s_pattern);
+
+    try {
+        mdict::scan_options options;
+        bind_scan_options(env, listener, cursor, options);
+
+        std::vector<mdict::fulltext_hit> hits = dict->regex_search_hits(cpp_pattern, options);
+        LOGD("Found %zu definition regex matches for %s", hits.size(), cpp_pattern.c_str());
+
+        store_scan_cursor(env, cursor, options);
+        return hits_to_jarray(env, hits);
+    } catch (const std::invalid_argument& e) {
+        LOGE("Invalid definition regex %s: %s", cpp_pattern.c_str(), e.what());
+        return nullptr;
+    } catch (const std::exception& e) {
+        LOGE("Exception in getDefinitionRegexHitsNative: %s", e.what());
+        return nullptr;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 11. Search Definitions across Dictionaries
+// ----------------------------------------------------------------------------
+JNIEXPORT jobjectArray JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_searchDefinitionsNative(
+        JNIEnv* env,
+        jclass /* clazz */,
+        jlongArray handles,
+        jstring query,
+        jboolean regex,
+        jint limit,
+        jobject listener,
+        jintArray sources) {
+
+    const char* s_query = env->GetStringUTFChars(query, nullptr);
+    std::string cpp_query(s_query);
+    env->ReleaseStringUTFChars(query, s_query);
+
+    std::vector<jlong> raw(env->GetArrayLength(handles));
+    if (!raw.empty()) env->GetLongArrayRegion(handles, 0, raw.size(), raw.data());
+    // closed engines have a zero handle, remember where each dictionary came from
+    std::vector<mdict::Mdict*> dicts;
+    std::vector<jint> origin;
+    for (size_t i = 0; i < raw.size(); ++i) {
+        if (raw[i] == 0) continue;
+        dicts.push_back(reinterpret_cast<mdict::Mdict*>(raw[i]));
+        origin.push_back(static_cast<jint>(i));
+    }
+
+    try {
+        // the scheduler polls from this thread every few milliseconds
+        mdict::scan_options options;
+        bind_scan_options(env, listener, nullptr, options, 1);
+
+        mdict::definition_matcher matcher = regex
+                ? mdict::definition_matcher::regex(cpp_query)
+                : mdict::definition_matcher::fulltext(cpp_query);
+        size_t max_hits = std::min<size_t>(std::max<jint>(limit, 0), env->GetArrayLength(sources));
+        mdict::SearchScheduler scheduler(dicts, matcher, max_hits);
+        std::vector<mdict::dictionary_hit> hits = scheduler.run(options.progress, options.cancelled);
+
+        std::vector<mdict::fulltext_hit> plain;
+        std::vector<jint> hit_sources;
+        for (auto& hit : hits) {
+            hit_sources.push_back(origin[hit.dict]);
+            plain.push_back(std::move(hit.hit));
+        }
+        if (!hit_sources.empty()) {
+            env->SetIntArrayRegion(sources, 0, hit_sources.size(), hit_sources.data());
+        }
+        return hits_to_jarray(env, plain);
+    } catch (const std::invalid_argument& e) {
+        LOGE("Invalid definition search %s: %s", cpp_query.c_str(), e.what());
+        return nullptr;
+    } catch (const std::exception& e) {
+        LOGE("Exception in searchDefinitionsNative: %s", e.what());
+        return nullptr;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 12. Affix Stemmer
+// ----------------------------------------------------------------------------
+// A stemmer handle owns a shared_ptr, so dictionaries using it keep it alive
+// after the Kotlin object is closed
+static std::string byte_array_to_string(JNIEnv* env, jbyteArray bytes) {
+    std::string out(env->GetArrayLength(bytes), '\0');
+    if (!out.empty()) {
+        env->GetByteArrayRegion(bytes, 0, out.size(), reinterpret_cast<jbyte*>(&out[0]));
+    }
+    return out;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_waltermelon_vibedict_data_AffixStemmer_createNative(
+        JNIEnv* env,
+        jclass /* clazz */,
+        jbyteArray affix,
+        jbyteArray words) {
+
+    try {
+        auto stemmer = std::make_shared<mdict::AffixStemmer>(
+                byte_array_to_string(env, affix), byte_array_to_string(env, words));
+        return reinterpret_cast<jlong>(new std::shared_ptr<mdict::AffixStemmer>(std::move(stemmer)));
+    } catch (const std::exception& e) {
+        LOGE("Exception in AffixStemmer createNative: %s", e.what());
+        return 0;
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_waltermelon_vibedict_data_AffixStemmer_destroyNative(
+        JNIEnv* env,
+        jclass /* clazz */,
+        jlong stemmerHandle) {
+
+    delete reinterpret_cast<std::shared_ptr<mdict::AffixStemmer>*>(stemmerHandle);
+}
+
+JNIEXPORT void JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_setStemmerNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle,
+        jlong stemmerHandle) {
+
+    if (dictHandle == 0) return;
+    auto* dict = reinterpret_cast<mdict::Mdict*>(dictHandle);
+    auto* stemmer = reinterpret_cast<std::shared_ptr<mdict::AffixStemmer>*>(stemmerHandle);
+    dict->set_stemmer(stemmer ? *stemmer : nullptr);
+}
+
+JNIEXPORT jobjectArray JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_stemNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle,
+        jstring word) {
+
+    if (dictHandle == 0) return nullptr;
+    auto* dict = reinterpret_cast<mdict::Mdict*>(dictHandle);
+
+    const char* c_word = env->GetStringUTFChars(word, nullptr);
+    std::string s_word(c_word);
+    env->ReleaseStringUTFChars(word, c_word);
+
+    try {
+        std::vector<std::string> stems = dict->stem(s_word);
+
+        jclass stringClass = env->FindClass("java/lang/String");
+        if (stringClass == nullptr) return nullptr;
+        jobjectArray stringArray = env->NewObjectArray(stems.size(), stringClass, nullptr);
+        if (stringArray == nullptr) return nullptr;
+        for (size_t i = 0; i < stems.size(); ++i) {
+            jstring javaString = utf8_to_jstring(env, stems[i]);
+            env->SetObjectArrayElement(stringArray, i, javaString);
+            env->DeleteLocalRef(javaString);
+        }
+        return stringArray;
+    } catch (const std::exception& e) {
+        LOGE("Exception in stemNative: %s", e.what());
+        return nullptr;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 13. Japanese Deinflection
+// ----------------------------------------------------------------------------
+JNIEXPORT jobjectArray JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_deinflectNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle,
+        jstring word) {
+
+    if (dictHandle == 0) return nullptr;
+    auto* dict = reinterpret_cast<mdict::Mdict*>(dictHandle);
+
+    const char* c_word = env->GetStringUTFChars(word, nullptr);
+    std::string s_word(c_word);
+    env->ReleaseStringUTFChars(word, c_word);
+
+    try {
+        std::vector<mdict::deinflection> forms = dict->deinflect(s_word);
+
+        jclass stringClass = env->FindClass("java/lang/String");
+        jclass formClass = env->FindClass("com/waltermelon/vibedict/data/Deinflection");
+        if (stringClass == nullptr || formClass == nullptr) return nullptr;
+        jmethodID formCtor = env->GetMethodID(formClass, "<init>", "(Ljava/lang/String;[Ljava/lang/String;)V");
+        if (formCtor == nullptr) return nullptr;
+
+        jobjectArray formArray = env->NewObjectArray(forms.size(), formClass, nullptr);
+        if (formArray == nullptr) return nullptr;
+        for (size_t i = 0; i < forms.size(); ++i) {
+            jobjectArray reasons = env->NewObjectArray(forms[i].reasons.size(), stringClass, nullptr);
+            for (size_t r = 0; r < forms[i].reasons.size(); ++r) {
+                jstring reason = env->NewStringUTF(forms[i].reasons[r].c_str());
+                env->SetObjectArrayElement(reasons, r, reason);
+                env->DeleteLocalRef(reason);
+            }
+            jstring headword = utf8_to_jstring(env, forms[i].term);
+            jobject form = env->NewObject(formClass, formCtor, headword, reasons);
+            env->SetObjectArrayElement(formArray, i, form);
+            env->DeleteLocalRef(form);
+            env->DeleteLocalRef(headword);
+            env->DeleteLocalRef(reasons);
+        }
+        return formArray;
+    } catch (const std::exception& e) {
+        LOGE("Exception in deinflectNative: %s", e.what());
+        return nullptr;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 14. Transliteration
+// ----------------------------------------------------------------------------
+JNIEXPORT jint JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_addTransliterationsNative(
+        JNIEnv* env,
+        jclass /* clazz */,
+        jbyteArray table) {
+
+    try {
+        return (jint) mdict::Transliterator::shared().add_readings(byte_array_to_string(env, table));
+    } catch (const std::exception& e) {
+        LOGE("Exception in addTransliterationsNative: %s", e.what());
+        return 0;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 15. Text Segmentation
+// ----------------------------------------------------------------------------
+JNIEXPORT jobjectArray JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_segmentNative(
+        JNIEnv* env,
+        jclass /* clazz */,
+        jlongArray handles,
+        jstring text) {
+
+    const char* c_text = env->GetStringUTFChars(text, nullptr);
+    std::string s_text(c_text);
+    env->ReleaseStringUTFChars(text, c_text);
+
+    std::vector<jlong> raw(env->GetArrayLength(handles));
+    if (!raw.empty()) env->GetLongArrayRegion(handles, 0, raw.size(), raw.data());
+    std::vector<mdict::Mdict*> dicts;
+    std::vector<jint> origin;
+    for (size_t i = 0; i < raw.size(); ++i) {
+        if (raw[i] == 0) continue;
+        dicts.push_back(reinterpret_cast<mdict::Mdict*>(raw[i]));
+        origin.push_back(static_cast<jint>(i));
+    }
 
-    const char* s_query = nullptr;
-    jobject globalListener = nullptr;
-    
     try {
-        if (dictHandle == 0) return nullptr;
-
-        s_query = env->GetStringUTFChars(query, nullptr);
-        std::string cpp_query(s_query);
-
-        auto* dict = reinterpret_cast<mdict::Mdict*>(dictHandle);
-        
-        std::function<void(float)> progress_cb = nullptr;
-        
-        if (listener != nullptr) {
-            jclass listenerClass = env->GetObjectClass(listener);
-            jmethodID onProgressMethod = env->GetMethodID(listenerClass, "onProgress", "(F)V");
-            
-            if (onProgressMethod != nullptr) {
-                globalListener = env->NewGlobalRef(listener);
-                progress_cb = [env, globalListener, onProgressMethod](float progress) {
-                    env->CallVoidMethod(globalListener, onProgressMethod, progress);
-                };
+        std::vector<mdict::text_segment> segments = mdict::segment_text(dicts, s_text);
+
+        // byte offsets to String indexes: every (modified) utf-8 sequence
+        // is one UTF-16 unit
+        std::vector<jint> utf16_at(s_text.size() + 1, 0);
+        jint units = 0;
+        for (size_t i = 0; i < s_text.size(); ++i) {
+            utf16_at[i] = units;
+            if ((static_cast<unsigned char>(s_text[i]) & 0xC0) != 0x80) ++units;
+        }
+        utf16_at[s_text.size()] = units;
+
+        jclass segmentClass = env->FindClass("com/waltermelon/vibedict/data/TextSegment");
+        if (segmentClass == nullptr) return nullptr;
+        jmethodID segmentCtor = env->GetMethodID(segmentClass, "<init>", "(IILjava/lang/String;I)V");
+        if (segmentCtor == nullptr) return nullptr;
+
+        jobjectArray segmentArray = env->NewObjectArray(segments.size(), segmentClass, nullptr);
+        if (segmentArray == nullptr) return nullptr;
+        for (size_t i = 0; i < segments.size(); ++i) {
+            const mdict::text_segment& s = segments[i];
+            jstring headword = nullptr;
+            jint source = -1;
+            if (!s.entries.empty()) {
+                const auto& first = s.entries.front();
+                headword = utf8_to_jstring(env, dicts[first.first]->entry_key(first.second));
+                source = origin[first.first];
             }
+            jobject segment = env->NewObject(segmentClass, segmentCtor,
+                                             utf16_at[s.start], utf16_at[s.start + s.length],
+                                             headword, source);
+            env->SetObjectArrayElement(segmentArray, i, segment);
+            env->DeleteLocalRef(segment);
+            if (headword != nullptr) env->DeleteLocalRef(headword);
         }
+        return segmentArray;
+    } catch (const std::exception& e) {
+        LOGE("Exception in segmentNative: %s", e.what());
+        return nullptr;
+    }
+}
 
-        __android_log_print(ANDROID_LOG_DEBUG, "MdictJNI", "getFullTextSuggestionsNative called with: %s", cpp_query.c_str());
 
-        std::vector<std::string> suggestions = dict->fulltext_search(cpp_query, progress_cb);
+// ----------------------------------------------------------------------------
+// 16. Key Filters
+// ----------------------------------------------------------------------------
+JNIEXPORT jbooleanArray JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_mayContainNative(
+        JNIEnv* env,
+        jclass /* clazz */,
+        jlongArray handles,
+        jstring word) {
 
-        __android_log_print(ANDROID_LOG_DEBUG, "MdictJNI", "Found %zu full-text matches", suggestions.size());
+    const char* c_word = env->GetStringUTFChars(word, nullptr);
+    std::string s_word(c_word);
+    env->ReleaseStringUTFChars(word, c_word);
+
+    std::vector<jlong> raw(env->GetArrayLength(handles));
+    if (!raw.empty()) env->GetLongArrayRegion(handles, 0, raw.size(), raw.data());
+    std::vector<mdict::Mdict*> dicts;
+    std::vector<jint> origin;
+    for (size_t i = 0; i < raw.size(); ++i) {
+        if (raw[i] == 0) continue;
+        dicts.push_back(reinterpret_cast<mdict::Mdict*>(raw[i]));
+        origin.push_back(static_cast<jint>(i));
+    }
 
-        if (s_query != nullptr) {
-            env->ReleaseStringUTFChars(query, s_query);
-            s_query = nullptr;
+    // one flag per handle, false for closed engines
+    std::vector<jboolean> flags(raw.size(), JNI_FALSE);
+    try {
+        for (uint32_t i : mdict::dictionaries_may_contain(dicts, s_word)) {
+            flags[origin[i]] = JNI_TRUE;
         }
+    } catch (const std::exception& e) {
+        LOGE("Exception in mayContainNative: %s", e.what());
+        // unknown: let the caller look everywhere
+        for (size_t i = 0; i < raw.size(); ++i) flags[i] = raw[i] != 0 ? JNI_TRUE : JNI_FALSE;
+    }
+
+    jbooleanArray result = env->NewBooleanArray(flags.size());
+    if (result == nullptr) return nullptr;
+    if (!flags.empty()) env->SetBooleanArrayRegion(result, 0, flags.size(), flags.data());
+    return result;
+}
+
+
+// ----------------------------------------------------------------------------
+// 17. Anagrams
+// ----------------------------------------------------------------------------
+JNIEXPORT jobjectArray JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_getAnagramsNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle,
+        jstring letters,
+        jboolean subset) {
+
+    if (dictHandle == 0) return nullptr;
+    auto* dict = reinterpret_cast<mdict::Mdict*>(dictHandle);
+
+    const char* c_letters = env->GetStringUTFChars(letters, nullptr);
+    std::string s_letters(c_letters);
+    env->ReleaseStringUTFChars(letters, c_letters);
+
+    try {
+        std::vector<std::string> words = dict->anagrams(s_letters, subset == JNI_TRUE);
 
         jclass stringClass = env->FindClass("java/lang/String");
-        if (stringClass == nullptr) {
-            if (globalListener != nullptr) env->DeleteGlobalRef(globalListener);
+        if (stringClass == nullptr) return nullptr;
+        jobjectArray stringArray = env->NewObjectArray(words.size(), stringClass, nullptr);
+        if (stringArray == nullptr) return nullptr;
+        for (size_t i = 0; i < words.size(); ++i) {
+            jstring javaString = utf8_to_jstring(env, words[i]);
+            env->SetObjectArrayElement(stringArray, i, javaString);
+            env->DeleteLocalRef(javaString);
+        }
+        return stringArray;
+    } catch (const std::exception& e) {
+        LOGE("Exception in getAnagramsNative: %s", e.what());
+        return nullptr;
+    }
+}
+
+
+// ----------------------------------------------------------------------------
+// 18. Resource Sets
+// ----------------------------------------------------------------------------
+JNIEXPORT jlong JNICALL
+Java_com_waltermelon_vibedict_data_MdictResourceSet_createNative(
+        JNIEnv* env,
+        jclass /* clazz */,
+        jlongArray handles) {
+
+    std::vector<jlong> raw(env->GetArrayLength(handles));
+    if (!raw.empty()) env->GetLongArrayRegion(handles, 0, raw.size(), raw.data());
+    std::vector<mdict::Mdict*> volumes;
+    for (jlong h : raw) {
+        // a closed volume keeps its place, so volume numbers match the array
+        if (h == 0) return 0;
+        volumes.push_back(reinterpret_cast<mdict::Mdict*>(h));
+    }
+
+    try {
+        return reinterpret_cast<jlong>(new mdict::ResourceSet(volumes));
+    } catch (const std::exception& e) {
+        LOGE("Exception in createNative: %s", e.what());
+        return 0;
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_waltermelon_vibedict_data_MdictResourceSet_destroyNative(
+        JNIEnv* /* env */,
+        jclass /* clazz */,
+        jlong setHandle) {
+    if (setHandle != 0) {
+        delete reinterpret_cast<mdict::ResourceSet*>(setHandle);
+    }
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_waltermelon_vibedict_data_MdictResourceSet_findNative(
+        JNIEnv* env,
+        jclass /* clazz */,
+        jlong setHandle,
+        jstring path) {
+
+    if (setHandle == 0) return -1;
+    auto* set = reinterpret_cast<mdict::ResourceSet*>(setHandle);
+
+    const char* c_path = env->GetStringUTFChars(path, nullptr);
+    std::string s_path(c_path);
+    env->ReleaseStringUTFChars(path, c_path);
+
+    uint32_t volume = 0, entry = 0;
+    if (!set->find(s_path, volume, entry)) return -1;
+    return (static_cast<jlong>(volume) << 32) | entry;
+}
+
+JNIEXPORT jbyteArray JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_getRecordNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle,
+        jint entry) {
+
+    if (dictHandle == 0 || entry < 0) return nullptr;
+    auto* dict = reinterpret_cast<mdict::Mdict*>(dictHandle);
+
+    try {
+        std::string record = dict->entry_record(static_cast<unsigned long>(entry));
+        jbyteArray bytes = env->NewByteArray(record.size());
+        if (bytes == nullptr) return nullptr;
+        env->SetByteArrayRegion(bytes, 0, record.size(), reinterpret_cast<const jbyte*>(record.data()));
+        return bytes;
+    } catch (const std::exception& e) {
+        LOGE("Exception in getRecordNative: %s", e.what());
+        return nullptr;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 19. ZIP Archives
+// ----------------------------------------------------------------------------
+JNIEXPORT jobjectArray JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_listZipDictionariesNative(
+        JNIEnv* env,
+        jclass /* clazz */,
+        jint fd) {
+
+    try {
+        std::vector<mdict::zip_member> members = mdict::list_zip_dictionaries(fd);
+
+        jclass stringClass = env->FindClass("java/lang/String");
+        if (stringClass == nullptr) return nullptr;
+        jobjectArray stringArray = env->NewObjectArray(members.size(), stringClass, nullptr);
+        if (stringArray == nullptr) return nullptr;
+        for (size_t i = 0; i < members.size(); ++i) {
+            jstring javaString = utf8_to_jstring(env, members[i].name);
+            env->SetObjectArrayElement(stringArray, i, javaString);
+            env->DeleteLocalRef(javaString);
+        }
+        return stringArray;
+    } catch (const std::exception& e) {
+        LOGE("Exception in listZipDictionariesNative: %s", e.what());
+        return nullptr;
+    }
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_initDictionaryZipNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jint fd,
+        jstring member,
+        jstring cacheDir) {
+
+    const char* c_member = env->GetStringUTFChars(member, nullptr);
+    const char* c_cache_dir = env->GetStringUTFChars(cacheDir, nullptr);
+
+    void* dict_ptr = mdict_init_zip(fd, c_member, c_cache_dir);
+    if (dict_ptr == nullptr) {
+        LOGE("Failed to initialize dictionary %s from ZIP archive", c_member);
+    }
+
+    env->ReleaseStringUTFChars(cacheDir, c_cache_dir);
+    env->ReleaseStringUTFChars(member, c_member);
+    return reinterpret_cast<jlong>(dict_ptr);
+}
+
+// ----------------------------------------------------------------------------
+// 20. Record Slices
+// ----------------------------------------------------------------------------
+JNIEXPORT jlongArray JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_getRecordSliceNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle,
+        jint entry) {
+
+    if (dictHandle == 0 || entry < 0) return nullptr;
+    auto* dict = reinterpret_cast<mdict::Mdict*>(dictHandle);
+
+    try {
+        int fd;
+        uint64_t offset, length;
+        if (!dict->record_slice(static_cast<unsigned long>(entry), fd, offset, length)) {
             return nullptr;
         }
-        jobjectArray stringArray = env->NewObjectArray(suggestions.size(), stringClass, nullptr);
-        if (stringArray == nullptr) {
-            if (globalListener != nullptr) env->DeleteGlobalRef(globalListener);
+        // the caller gets its own descriptor, valid after the engine closes
+        int own = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (own < 0) return nullptr;
+        jlong slice[3] = {own, static_cast<jlong>(offset), static_cast<jlong>(length)};
+        jlongArray result = env->NewLongArray(3);
+        if (result == nullptr) {
+            close(own);
             return nullptr;
         }
+        env->SetLongArrayRegion(result, 0, 3, slice);
+        return result;
+    } catch (const std::exception& e) {
+        LOGE("Exception in getRecordSliceNative: %s", e.what());
+        return nullptr;
+    }
+}
 
-        for (size_t i = 0; i < suggestions.size(); ++i) {
-            jstring str = env->NewStringUTF(suggestions[i].c_str());
-            env->SetObjectArrayElement(stringArray, i, str);
-            env->DeleteLocalRef(str);
-        }
+// ----------------------------------------------------------------------------
+// 21. Two-Phase Lookup
+// ----------------------------------------------------------------------------
+// Entries first (cheap metadata, see EntryMeta), definitions on demand
+JNIEXPORT jobjectArray JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_lookupEntriesNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle,
+        jstring word,
+        jint previewChars) {
 
-        if (globalListener != nullptr) {
-            env->DeleteGlobalRef(globalListener);
-        }
+    if (dictHandle == 0) return nullptr;
+    auto* dict = reinterpret_cast<mdict::Mdict*>(dictHandle);
 
+    const char* c_word = env->GetStringUTFChars(word, nullptr);
+    std::string s_word(c_word);
+    env->ReleaseStringUTFChars(word, c_word);
+
+    std::vector<mdict::entry_meta> metas =
+            dict->lookup_entries(s_word, static_cast<size_t>(std::max<jint>(previewChars, 0)));
+    if (metas.empty()) return nullptr;
+
+    jclass metaClass = env->FindClass("com/waltermelon/vibedict/data/EntryMeta");
+    if (metaClass == nullptr) return nullptr;
+    jmethodID metaCtor = env->GetMethodID(metaClass, "<init>", "(IILjava/lang/String;Ljava/lang/String;)V");
+    if (metaCtor == nullptr) return nullptr;
+
+    jobjectArray metaArray = env->NewObjectArray(metas.size(), metaClass, nullptr);
+    if (metaArray == nullptr) return nullptr;
+
+    for (size_t i = 0; i < metas.size(); ++i) {
+        jstring target = metas[i].redirect ? utf8_to_jstring(env, metas[i].target) : nullptr;
+        jstring preview = utf8_to_jstring(env, metas[i].preview);
+        jobject meta = env->NewObject(metaClass, metaCtor,
+                                      static_cast<jint>(metas[i].entry),
+                                      static_cast<jint>(metas[i].length),
+                                      target, preview);
+        env->SetObjectArrayElement(metaArray, i, meta);
+        env->DeleteLocalRef(meta);
+        env->DeleteLocalRef(preview);
+        if (target != nullptr) env->DeleteLocalRef(target);
+    }
+    return metaArray;
+}
+
+JNIEXPORT jobjectArray JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_getDefinitionsNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle,
+        jintArray entries) {
+
+    if (dictHandle == 0) return nullptr;
+    auto* dict = reinterpret_cast<mdict::Mdict*>(dictHandle);
+
+    std::vector<uint32_t> ids(env->GetArrayLength(entries));
+    if (!ids.empty()) {
+        env->GetIntArrayRegion(entries, 0, ids.size(), reinterpret_cast<jint*>(ids.data()));
+    }
+
+    try {
+        std::vector<std::string> definitions = dict->definitions(ids);
+
+        jclass stringClass = env->FindClass("java/lang/String");
+        if (stringClass == nullptr) return nullptr;
+        jobjectArray stringArray = env->NewObjectArray(definitions.size(), stringClass, nullptr);
+        if (stringArray == nullptr) return nullptr;
+
+        for (size_t i = 0; i < definitions.size(); ++i) {
+            jstring javaString = utf8_to_jstring(env, definitions[i]);
+            env->SetObjectArrayElement(stringArray, i, javaString);
+            env->DeleteLocalRef(javaString);
+        }
         return stringArray;
+    } catch (const std::exception& e) {
+        LOGE("Exception in getDefinitionsNative: %s", e.what());
+        return nullptr;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 22. Ranked Full-Text Search
+// ----------------------------------------------------------------------------
+// Every dictionary with a term index gives its own top hits, which are merged
+// by score; dictionaries without one are left to searchDefinitionsNative
+JNIEXPORT jobjectArray JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_rankedSearchNative(
+        JNIEnv* env,
+        jclass /* clazz */,
+        jlongArray handles,
+        jstring query,
+        jint limit,
+        jintArray sources) {
+
+    const char* s_query = env->GetStringUTFChars(query, nullptr);
+    std::string cpp_query(s_query);
+    env->ReleaseStringUTFChars(query, s_query);
+
+    std::vector<jlong> raw(env->GetArrayLength(handles));
+    if (!raw.empty()) env->GetLongArrayRegion(handles, 0, raw.size(), raw.data());
+    size_t max_hits = std::min<size_t>(std::max<jint>(limit, 0), env->GetArrayLength(sources));
+
+    try {
+        std::vector<std::pair<mdict::fulltext_hit, jint>> all;
+        for (size_t i = 0; i < raw.size(); ++i) {
+            if (raw[i] == 0) continue;
+            for (auto& hit : reinterpret_cast<mdict::Mdict*>(raw[i])->ranked_search(cpp_query, max_hits)) {
+                all.emplace_back(std::move(hit), static_cast<jint>(i));
+            }
+        }
+        std::stable_sort(all.begin(), all.end(), [](const auto& a, const auto& b) {
+            return a.first.score > b.first.score;
+        });
+        if (all.size() > max_hits) all.resize(max_hits);
 
+        std::vector<mdict::fulltext_hit> plain;
+        std::vector<jint> hit_sources;
+        for (auto& hit : all) {
+            hit_sources.push_back(hit.second);
+            plain.push_back(std::move(hit.first));
+        }
+        if (!hit_sources.empty()) {
+            env->SetIntArrayRegion(sources, 0, hit_sources.size(), hit_sources.data());
+        }
+        return hits_to_jarray(env, plain);
     } catch (const std::exception& e) {
-        __android_log_print(ANDROID_LOG_ERROR, "MdictJNI", "Exception in getFullTextSuggestionsNative: %s", e.what());
-        if (s_query != nullptr) env->ReleaseStringUTFChars(query, s_query);
-        if (globalListener != nullptr) env->DeleteGlobalRef(globalListener);
+        LOGE("Exception in rankedSearchNative: %s", e.what());
         return nullptr;
-    } catch (...) {
-        __android_log_print(ANDROID_LOG_ERROR, "MdictJNI", "Unknown exception in getFullTextSuggestionsNative");
-        if (s_query != nullptr) env->ReleaseStringUTFChars(query, s_query);
-        if (globalListener != nullptr) env->DeleteGlobalRef(globalListener);
+    }
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_hasTermIndexNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle) {
+
+    if (dictHandle == 0) return JNI_FALSE;
+    return reinterpret_cast<mdict::Mdict*>(dictHandle)->has_term_index() ? JNI_TRUE : JNI_FALSE;
+}
+
+// ----------------------------------------------------------------------------
+// 23. Integrity Scrub
+// ----------------------------------------------------------------------------
+// Every block is read and checked natively, see block_scrub.h; the report
+// comes back as a ScrubReport with its DamagedBlock list
+JNIEXPORT jobject JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_scrubNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle,
+        jobject listener) {
+
+    if (dictHandle == 0) return nullptr;
+    auto* dict = reinterpret_cast<mdict::Mdict*>(dictHandle);
+
+    try {
+        // the scrub polls from this thread between reads
+        mdict::scan_options options;
+        bind_scan_options(env, listener, nullptr, options, 1);
+        mdict::scrub_report report = dict->scrub(options.progress, options.cancelled);
+
+        jclass blockClass = env->FindClass("com/waltermelon/vibedict/data/DamagedBlock");
+        if (blockClass == nullptr) return nullptr;
+        jmethodID blockCtor = env->GetMethodID(blockClass, "<init>", "(ZJIILjava/lang/String;)V");
+        if (blockCtor == nullptr) return nullptr;
+        jclass reportClass = env->FindClass("com/waltermelon/vibedict/data/ScrubReport");
+        if (reportClass == nullptr) return nullptr;
+        jmethodID reportCtor = env->GetMethodID(
+                reportClass, "<init>", "(JJJZ[Lcom/waltermelon/vibedict/data/DamagedBlock;)V");
+        if (reportCtor == nullptr) return nullptr;
+
+        jobjectArray blocks = env->NewObjectArray(report.damaged.size(), blockClass, nullptr);
+        if (blocks == nullptr) return nullptr;
+        for (size_t i = 0; i < report.damaged.size(); ++i) {
+            const mdict::damaged_block& damaged = report.damaged[i];
+            jstring error = utf8_to_jstring(env, damaged.error);
+            jobject block = env->NewObject(blockClass, blockCtor,
+                                           damaged.kind == mdict::block_kind::KEY ? JNI_TRUE : JNI_FALSE,
+                                           static_cast<jlong>(damaged.block_id),
+                                           static_cast<jint>(damaged.first_entry),
+                                           static_cast<jint>(damaged.last_entry),
+                                           error);
+            env->SetObjectArrayElement(blocks, i, block);
+            env->DeleteLocalRef(block);
+            env->DeleteLocalRef(error);
+        }
+        return env->NewObject(reportClass, reportCtor,
+                              static_cast<jlong>(report.key_blocks),
+                              static_cast<jlong>(report.record_blocks),
+                              static_cast<jlong>(report.bytes),
+                              report.complete ? JNI_TRUE : JNI_FALSE,
+                              blocks);
+    } catch (const std::exception& e) {
+        LOGE("Exception in scrubNative: %s", e.what());
         return nullptr;
     }
 }
 
-} // extern "C"
\ No newline at end of file
+JNIEXPORT jboolean JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_isVerifiedNative(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong dictHandle) {
+
+    if (dictHandle == 0) return JNI_FALSE;
+    return reinterpret_cast<mdict::Mdict*>(dictHandle)->blocks_verified() ? JNI_TRUE : JNI_FALSE;
+}
+
+// ----------------------------------------------------------------------------
+// 24. Block Cache
+// ----------------------------------------------------------------------------
+JNIEXPORT void JNICALL
+Java_com_waltermelon_vibedict_data_MdictEngine_setBlockCacheBudgetNative(
+        JNIEnv* /* env */,
+        jclass /* clazz */,
+        jlong bytes) {
+
+    mdict::BlockCache::shared().set_budget(bytes > 0 ? static_cast<size_t>(bytes) : 0);
+}
+
+} // extern "C"
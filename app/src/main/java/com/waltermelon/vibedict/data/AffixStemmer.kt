@@ -0,0 +1,45 @@
+package com.waltermelon.vibedict.data
+
+import java.io.Closeable
+
+/**
+ * A Hunspell stemmer built from an affix file (.aff) and a word list (.dic).
+ * The rules are parsed once natively; attach the stemmer to any number of
+ * engines with [MdictEngine.setStemmer]. Engines keep their own reference,
+ * so closing this object only releases the Kotlin side's.
+ */
+class AffixStemmer private constructor(private var handle: Long) : Closeable {
+
+    companion object {
+        init {
+            System.loadLibrary("waltermelon-native")
+        }
+
+        /**
+         * @param affix Contents of the .aff file.
+         * @param words Contents of the .dic file.
+         * @return The stemmer, or null if the files could not be parsed.
+         */
+        fun create(affix: ByteArray, words: ByteArray): AffixStemmer? {
+            val handle = createNative(affix, words)
+            return if (handle != 0L) AffixStemmer(handle) else null
+        }
+
+        @JvmStatic
+        private external fun createNative(affix: ByteArray, words: ByteArray): Long
+
+        @JvmStatic
+        private external fun destroyNative(stemmerHandle: Long)
+    }
+
+    internal val nativeHandle: Long
+        @Synchronized get() = handle
+
+    @Synchronized
+    override fun close() {
+        if (handle != 0L) {
+            destroyNative(handle)
+            handle = 0
+        }
+    }
+}
@@ -1,5 +1,6 @@
 package com.waltermelon.vibedict.data
 
+import android.app.ActivityManager
 import android.content.Context
 import android.net.Uri
 import android.system.Os
@@ -12,8 +13,12 @@ import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.StateFlow
 import kotlinx.coroutines.flow.asStateFlow
+import kotlinx.coroutines.isActive
 import kotlinx.coroutines.withContext
+import java.io.ByteArrayInputStream
+import java.io.File
 import java.io.FileDescriptor
+import java.io.InputStream
 import java.security.MessageDigest
 import android.util.Log
 
@@ -34,7 +39,9 @@ object DictionaryManager {
         val defaultCssContent: String = "",
         val defaultJsContent: String = "",
         val webUrl: String? = null,
-        val aiPrompt: AIPrompt? = null
+        val aiPrompt: AIPrompt? = null,
+        // One path index over all mddEngines, see [MdictResourceSet]
+        val resources: MdictResourceSet? = null
     )
 
     // --- Helper: Compute partial hash for unique identification ---
@@ -94,6 +101,90 @@ object DictionaryManager {
         return allFiles
     }
 
+    // --- Helper: Dictionaries inside a ZIP archive, grouped like loose files ---
+    private fun loadZipDictionaries(context: Context, zip: DocumentFile): List<LoadedDictionary> {
+        val members = context.contentResolver.openFileDescriptor(zip.uri, "r")?.use { pfd ->
+            MdictEngine.listZipDictionaries(pfd.fd)
+        } ?: return emptyList()
+        if (members.isEmpty()) return emptyList()
+        // Deflated members are inflated here once; stored ones are read in place.
+        // One directory per archive, so archives never prune each other's files
+        val archiveKey = MessageDigest.getInstance("MD5").digest(zip.uri.toString().toByteArray())
+            .joinToString("") { "%02x".format(it) }
+        val inflateDir = File(context.cacheDir, "zip/$archiveKey").apply { mkdirs() }.absolutePath
+
+        // Each engine owns its own descriptor of the archive
+        fun open(member: String): MdictEngine? {
+            val pfd = context.contentResolver.openFileDescriptor(zip.uri, "r") ?: return null
+            val engine = MdictEngine()
+            if (engine.loadDictionaryZip(pfd.detachFd(), member, inflateDir)) return engine
+            engine.close()
+            return null
+        }
+
+        val baseNameRegex = "(\\.\\d+)?\\.(mdx|mdd)$".toRegex(RegexOption.IGNORE_CASE)
+        // Grouped by full path, same-named dictionaries in different folders stay apart
+        return members.groupBy { it.replace(baseNameRegex, "") }.mapNotNull { (basePath, names) ->
+            val baseName = basePath.substringAfterLast('/')
+            try {
+                val mdxName = names.find { it.endsWith(".mdx", ignoreCase = true) }
+                val mdxEngine = mdxName?.let { open(it) }
+                val mddNames = names.filter { it.endsWith(".mdd", ignoreCase = true) }
+                    .sortedBy { it.dropLast(4).substringAfterLast('.', "").toIntOrNull() ?: 0 }
+                val mddEngines = mutableListOf<MdictEngine>()
+                val mddPaths = mutableListOf<String>()
+                mddNames.forEach { name ->
+                    open(name)?.let {
+                        mddEngines.add(it)
+                        mddPaths.add("${zip.uri}#$name")
+                    }
+                }
+                if (mdxEngine == null && mddEngines.isEmpty()) return@mapNotNull null
+
+                // Members are keyed as "<archive uri>#<member>" in the hash cache
+                val mdxPath = if (mdxEngine != null) "${zip.uri}#$mdxName" else null
+                val cacheKey = mdxPath ?: mddPaths.first()
+                val cachedEntry = DictionaryCacheManager.getEntry(cacheKey)
+                val dictId = if (cachedEntry != null &&
+                    cachedEntry.size == zip.length() &&
+                    cachedEntry.lastModified == zip.lastModified()
+                ) {
+                    cachedEntry.hash
+                } else {
+                    val zipHash = context.contentResolver.openFileDescriptor(zip.uri, "r")?.use {
+                        computeFileHash(it.fileDescriptor)
+                    } ?: "unknown_hash_${System.currentTimeMillis()}"
+                    val member = cacheKey.substringAfter('#')
+                    val id = MessageDigest.getInstance("MD5").digest("$zipHash#$member".toByteArray())
+                        .joinToString("") { "%02x".format(it) }
+                    DictionaryCacheManager.putEntry(
+                        DictionaryCacheManager.CacheEntry(
+                            uri = cacheKey,
+                            size = zip.length(),
+                            lastModified = zip.lastModified(),
+                            hash = id,
+                            name = baseName
+                        )
+                    )
+                    id
+                }
+
+                LoadedDictionary(
+                    id = dictId,
+                    name = baseName,
+                    mdxEngine = mdxEngine,
+                    mddEngines = mddEngines,
+                    mdxPath = mdxPath,
+                    mddPaths = mddPaths,
+                    resources = if (mddEngines.isNotEmpty()) MdictResourceSet.create(mddEngines) else null
+                )
+            } catch (e: Exception) {
+                e.printStackTrace()
+                null
+            }
+        }
+    }
+
     suspend fun reloadDictionaries(
         context: Context,
         folderUris: Set<String>,
@@ -106,11 +197,17 @@ object DictionaryManager {
             // Load Cache
             DictionaryCacheManager.loadCache(context)
 
+            // Decompressed definition blocks, sized to the app's heap class
+            val activityManager = context.getSystemService(ActivityManager::class.java)
+            val cacheMiB = if (activityManager == null || activityManager.isLowRamDevice) 8 else activityManager.memoryClass / 8
+            MdictEngine.setBlockCacheBudget(cacheMiB.coerceIn(8, 64).toLong() shl 20)
+
             // Save providers for later use in lookup
             loadedProviders = llmProviders
 
             // Close existing local engines
             loadedDictionaries.forEach {
+                it.resources?.close()
                 it.mdxEngine?.close()
                 it.mddEngines.forEach { engine -> engine.close() }
             }
@@ -160,10 +257,47 @@ object DictionaryManager {
                             // 1. Get files in THIS folder only (Non-Recursive)
                             val filesInFolder = listFiles(dir)
 
+                            // Han reading tables (*.translit) for latin suggestions
+                            filesInFolder.filter { it.name!!.endsWith(".translit", ignoreCase = true) }.forEach { file ->
+                                try {
+                                    context.contentResolver.openInputStream(file.uri)?.use {
+                                        MdictEngine.addTransliterations(it.readBytes())
+                                    }
+                                } catch (e: Exception) {
+                                    e.printStackTrace()
+                                }
+                            }
+
                             // 2. Group by dictionary name
-                            val baseNameRegex = "(\\.\\d+)?\\.(mdx|mdd|css)$".toRegex(RegexOption.IGNORE_CASE)
+                            val baseNameRegex = "(\\.\\d+)?\\.(mdx|mdd|css|aff|dic)$".toRegex(RegexOption.IGNORE_CASE)
                             val fileGroups = filesInFolder.groupBy { it.name!!.replace(baseNameRegex, "") }
 
+                            // Hunspell .aff/.dic pairs: one named like a dictionary stems
+                            // for it, a standalone pair (en_US.aff) for the whole folder
+                            val stemmerFiles = fileGroups.mapNotNull { (baseName, files) ->
+                                val aff = files.find { it.name!!.endsWith(".aff", ignoreCase = true) }
+                                val dic = files.find { it.name!!.endsWith(".dic", ignoreCase = true) }
+                                if (aff != null && dic != null) baseName to (aff to dic) else null
+                            }.toMap()
+                            val folderStemmerName = stemmerFiles.keys.firstOrNull { name ->
+                                fileGroups[name]?.none { it.name!!.endsWith(".mdx", ignoreCase = true) } == true
+                            }
+                            val stemmers = mutableMapOf<String, AffixStemmer?>()
+                            fun stemmerFor(name: String): AffixStemmer? {
+                                if (name in stemmers) return stemmers[name]
+                                val (aff, dic) = stemmerFiles.getValue(name)
+                                val stemmer = try {
+                                    val affix = context.contentResolver.openInputStream(aff.uri)?.use { it.readBytes() }
+                                    val words = context.contentResolver.openInputStream(dic.uri)?.use { it.readBytes() }
+                                    if (affix != null && words != null) AffixStemmer.create(affix, words) else null
+                                } catch (e: Exception) {
+                                    e.printStackTrace()
+                                    null
+                                }
+                                stemmers[name] = stemmer
+                                return stemmer
+                            }
+
                             // 3. Process groups
                             fileGroups.mapNotNull { (baseName, files) ->
                                 try {
@@ -236,8 +370,15 @@ object DictionaryManager {
                                         } catch (e: Exception) { e.printStackTrace() }
                                     }
 
-                                    // Process MDD
+                                    // Stemming for lookups that miss
+                                    val stemmerName = if (baseName in stemmerFiles) baseName else folderStemmerName
+                                    if (stemmerName != null) {
+                                        stemmerFor(stemmerName)?.let { mdxEngine?.setStemmer(it) }
+                                    }
+
+                                    // Process MDD, name.mdd first, then name.1.mdd, name.2.mdd...
                                     val mddFiles = files.filter { it.name!!.endsWith(".mdd", ignoreCase = true) }
+                                        .sortedBy { it.name!!.dropLast(4).substringAfterLast('.', "").toIntOrNull() ?: 0 }
                                     mddFiles.forEach { mddFile ->
                                         try {
                                             val pfd = context.contentResolver.openFileDescriptor(mddFile.uri, "r")
@@ -288,7 +429,8 @@ object DictionaryManager {
                                             mdxPath = mdxPath,
                                             mddPaths = mddPaths,
                                             defaultCssContent = cssContent,
-                                            defaultJsContent = jsContent
+                                            defaultJsContent = jsContent,
+                                            resources = if (mddEngines.isNotEmpty()) MdictResourceSet.create(mddEngines) else null
                                         )
                                     } else {
                                         null
@@ -297,6 +439,19 @@ object DictionaryManager {
                                     e.printStackTrace()
                                     null
                                 }
+                            }.plus(
+                                // 4. Dictionaries kept inside ZIP archives
+                                filesInFolder.filter { it.name!!.endsWith(".zip", ignoreCase = true) }
+                                    .flatMap { loadZipDictionaries(context, it) }
+                                    .onEach { dict ->
+                                        val stemmerName = if (dict.name in stemmerFiles) dict.name else folderStemmerName
+                                        if (stemmerName != null) {
+                                            stemmerFor(stemmerName)?.let { dict.mdxEngine?.setStemmer(it) }
+                                        }
+                                    }
+                            ).also {
+                                // The engines hold their own references
+                                stemmers.values.forEach { it?.close() }
                             }
                         } else {
                             emptyList()
@@ -321,6 +476,7 @@ object DictionaryManager {
                     loadedDictionaries.add(dict)
                 } else {
                     // Duplicate found, close resources
+                    dict.resources?.close()
                     dict.mdxEngine?.close()
                     dict.mddEngines.forEach { it.close() }
                 }
@@ -329,6 +485,17 @@ object DictionaryManager {
             // Save Cache
             DictionaryCacheManager.saveCache(context)
 
+            // Step E: Build the optional search indexes in the background.
+            // Each dictionary gets its own dir keyed by content hash, so a
+            // replaced file never picks up a stale index.
+            loadedDictionaries.forEach { dict ->
+                dict.mdxEngine?.let { engine ->
+                    val indexDir = File(context.cacheDir, "indexes/${dict.id}")
+                    engine.setIndexDirectory(indexDir.absolutePath)
+                    engine.startIndexBuild()
+                }
+            }
+
         } catch (e: Exception) {
             e.printStackTrace()
         } finally {
@@ -378,6 +545,7 @@ object DictionaryManager {
 
     fun cleanup() {
         loadedDictionaries.forEach {
+            it.resources?.close()
             it.mdxEngine?.close()
             it.mddEngines.forEach { engine -> engine.close() }
         }
@@ -447,6 +615,94 @@ object DictionaryManager {
         return@withContext null
     }
 
+    /**
+     * First phase of a two-phase lookup: the entries an MDX dictionary has
+     * for [word], redirects followed, ordered like the definitions of
+     * [lookup]. Only lengths and short previews cross JNI; fetch the bodies
+     * with [loadDefinitions] when they are shown.
+     * @return null for web and AI dictionaries, which only support [lookup].
+     */
+    suspend fun lookupEntries(dictId: String, word: String, previewChars: Int = 120): List<EntryMeta>? = withContext(Dispatchers.IO) {
+        val dict = getDictionaryById(dictId) ?: return@withContext null
+        if (dict.webUrl != null || dict.aiPrompt != null) return@withContext null
+        val engine = dict.mdxEngine ?: return@withContext null
+        try {
+            fun resolve(w: String, depth: Int): List<EntryMeta> {
+                if (depth > 5) return emptyList()
+                return engine.lookupEntries(w, previewChars).flatMap { meta ->
+                    if (meta.isRedirect) resolve(meta.redirectTarget!!, depth + 1) else listOf(meta)
+                }
+            }
+            // An entry reached through several redirects is shown once,
+            // content-rich entries first
+            resolve(word, 0).distinctBy { it.entry }.sortedByDescending { it.length }
+        } catch (e: Exception) {
+            e.printStackTrace()
+            emptyList()
+        }
+    }
+
+    /**
+     * Second phase of a two-phase lookup: the definitions of [entries], as
+     * returned by [lookupEntries] for the same dictionary.
+     */
+    suspend fun loadDefinitions(dictId: String, entries: List<EntryMeta>): List<String> = withContext(Dispatchers.IO) {
+        val engine = getDictionaryById(dictId)?.mdxEngine ?: return@withContext emptyList()
+        try {
+            engine.getDefinitions(entries.map { it.entry }.toIntArray())
+        } catch (e: Exception) {
+            e.printStackTrace()
+            emptyList()
+        }
+    }
+
+    /**
+     * Base forms of an inflected [word] that some loaded dictionary has an
+     * entry for, see [MdictEngine.stem].
+     */
+    suspend fun stem(word: String): List<String> = withContext(Dispatchers.IO) {
+        loadedDictionaries.toList().flatMap { dict ->
+            try {
+                dict.mdxEngine?.stem(word) ?: emptyList()
+            } catch (e: Exception) {
+                e.printStackTrace()
+                emptyList()
+            }
+        }.distinct()
+    }
+
+    /**
+     * Splits [text] into the longest keys of the loaded dictionaries, see
+     * [MdictEngine.segment].
+     */
+    suspend fun segment(text: String): List<TextSegment> = withContext(Dispatchers.IO) {
+        val engines = loadedDictionaries.toList().mapNotNull { it.mdxEngine }
+        try {
+            MdictEngine.segment(engines, text)
+        } catch (e: Exception) {
+            e.printStackTrace()
+            emptyList()
+        }
+    }
+
+    /**
+     * The dictionaries of [dicts] that may have an entry for [word], checked
+     * against each key filter at once (see [MdictEngine.mayContain]). Web and
+     * AI dictionaries always stay; MDX dictionaries are dropped only when
+     * their filter rules the word out.
+     */
+    suspend fun mayContain(dicts: List<LoadedDictionary>, word: String): List<LoadedDictionary> = withContext(Dispatchers.IO) {
+        val mdx = dicts.filter { it.mdxEngine != null }
+        val flags = try {
+            MdictEngine.mayContain(mdx.map { it.mdxEngine!! }, word)
+        } catch (e: Exception) {
+            e.printStackTrace()
+            BooleanArray(mdx.size) { true }
+        }
+        val ruledOut = mdx.filterIndexed { i, _ -> !flags[i] }.toSet()
+        dicts.filter { it !in ruledOut }
+    }
+
     suspend fun lookupAll(word: String): List<Triple<String, String, List<String>>> = withContext(Dispatchers.IO) {
         val results = mutableListOf<Triple<String, String, List<String>>>()
         loadedDictionaries.toList().forEach { dict ->
@@ -470,8 +726,13 @@ object DictionaryManager {
 
         val dictSnapshot = loadedDictionaries.toList()
 
+        for (dict in dictSnapshot) {
+            dict.resources?.get(key)?.let { return it }
+        }
+
         for (v in variations) {
             for (dict in dictSnapshot) {
+                if (dict.resources != null) continue
                 dict.mddEngines.forEach { engine ->
                     val hexDataList = engine.lookup(v)
                     if (hexDataList.isNotEmpty()) {
@@ -492,6 +753,9 @@ object DictionaryManager {
         Log.d("DictionaryManager", "getResource: dictId=$dictId, key=$key")
         val dict = loadedDictionaries.find { it.id == dictId } ?: return null
 
+        // One probe across all volumes
+        dict.resources?.let { return it.get(key) }
+
         val variations = listOf(
             "\\" + key.replace('/', '\\'),
             key.replace('/', '\\'),
@@ -514,6 +778,22 @@ object DictionaryManager {
         return null
     }
 
+    /**
+     * Like [getResource], but a resource kept uncompressed in its MDD is
+     * streamed from the file instead of being read into memory first.
+     */
+    fun openResource(dictId: String, key: String): InputStream? {
+        getResourceSlice(dictId, key)?.let { return it.inputStream() }
+        return getResource(dictId, key)?.let { ByteArrayInputStream(it) }
+    }
+
+    /**
+     * @return The resource as a file slice, or null if it is missing or
+     * compressed; see [RecordSlice].
+     */
+    fun getResourceSlice(dictId: String, key: String): RecordSlice? =
+        loadedDictionaries.find { it.id == dictId }?.resources?.getSlice(key)
+
     suspend fun getSuggestionsRaw(prefix: String, limitToIds: List<String>? = null): List<Pair<String, String>> = withContext(Dispatchers.IO) {
         val allSuggestions = mutableListOf<Pair<String, String>>()
         val dictsToSearch = if (limitToIds.isNullOrEmpty()) loadedDictionaries.toList() else loadedDictionaries.filter { it.id in limitToIds }
@@ -552,47 +832,132 @@ object DictionaryManager {
         return@withContext allSuggestions
     }
 
+    /** Words spelled with [letters] in each dictionary, see [MdictEngine.getAnagrams]. */
+    suspend fun getAnagramsRaw(letters: String, subAnagram: Boolean, limitToIds: List<String>? = null): List<Pair<String, String>> = withContext(Dispatchers.IO) {
+        val allWords = mutableListOf<Pair<String, String>>()
+        val dictsToSearch = if (limitToIds.isNullOrEmpty()) loadedDictionaries.toList() else loadedDictionaries.filter { it.id in limitToIds }
+
+        dictsToSearch.forEach { dict ->
+            try {
+                dict.mdxEngine?.getAnagrams(letters, subAnagram)?.forEach { word ->
+                    allWords.add(Pair(word, dict.id))
+                }
+            } catch (e: Exception) {
+                e.printStackTrace()
+            }
+        }
+        return@withContext allWords
+    }
+
     private val _searchProgress = MutableStateFlow(0f)
     val searchProgress: StateFlow<Float> = _searchProgress.asStateFlow()
 
-    suspend fun getFullTextSuggestionsRaw(query: String, limitToIds: List<String>? = null): List<Pair<String, String>> = withContext(Dispatchers.IO) {
-        _searchProgress.value = 0f
-        val allSuggestions = mutableListOf<Pair<String, String>>()
+    // Overall cap on definition search results across a collection
+    private const val DEFINITION_SEARCH_LIMIT = 200
+
+    /**
+     * Full-text search. Dictionaries whose term index is built answer ranked
+     * by relevance (see [MdictEngine.searchRanked]), the others are scanned in
+     * dictionary order and their hits follow. Queries using the boolean
+     * syntax (quotes, parentheses, OR, NOT) are always scanned.
+     */
+    suspend fun getFullTextHitsRaw(query: String, limitToIds: List<String>? = null): List<Pair<FullTextHit, String>> =
+        withContext(Dispatchers.IO) {
+            val searched = searchedEngines(limitToIds)
+            val (ranked, scanned) = if (isBooleanQuery(query)) {
+                Pair(emptyList<Pair<String, MdictEngine>>(), searched)
+            } else {
+                searched.partition { it.second.hasTermIndex() }
+            }
+            val rankedHits: List<Pair<FullTextHit, String>> = if (ranked.isEmpty()) emptyList() else try {
+                MdictEngine.searchRanked(ranked.map { it.second }, query, DEFINITION_SEARCH_LIMIT)
+                    .map { (hit, source) -> Pair(hit, ranked[source].first) }
+            } catch (e: Exception) {
+                e.printStackTrace()
+                emptyList()
+            }
+            // The scan only fills what the ranked hits left of the overall cap
+            val remaining = DEFINITION_SEARCH_LIMIT - rankedHits.size
+            if (scanned.isEmpty() || remaining <= 0) {
+                _searchProgress.value = 1f
+                rankedHits
+            } else {
+                rankedHits + scanDefinitions(scanned, query, regex = false, limit = remaining)
+            }
+        }
+
+    private fun isBooleanQuery(query: String): Boolean =
+        query.any { it == '"' || it == '(' || it == '|' } ||
+            query.split(' ').any { it == "AND" || it == "OR" || it == "NOT" || it.startsWith("-") }
+
+    /** Regex search over the definitions, see [MdictEngine.getDefinitionRegexHits]. */
+    suspend fun getDefinitionRegexHitsRaw(pattern: String, limitToIds: List<String>? = null): List<Pair<FullTextHit, String>> =
+        searchDefinitionsRaw(pattern, regex = true, limitToIds = limitToIds)
+
+    private suspend fun searchDefinitionsRaw(
+        query: String,
+        regex: Boolean,
+        limitToIds: List<String>?
+    ): List<Pair<FullTextHit, String>> = scanDefinitions(searchedEngines(limitToIds), query, regex)
+
+    private fun searchedEngines(limitToIds: List<String>?): List<Pair<String, MdictEngine>> {
         val dicts = if (limitToIds.isNullOrEmpty()) loadedDictionaries.toList() else loadedDictionaries.filter { it.id in limitToIds }
-        if (dicts.isEmpty()) return@withContext emptyList()
+        return dicts.mapNotNull { dict -> dict.mdxEngine?.let { engine -> dict.id to engine } }
+    }
 
-        val progressMap = java.util.concurrent.ConcurrentHashMap<String, Float>()
-        
-        // Parallelize search
-        val deferredResults = dicts.map { dict ->
-            async {
-                try {
-                    dict.mdxEngine?.let { engine ->
-                        val listener = object : com.waltermelon.vibedict.data.MdictEngine.ProgressListener {
-                            override fun onProgress(progress: Float) {
-                                progressMap[dict.id] = progress
-                                // Calculate average progress
-                                val totalProgress = progressMap.values.sum() / dicts.size
-                                _searchProgress.value = totalProgress
-                            }
-                        }
-                        val suggestions = engine.getFullTextSuggestions(query, listener)
-                        // Ensure 100% progress for this dict upon completion
-                        progressMap[dict.id] = 1.0f
-                        _searchProgress.value = progressMap.values.sum() / dicts.size
-                        
-                        suggestions.map { word -> Pair(word, dict.id) }
-                    } ?: emptyList()
-                } catch (e: Exception) {
-                    e.printStackTrace()
-                    emptyList<Pair<String, String>>()
-                }
+    private suspend fun scanDefinitions(
+        searched: List<Pair<String, MdictEngine>>,
+        query: String,
+        regex: Boolean,
+        limit: Int = DEFINITION_SEARCH_LIMIT
+    ): List<Pair<FullTextHit, String>> = withContext(Dispatchers.IO) {
+        _searchProgress.value = 0f
+        if (searched.isEmpty()) return@withContext emptyList()
+
+        // One native job over every dictionary: blocks are balanced across a
+        // fixed pool and progress counts the bytes searched
+        val scope = this
+        val listener = object : MdictEngine.ProgressListener {
+            override fun onProgress(progress: Float) {
+                _searchProgress.value = progress
             }
-        }
 
-        deferredResults.awaitAll().flatten()
+            // A superseded search stops scanning instead of running to the end
+            override fun isCancelled(): Boolean = !scope.isActive
+        }
+        try {
+            MdictEngine.searchDefinitions(searched.map { it.second }, query, regex, limit, listener)
+                .map { (hit, source) -> Pair(hit, searched[source].first) }
+        } catch (e: Exception) {
+            e.printStackTrace()
+            emptyList()
+        }
     }
 
+    /**
+     * Checks every block of a dictionary's files for damage, the .mdx then
+     * each .mdd, see [MdictEngine.scrub].
+     * @param onProgress Fraction of the files checked.
+     * @return One report per file that could be scrubbed, in that order;
+     * empty if the dictionary is not loaded.
+     */
+    suspend fun scrubDictionary(dictId: String, onProgress: (Float) -> Unit = {}): List<ScrubReport> =
+        withContext(Dispatchers.IO) {
+            val dict = getDictionaryById(dictId) ?: return@withContext emptyList()
+            val engines = listOfNotNull(dict.mdxEngine) + dict.mddEngines
+            val scope = this
+            engines.mapIndexedNotNull { i, engine ->
+                val listener = object : MdictEngine.ProgressListener {
+                    override fun onProgress(progress: Float) {
+                        onProgress((i + progress) / engines.size)
+                    }
+
+                    override fun isCancelled(): Boolean = !scope.isActive
+                }
+                engine.scrub(listener)
+            }
+        }
+
     fun getDictionaryById(id: String): LoadedDictionary? {
         return loadedDictionaries.find { it.id == id }
     }
@@ -1,6 +1,117 @@
 package com.waltermelon.vibedict.data
 
+import android.os.ParcelFileDescriptor
 import java.io.Closeable
+import java.util.concurrent.locks.ReentrantReadWriteLock
+import kotlin.concurrent.read
+import kotlin.concurrent.write
+
+/**
+ * One full-text match. Built by the native layer (see getFullTextHitsNative),
+ * so the constructor signature must stay in sync with native-lib.cpp.
+ * @param snippet Plain text around the first match in the definition.
+ * @param matchStart Start of the match within [snippet] (String index).
+ * @param matchEnd End (exclusive) of the match within [snippet].
+ * @param score Relevance from [MdictEngine.searchRanked], higher is better;
+ * 0 for hits found in dictionary order.
+ */
+data class FullTextHit(
+    val headword: String,
+    val snippet: String,
+    val matchStart: Int,
+    val matchEnd: Int,
+    val score: Float = 0f
+)
+
+/**
+ * One entry found by [MdictEngine.lookupEntries], before its definition is
+ * fetched. Built by the native layer (see lookupEntriesNative), so the
+ * constructor signature must stay in sync with native-lib.cpp.
+ * @param entry Key list index, for [MdictEngine.getDefinitions].
+ * @param length Definition length in bytes.
+ * @param redirectTarget The headword an @@@LINK= entry points to, null for
+ * a real definition.
+ * @param preview The start of the definition's plain text, empty for
+ * redirects or when no preview was asked for.
+ */
+data class EntryMeta(
+    val entry: Int,
+    val length: Int,
+    val redirectTarget: String?,
+    val preview: String
+) {
+    val isRedirect: Boolean get() = redirectTarget != null
+}
+
+/**
+ * One block [MdictEngine.scrub] found damaged. Built by the native layer
+ * (see scrubNative), so the constructor signature must stay in sync with
+ * native-lib.cpp.
+ * @param keyBlock True for a key block (headwords), false for a record block
+ * (definitions).
+ * @param blockId Index of the block among the file's key or record blocks.
+ * @param firstEntry First entry stored in the block, numbered in file order
+ * (the key list index as long as no key block is damaged).
+ * @param lastEntry One past the last.
+ * @param error What is wrong with the block.
+ */
+data class DamagedBlock(
+    val keyBlock: Boolean,
+    val blockId: Long,
+    val firstEntry: Int,
+    val lastEntry: Int,
+    val error: String
+)
+
+/**
+ * Result of [MdictEngine.scrub].
+ * @param bytes Compressed bytes checked.
+ * @param complete False if the scrub was cancelled before the last block.
+ * @param damaged The damaged blocks, in file order.
+ */
+data class ScrubReport(
+    val keyBlocks: Long,
+    val recordBlocks: Long,
+    val bytes: Long,
+    val complete: Boolean,
+    val damaged: List<DamagedBlock>
+) {
+    // Called from native code (see scrubNative)
+    constructor(keyBlocks: Long, recordBlocks: Long, bytes: Long, complete: Boolean, damaged: Array<DamagedBlock>) :
+        this(keyBlocks, recordBlocks, bytes, complete, damaged.toList())
+
+    val isIntact: Boolean get() = complete && damaged.isEmpty()
+}
+
+/**
+ * A dictionary form found for a conjugated Japanese word.
+ * @param headword The entry to look up.
+ * @param reasons Inflections undone, from the dictionary form outwards
+ * (e.g. "causative", "potential or passive", "past").
+ */
+data class Deinflection(
+    val headword: String,
+    val reasons: List<String>
+) {
+    // Called from native code (see deinflectNative)
+    constructor(headword: String, reasons: Array<String>) : this(headword, reasons.toList())
+}
+
+/**
+ * One piece of text split by [MdictEngine.segment]. Built by the native layer
+ * (see segmentNative), so the constructor signature must stay in sync with
+ * native-lib.cpp.
+ * @param start Start of the piece in the text (String index).
+ * @param end End (exclusive) of the piece.
+ * @param headword The longest key matching the piece, null if no dictionary knows it.
+ * @param source Index of the engine the headword is from, -1 if unknown.
+ */
+data class TextSegment(
+    val start: Int,
+    val end: Int,
+    val headword: String?,
+    val source: Int
+)
 
 class MdictEngine : Closeable {
 
@@ -9,11 +120,170 @@ class MdictEngine : Closeable {
             // This loads the C++ library. The name must match 'add_library' in CMakeLists.txt
             System.loadLibrary("waltermelon-native")
         }
+
+        /** Bitmask passed to [startIndexBuild] to build every optional index. */
+        const val INDEX_ALL = -1
+
+        // Mirrors mdict::IndexBuildState
+        const val INDEX_STATE_IDLE = 0
+        const val INDEX_STATE_RUNNING = 1
+        const val INDEX_STATE_DONE = 2
+        const val INDEX_STATE_CANCELLED = 3
+        const val INDEX_STATE_FAILED = 4
+
+        /**
+         * Searches the definitions of several dictionaries as one job: the
+         * native scheduler spreads their record blocks over a fixed thread
+         * pool, stops at [limit] hits overall and reports progress by bytes
+         * searched. Engines are kept open for the whole search, lookups on
+         * them run meanwhile.
+         * @param regex True to match [query] as a regex, false for a full-text query.
+         * @return Hits paired with the index of their engine in [engines].
+         */
+        @JvmStatic
+        fun searchDefinitions(
+            engines: List<MdictEngine>,
+            query: String,
+            regex: Boolean,
+            limit: Int,
+            listener: ProgressListener? = null
+        ): List<Pair<FullTextHit, Int>> {
+            // Always take the guards in the same order, a close() waiting on one cannot deadlock
+            val ordered = engines.distinct().sortedBy { System.identityHashCode(it) }
+            return whileOpen(ordered, 0) {
+                val handles = LongArray(engines.size) { engines[it].dictionaryHandle }
+                val sources = IntArray(limit.coerceAtLeast(0))
+                val hits = searchDefinitionsNative(handles, query, regex, limit, listener, sources)
+                hits?.mapIndexed { i, hit -> hit to sources[i] } ?: emptyList()
+            }
+        }
+
+        /**
+         * Full-text search ranked by relevance (BM25 over the words of the
+         * definitions, headword matches first) over the engines whose term
+         * index is built, see [hasTermIndex]; the others are skipped. Any
+         * word of [query] may match, query operators are not interpreted.
+         * @return The best [limit] hits over all engines, best first, paired
+         * with the index of their engine in [engines].
+         */
+        @JvmStatic
+        fun searchRanked(engines: List<MdictEngine>, query: String, limit: Int): List<Pair<FullTextHit, Int>> {
+            val ordered = engines.distinct().sortedBy { System.identityHashCode(it) }
+            return whileOpen(ordered, 0) {
+                val handles = LongArray(engines.size) { engines[it].dictionaryHandle }
+                val sources = IntArray(limit.coerceAtLeast(0))
+                val hits = rankedSearchNative(handles, query, limit, sources)
+                hits?.mapIndexed { i, hit -> hit to sources[i] } ?: emptyList()
+            }
+        }
+
+        /**
+         * Adds Han character readings for searching dictionaries from a latin
+         * keyboard ("zhongguo" suggests 中国). Kana, Cyrillic and Greek keys
+         * are romanized without a table. Applies to every engine.
+         * @param table One character per line followed by its readings, e.g. a
+         * Unihan kMandarin extract ("U+4E2D kMandarin zhōng").
+         * @return Number of characters that got a new reading.
+         */
+        @JvmStatic
+        fun addTransliterations(table: ByteArray): Int = addTransliterationsNative(table)
+
+        /**
+         * Splits [text] into the longest keys of several dictionaries, for
+         * pasted sentences and CJK text without spaces. Unknown words are
+         * segments without a headword; separators are left out.
+         */
+        @JvmStatic
+        fun segment(engines: List<MdictEngine>, text: String): List<TextSegment> {
+            val ordered = engines.distinct().sortedBy { System.identityHashCode(it) }
+            return whileOpen(ordered, 0) {
+                val handles = LongArray(engines.size) { engines[it].dictionaryHandle }
+                segmentNative(handles, text)?.toList() ?: emptyList()
+            }
+        }
+
+        /**
+         * Asks each engine's key filter whether [lookup] can find [word]; a
+         * false is certain, a true may be wrong (~0.5%). Engines whose filter
+         * is not built yet answer true, closed ones false.
+         * @return One flag per engine, in [engines] order.
+         */
+        fun mayContain(engines: List<MdictEngine>, word: String): BooleanArray {
+            val ordered = engines.distinct().sortedBy { System.identityHashCode(it) }
+            return whileOpen(ordered, 0) {
+                val handles = LongArray(engines.size) { engines[it].dictionaryHandle }
+                mayContainNative(handles, word) ?: BooleanArray(engines.size) { handles[it] != 0L }
+            }
+        }
+
+        /**
+         * Lists the .mdx and .mdd members of a ZIP archive, for
+         * [loadDictionaryZip]. The descriptor is left open.
+         */
+        fun listZipDictionaries(fd: Int): List<String> =
+            listZipDictionariesNative(fd)?.toList() ?: emptyList()
+
+        /**
+         * Sets the memory shared by all engines for decompressed definition
+         * blocks, half kept as is and the rest LZO-recompressed. 0 turns the
+         * cache off.
+         */
+        @JvmStatic
+        fun setBlockCacheBudget(bytes: Long) = setBlockCacheBudgetNative(bytes)
+
+        // Runs [block] with every engine's lifecycle guard held: the engines
+        // cannot be closed or reloaded meanwhile, but their lookups proceed
+        private fun <T> whileOpen(engines: List<MdictEngine>, from: Int, block: () -> T): T =
+            if (from == engines.size) block() else engines[from].lifecycle.read { whileOpen(engines, from + 1, block) }
+
+        internal fun <T> withLocks(engines: List<MdictEngine>, from: Int, block: () -> T): T =
+            if (from == engines.size) block() else synchronized(engines[from]) { withLocks(engines, from + 1, block) }
+
+        @JvmStatic
+        private external fun searchDefinitionsNative(
+            handles: LongArray,
+            query: String,
+            regex: Boolean,
+            limit: Int,
+            listener: ProgressListener?,
+            sources: IntArray
+        ): Array<FullTextHit>?
+
+        @JvmStatic
+        private external fun rankedSearchNative(
+            handles: LongArray,
+            query: String,
+            limit: Int,
+            sources: IntArray
+        ): Array<FullTextHit>?
+
+        @JvmStatic
+        private external fun addTransliterationsNative(table: ByteArray): Int
+
+        @JvmStatic
+        private external fun segmentNative(handles: LongArray, text: String): Array<TextSegment>?
+
+        @JvmStatic
+        private external fun mayContainNative(handles: LongArray, word: String): BooleanArray?
+
+        @JvmStatic
+        private external fun listZipDictionariesNative(fd: Int): Array<String>?
+
+        @JvmStatic
+        private external fun setBlockCacheBudgetNative(bytes: Long)
     }
 
     // Holds the pointer to the C++ Mdict object
     private var dictionaryHandle: Long = 0
 
+    // Long calls (definition searches, scrubs) hold it shared instead of the
+    // monitor, so lookups are not held up; close and the loads hold it
+    // exclusively, so the native dictionary outlives those calls
+    private val lifecycle = ReentrantReadWriteLock()
+
+    internal val nativeHandle: Long
+        @Synchronized get() = dictionaryHandle
+
     /**
      * Loads a dictionary file (.mdx or .mdd).
      * @param path Absolute file path to the dictionary.
@@ -25,7 +295,7 @@ class MdictEngine : Closeable {
         if (dictionaryHandle != 0L) {
             close()
         }
-        dictionaryHandle = initDictionaryNative(path)
+        lifecycle.write { dictionaryHandle = initDictionaryNative(path) }
         return dictionaryHandle != 0L
     }
 
@@ -41,7 +311,23 @@ class MdictEngine : Closeable {
         }
         // Pass the isMdd flag to native layer so the C++ side can
         // correctly handle MDD (UTF-16 resource DB) files.
-        dictionaryHandle = initDictionaryFdNative(fd, isMdd)
+        lifecycle.write { dictionaryHandle = initDictionaryFdNative(fd, isMdd) }
+        return dictionaryHandle != 0L
+    }
+
+    /**
+     * Loads a dictionary stored inside a ZIP archive without extracting it.
+     * Stored members are read in place; deflated ones are inflated into
+     * [cacheDir] once and reused while the archive is unchanged.
+     * @param fd The archive's file descriptor, owned by the engine from here on.
+     * @param member The member path, as returned by [listZipDictionaries].
+     */
+    @Synchronized
+    fun loadDictionaryZip(fd: Int, member: String, cacheDir: String): Boolean {
+        if (dictionaryHandle != 0L) {
+            close()
+        }
+        lifecycle.write { dictionaryHandle = initDictionaryZipNative(fd, member, cacheDir) }
         return dictionaryHandle != 0L
     }
 
@@ -56,11 +342,33 @@ class MdictEngine : Closeable {
         return lookupNative(dictionaryHandle, word)?.toList() ?: emptyList()
     }
 
+    /**
+     * First phase of a two-phase lookup: the entries [lookup] would return,
+     * in the same order, without their definitions.
+     * @param previewChars Plain text characters of each definition to
+     * include as a preview, 0 for none.
+     */
+    @Synchronized
+    fun lookupEntries(word: String, previewChars: Int = 0): List<EntryMeta> {
+        if (dictionaryHandle == 0L) return emptyList()
+        return lookupEntriesNative(dictionaryHandle, word, previewChars)?.toList() ?: emptyList()
+    }
+
+    /**
+     * Second phase: the definitions of entries found by [lookupEntries].
+     * @return One definition per entry, in order; empty if they cannot be read.
+     */
+    @Synchronized
+    fun getDefinitions(entries: IntArray): List<String> {
+        if (dictionaryHandle == 0L || entries.isEmpty()) return emptyList()
+        return getDefinitionsNative(dictionaryHandle, entries)?.toList() ?: emptyList()
+    }
+
     /**
      * Cleans up C++ memory. Call this when the dictionary is no longer needed.
      */
     @Synchronized
-    override fun close() {
+    override fun close() = lifecycle.write {
         if (dictionaryHandle != 0L) {
             destroyNative(dictionaryHandle)
             dictionaryHandle = 0
@@ -77,16 +385,24 @@ class MdictEngine : Closeable {
     // --- Native JNI Declarations ---
     private external fun initDictionaryNative(path: String): Long
     private external fun initDictionaryFdNative(fd: Int, isMdd: Boolean): Long
+    private external fun initDictionaryZipNative(fd: Int, member: String, cacheDir: String): Long
     private external fun lookupNative(dictHandle: Long, word: String): Array<String>?
+    private external fun lookupEntriesNative(dictHandle: Long, word: String, previewChars: Int): Array<EntryMeta>?
+    private external fun getDefinitionsNative(dictHandle: Long, entries: IntArray): Array<String>?
     private external fun destroyNative(dictHandle: Long)
     private external fun getMatchCountNative(dictHandle: Long, word: String): Int
     private external fun getSuggestionsNative(dictHandle: Long, prefix: String): Array<String>?
     interface ProgressListener {
         fun onProgress(progress: Float)
+
+        /** Polled by definition searches and scrubs, which stop early when it returns true. */
+        fun isCancelled(): Boolean = false
     }
 
     private external fun getRegexSuggestionsNative(dictHandle: Long, regex: String): Array<String>?
-    private external fun getFullTextSuggestionsNative(dictHandle: Long, query: String, listener: ProgressListener?): Array<String>?
+    private external fun getAnagramsNative(dictHandle: Long, letters: String, subAnagram: Boolean): Array<String>?
+    private external fun getFullTextHitsNative(dictHandle: Long, query: String, listener: ProgressListener?, cursor: LongArray?): Array<FullTextHit>?
+    private external fun getDefinitionRegexHitsNative(dictHandle: Long, pattern: String, listener: ProgressListener?, cursor: LongArray?): Array<FullTextHit>?
     
     @Synchronized
     fun getMatchCount(word: String): Int {
@@ -100,10 +416,188 @@ class MdictEngine : Closeable {
         return getRegexSuggestionsNative(dictionaryHandle, regex)?.toList() ?: emptyList()
     }
 
+    /**
+     * Headwords spelled with [letters], for word games; case, accents and
+     * hyphens are ignored.
+     * @param letters The tiles, '?' or '.' stands for any letter.
+     * @param subAnagram False for words using every tile, true for words
+     * using some of them.
+     * @return Longest words first.
+     */
+    @Synchronized
+    fun getAnagrams(letters: String, subAnagram: Boolean = false): List<String> {
+        if (dictionaryHandle == 0L) return emptyList()
+        return getAnagramsNative(dictionaryHandle, letters, subAnagram)?.toList() ?: emptyList()
+    }
+
     @Synchronized
     fun getFullTextSuggestions(query: String, listener: ProgressListener? = null): List<String> {
+        return getFullTextHits(query, listener).map { it.headword }
+    }
+
+    /**
+     * Searches the plain text of the definitions (markup is ignored).
+     * Words must all occur; "quoted text" is a phrase; OR, NOT (or -word) and
+     * parentheses combine terms.
+     * @param cursor Optional paging cursor: cursor[0] is the entry to resume
+     * from (0 to start) and is advanced to where the next page starts, or to
+     * the entry count once the dictionary is exhausted.
+     * @return One page of matching entries, each with a snippet around the match.
+     */
+    @Synchronized
+    fun getFullTextHits(query: String, listener: ProgressListener? = null, cursor: LongArray? = null): List<FullTextHit> {
         if (dictionaryHandle == 0L) return emptyList()
-        val results = getFullTextSuggestionsNative(dictionaryHandle, query, listener)
+        val results = getFullTextHitsNative(dictionaryHandle, query, listener, cursor)
         return results?.toList() ?: emptyList()
     }
-}
\ No newline at end of file
+
+    /**
+     * Matches a regular expression (case-insensitive) against the plain text
+     * of the definitions, in linear time. Paging and cancellation work as in
+     * [getFullTextHits].
+     * @return One page of matching entries; empty if the pattern is invalid.
+     */
+    @Synchronized
+    fun getDefinitionRegexHits(pattern: String, listener: ProgressListener? = null, cursor: LongArray? = null): List<FullTextHit> {
+        if (dictionaryHandle == 0L) return emptyList()
+        val results = getDefinitionRegexHitsNative(dictionaryHandle, pattern, listener, cursor)
+        return results?.toList() ?: emptyList()
+    }
+
+    /**
+     * Points the engine at its per-dictionary index directory and loads the
+     * indexes already built there.
+     */
+    @Synchronized
+    fun setIndexDirectory(dir: String) {
+        if (dictionaryHandle == 0L) return
+        setIndexDirectoryNative(dictionaryHandle, dir)
+    }
+
+    /**
+     * Builds the missing optional indexes on a low-priority native thread.
+     * An interrupted build resumes from its last checkpoint.
+     * @return True if a build was started.
+     */
+    @Synchronized
+    fun startIndexBuild(kinds: Int = INDEX_ALL): Boolean {
+        if (dictionaryHandle == 0L) return false
+        return startIndexBuildNative(dictionaryHandle, kinds)
+    }
+
+    @Synchronized
+    fun cancelIndexBuild() {
+        if (dictionaryHandle == 0L) return
+        cancelIndexBuildNative(dictionaryHandle)
+    }
+
+    @Synchronized
+    fun getIndexBuildState(): Int {
+        if (dictionaryHandle == 0L) return INDEX_STATE_IDLE
+        return getIndexBuildStateNative(dictionaryHandle)
+    }
+
+    @Synchronized
+    fun getIndexBuildProgress(): Float {
+        if (dictionaryHandle == 0L) return 0f
+        return getIndexBuildProgressNative(dictionaryHandle)
+    }
+
+    /** True once the term index is built, so [searchRanked] can search this engine. */
+    @Synchronized
+    fun hasTermIndex(): Boolean {
+        if (dictionaryHandle == 0L) return false
+        return hasTermIndexNative(dictionaryHandle)
+    }
+
+    /**
+     * Reads every block of the dictionary file and checks its sizes and
+     * checksum, on all cores, to find damage (files on SD cards). Once a
+     * scrub finds nothing, later reads skip their checksums; with an index
+     * directory set this is remembered for the unchanged file.
+     * @param listener Progress by bytes checked; cancelling stops the scrub.
+     * Lookups on this engine proceed during the scrub.
+     * @return The report, null if the file cannot be scrubbed (encrypted
+     * records).
+     */
+    fun scrub(listener: ProgressListener? = null): ScrubReport? = lifecycle.read {
+        if (dictionaryHandle == 0L) null else scrubNative(dictionaryHandle, listener)
+    }
+
+    /** True once a scrub found every block of this file intact. */
+    @Synchronized
+    fun isVerified(): Boolean {
+        if (dictionaryHandle == 0L) return false
+        return isVerifiedNative(dictionaryHandle)
+    }
+
+    /**
+     * Reads one entry's record as stored: the resource bytes of an MDD entry.
+     * @param entry Key list index, as returned by [MdictResourceSet].
+     */
+    @Synchronized
+    fun getRecord(entry: Int): ByteArray? {
+        if (dictionaryHandle == 0L) return null
+        return getRecordNative(dictionaryHandle, entry)
+    }
+
+    /**
+     * Locates one entry's record in the file when its record block is stored
+     * uncompressed, for streaming it without a copy.
+     * @param entry Key list index, as returned by [MdictResourceSet].
+     * @return The slice, or null if the record has to be decoded ([getRecord]).
+     */
+    @Synchronized
+    fun getRecordSlice(entry: Int): RecordSlice? {
+        if (dictionaryHandle == 0L) return null
+        val slice = getRecordSliceNative(dictionaryHandle, entry) ?: return null
+        return RecordSlice(ParcelFileDescriptor.adoptFd(slice[0].toInt()), slice[1], slice[2])
+    }
+
+    /**
+     * Uses [stemmer] for [stem]; null removes it.
+     */
+    @Synchronized
+    fun setStemmer(stemmer: AffixStemmer?) {
+        if (dictionaryHandle == 0L) return
+        setStemmerNative(dictionaryHandle, stemmer?.nativeHandle ?: 0L)
+    }
+
+    /**
+     * Base forms of an inflected word ("running" -> "run", "mice" -> "mouse",
+     * "高かった" -> "高い") that this dictionary has entries for. Meant for
+     * lookups that miss. English-style stems need a stemmer ([setStemmer]),
+     * Japanese deinflection is built in.
+     * @return Headwords to look up instead, most likely first.
+     */
+    @Synchronized
+    fun stem(word: String): List<String> {
+        if (dictionaryHandle == 0L) return emptyList()
+        return stemNative(dictionaryHandle, word)?.toList() ?: emptyList()
+    }
+
+    /**
+     * Dictionary forms of a conjugated Japanese word (食べさせられた -> 食べる)
+     * that this dictionary has entries for, with the inflections undone.
+     * [stem] already includes these headwords.
+     */
+    @Synchronized
+    fun deinflect(word: String): List<Deinflection> {
+        if (dictionaryHandle == 0L) return emptyList()
+        return deinflectNative(dictionaryHandle, word)?.toList() ?: emptyList()
+    }
+
+    private external fun setIndexDirectoryNative(dictHandle: Long, dir: String)
+    private external fun startIndexBuildNative(dictHandle: Long, kinds: Int): Boolean
+    private external fun cancelIndexBuildNative(dictHandle: Long)
+    private external fun getIndexBuildStateNative(dictHandle: Long): Int
+    private external fun getIndexBuildProgressNative(dictHandle: Long): Float
+    private external fun hasTermIndexNative(dictHandle: Long): Boolean
+    private external fun scrubNative(dictHandle: Long, listener: ProgressListener?): ScrubReport?
+    private external fun isVerifiedNative(dictHandle: Long): Boolean
+    private external fun getRecordNative(dictHandle: Long, entry: Int): ByteArray?
+    private external fun getRecordSliceNative(dictHandle: Long, entry: Int): LongArray?
+    private external fun setStemmerNative(dictHandle: Long, stemmerHandle: Long)
+    private external fun stemNative(dictHandle: Long, word: String): Array<String>?
+    private external fun deinflectNative(dictHandle: Long, word: String): Array<Deinflection>?
+}
@@ -0,0 +1,82 @@
+package com.waltermelon.vibedict.data
+
+import java.io.Closeable
+
+/**
+ * The resources of a multi-volume MDD set (name.mdd, name.1.mdd, ...) in one
+ * native hash table of normalized paths, so [get] probes once instead of
+ * asking every volume for every spelling of the path. Paths are compared
+ * with '/' and '\' alike, without leading separators and ignoring ASCII
+ * case; a miss falls back to the file name. Earlier volumes win.
+ *
+ * The set does not own the volumes; close it before closing them.
+ */
+class MdictResourceSet private constructor(
+    private val volumes: List<MdictEngine>,
+    private var handle: Long
+) : Closeable {
+
+    companion object {
+        init {
+            System.loadLibrary("waltermelon-native")
+        }
+
+        /**
+         * @param volumes Loaded MDD engines, in volume order.
+         * @return The set, or null if a volume is closed.
+         */
+        fun create(volumes: List<MdictEngine>): MdictResourceSet? {
+            val ordered = volumes.distinct().sortedBy { System.identityHashCode(it) }
+            val handle = MdictEngine.withLocks(ordered, 0) {
+                createNative(LongArray(volumes.size) { volumes[it].nativeHandle })
+            }
+            return if (handle != 0L) MdictResourceSet(volumes, handle) else null
+        }
+
+        @JvmStatic
+        private external fun createNative(handles: LongArray): Long
+
+        @JvmStatic
+        private external fun destroyNative(setHandle: Long)
+
+        @JvmStatic
+        private external fun findNative(setHandle: Long, path: String): Long
+    }
+
+    /**
+     * @param path Resource path as referenced by a definition, e.g. "img/a.png".
+     * @return The resource bytes, or null if no volume has it.
+     */
+    fun get(path: String): ByteArray? {
+        val location = synchronized(this) {
+            if (handle == 0L) return null
+            findNative(handle, path)
+        }
+        if (location < 0) return null
+        val volume = (location ushr 32).toInt()
+        return volumes.getOrNull(volume)?.getRecord(location.toInt())
+    }
+
+    /**
+     * @param path Resource path as referenced by a definition.
+     * @return The resource as a file slice, or null if no volume has it or
+     * its block is compressed (use [get] then).
+     */
+    fun getSlice(path: String): RecordSlice? {
+        val location = synchronized(this) {
+            if (handle == 0L) return null
+            findNative(handle, path)
+        }
+        if (location < 0) return null
+        val volume = (location ushr 32).toInt()
+        return volumes.getOrNull(volume)?.getRecordSlice(location.toInt())
+    }
+
+    @Synchronized
+    override fun close() {
+        if (handle != 0L) {
+            destroyNative(handle)
+            handle = 0
+        }
+    }
+}
@@ -0,0 +1,56 @@
+package com.waltermelon.vibedict.data
+
+import android.os.ParcelFileDescriptor
+import android.system.Os
+import java.io.Closeable
+import java.io.InputStream
+
+/**
+ * A record kept uncompressed in its dictionary file: [length] bytes at
+ * [offset] of [fd]. Large MDD audio and video can be streamed or handed to a
+ * player from here without being copied into the heap.
+ *
+ * The slice owns its descriptor (a duplicate of the engine's), so it stays
+ * valid after the engine closes; close it, or the stream it opened.
+ */
+class RecordSlice(
+    val fd: ParcelFileDescriptor,
+    val offset: Long,
+    val length: Long
+) : Closeable {
+
+    /**
+     * Streams the slice with positional reads, so several slices of the same
+     * file can be read at once. Closing the stream closes the slice.
+     */
+    fun inputStream(): InputStream = object : InputStream() {
+        private var position = 0L
+
+        override fun read(): Int {
+            val one = ByteArray(1)
+            return if (read(one, 0, 1) == 1) one[0].toInt() and 0xff else -1
+        }
+
+        override fun read(b: ByteArray, off: Int, len: Int): Int {
+            if (len == 0) return 0
+            val left = length - position
+            if (left <= 0) return -1
+            val n = Os.pread(fd.fileDescriptor, b, off, minOf(len.toLong(), left).toInt(), offset + position)
+            if (n <= 0) return -1
+            position += n
+            return n
+        }
+
+        override fun skip(n: Long): Long {
+            val skipped = n.coerceIn(0, length - position)
+            position += skipped
+            return skipped
+        }
+
+        override fun available(): Int = (length - position).coerceAtMost(Int.MAX_VALUE.toLong()).toInt()
+
+        override fun close() = this@RecordSlice.close()
+    }
+
+    override fun close() = fd.close()
+}
@@ -32,7 +32,11 @@ import androidx.compose.ui.focus.focusRequester
 import androidx.compose.ui.graphics.Color
 import androidx.compose.ui.platform.LocalSoftwareKeyboardController
 import androidx.compose.ui.res.stringResource
+import androidx.compose.ui.text.SpanStyle
+import androidx.compose.ui.text.buildAnnotatedString
+import androidx.compose.ui.text.font.FontWeight
 import androidx.compose.ui.text.input.ImeAction
+import androidx.compose.ui.text.style.TextOverflow
 import androidx.compose.ui.unit.dp
 import com.waltermelon.vibedict.R
 import androidx.lifecycle.Lifecycle
@@ -372,6 +376,29 @@ fun SuggestionList(
                 Column(modifier = Modifier.weight(1f)) {
                     Text(suggestion.word, style = MaterialTheme.typography.titleLarge)
 
+                    // Full-text matches show where the query was found
+                    suggestion.snippet?.let { hit ->
+                        val highlight = SpanStyle(
+                            color = MaterialTheme.colorScheme.primary,
+                            fontWeight = FontWeight.Bold
+                        )
+                        val snippetText = remember(hit, highlight) {
+                            buildAnnotatedString {
+                                append(hit.snippet)
+                                val start = hit.matchStart.coerceIn(0, hit.snippet.length)
+                                val end = hit.matchEnd.coerceIn(start, hit.snippet.length)
+                                addStyle(highlight, start, end)
+                            }
+                        }
+                        Text(
+                            text = snippetText,
+                            style = MaterialTheme.typography.bodySmall,
+                            color = MaterialTheme.colorScheme.onSurfaceVariant,
+                            maxLines = 2,
+                            overflow = TextOverflow.Ellipsis
+                        )
+                    }
+
                     // --- NEW: FlowRow for dictionary "pills" ---
                     Spacer(modifier = Modifier.height(4.dp))
                     FlowRow(
@@ -6,6 +6,7 @@ import androidx.lifecycle.viewModelScope
 import com.waltermelon.vibedict.data.DictionaryManager
 import com.waltermelon.vibedict.data.UserPreferencesRepository
 import com.waltermelon.vibedict.data.DictCollection
+import com.waltermelon.vibedict.data.FullTextHit
 import kotlinx.coroutines.FlowPreview
 import kotlinx.coroutines.Job
 import kotlinx.coroutines.delay
@@ -13,7 +14,12 @@ import kotlinx.coroutines.flow.*
 import kotlinx.coroutines.launch
 
 // Data model for merged results
-data class MergedSearchResult(val word: String, val sources: List<String>)
+// snippet: plain-text context of a full-text match (first dictionary that matched)
+data class MergedSearchResult(
+    val word: String,
+    val sources: List<String>,
+    val snippet: FullTextHit? = null
+)
 
 @OptIn(FlowPreview::class)
 class SearchViewModel(private val repository: UserPreferencesRepository) : ViewModel() {
@@ -133,10 +139,19 @@ class SearchViewModel(private val repository: UserPreferencesRepository) : ViewM
             val filterIds = collection?.dictionaryIds
 
             // 2. Perform Suggestion Lookup
-            val rawSuggestions = if (isRegex) {
+            var snippets: Map<String, FullTextHit> = emptyMap()
+            val rawSuggestions = if (isFullText) {
+                // Regex and full-text together search the definitions with the regex
+                val hits = if (isRegex) {
+                    DictionaryManager.getDefinitionRegexHitsRaw(effectiveQuery, filterIds)
+                } else {
+                    DictionaryManager.getFullTextHitsRaw(effectiveQuery, filterIds)
+                }
+                // Keep the first snippet per headword (the best one for ranked hits)
+                snippets = hits.reversed().associate { (hit, _) -> hit.headword to hit }
+                hits.map { (hit, dictId) -> Pair(hit.headword, dictId) }
+            } else if (isRegex) {
                 DictionaryManager.getRegexSuggestionsRaw(effectiveQuery, filterIds)
-            } else if (isFullText) {
-                DictionaryManager.getFullTextSuggestionsRaw(effectiveQuery, filterIds)
             } else {
                 DictionaryManager.getSuggestionsRaw(effectiveQuery, filterIds)
             }
@@ -171,13 +186,14 @@ class SearchViewModel(private val repository: UserPreferencesRepository) : ViewM
                     }
                 }.distinct()
 
-                MergedSearchResult(word, displayNames)
+                MergedSearchResult(word, displayNames, snippets[word])
             }
 
             var results = finalResults
             if (isFullText) {
-                // Sorting logic: Exact Match > Prefix Match > Frequency > Shortest > Alphabetical
-                results = finalResults.sortedWith(compareBy<MergedSearchResult> { 
+                // Sorting logic: Relevance (ranked dictionaries) > Exact Match > Prefix Match > Frequency > Shortest > Alphabetical
+                results = finalResults.sortedWith(compareByDescending<MergedSearchResult> { it.snippet?.score ?: 0f }
+                .thenBy {
                     val word = it.word
                     // Use effectiveQuery which contains the actual query string
                     val q = effectiveQuery
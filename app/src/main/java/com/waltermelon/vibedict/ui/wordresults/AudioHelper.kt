@@ -2,6 +2,8 @@ package com.waltermelon.vibedict.ui.wordresults
 
 import android.content.Context
 import android.media.MediaPlayer
+import android.system.Os
+import com.waltermelon.vibedict.data.RecordSlice
 import java.io.File
 import java.io.FileOutputStream
 
@@ -23,6 +25,37 @@ fun playSound(context: Context, data: ByteArray) {
     playRawAudio(context, data, "mp3")
 }
 
+/**
+ * Plays audio stored uncompressed in an MDD straight from the file. Ogg
+ * (and Speex) need the bytes and take the copying path.
+ */
+fun playSound(context: Context, slice: RecordSlice) {
+    var mp: MediaPlayer? = null
+    try {
+        val head = ByteArray(4)
+        val headLength = Os.pread(slice.fd.fileDescriptor, head, 0, minOf(4L, slice.length).toInt(), slice.offset)
+        if (headLength == 4 && isOgg(head)) {
+            val data = slice.inputStream().use { it.readBytes() }
+            playSound(context, data)
+            return
+        }
+
+        mp = MediaPlayer()
+        mp.setDataSource(slice.fd.fileDescriptor, slice.offset, slice.length)
+        mp.prepare()
+        mp.start()
+
+        mp.setOnCompletionListener {
+            it.release()
+            slice.close()
+        }
+    } catch (e: Exception) {
+        e.printStackTrace()
+        mp?.release()
+        slice.close()
+    }
+}
+
 fun isOgg(data: ByteArray): Boolean {
     // Check for OggS header (0x4F 0x67 0x67 0x53)
     return data.size >= 4 && data[0] == 0x4F.toByte() && data[1] == 0x67.toByte() && data[2] == 0x67.toByte() && data[3] == 0x53.toByte()
@@ -42,11 +42,13 @@ import androidx.compose.ui.graphics.Color
 import androidx.compose.ui.graphics.luminance
 import androidx.compose.ui.text.font.FontWeight
 import androidx.compose.ui.text.input.ImeAction
+import androidx.compose.ui.text.style.TextOverflow
 import androidx.compose.ui.unit.dp
 import androidx.compose.ui.viewinterop.AndroidView
 import androidx.navigation.NavController
 import com.waltermelon.vibedict.ui.theme.Screen
 import com.waltermelon.vibedict.data.DictionaryManager
+import com.waltermelon.vibedict.data.EntryMeta
 import androidx.compose.ui.res.stringResource
 import com.waltermelon.vibedict.R
 import kotlinx.coroutines.launch
@@ -67,8 +69,13 @@ data class FindNavEvent(val forward: Boolean, val timestamp: Long = System.curre
     val isExpandedByDefault: Boolean,
     val forceOriginalStyle: Boolean,
     val customFontPaths: String = "",
-    val isLoading: Boolean = false // --- NEW: Individual Loading State ---
-)
+    val isLoading: Boolean = false, // --- NEW: Individual Loading State ---
+    // Entries found by a two-phase lookup whose definitions are not fetched
+    // yet, see DefViewModel.loadBodies
+    val pending: List<EntryMeta> = emptyList()
+) {
+    val entryCount: Int get() = if (entries.isEmpty()) pending.size else entries.size
+}
 
 @OptIn(ExperimentalMaterial3Api::class, ExperimentalFoundationApi::class)
 @Composable
@@ -250,7 +257,7 @@ fun DefScreen(
                                 isExpanded = isExpanded,
                                 onToggle = { expandedStates[stickyEntry.dictionaryName] = !isExpanded },
                                 isLoading = stickyEntry.isLoading,
-                                entryCount = stickyEntry.entries.size,
+                                entryCount = stickyEntry.entryCount,
                                 selectedIndex = selectedIndex,
                                 onSelectEntry = { newIndex -> selectedIndices[stickyEntry.id] = newIndex }
                             )
@@ -285,12 +292,18 @@ fun DefScreen(
                                             isExpanded = isExpanded,
                                             onToggle = { expandedStates[entry.dictionaryName] = !isExpanded },
                                             isLoading = entry.isLoading,
-                                            entryCount = entry.entries.size,
+                                            entryCount = entry.entryCount,
                                             selectedIndex = selectedIndex,
-                                            onSelectEntry = { newIndex -> selectedIndices[entry.id] = newIndex }
+                                            onSelectEntry = { newIndex -> selectedIndices[entry.id] = newIndex },
+                                            preview = entry.pending.firstOrNull()?.preview.orEmpty()
                                         )
                                     }
 
+                                    // Fetch the definitions of a two-phase section once it is opened
+                                    if (isExpanded && entry.pending.isNotEmpty()) {
+                                        LaunchedEffect(entry.id) { viewModel.loadBodies(entry.id) }
+                                    }
+
                                     // --- NEW: Observe live font paths to handle updates immediately ---
                                     val dynamicFontPaths by viewModel.getFontPaths(entry.id).collectAsState(initial = entry.customFontPaths)
 
@@ -311,7 +324,7 @@ fun DefScreen(
                                         forceOriginalStyle = entry.forceOriginalStyle,
                                         customFontPaths = dynamicFontPaths, // --- CHANGED to live flow ---
                                         findNavEvent = findNavEvent,
-                                        isLoading = entry.isLoading,
+                                        isLoading = entry.isLoading || entry.pending.isNotEmpty(),
                                         displayScale = displayScale // --- NEW ---
                                     )
                                 }
@@ -394,6 +407,8 @@ fun DictionaryHeaderItem(
     entryCount: Int = 1,
     selectedIndex: Int = 0,
     onSelectEntry: (Int) -> Unit = {},
+    // Start of the first definition, shown while the section is collapsed
+    preview: String = "",
     onToggle: () -> Unit
 ) {
     Surface(
@@ -425,6 +440,17 @@ fun DictionaryHeaderItem(
                 )
             }
             
+            if (preview.isNotEmpty() && !isExpanded) {
+                Text(
+                    text = preview,
+                    style = MaterialTheme.typography.bodySmall,
+                    color = MaterialTheme.colorScheme.onSurfaceVariant,
+                    maxLines = 2,
+                    overflow = TextOverflow.Ellipsis,
+                    modifier = Modifier.padding(start = 16.dp, end = 16.dp, bottom = 12.dp)
+                )
+            }
+
             // --- ENTRY SELECTION PILLS ---
             if (entryCount > 1 && isExpanded) {
                 FlowRow(
@@ -592,11 +618,11 @@ fun DictionaryBodyItem(
                                         try {
                                             val decodedKey = java.net.URLDecoder.decode(resourceKey, "UTF-8")
                                             // --- FIX: Use Scoped Lookup ---
-                                            val resourceData = DictionaryManager.getResource(dictId, decodedKey)
+                                            val resourceData = DictionaryManager.openResource(dictId, decodedKey)
                                             // ------------------------------
                                             if (resourceData != null) {
                                                 val mimeType = getMimeType(decodedKey)
-                                                return WebResourceResponse(mimeType, null, ByteArrayInputStream(resourceData))
+                                                return WebResourceResponse(mimeType, null, resourceData)
                                             }
                                         } catch (e: Exception) {
                                             e.printStackTrace()
@@ -627,7 +653,16 @@ fun DictionaryBodyItem(
 
                                         coroutineScope.launch(kotlinx.coroutines.Dispatchers.IO) {
                                             // --- FIX: Use Scoped Lookup for Sound too ---
-                                            val audioData = DictionaryManager.getResource(dictId, java.net.URLDecoder.decode(resourceKey, "UTF-8"))
+                                            val decodedKey = java.net.URLDecoder.decode(resourceKey, "UTF-8")
+                                            // Uncompressed audio plays straight from the MDD
+                                            val audioSlice = DictionaryManager.getResourceSlice(dictId, decodedKey)
+                                            if (audioSlice != null) {
+                                                kotlinx.coroutines.withContext(kotlinx.coroutines.Dispatchers.Main) {
+                                                    playSound(ctx, audioSlice)
+                                                }
+                                                return@launch
+                                            }
+                                            val audioData = DictionaryManager.getResource(dictId, decodedKey)
                                             if (audioData != null) {
                                                 kotlinx.coroutines.withContext(kotlinx.coroutines.Dispatchers.Main) {
                                                     playSound(ctx, audioData)
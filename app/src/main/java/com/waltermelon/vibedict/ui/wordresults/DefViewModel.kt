@@ -77,18 +77,27 @@ class DefViewModel(
             val allLoadedDicts = DictionaryManager.loadedDictionaries
             
             // Determine which dictionaries to show
-            val targetDicts = if (filterIds.isNullOrEmpty()) {
+            val collectionDicts = if (filterIds.isNullOrEmpty()) {
                 allLoadedDicts
             } else {
                 // Filter and order based on collection
                 filterIds.mapNotNull { id -> allLoadedDicts.find { it.id == id } }
             }
 
-            if (targetDicts.isEmpty()) {
+            if (collectionDicts.isEmpty()) {
                  _uiState.value = DefUiState.Empty
                  return@launch
             }
 
+            // Skip the dictionaries whose key filter rules the word out, so
+            // only real candidates get a placeholder
+            val targetDicts = DictionaryManager.mayContain(collectionDicts, query)
+            if (targetDicts.isEmpty()) {
+                Log.e("MdictJNI", "!!! DefViewModel: Query '$query' ruled out by every key filter.")
+                fallBack(query)
+                return@launch
+            }
+
             // 2. Initialize UI State with Loading Placeholders
             val initialEntries = targetDicts.map { dict ->
                  DictionaryEntry(
@@ -128,8 +137,11 @@ class DefViewModel(
                     val finalJs = if (customJs.isNotBlank()) customJs else fileJs
                     val finalName = if (customName.isNotBlank()) customName else entry.dictionaryName
 
-                    // Perform Lookup
-                    val content = DictionaryManager.lookup(entry.id, query)
+                    // Perform Lookup: a collapsed MDX section only gets its
+                    // entry list, loadBodies fetches the definitions once it
+                    // is expanded
+                    val pending = if (isExpanded) null else DictionaryManager.lookupEntries(entry.id, query)
+                    val content = if (pending != null) null else DictionaryManager.lookup(entry.id, query)
                     
                     // Update State
                     _resultsMutex.lock()
@@ -140,37 +152,20 @@ class DefViewModel(
                             val index = currentList.indexOfFirst { it.id == entry.id }
                             
                             if (index != -1) {
-                                if (!content.isNullOrEmpty()) {
-                                    // --- Check for Internal Resources ---
-                                    var hasInternalCss = false
-                                    var hasInternalJs = false
-
-                                    try {
-                                        // Check all entries for resource references
-                                        content.forEach { str ->
-                                            val cssLinks = Regex("""<link[^>]+href=["'](.*?)["']""", RegexOption.IGNORE_CASE).findAll(str).map { it.groupValues[1] }.toList()
-                                            val jsLinks = Regex("""<script[^>]+src=["'](.*?)["']""", RegexOption.IGNORE_CASE).findAll(str).map { it.groupValues[1] }.toList()
-
-                                            if (!hasInternalCss) {
-                                                hasInternalCss = cssLinks.any { path -> 
-                                                    val decoded = java.net.URLDecoder.decode(path, "UTF-8")
-                                                    DictionaryManager.getResource(entry.id, decoded) != null 
-                                                }
-                                            }
-                                            if (!hasInternalJs) {
-                                                hasInternalJs = jsLinks.any { path -> 
-                                                    val decoded = java.net.URLDecoder.decode(path, "UTF-8")
-                                                    DictionaryManager.getResource(entry.id, decoded) != null 
-                                                }
-                                            }
-                                        }
-                                    } catch (e: Exception) {
-                                        e.printStackTrace()
-                                    }
-
-                                    val resolvedCss = if (customCss.isNotBlank()) customCss else if (hasInternalCss) "" else fileCss
-                                    val resolvedJs = if (customJs.isNotBlank()) customJs else if (hasInternalJs) "" else fileJs
-                                    // ------------------------------------
+                                if (!pending.isNullOrEmpty()) {
+                                    currentList[index] = currentList[index].copy(
+                                        dictionaryName = finalName,
+                                        pending = pending,
+                                        customCss = finalCss,
+                                        customJs = finalJs,
+                                        isExpandedByDefault = isExpanded,
+                                        forceOriginalStyle = forceOriginal,
+                                        customFontPaths = customFontPaths,
+                                        isLoading = false
+                                    )
+                                    foundAny = true
+                                } else if (!content.isNullOrEmpty()) {
+                                    val (resolvedCss, resolvedJs) = resolveStyles(entry.id, content, customCss, customJs, fileCss, fileJs)
 
                                     currentList[index] = currentList[index].copy(
                                         dictionaryName = finalName,
@@ -200,24 +195,8 @@ class DefViewModel(
                         completedCount++
                         if (completedCount == total) {
                             if (!foundAny) {
-                                // --- FALLBACK LOGIC ---
                                 Log.e("MdictJNI", "!!! DefViewModel: Query '$query' empty. Attempting fallback...")
-                                val baseWord = query.split(" ").firstOrNull()
-
-                                if (baseWord != null && baseWord != query) {
-                                    // Check baseWord
-                                    val baseResults = DictionaryManager.lookupAll(baseWord) 
-                                    
-                                    if (baseResults.isNotEmpty()) {
-                                        Log.e("MdictJNI", "!!! DefViewModel: Fallback SUCCESS. Found '$baseWord'. Triggering nav.")
-                                        _navigateToWord.value = baseWord
-                                        _uiState.value = DefUiState.Empty
-                                    } else {
-                                        _uiState.value = DefUiState.Empty
-                                    }
-                                } else {
-                                    _uiState.value = DefUiState.Empty
-                                }
+                                fallBack(query)
                             } else {
                                 repository.addToHistory(query)
                             }
@@ -229,6 +208,111 @@ class DefViewModel(
             }
         }
     }
+
+    // Sections whose definitions were requested by loadBodies
+    private val bodyRequests = mutableSetOf<String>()
+
+    /**
+     * Fetches the definitions of a section that only has its entry list
+     * (see [DictionaryEntry.pending]), once it is expanded.
+     */
+    fun loadBodies(dictId: String) {
+        val results = (_uiState.value as? DefUiState.Success)?.results ?: return
+        val pending = results.find { it.id == dictId }?.pending
+        if (pending.isNullOrEmpty() || !bodyRequests.add(dictId)) return
+
+        viewModelScope.launch {
+            val content = DictionaryManager.loadDefinitions(dictId, pending)
+            val customCss = repository.getDictionaryCss(dictId).first()
+            val customJs = repository.getDictionaryJs(dictId).first()
+            val dictObj = DictionaryManager.getDictionaryById(dictId)
+            val (resolvedCss, resolvedJs) = resolveStyles(
+                dictId, content, customCss, customJs,
+                dictObj?.defaultCssContent ?: "", dictObj?.defaultJsContent ?: ""
+            )
+
+            _resultsMutex.lock()
+            try {
+                val currentState = _uiState.value
+                if (currentState is DefUiState.Success) {
+                    _uiState.value = DefUiState.Success(currentState.results.map {
+                        if (it.id == dictId) {
+                            it.copy(entries = content, pending = emptyList(), customCss = resolvedCss, customJs = resolvedJs)
+                        } else {
+                            it
+                        }
+                    })
+                }
+            } finally {
+                _resultsMutex.unlock()
+            }
+        }
+    }
+
+    /**
+     * The CSS and JS to inject around [content]: the user's own if set,
+     * nothing if the definitions link the dictionary's stylesheets and
+     * scripts themselves, else the ones shipped next to the dictionary.
+     */
+    private fun resolveStyles(
+        dictId: String,
+        content: List<String>,
+        customCss: String,
+        customJs: String,
+        fileCss: String,
+        fileJs: String
+    ): Pair<String, String> {
+        // --- Check for Internal Resources ---
+        var hasInternalCss = false
+        var hasInternalJs = false
+
+        try {
+            // Check all entries for resource references
+            content.forEach { str ->
+                val cssLinks = Regex("""<link[^>]+href=["'](.*?)["']""", RegexOption.IGNORE_CASE).findAll(str).map { it.groupValues[1] }.toList()
+                val jsLinks = Regex("""<script[^>]+src=["'](.*?)["']""", RegexOption.IGNORE_CASE).findAll(str).map { it.groupValues[1] }.toList()
+
+                if (!hasInternalCss) {
+                    hasInternalCss = cssLinks.any { path ->
+                        val decoded = java.net.URLDecoder.decode(path, "UTF-8")
+                        DictionaryManager.getResource(dictId, decoded) != null
+                    }
+                }
+                if (!hasInternalJs) {
+                    hasInternalJs = jsLinks.any { path ->
+                        val decoded = java.net.URLDecoder.decode(path, "UTF-8")
+                        DictionaryManager.getResource(dictId, decoded) != null
+                    }
+                }
+            }
+        } catch (e: Exception) {
+            e.printStackTrace()
+        }
+
+        val resolvedCss = if (customCss.isNotBlank()) customCss else if (hasInternalCss) "" else fileCss
+        val resolvedJs = if (customJs.isNotBlank()) customJs else if (hasInternalJs) "" else fileJs
+        return resolvedCss to resolvedJs
+    }
+
+    // --- FALLBACK LOGIC ---
+    private suspend fun fallBack(query: String) {
+        // Inflected forms first (running -> run, 食べた -> 食べる),
+        // the stems come back already checked against the keys,
+        // then the first known word of a phrase or CJK text
+        val baseWord = DictionaryManager.stem(query).firstOrNull { it != query }
+            ?: DictionaryManager.segment(query).firstNotNullOfOrNull { it.headword }
+
+        if (baseWord != null && baseWord != query) {
+            // Check baseWord
+            val baseResults = DictionaryManager.lookupAll(baseWord)
+
+            if (baseResults.isNotEmpty()) {
+                Log.e("MdictJNI", "!!! DefViewModel: Fallback SUCCESS. Found '$baseWord'. Triggering nav.")
+                _navigateToWord.value = baseWord
+            }
+        }
+        _uiState.value = DefUiState.Empty
+    }
 }
 
 sealed class DefUiState {